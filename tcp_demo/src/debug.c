@@ -25,12 +25,69 @@
  **/
 
 //Dependencies
+#include <stdarg.h>
 #include "stm32f4xx.h"
 #include "debug.h"
 
 //Function declaration
 void lcdPutChar(char_t c);
 
+#if (TRACE_ASYNC_SUPPORT == ENABLED)
+
+//Interrupt priority grouping
+#ifndef TRACE_ASYNC_IRQ_PRIORITY_GROUPING
+   #define TRACE_ASYNC_IRQ_PRIORITY_GROUPING 3
+#elif (TRACE_ASYNC_IRQ_PRIORITY_GROUPING < 0)
+   #error TRACE_ASYNC_IRQ_PRIORITY_GROUPING parameter is not valid
+#endif
+
+//DMA interrupt group priority
+#ifndef TRACE_ASYNC_IRQ_GROUP_PRIORITY
+   #define TRACE_ASYNC_IRQ_GROUP_PRIORITY 14
+#elif (TRACE_ASYNC_IRQ_GROUP_PRIORITY < 0)
+   #error TRACE_ASYNC_IRQ_GROUP_PRIORITY parameter is not valid
+#endif
+
+//DMA interrupt subpriority
+#ifndef TRACE_ASYNC_IRQ_SUB_PRIORITY
+   #define TRACE_ASYNC_IRQ_SUB_PRIORITY 0
+#elif (TRACE_ASYNC_IRQ_SUB_PRIORITY < 0)
+   #error TRACE_ASYNC_IRQ_SUB_PRIORITY parameter is not valid
+#endif
+
+//Trace ring buffer
+static uint8_t debugTxBuffer[TRACE_ASYNC_BUFFER_SIZE];
+//Free-running index of the next byte to reserve
+static uint_t debugTxReserveIndex;
+//Free-running index up to which the ring buffer holds complete messages
+static volatile uint_t debugTxWriteIndex;
+//Free-running read index (updated by the drain task only)
+static volatile uint_t debugTxReadIndex;
+//Number of producers still copying a message into the ring buffer
+static uint_t debugTxPendingCount;
+//Number of characters discarded because the ring buffer was full
+static uint32_t debugTxDropCount;
+//Number of discarded characters already reported in the trace output
+static uint32_t debugTxDropReported;
+//The drain task waits for new trace output
+static volatile bool_t debugTxIdle;
+//Event signaled when trace output is published while the drain task is idle
+static OsEvent debugTxEvent;
+//Event signaled by the DMA transfer complete interrupt
+static OsEvent debugDmaEvent;
+
+//Truncation marker
+#define TRACE_ASYNC_MARKER "\r\n[%" PRIu32 " chars dropped]\r\n"
+//Length of the truncation marker, excluding the number of characters
+#define TRACE_ASYNC_MARKER_LEN 20
+//Maximum length of the truncation marker
+#define TRACE_ASYNC_MARKER_MAX_LEN (TRACE_ASYNC_MARKER_LEN + 10)
+
+//Trace drain task
+void debugTask(void *param);
+
+#endif
+
 
 /**
  * @brief Debug UART initialization
@@ -70,8 +127,318 @@ void debugInit(uint32_t baudrate)
 
    //Enable USART6
    USART_Cmd(USART6, ENABLE);
+
+#if (TRACE_ASYNC_SUPPORT == ENABLED)
+   //Enable DMA2 clock
+   RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA2, ENABLE);
+
+   //USART6_TX requests are routed to DMA2 stream 6 (channel 5)
+   DMA_DeInit(DMA2_Stream6);
+   //Let USART6 issue a DMA request whenever its transmit register is empty
+   USART_DMACmd(USART6, USART_DMAReq_Tx, ENABLE);
+
+   //Flush the trace ring buffer
+   debugTxReserveIndex = 0;
+   debugTxWriteIndex = 0;
+   debugTxReadIndex = 0;
+   debugTxPendingCount = 0;
+   debugTxDropCount = 0;
+   debugTxDropReported = 0;
+   debugTxIdle = FALSE;
+
+   //Create the events used to wake up the drain task
+   osCreateEvent(&debugTxEvent);
+   osCreateEvent(&debugDmaEvent);
+
+   //Set priority grouping (4 bits for pre-emption priority, no bits for subpriority)
+   NVIC_SetPriorityGrouping(TRACE_ASYNC_IRQ_PRIORITY_GROUPING);
+
+   //Configure DMA2 stream 6 interrupt priority
+   NVIC_SetPriority(DMA2_Stream6_IRQn, NVIC_EncodePriority(TRACE_ASYNC_IRQ_PRIORITY_GROUPING,
+      TRACE_ASYNC_IRQ_GROUP_PRIORITY, TRACE_ASYNC_IRQ_SUB_PRIORITY));
+
+   //Enable DMA2 stream 6 interrupt
+   NVIC_EnableIRQ(DMA2_Stream6_IRQn);
+
+   //Create a low-priority task that drains the ring buffer
+   osCreateTask("Trace", debugTask, NULL,
+      TRACE_ASYNC_TASK_STACK_SIZE, TRACE_ASYNC_TASK_PRIORITY);
+#endif
+}
+
+
+#if (TRACE_ASYNC_SUPPORT == ENABLED)
+
+/**
+ * @brief Trace drain task
+ *
+ * Messages queued by debugWrite() are sent over USART6 using DMA, one
+ * contiguous region of the ring buffer at a time. The task sleeps until
+ * the DMA transfer complete interrupt fires, and until a producer
+ * publishes new output when the ring buffer is empty
+ *
+ * @param[in] param Unused parameter
+ **/
+
+void debugTask(void *param)
+{
+   uint_t n;
+   uint_t offset;
+   DMA_InitTypeDef DMA_InitStructure;
+
+   //Process pending trace output
+   while(1)
+   {
+      //Number of characters waiting in the ring buffer
+      n = debugTxWriteIndex - debugTxReadIndex;
+
+      //Any data to send?
+      if(n > 0)
+      {
+         //Position of the first character to send
+         offset = debugTxReadIndex & (TRACE_ASYNC_BUFFER_SIZE - 1);
+         //Do not wrap around the end of the ring buffer
+         n = MIN(n, TRACE_ASYNC_BUFFER_SIZE - offset);
+
+         //Configure DMA2 stream 6 for a memory to USART6 transfer
+         DMA_InitStructure.DMA_Channel = DMA_Channel_5;
+         DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t) &USART6->DR;
+         DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t) (debugTxBuffer + offset);
+         DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+         DMA_InitStructure.DMA_BufferSize = n;
+         DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+         DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+         DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+         DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+         DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+         DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+         DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+         DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_Full;
+         DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+         DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+         DMA_Init(DMA2_Stream6, &DMA_InitStructure);
+
+         //Clear the transfer complete flag and enable the corresponding interrupt
+         DMA_ClearFlag(DMA2_Stream6, DMA_FLAG_TCIF6);
+         DMA_ITConfig(DMA2_Stream6, DMA_IT_TC, ENABLE);
+
+         //Start the transfer
+         DMA_Cmd(DMA2_Stream6, ENABLE);
+
+         //Sleep until the transfer complete interrupt fires
+         osWaitForEvent(&debugDmaEvent, INFINITE_DELAY);
+
+         //Release the corresponding entries of the ring buffer
+         debugTxReadIndex += n;
+      }
+      else
+      {
+         //Producers must wake up the task when they publish new output
+         debugTxIdle = TRUE;
+         //Make sure the flag is visible before the write index is read again
+         __DMB();
+
+         //The ring buffer may have been filled before the flag was set
+         if(debugTxWriteIndex == debugTxReadIndex)
+         {
+            //Wait for more trace output
+            osWaitForEvent(&debugTxEvent, INFINITE_DELAY);
+         }
+
+         //The task is running again
+         debugTxIdle = FALSE;
+      }
+   }
+}
+
+
+/**
+ * @brief DMA2 stream 6 interrupt service routine
+ **/
+
+void DMA2_Stream6_IRQHandler(void)
+{
+   bool_t flag;
+
+   //Enter interrupt service routine
+   osEnterIsr();
+
+   //This flag will be set if a higher priority task must be woken
+   flag = FALSE;
+
+   //Transfer complete?
+   if(DMA_GetITStatus(DMA2_Stream6, DMA_IT_TCIF6) != RESET)
+   {
+      //Clear TCIF interrupt flag
+      DMA_ClearITPendingBit(DMA2_Stream6, DMA_IT_TCIF6);
+      //Disable the interrupt until the next transfer
+      DMA_ITConfig(DMA2_Stream6, DMA_IT_TC, DISABLE);
+
+      //Notify the drain task
+      flag = osSetEventFromIsr(&debugDmaEvent);
+   }
+
+   //Leave interrupt service routine
+   osExitIsr(flag);
+}
+
+
+/**
+ * @brief Format a trace message and queue it
+ * @param[in] format NULL-terminated format string
+ * @param[in] ... Optional arguments
+ **/
+
+void debugPrintf(const char_t *format, ...)
+{
+   int_t n;
+   va_list args;
+   char_t buffer[TRACE_ASYNC_MAX_MSG_LEN];
+
+   //The message is formatted on the stack of the caller, so that producers
+   //never wait for one another
+   va_start(args, format);
+   n = vsnprintf(buffer, sizeof(buffer), format, args);
+   va_end(args);
+
+   //Formatting error?
+   if(n < 0)
+      return;
+
+   //Queue the message. Characters beyond the maximum length are discarded
+   if((size_t) n < sizeof(buffer))
+   {
+      debugWrite(buffer, n);
+   }
+   else
+   {
+      debugWrite(buffer, sizeof(buffer) - 1);
+      debugWrite(NULL, n - (sizeof(buffer) - 1));
+   }
+}
+
+
+/**
+ * @brief Queue trace output
+ *
+ * Any number of tasks and interrupt service routines may call this function
+ * concurrently. Interrupts are only masked while space is reserved in the
+ * ring buffer and while the message is published, never while the message
+ * is copied
+ *
+ * @param[in] data Characters to queue (NULL to count discarded characters)
+ * @param[in] length Number of characters
+ **/
+
+void debugWrite(const char_t *data, size_t length)
+{
+   uint_t i;
+   uint_t n;
+   uint_t index;
+   uint_t markerLength;
+   uint32_t count;
+   uint32_t primask;
+   bool_t idle;
+   char_t marker[TRACE_ASYNC_MARKER_MAX_LEN + 1];
+
+   //Nothing to queue?
+   if(length == 0)
+      return;
+
+   //Enter critical section
+   primask = __get_PRIMASK();
+   __disable_irq();
+
+   //Number of characters discarded since the last marker
+   count = debugTxDropCount - debugTxDropReported;
+
+   //A marker must precede any new output if characters have been discarded
+   if(count > 0)
+   {
+      //Length of the truncation marker
+      for(markerLength = TRACE_ASYNC_MARKER_LEN + 1, n = count;
+         n >= 10; n /= 10)
+      {
+         markerLength++;
+      }
+   }
+   else
+   {
+      //No marker is needed
+      markerLength = 0;
+   }
+
+   //Number of characters waiting in the ring buffer or being copied
+   n = debugTxReserveIndex - debugTxReadIndex;
+
+   //Never wait for the UART. Discard the message if the ring buffer is full
+   if(data == NULL || (n + markerLength + length) > TRACE_ASYNC_BUFFER_SIZE)
+   {
+      //Keep track of discarded characters
+      debugTxDropCount += length;
+      //Leave critical section
+      __set_PRIMASK(primask);
+      //Do not queue the message
+      return;
+   }
+
+   //Reserve space for the marker and the message
+   index = debugTxReserveIndex;
+   debugTxReserveIndex += markerLength + length;
+   //The message is not complete yet
+   debugTxPendingCount++;
+   //The discarded characters are about to be reported
+   debugTxDropReported += count;
+
+   //Leave critical section
+   __set_PRIMASK(primask);
+
+   //Queue the truncation marker, if any
+   if(markerLength > 0)
+   {
+      sprintf(marker, TRACE_ASYNC_MARKER, count);
+
+      for(i = 0; i < markerLength; i++, index++)
+         debugTxBuffer[index & (TRACE_ASYNC_BUFFER_SIZE - 1)] = marker[i];
+   }
+
+   //Copy the message
+   for(i = 0; i < length; i++, index++)
+      debugTxBuffer[index & (TRACE_ASYNC_BUFFER_SIZE - 1)] = data[i];
+
+   //Make sure the message is stored before it is published
+   __DMB();
+
+   //Enter critical section
+   primask = __get_PRIMASK();
+   __disable_irq();
+
+   //The last producer to finish publishes every reserved message at once,
+   //so that the drain task never sees a partially copied message
+   if(--debugTxPendingCount == 0)
+      debugTxWriteIndex = debugTxReserveIndex;
+
+   //Leave critical section
+   __set_PRIMASK(primask);
+
+   //Make sure the write index is updated before the idle flag is read
+   __DMB();
+   //Check whether the drain task is waiting for new output
+   idle = debugTxIdle;
+
+   //Wake up the drain task if necessary
+   if(idle)
+   {
+      //Interrupt service routines must use the dedicated primitive
+      if(__get_IPSR() != 0)
+         osSetEventFromIsr(&debugTxEvent);
+      else
+         osSetEvent(&debugTxEvent);
+   }
 }
 
+#endif
+
 
 /**
  * @brief Display the contents of an array
@@ -84,6 +451,36 @@ void debugInit(uint32_t baudrate)
 void debugDisplayArray(FILE *stream,
    const char_t *prepend, const void *data, size_t length)
 {
+#if (TRACE_ASYNC_SUPPORT == ENABLED)
+   uint_t i;
+   uint_t n;
+   char_t buffer[TRACE_ASYNC_MAX_MSG_LEN];
+
+   //Initialize line length
+   n = 0;
+
+   for(i = 0; i < length; i++)
+   {
+      //Beginning of a new line?
+      if((i % 16) == 0)
+      {
+         //Copy the prefix, leaving room for 16 data bytes and the line ending
+         for(n = 0; prepend[n] != '\0' && n < (sizeof(buffer) - 51); n++)
+            buffer[n] = prepend[n];
+      }
+
+      //Display current data byte
+      n += sprintf(buffer + n, "%02" PRIX8 " ", *((uint8_t *) data + i));
+
+      //End of current line?
+      if((i % 16) == 15 || i == (length - 1))
+      {
+         n += sprintf(buffer + n, "\r\n");
+         //Each line is queued as a single message
+         debugWrite(buffer, n);
+      }
+   }
+#else
    uint_t i;
 
    for(i = 0; i < length; i++)
@@ -97,6 +494,7 @@ void debugDisplayArray(FILE *stream,
       if((i % 16) == 15 || i == (length - 1))
          fprintf(stream, "\r\n");
    }
+#endif
 }
 
 
@@ -110,6 +508,16 @@ void debugDisplayArray(FILE *stream,
 
 int_t fputc(int_t c, FILE *stream)
 {
+#if (TRACE_ASYNC_SUPPORT == ENABLED)
+   char_t ch;
+
+   //Queue the character
+   ch = (char_t) c;
+   debugWrite(&ch, 1);
+
+   //On success, the character written is returned
+   return c;
+#else
    //Standard output?
    /*if(stream == stdout)
    {
@@ -138,4 +546,5 @@ int_t fputc(int_t c, FILE *stream)
       //If a writing error occurs, EOF is returned
       return EOF;
    }*/
+#endif
 }
@@ -44,13 +44,54 @@
    #define TRACE_LEVEL TRACE_LEVEL_DEBUG
 #endif
 
+//Asynchronous trace output
+#ifndef TRACE_ASYNC_SUPPORT
+   #define TRACE_ASYNC_SUPPORT DISABLED
+#elif (TRACE_ASYNC_SUPPORT != ENABLED && TRACE_ASYNC_SUPPORT != DISABLED)
+   #error TRACE_ASYNC_SUPPORT parameter is not valid
+#endif
+
+//Size of the trace ring buffer (must be a power of two)
+#ifndef TRACE_ASYNC_BUFFER_SIZE
+   #define TRACE_ASYNC_BUFFER_SIZE 2048
+#elif (TRACE_ASYNC_BUFFER_SIZE < 64 || (TRACE_ASYNC_BUFFER_SIZE & (TRACE_ASYNC_BUFFER_SIZE - 1)) != 0)
+   #error TRACE_ASYNC_BUFFER_SIZE parameter is not valid
+#endif
+
+//Stack size required to run the trace drain task
+#ifndef TRACE_ASYNC_TASK_STACK_SIZE
+   #define TRACE_ASYNC_TASK_STACK_SIZE 200
+#elif (TRACE_ASYNC_TASK_STACK_SIZE < 1)
+   #error TRACE_ASYNC_TASK_STACK_SIZE parameter is not valid
+#endif
+
+//Priority at which the trace drain task should run
+#ifndef TRACE_ASYNC_TASK_PRIORITY
+   #define TRACE_ASYNC_TASK_PRIORITY OS_TASK_PRIORITY_LOW
+#endif
+
+//Maximum length of a trace message (longer messages are truncated)
+#ifndef TRACE_ASYNC_MAX_MSG_LEN
+   #define TRACE_ASYNC_MAX_MSG_LEN 128
+#elif (TRACE_ASYNC_MAX_MSG_LEN < 64 || TRACE_ASYNC_MAX_MSG_LEN > TRACE_ASYNC_BUFFER_SIZE / 2)
+   #error TRACE_ASYNC_MAX_MSG_LEN parameter is not valid
+#endif
+
 //Trace output redirection
 #ifndef TRACE_PRINTF
-   #define TRACE_PRINTF(...) osSuspendAllTasks(), fprintf(stderr, __VA_ARGS__), osResumeAllTasks()
+   #if (TRACE_ASYNC_SUPPORT == ENABLED)
+      #define TRACE_PRINTF(...) debugPrintf(__VA_ARGS__)
+   #else
+      #define TRACE_PRINTF(...) osSuspendAllTasks(), fprintf(stderr, __VA_ARGS__), osResumeAllTasks()
+   #endif
 #endif
 
 #ifndef TRACE_ARRAY
-   #define TRACE_ARRAY(p, a, n) osSuspendAllTasks(), debugDisplayArray(stderr, p, a, n), osResumeAllTasks()
+   #if (TRACE_ASYNC_SUPPORT == ENABLED)
+      #define TRACE_ARRAY(p, a, n) debugDisplayArray(stderr, p, a, n)
+   #else
+      #define TRACE_ARRAY(p, a, n) osSuspendAllTasks(), debugDisplayArray(stderr, p, a, n), osResumeAllTasks()
+   #endif
 #endif
 
 #ifndef TRACE_MPI
@@ -117,6 +158,11 @@ void debugInit(uint32_t baudrate);
 void debugDisplayArray(FILE *stream,
    const char_t *prepend, const void *data, size_t length);
 
+#if (TRACE_ASYNC_SUPPORT == ENABLED)
+   void debugPrintf(const char_t *format, ...);
+   void debugWrite(const char_t *data, size_t length);
+#endif
+
 //Deprecated definitions
 #define TRACE_LEVEL_NO_TRACE TRACE_LEVEL_OFF
 
@@ -193,6 +193,18 @@ void osDeleteTask(OsTask *task)
 }
 
 
+/**
+ * @brief Retrieve the calling task
+ * @return Pointer identifying the task that is currently running
+ **/
+
+OsTask *osGetCurrentTask(void)
+{
+   //Retrieve the thread that is currently running
+   return (OsTask *) chThdGetSelfX();
+}
+
+
 /**
  * @brief Delay routine
  * @param[in] delay Amount of time for which the calling task should block
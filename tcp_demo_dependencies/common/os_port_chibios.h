@@ -37,6 +37,11 @@
    #error OS_PORT_MAX_TASKS parameter is not valid
 #endif
 
+//Task priority (low)
+#ifndef OS_TASK_PRIORITY_LOW
+   #define OS_TASK_PRIORITY_LOW LOWPRIO
+#endif
+
 //Task priority (normal)
 #ifndef OS_TASK_PRIORITY_NORMAL
    #define OS_TASK_PRIORITY_NORMAL NORMALPRIO
@@ -136,6 +141,7 @@ OsTask *osCreateTask(const char_t *name, OsTaskCode taskCode,
    void *params, size_t stackSize, int_t priority);
 
 void osDeleteTask(OsTask *task);
+OsTask *osGetCurrentTask(void);
 void osDelayTask(systime_t delay);
 void osSwitchTask(void);
 void osSuspendAllTasks(void);
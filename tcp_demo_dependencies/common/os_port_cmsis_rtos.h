@@ -30,6 +30,11 @@
 //Dependencies
 #include "cmsis_os.h"
 
+//Task priority (low)
+#ifndef OS_TASK_PRIORITY_LOW
+   #define OS_TASK_PRIORITY_LOW osPriorityLow
+#endif
+
 //Task priority (normal)
 #ifndef OS_TASK_PRIORITY_NORMAL
    #define OS_TASK_PRIORITY_NORMAL osPriorityNormal
@@ -124,6 +129,7 @@ OsTask *osCreateTask(const char_t *name, OsTaskCode taskCode,
    void *params, size_t stackSize, int_t priority);
 
 void osDeleteTask(OsTask *task);
+OsTask *osGetCurrentTask(void);
 void osDelayTask(systime_t delay);
 void osSwitchTask(void);
 void osSuspendAllTasks(void);
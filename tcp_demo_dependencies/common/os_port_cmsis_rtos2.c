@@ -107,6 +107,18 @@ void osDeleteTask(OsTask *task)
 }
 
 
+/**
+ * @brief Retrieve the calling task
+ * @return Pointer identifying the task that is currently running
+ **/
+
+OsTask *osGetCurrentTask(void)
+{
+   //Retrieve the identifier of the calling thread
+   return (OsTask *) osThreadGetId();
+}
+
+
 /**
  * @brief Delay routine
  * @param[in] delay Amount of time for which the calling task should block
@@ -185,6 +185,18 @@ void osDeleteTask(OsTask *task)
 }
 
 
+/**
+ * @brief Retrieve the calling task
+ * @return Pointer identifying the task that is currently running
+ **/
+
+OsTask *osGetCurrentTask(void)
+{
+   //Retrieve the control block of the calling task
+   return (OsTask *) OS_GetTaskID();
+}
+
+
 /**
  * @brief Delay routine
  * @param[in] delay Amount of time for which the calling task should block
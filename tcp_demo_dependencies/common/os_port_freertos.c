@@ -96,6 +96,18 @@ void osDeleteTask(OsTask *task)
 }
 
 
+/**
+ * @brief Retrieve the calling task
+ * @return Pointer to the task that is currently running
+ **/
+
+OsTask *osGetCurrentTask(void)
+{
+   //Retrieve the handle of the calling task
+   return (OsTask *) xTaskGetCurrentTaskHandle();
+}
+
+
 /**
  * @brief Delay routine
  * @param[in] delay Amount of time for which the calling task should block
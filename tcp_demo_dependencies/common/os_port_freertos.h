@@ -32,6 +32,11 @@
 #include "task.h"
 #include "semphr.h"
 
+//Task priority (low)
+#ifndef OS_TASK_PRIORITY_LOW
+   #define OS_TASK_PRIORITY_LOW (tskIDLE_PRIORITY)
+#endif
+
 //Task priority (normal)
 #ifndef OS_TASK_PRIORITY_NORMAL
    #define OS_TASK_PRIORITY_NORMAL (tskIDLE_PRIORITY + 1)
@@ -130,6 +135,7 @@ OsTask *osCreateTask(const char_t *name, OsTaskCode taskCode,
    void *params, size_t stackSize, int_t priority);
 
 void osDeleteTask(OsTask *task);
+OsTask *osGetCurrentTask(void);
 void osDelayTask(systime_t delay);
 void osSwitchTask(void);
 void osSuspendAllTasks(void);
@@ -94,6 +94,18 @@ void osDeleteTask(OsTask *task)
 }
 
 
+/**
+ * @brief Retrieve the calling task
+ * @return Pointer to the task that is currently running
+ **/
+
+OsTask *osGetCurrentTask(void)
+{
+   //Single execution context
+   return NULL;
+}
+
+
 /**
  * @brief Delay routine
  * @param[in] delay Amount of time for which the calling task should block
@@ -189,6 +189,18 @@ void osDeleteTask(OsTask *task)
 }
 
 
+/**
+ * @brief Retrieve the calling task
+ * @return Pointer identifying the task that is currently running
+ **/
+
+OsTask *osGetCurrentTask(void)
+{
+   //The task identifier is used as an opaque handle
+   return (OsTask *) (uintptr_t) os_tsk_self();
+}
+
+
 /**
  * @brief Delay routine
  * @param[in] delay Amount of time for which the calling task should block
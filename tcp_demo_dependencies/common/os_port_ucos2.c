@@ -176,6 +176,21 @@ void osDeleteTask(OsTask *task)
 }
 
 
+/**
+ * @brief Retrieve the calling task
+ * @return Pointer identifying the task that is currently running
+ **/
+
+OsTask *osGetCurrentTask(void)
+{
+   //Each task is identified by its priority
+   if(OSPrioCur < OS_LOWEST_PRIO)
+      return &tcbTable[OSPrioCur];
+   else
+      return NULL;
+}
+
+
 /**
  * @brief Delay routine
  * @param[in] delay Amount of time for which the calling task should block
@@ -1092,6 +1092,82 @@ int_t setsockopt(int_t s, int_t level, int_t optname,
             break;
          }
       }
+      //Level at which the option is defined?
+      else if(level == IPPROTO_TCP)
+      {
+         //Check option type
+         switch(optname)
+         {
+         //Select the congestion control algorithm
+         case TCP_CONGESTION:
+            //Check the length of the option
+            if(optlen >= (socklen_t) sizeof(int_t))
+            {
+               //Cast the option value to the relevant type
+               val = (int_t *) optval;
+
+               //Use the specified algorithm (see #TcpCongestAlgo enumeration)
+               if(!socketSetCongestionControl(sock, (TcpCongestAlgo) *val))
+               {
+                  //Successful processing
+                  ret = SOCKET_SUCCESS;
+               }
+               else
+               {
+                  //The algorithm is not supported
+                  sock->errnoCode = EINVAL;
+                  ret = SOCKET_ERROR;
+               }
+            }
+            else
+            {
+               //The option length is not valid
+               sock->errnoCode = EFAULT;
+               ret = SOCKET_ERROR;
+            }
+
+            //We are done
+            break;
+
+         //Disable delayed acknowledgments
+         case TCP_QUICKACK:
+            //Check the length of the option
+            if(optlen >= (socklen_t) sizeof(int_t))
+            {
+               //Cast the option value to the relevant type
+               val = (int_t *) optval;
+
+               //A non-zero value causes every segment to be acknowledged immediately
+               if(!socketSetDelayedAck(sock, *val ? FALSE : TRUE))
+               {
+                  //Successful processing
+                  ret = SOCKET_SUCCESS;
+               }
+               else
+               {
+                  //Delayed acknowledgments are not supported
+                  sock->errnoCode = EINVAL;
+                  ret = SOCKET_ERROR;
+               }
+            }
+            else
+            {
+               //The option length is not valid
+               sock->errnoCode = EFAULT;
+               ret = SOCKET_ERROR;
+            }
+
+            //We are done
+            break;
+
+         //Unknown option
+         default:
+            //Report an error
+            sock->errnoCode = ENOPROTOOPT;
+            ret = SOCKET_ERROR;
+            break;
+         }
+      }
       else
       {
          //The specified level is not valid
@@ -119,6 +119,8 @@
 
 //TCP level options
 #define TCP_NODELAY      0x0001
+#define TCP_QUICKACK     0x000C
+#define TCP_CONGESTION   0x000D
 
 //IOCTL commands
 #define FIONREAD         0x400466FF
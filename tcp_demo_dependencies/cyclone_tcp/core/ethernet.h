@@ -53,6 +53,13 @@
    #error ETH_FAST_CRC_SUPPORT parameter is not valid
 #endif
 
+//Slicing-by-8 CRC32 calculation (requires ETH_FAST_CRC_SUPPORT)
+#ifndef ETH_CRC_SLICING_BY_8_SUPPORT
+   #define ETH_CRC_SLICING_BY_8_SUPPORT DISABLED
+#elif (ETH_CRC_SLICING_BY_8_SUPPORT != ENABLED && ETH_CRC_SLICING_BY_8_SUPPORT != DISABLED)
+   #error ETH_CRC_SLICING_BY_8_SUPPORT parameter is not valid
+#endif
+
 //Minimum Ethernet frame size
 #define ETH_MIN_FRAME_SIZE 64
 //Maximum Ethernet frame size
@@ -197,6 +204,7 @@ void ethUpdateOutStats(NetInterface *interface, const MacAddr *destMacAddr, size
 
 uint32_t ethCalcCrc(const void *data, size_t length);
 uint32_t ethCalcCrcEx(const NetBuffer *buffer, size_t offset, size_t length);
+uint32_t ethUpdateCrc(uint32_t crc, const void *data, size_t length);
 
 NetBuffer *ethAllocBuffer(size_t length, size_t *offset);
 
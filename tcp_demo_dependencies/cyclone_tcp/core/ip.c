@@ -38,6 +38,14 @@
 #include "ipv6/ipv6_misc.h"
 #include "debug.h"
 
+//AVX2 checksum kernel (host builds)
+#if (IP_FAST_CHECKSUM_SUPPORT == ENABLED && defined(__AVX2__))
+   #include <immintrin.h>
+   #define IP_CHECKSUM_VECTOR_SIZE 32
+   //Shorter data is processed faster by the scalar loop
+   #define IP_CHECKSUM_VECTOR_THRESHOLD 128
+#endif
+
 //Special IP addresses
 const IpAddr IP_ADDR_ANY = {0};
 const IpAddr IP_ADDR_UNSPECIFIED = {0};
@@ -50,11 +58,12 @@ const IpAddr IP_ADDR_UNSPECIFIED = {0};
  * @param[in] buffer Multi-part buffer containing the payload
  * @param[in] offset Offset to the first payload byte
  * @param[in] ttl TTL value. Default Time-To-Live is used when this parameter is zero
+ * @param[in] destCacheSlot IPv4 destination cache slot of the sender, if any
  * @return Error code
  **/
 
 error_t ipSendDatagram(NetInterface *interface, IpPseudoHeader *pseudoHeader,
-   NetBuffer *buffer, size_t offset, uint8_t ttl)
+   NetBuffer *buffer, size_t offset, uint8_t ttl, Ipv4DestCacheEntry *destCacheSlot)
 {
    error_t error;
 
@@ -64,7 +73,7 @@ error_t ipSendDatagram(NetInterface *interface, IpPseudoHeader *pseudoHeader,
    {
       //Form an IPv4 packet and send it
       error = ipv4SendDatagram(interface, &pseudoHeader->ipv4Data,
-         buffer, offset, ttl);
+         buffer, offset, ttl, destCacheSlot);
    }
    else
 #endif
@@ -341,6 +350,70 @@ error_t ipLeaveMulticastGroup(NetInterface *interface, const IpAddr *groupAddr)
 }
 
 
+//AVX2 checksum kernel?
+#ifdef IP_CHECKSUM_VECTOR_SIZE
+
+/**
+ * @brief Sum 16-bit words using AVX2 instructions
+ *
+ * Each 16-bit word is zero-extended into a 32-bit lane, so that carries
+ * are deferred. A lane receives two words per vector and cannot overflow
+ * before 32768 vectors have been accumulated
+ *
+ * @param[in] data Pointer to the data
+ * @param[in] length Number of bytes to process (multiple of the vector size)
+ * @return Sum of the 16-bit words
+ **/
+
+static uint64_t ipSumWordsVector(const uint8_t *data, size_t length)
+{
+   uint_t i;
+   uint_t n;
+   uint64_t sum;
+   uint32_t lane[8];
+   __m256i v;
+   __m256i acc;
+   __m256i zero = _mm256_setzero_si256();
+
+   //Initialize the sum
+   sum = 0;
+
+   //Process the data by batches of at most 32768 vectors
+   while(length > 0)
+   {
+      //Number of vectors in the current batch
+      n = MIN(length / IP_CHECKSUM_VECTOR_SIZE, 32768);
+
+      //Clear the 32-bit lanes
+      acc = zero;
+
+      //Accumulate 16 words per vector
+      for(i = 0; i < n; i++)
+      {
+         v = _mm256_loadu_si256((const __m256i *) data);
+         acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+         acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+         data += 32;
+      }
+
+      //Save the lanes
+      _mm256_storeu_si256((__m256i *) lane, acc);
+
+      //Add the lanes together
+      for(i = 0; i < 8; i++)
+         sum += lane[i];
+
+      //Number of bytes left to process
+      length -= n * IP_CHECKSUM_VECTOR_SIZE;
+   }
+
+   //Return the sum of the 16-bit words
+   return sum;
+}
+
+#endif
+
+
 /**
  * @brief IP checksum calculation
  * @param[in] data Pointer to the data over which to calculate the IP checksum
@@ -350,7 +423,15 @@ error_t ipLeaveMulticastGroup(NetInterface *interface, const IpAddr *groupAddr)
 
 uint16_t ipCalcChecksum(const void *data, size_t length)
 {
+#if (IP_FAST_CHECKSUM_SUPPORT == ENABLED)
+   uint64_t sum;
+   const uint32_t *q;
+#ifdef IP_CHECKSUM_VECTOR_SIZE
+   size_t n;
+#endif
+#else
    uint32_t temp;
+#endif
    uint32_t checksum;
    const uint8_t *p;
 
@@ -394,6 +475,63 @@ uint16_t ipCalcChecksum(const void *data, size_t length)
       }
    }
 
+#if (IP_FAST_CHECKSUM_SUPPORT == ENABLED)
+   //Use a 64-bit accumulator so that carries can be deferred
+   sum = checksum;
+
+#ifdef IP_CHECKSUM_VECTOR_SIZE
+   //Process the bulk of the data with vector instructions (a 16-bit word
+   //sum is congruent to the 32-bit word sum modulo 0xFFFF)
+   if(length >= IP_CHECKSUM_VECTOR_THRESHOLD)
+   {
+      //Round the length down to a whole number of vectors
+      n = length & ~((size_t) IP_CHECKSUM_VECTOR_SIZE - 1);
+      sum += ipSumWordsVector(p, n);
+
+      //Point to the remaining data
+      p += n;
+      //Number of bytes left to process
+      length -= n;
+   }
+#endif
+
+   //Point to the first 32-bit word
+   q = (const uint32_t *) p;
+
+   //Process the data 16 bytes at a time
+   while(length >= 16)
+   {
+      //Update checksum value
+      sum += q[0];
+      sum += q[1];
+      sum += q[2];
+      sum += q[3];
+
+      //Point to the next block
+      q += 4;
+      //Number of bytes left to process
+      length -= 16;
+   }
+
+   //Process the remaining data 4 bytes at a time
+   while(length >= 4)
+   {
+      //Update checksum value
+      sum += *(q++);
+      //Number of bytes left to process
+      length -= 4;
+   }
+
+   //Fold 64-bit sum to 32 bits (first pass)
+   sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+   //Fold 64-bit sum to 32 bits (second pass)
+   sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+
+   //Retrieve the 32-bit sum
+   checksum = (uint32_t) sum;
+   //Point to the left-over bytes, if any
+   p = (const uint8_t *) q;
+#else
    //Process the data 4 bytes at a time
    while(length >= 4)
    {
@@ -415,6 +553,7 @@ uint16_t ipCalcChecksum(const void *data, size_t length)
       //Number of bytes left to process
       length -= 4;
    }
+#endif
 
    //Fold 32-bit sum to 16 bits
    checksum = (checksum & 0xFFFF) + (checksum >> 16);
@@ -474,6 +613,7 @@ uint16_t ipCalcChecksumEx(const NetBuffer *buffer, size_t offset, size_t length)
    uint_t n;
    uint_t pos;
    uint8_t *data;
+   uint32_t partial;
    uint32_t checksum;
 
    //Checksum preset value
@@ -496,25 +636,21 @@ uint16_t ipCalcChecksumEx(const NetBuffer *buffer, size_t offset, size_t length)
          //Limit the number of byte to process
          n = MIN(n, length - pos);
 
+         //Process data chunk
+         partial = ipCalcChecksum(data, n) ^ 0xFFFF;
+
          //Take care of alignment issues
          if((pos & 1) != 0)
          {
-            //Swap checksum value
-            checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
+            //Swap the partial sum rather than the running checksum
+            partial = ((partial >> 8) | (partial << 8)) & 0xFFFF;
          }
 
-         //Process data chunk
-         checksum += ipCalcChecksum(data, n) ^ 0xFFFF;
+         //Update checksum value
+         checksum += partial;
          //Fold 32-bit sum to 16 bits
          checksum = (checksum & 0xFFFF) + (checksum >> 16);
 
-         //Restore checksum endianness
-         if((pos & 1) != 0)
-         {
-            //Swap checksum value
-            checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
-         }
-
          //Advance current position
          pos += n;
          //Process the next block from the start
@@ -585,6 +721,47 @@ uint16_t ipCalcUpperLayerChecksumEx(const void *pseudoHeader,
 }
 
 
+/**
+ * @brief Check whether the checksum of an incoming datagram was verified by hardware
+ *
+ * Frames with a bad TCP, UDP or ICMP checksum are discarded by the NIC when
+ * receive checksum offload is enabled. Fragmented datagrams are not processed
+ * by the checksum offload engine and are verified upon reassembly. Frames
+ * the checksum offload engine has bypassed are verified in software
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader Pseudo header of the incoming datagram
+ * @return TRUE if the checksum has already been verified, else FALSE
+ **/
+
+bool_t ipIsRxChecksumOffloaded(NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader)
+{
+   bool_t offload;
+
+   //Default value
+   offload = FALSE;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 datagram whose checksum has been processed by the NIC?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader) &&
+      !interface->nicRxChecksumBypassed)
+   {
+      //Check upper layer protocol
+      if(pseudoHeader->ipv4Data.protocol == IPV4_PROTOCOL_ICMP)
+         offload = interface->nicDriver->autoIcmpChecksumVerif;
+      else if(pseudoHeader->ipv4Data.protocol == IPV4_PROTOCOL_TCP)
+         offload = interface->nicDriver->autoTcpChecksumVerif;
+      else if(pseudoHeader->ipv4Data.protocol == IPV4_PROTOCOL_UDP)
+         offload = interface->nicDriver->autoUdpChecksumVerif;
+   }
+#endif
+
+   //Return TRUE if the checksum has been verified by hardware
+   return offload;
+}
+
+
 /**
  * @brief Allocate a buffer to hold an IP packet
  * @param[in] length Desired payload length
@@ -33,6 +33,13 @@
 #include "ipv4/ipv4.h"
 #include "ipv6/ipv6.h"
 
+//Optimized checksum computation
+#ifndef IP_FAST_CHECKSUM_SUPPORT
+   #define IP_FAST_CHECKSUM_SUPPORT DISABLED
+#elif (IP_FAST_CHECKSUM_SUPPORT != ENABLED && IP_FAST_CHECKSUM_SUPPORT != DISABLED)
+   #error IP_FAST_CHECKSUM_SUPPORT parameter is not valid
+#endif
+
 //C++ guard
 #ifdef __cplusplus
    extern "C" {
@@ -95,7 +102,7 @@ extern const IpAddr IP_ADDR_UNSPECIFIED;
 
 //IP related functions
 error_t ipSendDatagram(NetInterface *interface, IpPseudoHeader *pseudoHeader,
-   NetBuffer *buffer, size_t offset, uint8_t ttl);
+   NetBuffer *buffer, size_t offset, uint8_t ttl, Ipv4DestCacheEntry *destCacheSlot);
 
 error_t ipSelectSourceAddr(NetInterface **interface,
    const IpAddr *destAddr, IpAddr *srcAddr);
@@ -115,6 +122,9 @@ uint16_t ipCalcUpperLayerChecksum(const void *pseudoHeader,
 uint16_t ipCalcUpperLayerChecksumEx(const void *pseudoHeader,
    size_t pseudoHeaderLength, const NetBuffer *buffer, size_t offset, size_t length);
 
+bool_t ipIsRxChecksumOffloaded(NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader);
+
 NetBuffer *ipAllocBuffer(size_t length, size_t *offset);
 
 error_t ipStringToAddr(const char_t *str, IpAddr *ipAddr);
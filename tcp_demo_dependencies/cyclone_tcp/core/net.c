@@ -77,6 +77,12 @@ NetInterface netInterface[NET_INTERFACE_COUNT];
 static bool_t netTaskRunning;
 //Timestamp
 static systime_t netTimestamp;
+#if (TCP_SUPPORT == ENABLED)
+//Time at which the TCP timers must be processed
+static systime_t netTcpTimestamp;
+//At least one TCP timer is pending
+static bool_t netTcpTimerPending;
+#endif
 //Pseudo-random number generator state
 static uint32_t prngState = 0;
 
@@ -111,6 +117,12 @@ error_t netInit(void)
    //Get current time
    netTimestamp = osGetSystemTime();
 
+#if (TCP_SUPPORT == ENABLED)
+   //The TCP timers are checked during the first pass of netTask
+   netTcpTimestamp = netTimestamp;
+   netTcpTimerPending = TRUE;
+#endif
+
    //Create a mutex to prevent simultaneous access to the TCP/IP stack
    if(!osCreateMutex(&netMutex))
    {
@@ -252,9 +264,6 @@ error_t netInit(void)
 #if (IPV6_SUPPORT == ENABLED && DHCPV6_CLIENT_SUPPORT == ENABLED)
    dhcpv6ClientTickCounter = 0;
 #endif
-#if (TCP_SUPPORT == ENABLED)
-   tcpTickCounter = 0;
-#endif
 #if (DNS_CLIENT_SUPPORT == ENABLED || MDNS_CLIENT_SUPPORT == ENABLED || \
    NBNS_CLIENT_SUPPORT == ENABLED)
    dnsTickCounter = 0;
@@ -881,6 +890,7 @@ void netTask(void)
 {
    uint_t i;
    bool_t status;
+   bool_t deferred;
    systime_t time;
    systime_t timeout;
    NetInterface *interface;
@@ -922,16 +932,50 @@ void netTask(void)
       else
          timeout = 0;
 
+#if (TCP_SUPPORT == ENABLED)
+      //Do not sleep past the expiration of the next TCP timer
+      if(netTcpTimerPending)
+      {
+         if(timeCompare(time, netTcpTimestamp) < 0)
+            timeout = MIN(timeout, netTcpTimestamp - time);
+         else
+            timeout = 0;
+      }
+#endif
+
+      //A driver may leave a NIC event pending without signaling it, so
+      //that the remaining work is resumed after the other tasks have had
+      //a chance to run
+      deferred = FALSE;
+
+      //Loop through network interfaces
+      for(i = 0; i < NET_INTERFACE_COUNT; i++)
+      {
+         //Deferred NIC event?
+         if(netInterface[i].nicEvent)
+            deferred = TRUE;
+      }
+
+      //Do not sleep past the servicing of the deferred event
+      if(deferred)
+         timeout = MIN(timeout, NET_DEFERRED_EVENT_DELAY);
+
       //Receive notifications when a frame has been received, or the
       //link state of any network interfaces has changed
       status = osWaitForEvent(&netEvent, timeout);
 
-      //Check whether the specified event is in signaled state
-      if(status)
+      //Check whether the specified event is in signaled state, or whether
+      //a deferred event is due
+      if(status || deferred)
       {
          //Get exclusive access
          osAcquireMutex(&netMutex);
 
+#if (TCP_SUPPORT == ENABLED)
+         //The next TCP timeout is computed once the events are processed
+         tcpSuspendWakeup();
+#endif
+
          //Process events
          for(i = 0; i < NET_INTERFACE_COUNT; i++)
          {
@@ -967,6 +1011,11 @@ void netTask(void)
             }
          }
 
+#if (TCP_SUPPORT == ENABLED)
+         //TCP timers may have been started while processing the events
+         netUpdateTcpTimestamp();
+#endif
+
          //Release exclusive access
          osReleaseMutex(&netMutex);
       }
@@ -984,12 +1033,64 @@ void netTask(void)
          //Next event
          netTimestamp = time + NET_TICK_INTERVAL;
       }
+
+#if (TCP_SUPPORT == ENABLED)
+      //Check whether a TCP timer is due
+      if(netTcpTimerPending &&
+         timeCompare(osGetSystemTime(), netTcpTimestamp) >= 0)
+      {
+         //Get exclusive access
+         osAcquireMutex(&netMutex);
+         //The next TCP timeout is computed once the timers are processed
+         tcpSuspendWakeup();
+         //Handle the TCP timers that have expired
+         tcpTick();
+         //Compute the time at which the next TCP timer expires
+         netUpdateTcpTimestamp();
+         //Release exclusive access
+         osReleaseMutex(&netMutex);
+      }
+#endif
 #if (NET_RTOS_SUPPORT == ENABLED)
    }
 #endif
 }
 
 
+#if (TCP_SUPPORT == ENABLED)
+
+/**
+ * @brief Record the time at which the next TCP timer expires
+ *
+ * This function must be called with the netMutex held, so that netTask
+ * can decide whether the TCP timers need to be processed without taking
+ * the mutex
+ **/
+
+void netUpdateTcpTimestamp(void)
+{
+   systime_t delay;
+
+   //Get the delay before the expiration of the next TCP timer
+   delay = tcpGetNextTimeout();
+
+   //Any pending timer?
+   if(delay != INFINITE_DELAY)
+   {
+      //Save the expiration time
+      netTcpTimestamp = osGetSystemTime() + delay;
+      netTcpTimerPending = TRUE;
+   }
+   else
+   {
+      //No TCP timer is running
+      netTcpTimerPending = FALSE;
+   }
+}
+
+#endif
+
+
 /**
  * @brief Manage TCP/IP timers
  **/
@@ -998,6 +1099,10 @@ void netTick(void)
 {
    uint_t i;
 
+   //Fold the fast-path counter blocks into the MIB counters before any of
+   //them can wrap
+   netFoldCounters();
+
    //Increment tick counter
    nicTickCounter += NET_TICK_INTERVAL;
 
@@ -1236,20 +1341,6 @@ void netTick(void)
    }
 #endif
 
-#if (TCP_SUPPORT == ENABLED)
-   //Increment tick counter
-   tcpTickCounter += NET_TICK_INTERVAL;
-
-   //Manage TCP related timers
-   if(tcpTickCounter >= TCP_TICK_INTERVAL)
-   {
-      //TCP timer handler
-      tcpTick();
-      //Reset tick counter
-      tcpTickCounter = 0;
-   }
-#endif
-
 #if (DNS_CLIENT_SUPPORT == ENABLED || MDNS_CLIENT_SUPPORT == ENABLED || \
    NBNS_CLIENT_SUPPORT == ENABLED)
    //Increment tick counter
@@ -1299,6 +1390,37 @@ void netTick(void)
 }
 
 
+/**
+ * @brief Fold the fast-path counter blocks into the MIB counters
+ *
+ * The per-packet statistics of IPv4, TCP and UDP are accumulated in compact
+ * counter blocks. This function adds them to the MIB-II, IP-MIB, TCP-MIB
+ * and UDP-MIB counters, which are exact once it returns. The caller must
+ * have exclusive access to the TCP/IP stack
+ **/
+
+void netFoldCounters(void)
+{
+#if (IPV4_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+      ipv4FoldCounters(&netInterface[i]);
+#endif
+
+#if (TCP_SUPPORT == ENABLED)
+   //Fold TCP statistics
+   tcpFoldCounters();
+#endif
+
+#if (UDP_SUPPORT == ENABLED)
+   //Fold UDP statistics
+   udpFoldCounters();
+#endif
+}
+
+
 /**
  * @brief Get default network interface
  * @return Pointer to the default network interface to be used
@@ -137,6 +137,30 @@ struct _NetInterface;
    #error NET_TICK_INTERVAL parameter is not valid
 #endif
 
+//Delay before a NIC event left pending by the driver is serviced
+#ifndef NET_DEFERRED_EVENT_DELAY
+   #define NET_DEFERRED_EVENT_DELAY 1
+#elif (NET_DEFERRED_EVENT_DELAY < 1)
+   #error NET_DEFERRED_EVENT_DELAY parameter is not valid
+#endif
+
+//Zero-copy receive (received buffers may be loaned to the upper layers).
+//Disabled by default: it only pays off with a driver that sets zeroCopyRx,
+//and the loaned buffers stay out of the memory pool until the application
+//reads the data, so the pool must cover the receive windows of the sockets
+#ifndef NET_ZERO_COPY_RX_SUPPORT
+   #define NET_ZERO_COPY_RX_SUPPORT DISABLED
+#elif (NET_ZERO_COPY_RX_SUPPORT != ENABLED && NET_ZERO_COPY_RX_SUPPORT != DISABLED)
+   #error NET_ZERO_COPY_RX_SUPPORT parameter is not valid
+#endif
+
+//Zero-copy transmit (buffers are handed to the DMA until transmission completes)
+#ifndef NET_ZERO_COPY_TX_SUPPORT
+   #define NET_ZERO_COPY_TX_SUPPORT DISABLED
+#elif (NET_ZERO_COPY_TX_SUPPORT != ENABLED && NET_ZERO_COPY_TX_SUPPORT != DISABLED)
+   #error NET_ZERO_COPY_TX_SUPPORT parameter is not valid
+#endif
+
 //C++ guard
 #ifdef __cplusplus
    extern "C" {
@@ -165,6 +189,13 @@ struct _NetInterface
    uint8_t nicContext[NIC_CONTEXT_SIZE];          ///<Driver specific context
    OsEvent nicTxEvent;                            ///<Network controller TX event
    bool_t nicEvent;                               ///<A NIC event is pending
+   bool_t nicRxChecksumBypassed;                  ///<The NIC did not verify the checksums of the current frame
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   uint8_t *nicRxLoanBuffer;                      ///<Buffer holding the packet being processed
+   size_t nicRxLoanLength;                        ///<Length of the packet being processed
+   size_t nicRxLoanSize;                          ///<Size of the buffer holding the packet
+   bool_t nicRxLoaned;                            ///<The buffer has been kept by the upper layers
+#endif
    bool_t phyEvent;                               ///<A PHY event is pending
    bool_t linkState;                              ///<Link state
    uint32_t linkSpeed;                            ///<Link speed
@@ -179,6 +210,11 @@ struct _NetInterface
 #if (IPV4_SUPPORT == ENABLED)
    Ipv4Context ipv4Context;                       ///<IPv4 context
    ArpCacheEntry arpCache[ARP_CACHE_SIZE];        ///<ARP cache
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   ArpCacheEntry *arpHashTable[ARP_HASH_TABLE_SIZE]; ///<ARP cache hash buckets
+   ArpCacheEntry *arpLruHead;                     ///<Most recently used ARP entry
+   ArpCacheEntry *arpLruTail;                     ///<Least recently used ARP entry
+#endif
 #if (IGMP_SUPPORT == ENABLED)
    systime_t igmpv1RouterPresentTimer;            ///<IGMPv1 router present timer
    bool_t igmpv1RouterPresent;                    ///<An IGMPv1 query has been recently heard
@@ -279,6 +315,8 @@ error_t netConfigInterface(NetInterface *interface);
 
 void netTask(void);
 void netTick(void);
+void netFoldCounters(void);
+void netUpdateTcpTimestamp(void);
 
 NetInterface *netGetDefaultInterface(void);
 
@@ -46,17 +46,234 @@
 //Use fixed-size blocks allocation?
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
 
+//End-of-list marker
+#define MEM_POOL_INVALID_INDEX NET_MEM_POOL_BUFFER_COUNT
+
+//Per-task buffer caches?
+#if (NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+
+/**
+ * @brief Per-task buffer cache
+ *
+ * The buffers are only manipulated by the owner of the cache. Other tasks
+ * merely read the ownership fields and raise the flush request flag
+ **/
+
+typedef struct
+{
+   volatile bool_t used;
+   OsTask *volatile owner;
+   volatile bool_t flushRequest;
+   uint_t count;
+   void *buffer[NET_MEM_POOL_CACHE_SIZE];
+   uint_t hits;
+   uint_t misses;
+   uint_t refills;
+} MemPoolCache;
+
+#endif
+
+//Slab allocator for small control objects?
+#if (NET_MEM_SLAB_SUPPORT == ENABLED)
+
+//Number of size classes
+#define MEM_SLAB_CLASS_COUNT 3
+//Block size of the largest size class
+#define MEM_SLAB_MAX_BLOCK_SIZE 256
+//Total size of the storage shared by the size classes
+#define MEM_SLAB_STORAGE_SIZE (NET_MEM_SLAB_64_COUNT * 64 + \
+   NET_MEM_SLAB_128_COUNT * 128 + NET_MEM_SLAB_256_COUNT * 256)
+
+/**
+ * @brief Size class of the slab allocator
+ **/
+
+typedef struct
+{
+   size_t blockSize;
+   uint_t blockCount;
+   uint8_t *memory;
+   void *freeList;
+   uint_t currentUsage;
+   uint_t maxUsage;
+} MemSlab;
+
+#endif
+
 //Mutex preventing simultaneous access to the memory pool
 static OsMutex memPoolMutex;
 //Memory pool
-static uint8_t memPool[NET_MEM_POOL_BUFFER_COUNT][NET_MEM_POOL_BUFFER_SIZE];
-//Allocation table
-static bool_t memPoolAllocTable[NET_MEM_POOL_BUFFER_COUNT];
+#if defined(__ICCARM__) && defined(NET_MEM_POOL_RAM_SECTION)
+#pragma location = NET_MEM_POOL_RAM_SECTION
+#endif
+static uint8_t memPool[NET_MEM_POOL_BUFFER_COUNT][NET_MEM_POOL_BUFFER_SIZE]
+   NET_MEM_POOL_RAM_ATTRIBUTE;
+//Free list (index of the next free block, for each block)
+static uint_t memPoolNextFree[NET_MEM_POOL_BUFFER_COUNT];
+//Index of the first free block
+static uint_t memPoolFreeHead;
+//Number of additional references held on each block
+static uint16_t memPoolRefCount[NET_MEM_POOL_BUFFER_COUNT];
+//Blocks currently handed out to the caller (one state byte per block)
+static uint8_t memPoolAllocated[NET_MEM_POOL_BUFFER_COUNT];
 //Number of buffers currently allocated
 uint_t memPoolCurrentUsage;
 //Maximum number of buffers that have been allocated so far
 uint_t memPoolMaxUsage;
 
+//Per-task buffer caches?
+#if (NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+//Buffer caches
+static MemPoolCache memPoolCache[NET_MEM_POOL_CACHE_COUNT];
+#endif
+
+//Slab allocator for small control objects?
+#if (NET_MEM_SLAB_SUPPORT == ENABLED)
+//Storage shared by the size classes (32-bit words ensure proper alignment)
+static uint32_t memSlabStorage[MEM_SLAB_STORAGE_SIZE / 4];
+//Size classes, sorted by increasing block size
+static MemSlab memSlab[MEM_SLAB_CLASS_COUNT];
+#endif
+
+#endif
+
+
+//Slab allocator for small control objects?
+#if (NET_MEM_POOL_SUPPORT == ENABLED && NET_MEM_SLAB_SUPPORT == ENABLED)
+
+/**
+ * @brief Initialize a size class of the slab allocator
+ * @param[in] slab Pointer to the size class
+ * @param[in] memory Storage area of the size class
+ * @param[in] blockSize Size of each block, in bytes
+ * @param[in] blockCount Number of blocks
+ **/
+
+static void memSlabInit(MemSlab *slab, void *memory,
+   size_t blockSize, uint_t blockCount)
+{
+   uint_t i;
+   uint8_t *p;
+
+   //Save the characteristics of the size class
+   slab->blockSize = blockSize;
+   slab->blockCount = blockCount;
+   slab->memory = memory;
+
+   //Link all the blocks together (the first word of each free
+   //block points to the next free block)
+   for(i = 0; i < blockCount; i++)
+   {
+      p = slab->memory + i * blockSize;
+      *((void **) p) = (i < (blockCount - 1)) ? (p + blockSize) : NULL;
+   }
+
+   //The free list initially contains all the blocks
+   slab->freeList = memory;
+
+   //Clear statistics
+   slab->currentUsage = 0;
+   slab->maxUsage = 0;
+}
+
+
+/**
+ * @brief Allocate a block from the smallest suitable size class
+ *
+ * When a size class is exhausted, the block is taken from the
+ * next larger one
+ *
+ * @param[in] size Bytes to allocate
+ * @return Pointer to the block or NULL if no suitable block is available
+ **/
+
+static void *memSlabAlloc(size_t size)
+{
+   uint_t i;
+   void *p;
+   MemSlab *slab;
+
+   //Pointer to the allocated block
+   p = NULL;
+
+   //Acquire exclusive access to the memory pool
+   osAcquireMutex(&memPoolMutex);
+
+   //Loop through the size classes
+   for(i = 0; i < MEM_SLAB_CLASS_COUNT && p == NULL; i++)
+   {
+      //Point to the current size class
+      slab = &memSlab[i];
+
+      //Check whether the block size and the availability are suitable
+      if(size <= slab->blockSize && slab->freeList != NULL)
+      {
+         //Remove the first block from the free list
+         p = slab->freeList;
+         slab->freeList = *((void **) p);
+
+         //Update statistics
+         slab->currentUsage++;
+         slab->maxUsage = MAX(slab->currentUsage, slab->maxUsage);
+      }
+   }
+
+   //Release exclusive access to the memory pool
+   osReleaseMutex(&memPoolMutex);
+
+   //Return a pointer to the allocated block
+   return p;
+}
+
+
+/**
+ * @brief Release a block that belongs to the slab allocator
+ * @param[in] p Pointer to any location within the block
+ * @return TRUE if the block has been released, FALSE if the pointer
+ *   does not belong to the slab allocator
+ **/
+
+static bool_t memSlabFree(void *p)
+{
+   uint_t i;
+   size_t offset;
+   MemSlab *slab;
+
+   //Loop through the size classes
+   for(i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+   {
+      //Point to the current size class
+      slab = &memSlab[i];
+
+      //Check whether the pointer belongs to the current size class
+      if((uint8_t *) p >= slab->memory &&
+         (uint8_t *) p < (slab->memory + slab->blockCount * slab->blockSize))
+      {
+         //Retrieve the beginning of the block
+         offset = ((uint8_t *) p - slab->memory) / slab->blockSize;
+         p = slab->memory + offset * slab->blockSize;
+
+         //Acquire exclusive access to the memory pool
+         osAcquireMutex(&memPoolMutex);
+
+         //Insert the block at the head of the free list
+         *((void **) p) = slab->freeList;
+         slab->freeList = p;
+         //Update statistics
+         slab->currentUsage--;
+
+         //Release exclusive access to the memory pool
+         osReleaseMutex(&memPoolMutex);
+
+         //The block has been released
+         return TRUE;
+      }
+   }
+
+   //The pointer does not belong to the slab allocator
+   return FALSE;
+}
+
 #endif
 
 
@@ -69,6 +286,8 @@ error_t memPoolInit(void)
 {
 //Use fixed-size blocks allocation?
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
+   uint_t i;
+
    //Create a mutex to prevent simultaneous access to the memory pool
    if(!osCreateMutex(&memPoolMutex))
    {
@@ -76,12 +295,38 @@ error_t memPoolInit(void)
       return ERROR_OUT_OF_RESOURCES;
    }
 
-   //Clear allocation table
-   memset(memPoolAllocTable, 0, sizeof(memPoolAllocTable));
+   //Link all the blocks together
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+      memPoolNextFree[i] = i + 1;
+
+   //The free list initially contains all the blocks
+   memPoolFreeHead = 0;
+   //No additional reference is held
+   memset(memPoolRefCount, 0, sizeof(memPoolRefCount));
+
+   //No block has been handed out yet
+   memset(memPoolAllocated, 0, sizeof(memPoolAllocated));
 
    //Clear statistics
    memPoolCurrentUsage = 0;
    memPoolMaxUsage = 0;
+
+//Per-task buffer caches?
+#if (NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+   //All the caches are initially unused
+   memset((void *) memPoolCache, 0, sizeof(memPoolCache));
+#endif
+
+//Slab allocator for small control objects?
+#if (NET_MEM_SLAB_SUPPORT == ENABLED)
+   //Initialize the size classes
+   memSlabInit(&memSlab[0], (uint8_t *) memSlabStorage,
+      64, NET_MEM_SLAB_64_COUNT);
+   memSlabInit(&memSlab[1], memSlab[0].memory + NET_MEM_SLAB_64_COUNT * 64,
+      128, NET_MEM_SLAB_128_COUNT);
+   memSlabInit(&memSlab[2], memSlab[1].memory + NET_MEM_SLAB_128_COUNT * 128,
+      256, NET_MEM_SLAB_256_COUNT);
+#endif
 #endif
 
    //Successful initialization
@@ -89,6 +334,168 @@ error_t memPoolInit(void)
 }
 
 
+//Use fixed-size blocks allocation?
+#if (NET_MEM_POOL_SUPPORT == ENABLED)
+
+/**
+ * @brief Take a block from the free list
+ *
+ * The caller must hold the memory pool mutex
+ *
+ * @return Pointer to the block or NULL if the pool is exhausted
+ **/
+
+static void *memPoolGetBlock(void)
+{
+   uint_t i;
+
+   //No free block available?
+   if(memPoolFreeHead == MEM_POOL_INVALID_INDEX)
+      return NULL;
+
+   //Retrieve the first free block
+   i = memPoolFreeHead;
+   //Remove it from the free list
+   memPoolFreeHead = memPoolNextFree[i];
+
+   //Update statistics
+   memPoolCurrentUsage++;
+   //Maximum number of buffers that have been allocated so far
+   memPoolMaxUsage = MAX(memPoolCurrentUsage, memPoolMaxUsage);
+
+   //Point to the corresponding memory block
+   return memPool[i];
+}
+
+
+/**
+ * @brief Return a block to the free list
+ *
+ * The caller must hold the memory pool mutex
+ *
+ * @param[in] p Pointer to the block
+ **/
+
+static void memPoolPutBlock(void *p)
+{
+   uint_t i;
+
+   //Retrieve the index of the block
+   i = ((uint8_t *) p - memPool[0]) / NET_MEM_POOL_BUFFER_SIZE;
+
+   //Insert the block at the head of the free list
+   memPoolNextFree[i] = memPoolFreeHead;
+   memPoolFreeHead = i;
+
+   //Update statistics
+   memPoolCurrentUsage--;
+}
+
+#endif
+
+//Per-task buffer caches?
+#if (NET_MEM_POOL_SUPPORT == ENABLED && NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+
+/**
+ * @brief Retrieve the buffer cache of the calling task
+ *
+ * Each task is statically mapped to a single cache by hashing its handle,
+ * so the lookup involves neither a search nor a mutex. The memory pool
+ * mutex is only taken when binding a free cache. A task whose cache is
+ * owned by another task uses the pool directly
+ *
+ * @param[in] bind Bind the cache if it is free
+ * @return Pointer to the cache owned by the calling task or NULL if none
+ *   is available
+ **/
+
+static MemPoolCache *memPoolGetCache(bool_t bind)
+{
+   uint32_t h;
+   OsTask *task;
+   MemPoolCache *cache;
+
+   //Identify the calling task
+   task = osGetCurrentTask();
+
+   //Hash the task handle (Fibonacci hashing)
+   h = (uint32_t) ((uintptr_t) task >> 2) * 0x9E3779B1;
+   //Point to the cache assigned to the task
+   cache = &memPoolCache[(h >> 16) % NET_MEM_POOL_CACHE_COUNT];
+
+   //The cache is only bound and released by its owner, so the test
+   //is reliable without holding any lock
+   if(cache->used && cache->owner == task)
+      return cache;
+
+   //The cache belongs to another task?
+   if(cache->used || !bind)
+      return NULL;
+
+   //Acquire exclusive access to the memory pool
+   osAcquireMutex(&memPoolMutex);
+
+   //Another task may have bound the cache in the meantime
+   if(!cache->used)
+   {
+      //Bind the cache to the calling task
+      cache->owner = task;
+      cache->flushRequest = FALSE;
+      cache->used = TRUE;
+   }
+
+   //Release exclusive access to the memory pool
+   osReleaseMutex(&memPoolMutex);
+
+   //Return the cache only if the calling task owns it
+   return (cache->owner == task) ? cache : NULL;
+}
+
+
+/**
+ * @brief Return the buffers held by a cache to the pool
+ *
+ * Only the owner of the cache (or a task releasing the cache of a deleted
+ * task) may call this function. The caller must hold the memory pool mutex
+ *
+ * @param[in] cache Pointer to the cache
+ * @param[in] count Number of buffers to keep in the cache
+ **/
+
+static void memPoolDrainCache(MemPoolCache *cache, uint_t count)
+{
+   //Return the surplus buffers to the pool
+   while(cache->count > count)
+      memPoolPutBlock(cache->buffer[--cache->count]);
+}
+
+
+/**
+ * @brief Ask the owners of the caches to return their buffers
+ *
+ * This function is called when the pool is exhausted. Each owner returns
+ * its buffers to the pool on its next allocation or release, so that a
+ * subsequent allocation may succeed
+ *
+ * @param[in] self Cache of the calling task (may be NULL)
+ **/
+
+static void memPoolRequestFlush(MemPoolCache *self)
+{
+   uint_t i;
+
+   //Loop through the caches
+   for(i = 0; i < NET_MEM_POOL_CACHE_COUNT; i++)
+   {
+      //Only caches holding buffers are concerned
+      if(&memPoolCache[i] != self && memPoolCache[i].count > 0)
+         memPoolCache[i].flushRequest = TRUE;
+   }
+}
+
+#endif
+
+
 /**
  * @brief Allocate a memory block
  * @param[in] size Bytes to allocate
@@ -97,8 +504,8 @@ error_t memPoolInit(void)
 
 void *memPoolAlloc(size_t size)
 {
-#if (NET_MEM_POOL_SUPPORT == ENABLED)
-   uint_t i;
+#if (NET_MEM_POOL_SUPPORT == ENABLED && NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+   MemPoolCache *cache;
 #endif
 
    //Pointer to the allocated memory block
@@ -109,36 +516,107 @@ void *memPoolAlloc(size_t size)
 
 //Use fixed-size blocks allocation?
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
-   //Acquire exclusive access to the memory pool
-   osAcquireMutex(&memPoolMutex);
+//Slab allocator for small control objects?
+#if (NET_MEM_SLAB_SUPPORT == ENABLED)
+   //Small objects do not consume a whole packet buffer
+   if(size <= MEM_SLAB_MAX_BLOCK_SIZE)
+      p = memSlabAlloc(size);
+#endif
 
    //Enforce block size
-   if(size <= NET_MEM_POOL_BUFFER_SIZE)
+   if(p == NULL && size <= NET_MEM_POOL_BUFFER_SIZE)
    {
-      //Loop through allocation table
-      for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+//Per-task buffer caches?
+#if (NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+      //Retrieve the cache of the calling task
+      cache = memPoolGetCache(TRUE);
+
+      //Any cache available?
+      if(cache != NULL)
       {
-         //Check whether the current block is free
-         if(!memPoolAllocTable[i])
+         //Another task ran out of buffers?
+         if(cache->flushRequest)
+         {
+            //Clear the request before handling it
+            cache->flushRequest = FALSE;
+
+            //Acquire exclusive access to the memory pool
+            osAcquireMutex(&memPoolMutex);
+            //Return all the cached buffers to the pool
+            memPoolDrainCache(cache, 0);
+            //Take a single block, without refilling the cache
+            p = memPoolGetBlock();
+            //Release exclusive access to the memory pool
+            osReleaseMutex(&memPoolMutex);
+         }
+         //Empty cache?
+         else if(cache->count == 0)
          {
-            //Mark the current entry as used
-            memPoolAllocTable[i] = TRUE;
-            //Point to the corresponding memory block
-            p = memPool[i];
-
             //Update statistics
-            memPoolCurrentUsage++;
-            //Maximum number of buffers that have been allocated so far
-            memPoolMaxUsage = MAX(memPoolCurrentUsage, memPoolMaxUsage);
+            cache->misses++;
+
+            //Acquire exclusive access to the memory pool
+            osAcquireMutex(&memPoolMutex);
+
+            //Refill the cache with a batch of buffers
+            while(cache->count < NET_MEM_POOL_CACHE_BATCH)
+            {
+               //Take a block from the pool
+               p = memPoolGetBlock();
+               //Pool exhausted?
+               if(p == NULL)
+                  break;
+
+               //Save the block in the cache
+               cache->buffer[cache->count++] = p;
+            }
+
+            //Release exclusive access to the memory pool
+            osReleaseMutex(&memPoolMutex);
 
-            //Exit immediately
-            break;
+            //The block is taken from the cache below
+            p = NULL;
+
+            //Any buffer transferred from the pool?
+            if(cache->count > 0)
+               cache->refills++;
+         }
+         else
+         {
+            //The request is served without taking any mutex
+            cache->hits++;
          }
+
+         //Take the most recently released buffer
+         if(p == NULL && cache->count > 0)
+            p = cache->buffer[--cache->count];
       }
+      else
+#endif
+      {
+         //Acquire exclusive access to the memory pool
+         osAcquireMutex(&memPoolMutex);
+         //Take a block from the pool
+         p = memPoolGetBlock();
+         //Release exclusive access to the memory pool
+         osReleaseMutex(&memPoolMutex);
+      }
+
+//Per-task buffer caches?
+#if (NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+      //The pool is exhausted, but other tasks may still cache free buffers
+      if(p == NULL)
+         memPoolRequestFlush(cache);
+#endif
    }
 
-   //Release exclusive access to the memory pool
-   osReleaseMutex(&memPoolMutex);
+   //Check whether the block belongs to the memory pool
+   if((uint8_t *) p >= memPool[0] &&
+      (uint8_t *) p < memPool[NET_MEM_POOL_BUFFER_COUNT])
+   {
+      //The block is now owned by the caller
+      memPoolAllocated[((uint8_t *) p - memPool[0]) / NET_MEM_POOL_BUFFER_SIZE] = TRUE;
+   }
 #else
    //Allocate a memory block
    p = osAllocMem(size);
@@ -158,6 +636,10 @@ void *memPoolAlloc(size_t size)
 
 /**
  * @brief Release a memory block
+ *
+ * When additional references have been taken with memPoolHold, the
+ * block is returned to the pool only when the last reference is dropped
+ *
  * @param[in] p Previously allocated memory block to be freed
  **/
 
@@ -166,37 +648,181 @@ void memPoolFree(void *p)
 //Use fixed-size blocks allocation?
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
    uint_t i;
+#if (NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+   MemPoolCache *cache;
+#endif
 
-   //Acquire exclusive access to the memory pool
-   osAcquireMutex(&memPoolMutex);
+//Slab allocator for small control objects?
+#if (NET_MEM_SLAB_SUPPORT == ENABLED)
+   //The block may belong to one of the size classes
+   if((uint8_t *) p >= (uint8_t *) memSlabStorage &&
+      (uint8_t *) p < (uint8_t *) memSlabStorage + MEM_SLAB_STORAGE_SIZE)
+   {
+      //Release the block
+      memSlabFree(p);
+      return;
+   }
+#endif
 
-   //Loop through allocation table
-   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+   //Make sure the pointer belongs to the memory pool
+   if((uint8_t *) p < memPool[0] ||
+      (uint8_t *) p >= memPool[NET_MEM_POOL_BUFFER_COUNT])
+   {
+      return;
+   }
+
+   //Retrieve the index of the block
+   i = ((uint8_t *) p - memPool[0]) / NET_MEM_POOL_BUFFER_SIZE;
+   //The pointer may designate any location within the block
+   p = memPool[i];
+
+   //Any additional reference held on the block?
+   if(memPoolRefCount[i] > 0)
    {
-      if(memPool[i] == p)
+      //Acquire exclusive access to the memory pool
+      osAcquireMutex(&memPoolMutex);
+
+      //Check the reference count again while holding the mutex
+      if(memPoolRefCount[i] > 0)
       {
-         //Mark the current block as free
-         memPoolAllocTable[i] = FALSE;
+         //Drop one reference
+         memPoolRefCount[i]--;
+         //Release exclusive access to the memory pool
+         osReleaseMutex(&memPoolMutex);
+         //The block is still in use
+         return;
+      }
 
-         //Update statistics
-         memPoolCurrentUsage--;
+      //Release exclusive access to the memory pool
+      osReleaseMutex(&memPoolMutex);
+   }
 
-         //Exit immediately
-         break;
+   //Linking a block that is already free would create a cycle in the
+   //free list and the block would then be handed out twice
+   if(!memPoolAllocated[i])
+   {
+//Report double frees?
+#if (NET_MEM_POOL_CHECK_SUPPORT == ENABLED)
+      //Debug message
+      TRACE_ERROR("Double free of memory block %u detected!\r\n", i);
+#endif
+      //Leave the free list untouched
+      return;
+   }
+
+   //The block is no longer owned by the caller
+   memPoolAllocated[i] = FALSE;
+
+//Per-task buffer caches?
+#if (NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+   //Retrieve the cache of the calling task
+   cache = memPoolGetCache(TRUE);
+
+   //Any cache available?
+   if(cache != NULL)
+   {
+      //Another task ran out of buffers?
+      if(cache->flushRequest)
+      {
+         //Clear the request before handling it
+         cache->flushRequest = FALSE;
+
+         //Acquire exclusive access to the memory pool
+         osAcquireMutex(&memPoolMutex);
+         //Return all the cached buffers to the pool
+         memPoolDrainCache(cache, 0);
+         //Return the block to the pool
+         memPoolPutBlock(p);
+         //Release exclusive access to the memory pool
+         osReleaseMutex(&memPoolMutex);
       }
+      else
+      {
+         //Full cache?
+         if(cache->count >= NET_MEM_POOL_CACHE_SIZE)
+         {
+            //Acquire exclusive access to the memory pool
+            osAcquireMutex(&memPoolMutex);
+            //Return a batch of buffers to the pool
+            memPoolDrainCache(cache, NET_MEM_POOL_CACHE_SIZE - NET_MEM_POOL_CACHE_BATCH);
+            //Release exclusive access to the memory pool
+            osReleaseMutex(&memPoolMutex);
+         }
+
+         //Keep the buffer in the cache
+         cache->buffer[cache->count++] = p;
+      }
+   }
+   else
+#endif
+   {
+      //Acquire exclusive access to the memory pool
+      osAcquireMutex(&memPoolMutex);
+      //Return the block to the pool
+      memPoolPutBlock(p);
+      //Release exclusive access to the memory pool
+      osReleaseMutex(&memPoolMutex);
+   }
+#else
+   //Release memory block
+   osFreeMem(p);
+#endif
+}
+
+
+/**
+ * @brief Hold an additional reference on a memory block
+ *
+ * The block is returned to the pool only when memPoolFree has been
+ * called once for the original allocation and once for each reference
+ * taken with this function
+ *
+ * @param[in] p Pointer to any location within the block
+ * @return TRUE if the reference has been taken, FALSE if the pointer
+ *   does not designate an allocated block of the memory pool
+ **/
+
+bool_t memPoolHold(const void *p)
+{
+//Use fixed-size blocks allocation?
+#if (NET_MEM_POOL_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Make sure the pointer belongs to the memory pool
+   if((const uint8_t *) p < memPool[0] ||
+      (const uint8_t *) p >= memPool[NET_MEM_POOL_BUFFER_COUNT])
+   {
+      return FALSE;
    }
 
+   //Retrieve the index of the block
+   i = ((const uint8_t *) p - memPool[0]) / NET_MEM_POOL_BUFFER_SIZE;
+
+   //A reference cannot be taken on a free block
+   if(!memPoolAllocated[i])
+      return FALSE;
+
+   //Acquire exclusive access to the memory pool
+   osAcquireMutex(&memPoolMutex);
+   //Take one more reference
+   memPoolRefCount[i]++;
    //Release exclusive access to the memory pool
    osReleaseMutex(&memPoolMutex);
+
+   //The block will not be released until the reference is dropped
+   return TRUE;
 #else
-   //Release memory block
-   osFreeMem(p);
+   //Dynamically allocated blocks cannot be shared
+   return FALSE;
 #endif
 }
 
 
 /**
  * @brief Get memory pool usage
+ *
+ * Blocks served by the slab allocator are reported by memPoolGetSlabStats()
+ *
  * @param[out] currentUsage Number of buffers currently allocated
  * @param[out] maxUsage Maximum number of buffers that have been allocated so far
  * @param[out] size Total number of buffers in the memory pool
@@ -206,9 +832,24 @@ void memPoolGetStats(uint_t *currentUsage, uint_t *maxUsage, uint_t *size)
 {
 //Use fixed-size blocks allocation?
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
+   uint_t n;
+#if (NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+   uint_t i;
+#endif
+
+   //Number of blocks taken from the free list
+   n = memPoolCurrentUsage;
+
+//Per-task buffer caches?
+#if (NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+   //Buffers held in a cache are free
+   for(i = 0; i < NET_MEM_POOL_CACHE_COUNT; i++)
+      n -= MIN(memPoolCache[i].count, n);
+#endif
+
    //Number of buffers currently allocated
    if(currentUsage != NULL)
-      *currentUsage = memPoolCurrentUsage;
+      *currentUsage = n;
 
    //Maximum number of buffers that have been allocated so far
    if(maxUsage != NULL)
@@ -230,6 +871,163 @@ void memPoolGetStats(uint_t *currentUsage, uint_t *maxUsage, uint_t *size)
 #endif
 }
 
+/**
+ * @brief Get the usage of a size class of the slab allocator
+ * @param[in] blockSize Block size of the size class (64, 128 or 256)
+ * @param[out] currentUsage Number of blocks currently allocated
+ * @param[out] maxUsage Maximum number of blocks that have been allocated so far
+ * @param[out] size Total number of blocks in the size class
+ **/
+
+void memPoolGetSlabStats(size_t blockSize, uint_t *currentUsage,
+   uint_t *maxUsage, uint_t *size)
+{
+#if (NET_MEM_POOL_SUPPORT == ENABLED && NET_MEM_SLAB_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Search for the specified size class
+   for(i = 0; i < MEM_SLAB_CLASS_COUNT; i++)
+   {
+      if(memSlab[i].blockSize == blockSize)
+         break;
+   }
+
+   //Size class found?
+   if(i < MEM_SLAB_CLASS_COUNT)
+   {
+      //Number of blocks currently allocated
+      if(currentUsage != NULL)
+         *currentUsage = memSlab[i].currentUsage;
+
+      //Maximum number of blocks that have been allocated so far
+      if(maxUsage != NULL)
+         *maxUsage = memSlab[i].maxUsage;
+
+      //Total number of blocks in the size class
+      if(size != NULL)
+         *size = memSlab[i].blockCount;
+
+      //We are done
+      return;
+   }
+#endif
+
+   //The size class is not used...
+   if(currentUsage != NULL)
+      *currentUsage = 0;
+
+   if(maxUsage != NULL)
+      *maxUsage = 0;
+
+   if(size != NULL)
+      *size = 0;
+}
+
+
+/**
+ * @brief Get per-task buffer cache statistics
+ *
+ * Buffers held in a cache are reported as free by memPoolGetStats()
+ *
+ * @param[out] hits Number of allocations served without taking the pool mutex
+ * @param[out] misses Number of allocations that found an empty cache
+ * @param[out] refills Number of batches transferred from the pool to a cache
+ **/
+
+void memPoolGetCacheStats(uint_t *hits, uint_t *misses, uint_t *refills)
+{
+#if (NET_MEM_POOL_SUPPORT == ENABLED && NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+   uint_t i;
+   uint_t totalHits;
+   uint_t totalMisses;
+   uint_t totalRefills;
+
+   //Initialize counters
+   totalHits = 0;
+   totalMisses = 0;
+   totalRefills = 0;
+
+   //Each cache maintains its own set of counters
+   for(i = 0; i < NET_MEM_POOL_CACHE_COUNT; i++)
+   {
+      totalHits += memPoolCache[i].hits;
+      totalMisses += memPoolCache[i].misses;
+      totalRefills += memPoolCache[i].refills;
+   }
+
+   //Number of allocations served from a cache
+   if(hits != NULL)
+      *hits = totalHits;
+
+   //Number of allocations that required access to the pool
+   if(misses != NULL)
+      *misses = totalMisses;
+
+   //Number of batches transferred from the pool
+   if(refills != NULL)
+      *refills = totalRefills;
+#else
+   //Buffer caches are not used...
+   if(hits != NULL)
+      *hits = 0;
+
+   if(misses != NULL)
+      *misses = 0;
+
+   if(refills != NULL)
+      *refills = 0;
+#endif
+}
+
+
+/**
+ * @brief Release the buffer cache of a task
+ *
+ * All the buffers held by the cache are returned to the pool and the cache
+ * becomes available for another task. This function must be called by a
+ * task before it deletes itself. It may also be called by another task,
+ * once the owner has been deleted, with the handle the owner obtained from
+ * osGetCurrentTask()
+ *
+ * @param[in] task Task being deleted (NULL for the calling task)
+ **/
+
+void memPoolFlushCache(OsTask *task)
+{
+#if (NET_MEM_POOL_SUPPORT == ENABLED && NET_MEM_POOL_CACHE_SUPPORT == ENABLED)
+   uint_t i;
+   MemPoolCache *cache;
+
+   //Release the cache of the calling task?
+   if(task == NULL)
+      task = osGetCurrentTask();
+
+   //Acquire exclusive access to the memory pool
+   osAcquireMutex(&memPoolMutex);
+
+   //Search the cache owned by the specified task
+   for(i = 0; i < NET_MEM_POOL_CACHE_COUNT; i++)
+   {
+      //Point to the current cache
+      cache = &memPoolCache[i];
+
+      //Matching entry?
+      if(cache->used && cache->owner == task)
+      {
+         //Return all the cached buffers to the pool
+         memPoolDrainCache(cache, 0);
+
+         //The cache is now available for another task
+         cache->used = FALSE;
+         cache->owner = NULL;
+      }
+   }
+
+   //Release exclusive access to the memory pool
+   osReleaseMutex(&memPoolMutex);
+#endif
+}
+
 
 /**
  * @brief Allocate a multi-part buffer
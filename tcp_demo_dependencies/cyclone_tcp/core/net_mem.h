@@ -71,6 +71,77 @@
    #error NET_MEM_POOL_BUFFER_SIZE parameter is not valid
 #endif
 
+//Report double frees (they are always detected and ignored)
+#ifndef NET_MEM_POOL_CHECK_SUPPORT
+   #define NET_MEM_POOL_CHECK_SUPPORT DISABLED
+#elif (NET_MEM_POOL_CHECK_SUPPORT != ENABLED && NET_MEM_POOL_CHECK_SUPPORT != DISABLED)
+   #error NET_MEM_POOL_CHECK_SUPPORT parameter is not valid
+#endif
+
+//Per-task buffer caches
+#ifndef NET_MEM_POOL_CACHE_SUPPORT
+   #define NET_MEM_POOL_CACHE_SUPPORT DISABLED
+#elif (NET_MEM_POOL_CACHE_SUPPORT != ENABLED && NET_MEM_POOL_CACHE_SUPPORT != DISABLED)
+   #error NET_MEM_POOL_CACHE_SUPPORT parameter is not valid
+#endif
+
+//Linker section holding the memory pool (it must be reachable by the DMA
+//of the drivers that use zero-copy receive or transmit)
+#if defined(NET_MEM_POOL_RAM_SECTION) && !defined(__ICCARM__)
+   #define NET_MEM_POOL_RAM_ATTRIBUTE __attribute__((section(NET_MEM_POOL_RAM_SECTION)))
+#else
+   #define NET_MEM_POOL_RAM_ATTRIBUTE
+#endif
+
+//Number of per-task buffer caches (each task is hashed to one of them)
+#ifndef NET_MEM_POOL_CACHE_COUNT
+   #define NET_MEM_POOL_CACHE_COUNT 4
+#elif (NET_MEM_POOL_CACHE_COUNT < 1)
+   #error NET_MEM_POOL_CACHE_COUNT parameter is not valid
+#endif
+
+//Maximum number of buffers held by a cache
+#ifndef NET_MEM_POOL_CACHE_SIZE
+   #define NET_MEM_POOL_CACHE_SIZE 8
+#elif (NET_MEM_POOL_CACHE_SIZE < 2)
+   #error NET_MEM_POOL_CACHE_SIZE parameter is not valid
+#endif
+
+//Number of buffers moved between a cache and the pool at once
+#ifndef NET_MEM_POOL_CACHE_BATCH
+   #define NET_MEM_POOL_CACHE_BATCH (NET_MEM_POOL_CACHE_SIZE / 2)
+#elif (NET_MEM_POOL_CACHE_BATCH < 1 || NET_MEM_POOL_CACHE_BATCH > NET_MEM_POOL_CACHE_SIZE)
+   #error NET_MEM_POOL_CACHE_BATCH parameter is not valid
+#endif
+
+//Slab allocator for small control objects
+#ifndef NET_MEM_SLAB_SUPPORT
+   #define NET_MEM_SLAB_SUPPORT DISABLED
+#elif (NET_MEM_SLAB_SUPPORT != ENABLED && NET_MEM_SLAB_SUPPORT != DISABLED)
+   #error NET_MEM_SLAB_SUPPORT parameter is not valid
+#endif
+
+//Number of 64-byte blocks
+#ifndef NET_MEM_SLAB_64_COUNT
+   #define NET_MEM_SLAB_64_COUNT 16
+#elif (NET_MEM_SLAB_64_COUNT < 1)
+   #error NET_MEM_SLAB_64_COUNT parameter is not valid
+#endif
+
+//Number of 128-byte blocks
+#ifndef NET_MEM_SLAB_128_COUNT
+   #define NET_MEM_SLAB_128_COUNT 16
+#elif (NET_MEM_SLAB_128_COUNT < 1)
+   #error NET_MEM_SLAB_128_COUNT parameter is not valid
+#endif
+
+//Number of 256-byte blocks
+#ifndef NET_MEM_SLAB_256_COUNT
+   #define NET_MEM_SLAB_256_COUNT 32
+#elif (NET_MEM_SLAB_256_COUNT < 1)
+   #error NET_MEM_SLAB_256_COUNT parameter is not valid
+#endif
+
 //Size of the header part of the buffer
 #define CHUNKED_BUFFER_HEADER_SIZE (sizeof(NetBuffer) + MAX_CHUNK_COUNT * sizeof(ChunkDesc))
 
@@ -119,7 +190,12 @@ typedef struct
 error_t memPoolInit(void);
 void *memPoolAlloc(size_t size);
 void memPoolFree(void *p);
+bool_t memPoolHold(const void *p);
 void memPoolGetStats(uint_t *currentUsage, uint_t *maxUsage, uint_t *size);
+void memPoolGetCacheStats(uint_t *hits, uint_t *misses, uint_t *refills);
+void memPoolGetSlabStats(size_t blockSize, uint_t *currentUsage,
+   uint_t *maxUsage, uint_t *size);
+void memPoolFlushCache(OsTask *task);
 
 NetBuffer *netBufferAlloc(size_t length);
 void netBufferFree(NetBuffer *buffer);
@@ -209,6 +209,124 @@ void nicProcessPacket(NetInterface *interface, void *packet, size_t length)
 }
 
 
+/**
+ * @brief Handle a packet whose buffer may be kept by the upper layers
+ *
+ * The buffer must have been allocated with memPoolAlloc() and the packet
+ * must be located at the start of the buffer. When the function returns
+ * TRUE, the buffer belongs to the upper layers, which will release it using
+ * memPoolFree(), and the driver must provide a new receive buffer
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] packet Incoming packet to process
+ * @param[in] length Total packet length
+ * @param[in] size Size of the buffer that holds the packet
+ * @return TRUE if the buffer has been kept by the upper layers, else FALSE
+ **/
+
+bool_t nicProcessLoanablePacket(NetInterface *interface,
+   void *packet, size_t length, size_t size)
+{
+   bool_t loaned;
+
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   //Check whether the driver is able to loan its receive buffers
+   if(interface->nicDriver->zeroCopyRx)
+   {
+      //The buffer can be kept while the packet is being processed
+      interface->nicRxLoanBuffer = packet;
+      interface->nicRxLoanLength = length;
+      interface->nicRxLoanSize = size;
+      interface->nicRxLoaned = FALSE;
+   }
+#endif
+
+   //Process incoming packet
+   nicProcessPacket(interface, packet, length);
+
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   //Check whether the buffer has been kept by the upper layers
+   loaned = interface->nicRxLoaned;
+
+   //The buffer cannot be loaned anymore
+   interface->nicRxLoanBuffer = NULL;
+   interface->nicRxLoaned = FALSE;
+#else
+   //Zero-copy receive is not supported
+   loaned = FALSE;
+#endif
+
+   //Return TRUE if the buffer now belongs to the upper layers
+   return loaned;
+}
+
+
+/**
+ * @brief Take ownership of the buffer that holds the packet being processed
+ *
+ * The unused space that follows the packet can be used by the caller
+ * to store its own bookkeeping information. The interface that received
+ * the packet is found from the location of the data
+ *
+ * @param[in] data Pointer to the data that must remain valid
+ * @param[in] length Length of the data
+ * @param[in] size Number of bytes to reserve after the packet
+ * @param[out] buffer Start of the buffer, to be released using memPoolFree()
+ * @return Pointer to the reserved area or NULL if the buffer cannot be loaned
+ **/
+
+void *nicLoanRxBuffer(const void *data, size_t length,
+   size_t size, void **buffer)
+{
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   uint_t i;
+   size_t offset;
+   NetInterface *interface;
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      //Point to the current interface
+      interface = &netInterface[i];
+
+      //Any buffer available for loan?
+      if(interface->nicRxLoanBuffer == NULL || interface->nicRxLoaned)
+         continue;
+
+      //Make sure the data lies within the packet
+      if((const uint8_t *) data < interface->nicRxLoanBuffer ||
+         (const uint8_t *) data + length > interface->nicRxLoanBuffer +
+         interface->nicRxLoanLength)
+      {
+         continue;
+      }
+
+      //The reserved area immediately follows the packet, aligned on the
+      //size of a pointer so that it can hold any bookkeeping structure
+      offset = (interface->nicRxLoanLength + sizeof(void *) - 1) &
+         ~(sizeof(void *) - 1);
+
+      //Make sure there is enough room left in the buffer
+      if((offset + size) > interface->nicRxLoanSize)
+         return NULL;
+
+      //The upper layers now own the buffer
+      interface->nicRxLoaned = TRUE;
+      *buffer = interface->nicRxLoanBuffer;
+
+      //Return a pointer to the reserved area
+      return interface->nicRxLoanBuffer + offset;
+   }
+
+   //The data does not belong to a packet available for loan
+   return NULL;
+#else
+   //Zero-copy receive is not supported
+   return NULL;
+#endif
+}
+
+
 /**
  * @brief Process link state change event
  * @param[in] interface Underlying network interface
@@ -335,3 +453,158 @@ void nicNotifyLinkChange(NetInterface *interface)
    //Disable interrupts
    interface->nicDriver->disableIrq(interface);
 }
+
+
+/**
+ * @brief Initialize a TX descriptor ring
+ * @param[in] ring TX descriptor ring
+ * @param[in] heldBuffer Array holding the references of each descriptor
+ * @param[in] size Number of descriptors
+ **/
+
+void nicTxRingInit(NicTxRing *ring, void *(*heldBuffer)[2], uint_t size)
+{
+   uint_t i;
+
+   //No buffer is attached to the descriptors
+   for(i = 0; i < size; i++)
+   {
+      heldBuffer[i][0] = NULL;
+      heldBuffer[i][1] = NULL;
+   }
+
+   //All the descriptors are available
+   ring->size = size;
+   ring->curIndex = 0;
+   ring->dirtyIndex = 0;
+   ring->pendingCount = 0;
+   ring->heldBuffer = heldBuffer;
+}
+
+
+/**
+ * @brief Get the number of descriptors available for writing
+ * @param[in] ring TX descriptor ring
+ * @return Number of free descriptors
+ **/
+
+uint_t nicTxRingGetFreeCount(const NicTxRing *ring)
+{
+   //Descriptors that have not been reclaimed cannot be reused
+   return ring->size - ring->pendingCount;
+}
+
+
+/**
+ * @brief Attach a memory pool reference to a DMA buffer of the next frame
+ *
+ * The DMA buffers of a frame are numbered from 0, starting with buffer 1
+ * of the current descriptor. The caller must own a reference on the
+ * block, which is dropped when the descriptor is reclaimed
+ *
+ * @param[in] ring TX descriptor ring
+ * @param[in] n Index of the DMA buffer within the frame
+ * @param[in] p Pointer to the data held by the DMA buffer
+ * @return Index of the descriptor the buffer belongs to
+ **/
+
+uint_t nicTxRingAttachBuffer(NicTxRing *ring, uint_t n, void *p)
+{
+   uint_t index;
+
+   //Even buffers use buffer 1 while odd buffers use buffer 2
+   index = (ring->curIndex + n / 2) % ring->size;
+   ring->heldBuffer[index][n % 2] = p;
+
+   //Return the index of the descriptor
+   return index;
+}
+
+
+/**
+ * @brief Drop the references attached to a frame that will not be sent
+ * @param[in] ring TX descriptor ring
+ * @param[in] n Number of DMA buffers attached so far
+ **/
+
+void nicTxRingDetachBuffers(NicTxRing *ring, uint_t n)
+{
+   uint_t i;
+   uint_t index;
+
+   //Loop through the DMA buffers of the frame
+   for(i = 0; i < n; i++)
+   {
+      //Point to the relevant descriptor
+      index = (ring->curIndex + i / 2) % ring->size;
+
+      //Drop the reference
+      memPoolFree(ring->heldBuffer[index][i % 2]);
+      ring->heldBuffer[index][i % 2] = NULL;
+   }
+}
+
+
+/**
+ * @brief Account for the descriptors handed to the DMA
+ * @param[in] ring TX descriptor ring
+ * @param[in] count Number of descriptors used by the frame
+ **/
+
+void nicTxRingCommit(NicTxRing *ring, uint_t count)
+{
+   //Point to the next free descriptor
+   ring->curIndex = (ring->curIndex + count) % ring->size;
+   //Update the number of descriptors in use
+   ring->pendingCount += count;
+}
+
+
+/**
+ * @brief Release the buffers of the descriptors processed by the DMA
+ *
+ * Descriptors are reclaimed in the order they were handed to the DMA,
+ * up to the first one the DMA still owns
+ *
+ * @param[in] ring TX descriptor ring
+ * @param[in] owned Driver callback telling whether the DMA owns a descriptor
+ * @return Number of descriptors reclaimed
+ **/
+
+uint_t nicTxRingReclaim(NicTxRing *ring, NicTxDescOwned owned)
+{
+   uint_t i;
+   uint_t n;
+
+   //Number of descriptors reclaimed so far
+   n = 0;
+
+   //Process the descriptors in the order they were handed to the DMA
+   while(ring->pendingCount > 0)
+   {
+      //Point to the oldest descriptor
+      i = ring->dirtyIndex;
+
+      //The DMA has not yet processed the descriptor?
+      if(owned(i))
+         break;
+
+      //Drop the references held by the descriptor
+      if(ring->heldBuffer[i][0] != NULL)
+         memPoolFree(ring->heldBuffer[i][0]);
+      if(ring->heldBuffer[i][1] != NULL)
+         memPoolFree(ring->heldBuffer[i][1]);
+
+      //The descriptor is free
+      ring->heldBuffer[i][0] = NULL;
+      ring->heldBuffer[i][1] = NULL;
+
+      //Point to the next descriptor
+      ring->dirtyIndex = (i + 1) % ring->size;
+      ring->pendingCount--;
+      n++;
+   }
+
+   //Return the number of descriptors reclaimed
+   return n;
+}
@@ -146,6 +146,9 @@ typedef error_t (*ExtIntInit)(void);
 typedef void (*ExtIntEnableIrq)(void);
 typedef void (*ExtIntDisableIrq)(void);
 
+//TX descriptor ring helpers
+typedef bool_t (*NicTxDescOwned)(uint_t index);
+
 
 /**
  * @brief NIC driver
@@ -169,16 +172,17 @@ typedef struct
    bool_t autoCrcCalc;
    bool_t autoCrcVerif;
    bool_t autoCrcStrip;
-   //bool_t autoIpv4ChecksumCalc;
-   //bool_t autoIpv4ChecksumVerif;
-   //bool_t autoIpv6ChecksumCalc;
-   //bool_t autoIpv6ChecksumVerif;
-   //bool_t autoIcmpChecksumCalc;
-   //bool_t autoIcmpChecksumVerif;
-   //bool_t autoTcpChecksumCalc;
-   //bool_t autoTcpChecksumVerif;
-   //bool_t autoUdpChecksumCalc;
-   //bool_t autoUdpChecksumVerif;
+   bool_t autoIpv4ChecksumCalc;
+   bool_t autoIpv4ChecksumVerif;
+   bool_t autoIpv6ChecksumCalc;
+   bool_t autoIpv6ChecksumVerif;
+   bool_t autoIcmpChecksumCalc;
+   bool_t autoIcmpChecksumVerif;
+   bool_t autoTcpChecksumCalc;
+   bool_t autoTcpChecksumVerif;
+   bool_t autoUdpChecksumCalc;
+   bool_t autoUdpChecksumVerif;
+   bool_t zeroCopyRx;
 } NicDriver;
 
 
@@ -236,6 +240,23 @@ typedef struct
 } ExtIntDriver;
 
 
+/**
+ * @brief TX descriptor ring
+ *
+ * Bookkeeping shared by the DMA drivers that transmit directly from
+ * memory pool blocks. Each descriptor holds up to two buffers
+ **/
+
+typedef struct
+{
+   uint_t size;            ///<Number of descriptors
+   uint_t curIndex;        ///<Index of the next descriptor to be used
+   uint_t dirtyIndex;      ///<Index of the oldest descriptor not yet reclaimed
+   uint_t pendingCount;    ///<Number of descriptors not yet reclaimed
+   void *(*heldBuffer)[2]; ///<Memory pool references held by each descriptor
+} NicTxRing;
+
+
 //Tick counter to handle periodic operations
 extern systime_t nicTickCounter;
 
@@ -246,8 +267,20 @@ error_t nicSendPacket(NetInterface *interface, const NetBuffer *buffer, size_t o
 error_t nicSetMulticastFilter(NetInterface *interface);
 
 void nicProcessPacket(NetInterface *interface, void *packet, size_t length);
+bool_t nicProcessLoanablePacket(NetInterface *interface,
+   void *packet, size_t length, size_t size);
+
+void *nicLoanRxBuffer(const void *data, size_t length,
+   size_t size, void **buffer);
 void nicNotifyLinkChange(NetInterface *interface);
 
+void nicTxRingInit(NicTxRing *ring, void *(*heldBuffer)[2], uint_t size);
+uint_t nicTxRingGetFreeCount(const NicTxRing *ring);
+uint_t nicTxRingAttachBuffer(NicTxRing *ring, uint_t n, void *p);
+void nicTxRingDetachBuffers(NicTxRing *ring, uint_t n);
+void nicTxRingCommit(NicTxRing *ring, uint_t count);
+uint_t nicTxRingReclaim(NicTxRing *ring, NicTxDescOwned owned);
+
 //C++ guard
 #ifdef __cplusplus
    }
@@ -460,7 +460,7 @@ error_t rawSocketSendIpPacket(Socket *socket, const IpAddr *destIpAddr,
       }
 
       //Send raw IP datagram
-      error = ipSendDatagram(interface, &pseudoHeader, buffer, offset, socket->ttl);
+      error = ipSendDatagram(interface, &pseudoHeader, buffer, offset, socket->ttl, NULL);
       //Failed to send data?
       if(error)
          break;
@@ -37,6 +37,7 @@
 #include "core/udp.h"
 #include "core/tcp.h"
 #include "core/tcp_misc.h"
+#include "core/tcp_timer.h"
 #include "dns/dns_client.h"
 #include "mdns/mdns_client.h"
 #include "netbios/nbns_client.h"
@@ -44,6 +45,10 @@
 
 //Socket table
 Socket socketTable[SOCKET_MAX_COUNT];
+//Hash table of connected TCP sockets (local port, remote port and remote address)
+static Socket *socketConnHashTable[SOCKET_CONN_HASH_TABLE_SIZE];
+//Hash table of listening TCP sockets and UDP sockets (local port)
+static Socket *socketPortHashTable[SOCKET_PORT_HASH_TABLE_SIZE];
 
 
 /**
@@ -58,6 +63,9 @@ error_t socketInit(void)
 
    //Initialize socket descriptors
    memset(socketTable, 0, sizeof(socketTable));
+   //Clear hash tables
+   memset(socketConnHashTable, 0, sizeof(socketConnHashTable));
+   memset(socketPortHashTable, 0, sizeof(socketPortHashTable));
 
    //Loop through socket descriptors
    for(i = 0; i < SOCKET_MAX_COUNT; i++)
@@ -178,6 +186,12 @@ Socket *socketOpen(uint_t type, uint_t protocol)
          i = socket->descriptor;
          //Save event object instance
          memcpy(&event, &socket->event, sizeof(OsEvent));
+         //Unlink the entry from the hash table it may still belong to
+         socketRemoveHashEntry(socket);
+#if (TCP_SUPPORT == ENABLED)
+         //Unlink the TCP timers from the timing wheel
+         tcpStopTimers(socket);
+#endif
 
          //Clear associated structure
          memset(socket, 0, sizeof(Socket));
@@ -194,7 +208,23 @@ Socket *socketOpen(uint_t type, uint_t protocol)
 #if (TCP_SUPPORT == ENABLED)
          socket->txBufferSize = MIN(TCP_DEFAULT_TX_BUFFER_SIZE, TCP_MAX_TX_BUFFER_SIZE);
          socket->rxBufferSize = MIN(TCP_DEFAULT_RX_BUFFER_SIZE, TCP_MAX_RX_BUFFER_SIZE);
+
+         //Bind the TCP timers to their handlers
+         tcpInitTimers(socket);
+
+#if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+         //Default congestion control algorithm
+         socket->congestOps = tcpGetCongestOps(TCP_DEFAULT_CONGEST_ALGO);
 #endif
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+         //Delayed acknowledgments are used by default
+         socket->delayedAckEnabled = TRUE;
+#endif
+#endif
+
+         //Make the socket visible to the demultiplexing routines
+         socketUpdateHashEntry(socket);
       }
    }
 
@@ -206,6 +236,182 @@ Socket *socketOpen(uint_t type, uint_t protocol)
 }
 
 
+/**
+ * @brief Compute the hash value of a connection
+ * @param[in] localPort Local port number
+ * @param[in] remoteIpAddr IP address of the remote host
+ * @param[in] remotePort Remote port number
+ * @return Index of the relevant entry in the connection hash table
+ **/
+
+static uint_t socketHashConn(uint16_t localPort,
+   const IpAddr *remoteIpAddr, uint16_t remotePort)
+{
+   uint32_t h;
+
+   //Combine port numbers
+   h = ((uint32_t) localPort << 16) | remotePort;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 address?
+   if(remoteIpAddr->length == sizeof(Ipv4Addr))
+   {
+      //Fold the remote address
+      h ^= remoteIpAddr->ipv4Addr;
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 address?
+   if(remoteIpAddr->length == sizeof(Ipv6Addr))
+   {
+      //Fold the remote address
+      h ^= remoteIpAddr->ipv6Addr.dw[0] ^ remoteIpAddr->ipv6Addr.dw[1] ^
+         remoteIpAddr->ipv6Addr.dw[2] ^ remoteIpAddr->ipv6Addr.dw[3];
+   }
+   else
+#endif
+   //Unspecified address?
+   {
+      //Only port numbers are relevant
+   }
+
+   //Mix the bits so that the low-order bits depend on the whole value
+   h ^= h >> 16;
+   h *= 0x45D9F3B;
+   h ^= h >> 16;
+
+   //Return the index of the bucket
+   return h & (SOCKET_CONN_HASH_TABLE_SIZE - 1);
+}
+
+
+/**
+ * @brief Insert a socket in the relevant hash table
+ *
+ * Connected TCP sockets are indexed by their local port, remote port and
+ * remote address. Other TCP sockets and UDP sockets are indexed by local
+ * port only. This function must be called whenever one of these fields
+ * changes. The caller must hold the netMutex
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void socketUpdateHashEntry(Socket *socket)
+{
+   Socket **p;
+
+   //Unlink the socket from its current bucket
+   socketRemoveHashEntry(socket);
+
+   //Connected TCP socket?
+   if(socket->type == SOCKET_TYPE_STREAM && socket->remotePort != 0 &&
+      socket->remoteIpAddr.length != 0)
+   {
+      //Point to the relevant bucket
+      p = &socketConnHashTable[socketHashConn(socket->localPort,
+         &socket->remoteIpAddr, socket->remotePort)];
+   }
+   //Listening TCP socket or UDP socket?
+   else if(socket->type == SOCKET_TYPE_STREAM ||
+      socket->type == SOCKET_TYPE_DGRAM)
+   {
+      //Point to the relevant bucket
+      p = &socketPortHashTable[socket->localPort & (SOCKET_PORT_HASH_TABLE_SIZE - 1)];
+   }
+   //Raw socket?
+   else
+   {
+      //Raw sockets are not demultiplexed by port
+      return;
+   }
+
+   //Save the bucket the socket belongs to
+   socket->hashBucket = p;
+
+   //Sockets are kept sorted by descriptor so that lookups return the
+   //same entry as a linear scan of the socket table
+   while(*p != NULL && (*p)->descriptor < socket->descriptor)
+      p = &(*p)->hashNext;
+
+   //Link the socket
+   socket->hashNext = *p;
+   *p = socket;
+}
+
+
+/**
+ * @brief Remove a socket from the hash table it belongs to
+ *
+ * The caller must hold the netMutex
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void socketRemoveHashEntry(Socket *socket)
+{
+   Socket **p;
+
+   //The socket does not belong to any hash table?
+   if(socket->hashBucket == NULL)
+      return;
+
+   //Search the bucket for the socket
+   for(p = socket->hashBucket; *p != NULL; p = &(*p)->hashNext)
+   {
+      //Matching entry?
+      if(*p == socket)
+      {
+         //Unlink the socket
+         *p = socket->hashNext;
+         break;
+      }
+   }
+
+   //The socket is no longer linked
+   socket->hashNext = NULL;
+   socket->hashBucket = NULL;
+}
+
+
+/**
+ * @brief Retrieve the chain of connected TCP sockets matching a 4-tuple
+ *
+ * The returned chain may contain other sockets sharing the same hash value,
+ * or sockets in the CLOSED state that are still owned by the user. The
+ * caller must check each entry and follow the hashNext field
+ *
+ * @param[in] localPort Local port number
+ * @param[in] remoteIpAddr IP address of the remote host
+ * @param[in] remotePort Remote port number
+ * @return First socket of the chain
+ **/
+
+Socket *socketGetConnHashChain(uint16_t localPort,
+   const IpAddr *remoteIpAddr, uint16_t remotePort)
+{
+   //Point to the relevant bucket
+   return socketConnHashTable[socketHashConn(localPort, remoteIpAddr, remotePort)];
+}
+
+
+/**
+ * @brief Retrieve the chain of listening TCP sockets and UDP sockets
+ *
+ * The returned chain may contain sockets bound to other ports. The caller
+ * must check each entry and follow the hashNext field
+ *
+ * @param[in] localPort Local port number
+ * @return First socket of the chain
+ **/
+
+Socket *socketGetPortHashChain(uint16_t localPort)
+{
+   //Point to the relevant bucket
+   return socketPortHashTable[localPort & (SOCKET_PORT_HASH_TABLE_SIZE - 1)];
+}
+
+
 /**
  * @brief Set timeout value for blocking operations
  * @param[in] socket Handle to a socket
@@ -299,6 +505,90 @@ error_t socketSetRxBufferSize(Socket *socket, size_t size)
 }
 
 
+/**
+ * @brief Select the congestion control algorithm of a socket
+ * @param[in] socket Handle to a socket
+ * @param[in] algo Congestion control algorithm
+ * @return Error code
+ **/
+
+error_t socketSetCongestionControl(Socket *socket, TcpCongestAlgo algo)
+{
+#if (TCP_SUPPORT == ENABLED && TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+   const TcpCongestOps *ops;
+
+   //Make sure the socket handle is valid
+   if(socket == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Retrieve the operations of the specified algorithm
+   ops = tcpGetCongestOps(algo);
+   //Algorithm not supported?
+   if(ops == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //This function shall be used with connection-oriented socket types
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+   //The algorithm cannot be changed when the connection is established
+   if(tcpGetState(socket) != TCP_STATE_CLOSED &&
+      tcpGetState(socket) != TCP_STATE_LISTEN)
+   {
+      return ERROR_INVALID_SOCKET;
+   }
+
+   //Use the specified algorithm
+   socket->congestOps = ops;
+   //No error to report
+   return NO_ERROR;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable or disable delayed acknowledgments
+ *
+ * When delayed acknowledgments are disabled, every incoming data segment
+ * is acknowledged immediately
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] enable TRUE to delay acknowledgments, FALSE to send them immediately
+ * @return Error code
+ **/
+
+error_t socketSetDelayedAck(Socket *socket, bool_t enable)
+{
+#if (TCP_SUPPORT == ENABLED && TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //Make sure the socket handle is valid
+   if(socket == NULL)
+      return ERROR_INVALID_PARAMETER;
+   //This function shall be used with connection-oriented socket types
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
+   //Save the setting
+   socket->delayedAckEnabled = enable;
+
+   //Acknowledge pending data immediately when the feature is disabled
+   if(!enable && socket->ackPendingLength > 0)
+      tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+
+   //No error to report
+   return NO_ERROR;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Bind a socket to a particular network interface
  * @param[in] socket Handle to a socket
@@ -337,9 +627,17 @@ error_t socketBind(Socket *socket, const IpAddr *localIpAddr, uint16_t localPort
    if(socket->type != SOCKET_TYPE_STREAM && socket->type != SOCKET_TYPE_DGRAM)
       return ERROR_INVALID_SOCKET;
 
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
    //Associate the specified IP address and port number
    socket->localIpAddr = *localIpAddr;
    socket->localPort = localPort;
+   //Move the socket to the relevant hash bucket
+   socketUpdateHashEntry(socket);
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
 
    //No error to report
    return NO_ERROR;
@@ -380,9 +678,17 @@ error_t socketConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remot
    //Connectionless socket?
    if(socket->type == SOCKET_TYPE_DGRAM)
    {
+      //Get exclusive access
+      osAcquireMutex(&netMutex);
+
       //Save port number and IP address of the remote host
       socket->remoteIpAddr = *remoteIpAddr;
       socket->remotePort = remotePort;
+      //Move the socket to the relevant hash bucket
+      socketUpdateHashEntry(socket);
+
+      //Release exclusive access
+      osReleaseMutex(&netMutex);
       //No error to report
       error = NO_ERROR;
    }
@@ -692,6 +998,99 @@ error_t socketReceiveEx(Socket *socket, IpAddr *srcIpAddr, uint16_t *srcPort,
 }
 
 
+/**
+ * @brief Receive data from a connected socket without copying
+ *
+ * The function returns a pointer to the next contiguous block of data held
+ * by the socket. The application consumes the data in place and then calls
+ * socketReleaseBuffer() to give the memory back to the TCP/IP stack
+ *
+ * @param[in] socket Handle that identifies a connected socket
+ * @param[out] data Pointer to the first byte of data
+ * @param[out] length Number of contiguous bytes available
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t socketReceiveZeroCopy(Socket *socket,
+   const void **data, size_t *length, uint_t flags)
+{
+   error_t error;
+
+   //Check parameters
+   if(socket == NULL || data == NULL || length == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
+#if (TCP_SUPPORT == ENABLED)
+   //Connection-oriented socket?
+   if(socket->type == SOCKET_TYPE_STREAM)
+   {
+      //Retrieve the next block of data
+      error = tcpReceiveZeroCopy(socket, (const uint8_t **) data, length, flags);
+   }
+   else
+#endif
+   //Socket type not supported...
+   {
+      //No data can be read
+      *data = NULL;
+      *length = 0;
+      //Invalid socket type
+      error = ERROR_INVALID_SOCKET;
+   }
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release data obtained with socketReceiveZeroCopy()
+ * @param[in] socket Handle that identifies a connected socket
+ * @param[in] length Number of bytes that have been consumed
+ * @return Error code
+ **/
+
+error_t socketReleaseBuffer(Socket *socket, size_t length)
+{
+   error_t error;
+
+   //Make sure the socket handle is valid
+   if(socket == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
+#if (TCP_SUPPORT == ENABLED)
+   //Connection-oriented socket?
+   if(socket->type == SOCKET_TYPE_STREAM)
+   {
+      //Release the data that have been consumed
+      error = tcpReleaseBuffer(socket, length);
+   }
+   else
+#endif
+   //Socket type not supported...
+   {
+      //Invalid socket type
+      error = ERROR_INVALID_SOCKET;
+   }
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Retrieve the local address for a given socket
  * @param[in] socket Handle that identifies a socket
@@ -831,6 +1230,8 @@ void socketClose(Socket *socket)
          queueItem = nextQueueItem;
       }
 
+      //Remove the socket from the demultiplexing tables
+      socketRemoveHashEntry(socket);
       //Mark the socket as closed
       socket->type = SOCKET_TYPE_UNUSED;
    }
@@ -59,6 +59,20 @@ struct _Socket;
    #error SOCKET_EPHEMERAL_PORT_MAX parameter is not valid
 #endif
 
+//Size of the hash table used to look up connected TCP sockets
+#ifndef SOCKET_CONN_HASH_TABLE_SIZE
+   #define SOCKET_CONN_HASH_TABLE_SIZE 64
+#elif (SOCKET_CONN_HASH_TABLE_SIZE < 1 || (SOCKET_CONN_HASH_TABLE_SIZE & (SOCKET_CONN_HASH_TABLE_SIZE - 1)))
+   #error SOCKET_CONN_HASH_TABLE_SIZE parameter is not valid
+#endif
+
+//Size of the hash table used to look up listening TCP sockets and UDP sockets
+#ifndef SOCKET_PORT_HASH_TABLE_SIZE
+   #define SOCKET_PORT_HASH_TABLE_SIZE 16
+#elif (SOCKET_PORT_HASH_TABLE_SIZE < 1 || (SOCKET_PORT_HASH_TABLE_SIZE & (SOCKET_PORT_HASH_TABLE_SIZE - 1)))
+   #error SOCKET_PORT_HASH_TABLE_SIZE parameter is not valid
+#endif
+
 //C++ guard
 #ifdef __cplusplus
    extern "C" {
@@ -223,6 +237,8 @@ struct _Socket
    uint_t eventMask;
    uint_t eventFlags;
    OsEvent *userEvent;
+   Socket *hashNext;
+   Socket **hashBucket;
 
 //TCP specific variables
 #if (TCP_SUPPORT == ENABLED)
@@ -238,15 +254,24 @@ struct _Socket
 
    uint32_t sndUna;               ///<Data that have been sent but not yet acknowledged
    uint32_t sndNxt;               ///<Sequence number of the next byte to be sent
-   uint16_t sndUser;              ///<Amount of data buffered but not yet sent
-   uint16_t sndWnd;               ///<Size of the send window
-   uint16_t maxSndWnd;            ///<Maximum send window it has seen so far on the connection
+   uint32_t sndUser;              ///<Amount of data buffered but not yet sent
+   uint32_t sndWnd;               ///<Size of the send window
+   uint32_t maxSndWnd;            ///<Maximum send window it has seen so far on the connection
    uint32_t sndWl1;               ///<Segment sequence number used for last window update
    uint32_t sndWl2;               ///<Segment acknowledgment number used for last window update
 
    uint32_t rcvNxt;               ///<Receive next sequence number
-   uint16_t rcvUser;              ///<Number of data received but not yet consumed
-   uint16_t rcvWnd;               ///<Receive window
+   uint32_t rcvUser;              ///<Number of data received but not yet consumed
+   uint32_t rcvWnd;               ///<Receive window
+
+   bool_t wndScaleEnabled;        ///<Window scale option negotiated on the connection
+   uint8_t sndWndShift;           ///<Scale factor applied to the windows advertised by the peer
+   uint8_t rcvWndShift;           ///<Scale factor applied to the windows advertised to the peer
+
+   bool_t tsEnabled;              ///<Timestamps option negotiated on the connection
+   uint32_t tsRecent;             ///<Timestamp to be echoed in the next segment sent
+   systime_t tsRecentAge;         ///<Time at which TS.Recent was last updated
+   uint32_t lastAckSent;          ///<Last acknowledgment number sent to the peer
 
    bool_t rttBusy;                ///<RTT measurement is being performed
    uint32_t rttSeqNum;            ///<Sequence number identifying a TCP segment
@@ -256,20 +281,36 @@ struct _Socket
    systime_t rto;                 ///<Retransmission timeout
 
 #if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+   const TcpCongestOps *congestOps; ///<Congestion control algorithm
    TcpCongestState congestState;  ///<Congestion state
-   uint16_t cwnd;                 ///<Congestion window
-   uint16_t ssthresh;             ///<Slow start threshold
+   uint32_t cwnd;                 ///<Congestion window
+   uint32_t ssthresh;             ///<Slow start threshold
    uint_t dupAckCount;            ///<Number of consecutive duplicate ACKs
    uint_t n;                      ///<Number of bytes acknowledged during the whole round-trip
    uint32_t recover;              ///<NewReno modification to TCP's fast recovery algorithm
 #endif
 
+#if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED && TCP_CUBIC_SUPPORT == ENABLED)
+   uint32_t cubicWmax;            ///<Congestion window just before the last reduction
+   uint32_t cubicOrigin;          ///<Origin point of the cubic function
+   systime_t cubicK;              ///<Time needed to reach the origin point
+   systime_t cubicEpochStart;     ///<Beginning of the current congestion avoidance epoch
+   uint32_t cubicEstWnd;          ///<Estimated window of standard TCP (TCP-friendly region)
+   uint32_t cubicEstAckCount;     ///<Bytes acknowledged since the last increase of the estimated window
+   uint32_t cubicAckCount;        ///<Bytes acknowledged since the last cwnd increase
+#endif
+
    TcpTxBuffer txBuffer;          ///<Send buffer
    size_t txBufferSize;           ///<Size of the send buffer
    TcpRxBuffer rxBuffer;          ///<Receive buffer
    size_t rxBufferSize;           ///<Size of the receive buffer
+   TcpRxQueueItem *rxQueue;       ///<Loaned buffers holding in-order data (zero-copy receive)
+   TcpRxQueueItem *rxQueueTail;   ///<Last item of the receive queue
+   uint_t rxQueueCount;           ///<Number of loaned buffers in the receive queue
+   size_t rxQueueLength;          ///<Number of unread data held by the receive queue
 
    TcpQueueItem *retransmitQueue; ///<Retransmission queue
+   TcpQueueItem *retransmitQueueTail; ///<Last item of the retransmission queue
    TcpTimer retransmitTimer;      ///<Retransmission timer
    uint_t retransmitCount;        ///<Number of retransmissions
 
@@ -284,9 +325,27 @@ struct _Socket
    TcpTimer finWait2Timer;        ///<FIN-WAIT-2 timer
    TcpTimer timeWaitTimer;        ///<2MSL timer
 
+   bool_t delayedAckEnabled;      ///<Delayed ACK is enabled on the socket
+   uint_t ackPendingLength;       ///<Number of bytes received but not yet acknowledged
+   TcpTimer delayedAckTimer;      ///<Delayed ACK timer
+
    bool_t sackPermitted;                        ///<SACK Permitted option received
    TcpSackBlock sackBlock[TCP_MAX_SACK_BLOCKS]; ///<List of non-contiguous blocks that have been received
    uint_t sackBlockCount;                       ///<Number of non-contiguous blocks that have been received
+   uint32_t highRxt;                            ///<Highest sequence number retransmitted during SACK recovery
+   uint32_t highSacked;                         ///<Highest sequence number SACKed by the peer
+   uint_t sackedCount;                          ///<Number of SACKed segments in the retransmission queue
+   uint_t sackedBytes;                          ///<Number of SACKed bytes in the retransmission queue
+   uint_t lostBytes;                            ///<Number of bytes deemed lost and not SACKed
+   uint_t retransBytes;                         ///<Number of retransmitted bytes neither SACKed nor acknowledged
+   TcpQueueItem *lostItem;                      ///<Highest segment deemed lost (loss boundary of the scoreboard)
+   uint_t lostSackedCount;                      ///<Number of SACKed segments up to the loss boundary
+   uint_t lostSackedBytes;                      ///<Number of SACKed bytes up to the loss boundary
+   TcpQueueItem *nextSegItem;                   ///<Scoreboard cursor used to select the next segment
+   TcpQueueItem *highSackedItem;                ///<Highest SACKed segment, where the scan of new SACK blocks resumes
+#if (IPV4_SUPPORT == ENABLED && IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   Ipv4DestCacheEntry destCacheEntry;           ///<Next hop last resolved for the connection
+#endif
 #endif
 
 //UDP specific variables
@@ -316,9 +375,17 @@ error_t socketInit(void);
 
 Socket *socketOpen(uint_t type, uint_t protocol);
 
+void socketUpdateHashEntry(Socket *socket);
+void socketRemoveHashEntry(Socket *socket);
+Socket *socketGetConnHashChain(uint16_t localPort,
+   const IpAddr *remoteIpAddr, uint16_t remotePort);
+Socket *socketGetPortHashChain(uint16_t localPort);
+
 error_t socketSetTimeout(Socket *socket, systime_t timeout);
 error_t socketSetTxBufferSize(Socket *socket, size_t size);
 error_t socketSetRxBufferSize(Socket *socket, size_t size);
+error_t socketSetCongestionControl(Socket *socket, TcpCongestAlgo algo);
+error_t socketSetDelayedAck(Socket *socket, bool_t enable);
 
 error_t socketBindToInterface(Socket *socket, NetInterface *interface);
 error_t socketBind(Socket *socket, const IpAddr *localIpAddr, uint16_t localPort);
@@ -341,6 +408,11 @@ error_t socketReceiveFrom(Socket *socket, IpAddr *srcIpAddr, uint16_t *srcPort,
 error_t socketReceiveEx(Socket *socket, IpAddr *srcIpAddr, uint16_t *srcPort,
    IpAddr *destIpAddr, void *data, size_t size, size_t *received, uint_t flags);
 
+error_t socketReceiveZeroCopy(Socket *socket,
+   const void **data, size_t *length, uint_t flags);
+
+error_t socketReleaseBuffer(Socket *socket, size_t length);
+
 error_t socketGetLocalAddr(Socket *socket, IpAddr *localIpAddr, uint16_t *localPort);
 error_t socketGetRemoteAddr(Socket *socket, IpAddr *remoteIpAddr, uint16_t *remotePort);
 
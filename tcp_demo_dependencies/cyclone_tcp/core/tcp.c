@@ -36,6 +36,8 @@
 #include "core/tcp.h"
 #include "core/tcp_misc.h"
 #include "core/tcp_timer.h"
+#include "core/tcp_new_reno.h"
+#include "core/tcp_cubic.h"
 #include "mibs/mib2_module.h"
 #include "mibs/tcp_mib_module.h"
 #include "debug.h"
@@ -43,12 +45,14 @@
 //Check TCP/IP stack configuration
 #if (TCP_SUPPORT == ENABLED)
 
-//Tick counter to handle periodic operations
-systime_t tcpTickCounter;
-
 //Ephemeral ports are used for dynamic port assignment
 static uint16_t tcpDynamicPort;
 
+//Statistics not yet folded into the MIB counters
+#if (TCP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   TcpCounters tcpCounters;
+#endif
+
 
 /**
  * @brief TCP related initialization
@@ -59,6 +63,13 @@ error_t tcpInit(void)
 {
    //Reset ephemeral port number
    tcpDynamicPort = 0;
+   //Initialize the timing wheel
+   tcpInitTimerWheel();
+
+#if (TCP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   //Clear the counter block
+   memset(&tcpCounters, 0, sizeof(TcpCounters));
+#endif
 
    //Successful initialization
    return NO_ERROR;
@@ -102,6 +113,35 @@ uint16_t tcpGetDynamicPort(void)
 }
 
 
+/**
+ * @brief Fold the TCP counter block into the MIB counters
+ *
+ * Called by netFoldCounters() with exclusive access to the TCP/IP stack
+ **/
+
+void tcpFoldCounters(void)
+{
+#if (TCP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   //Total number of segments received, including those received in error
+   MIB2_INC_COUNTER32(tcpGroup.tcpInSegs, tcpCounters.inSegs);
+   TCP_MIB_INC_COUNTER32(tcpInSegs, tcpCounters.inSegs);
+   TCP_MIB_INC_COUNTER64(tcpHCInSegs, tcpCounters.inSegs);
+
+   //Total number of segments sent
+   MIB2_INC_COUNTER32(tcpGroup.tcpOutSegs, tcpCounters.outSegs);
+   TCP_MIB_INC_COUNTER32(tcpOutSegs, tcpCounters.outSegs);
+   TCP_MIB_INC_COUNTER64(tcpHCOutSegs, tcpCounters.outSegs);
+
+   //Total number of segments retransmitted
+   MIB2_INC_COUNTER32(tcpGroup.tcpRetransSegs, tcpCounters.retransSegs);
+   TCP_MIB_INC_COUNTER32(tcpRetransSegs, tcpCounters.retransSegs);
+
+   //The counter block is now empty
+   memset(&tcpCounters, 0, sizeof(TcpCounters));
+#endif
+}
+
+
 /**
  * @brief Establish a TCP connection
  * @param[in] socket Handle to an unconnected socket
@@ -121,6 +161,8 @@ error_t tcpConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePo
       //Save port number and IP address of the remote host
       socket->remoteIpAddr = *remoteIpAddr;
       socket->remotePort = remotePort;
+      //Move the socket to the connection hash table
+      socketUpdateHashEntry(socket);
 
       //Select the source address and the relevant network interface
       //to use when establishing the connection
@@ -175,6 +217,25 @@ error_t tcpConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePo
       socket->rcvUser = 0;
       socket->rcvWnd = socket->rxBufferSize;
 
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //Offer the Window Scale option in the SYN segment
+      socket->wndScaleEnabled = TRUE;
+      socket->sndWndShift = 0;
+      socket->rcvWndShift = tcpGetWindowShift(socket->rxBufferSize);
+#endif
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //Offer the SACK Permitted option in the SYN segment
+      socket->sackPermitted = TRUE;
+#endif
+
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+      //Offer the Timestamps option in the SYN segment
+      socket->tsEnabled = TRUE;
+      socket->tsRecent = 0;
+      socket->tsRecentAge = osGetSystemTime();
+#endif
+
       //Default retransmission timeout
       socket->rto = TCP_INITIAL_RTO;
 
@@ -184,9 +245,11 @@ error_t tcpConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePo
       //Initial congestion window
       socket->cwnd = MIN(TCP_INITIAL_WINDOW * socket->smss, socket->txBufferSize);
       //Slow start threshold should be set arbitrarily high
-      socket->ssthresh = UINT16_MAX;
+      socket->ssthresh = UINT32_MAX;
       //Recover is set to the initial send sequence number
       socket->recover = socket->iss;
+      //Reset the state of the congestion control algorithm
+      socket->congestOps->cwndEvent(socket, TCP_CONGEST_EVENT_INIT);
 #endif
 
       //Send a SYN segment
@@ -324,6 +387,7 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
          //Inherit settings from the listening socket
          newSocket->txBufferSize = socket->txBufferSize;
          newSocket->rxBufferSize = socket->rxBufferSize;
+         newSocket->delayedAckEnabled = socket->delayedAckEnabled;
 
          //Number of chunks that comprise the TX and the RX buffers
          newSocket->txBuffer.maxChunkCount = arraysize(newSocket->txBuffer.chunk);
@@ -351,6 +415,8 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
             //Save the port number and the IP address of the remote host
             newSocket->remoteIpAddr = queueItem->srcAddr;
             newSocket->remotePort = queueItem->srcPort;
+            //Move the socket to the connection hash table
+            socketUpdateHashEntry(newSocket);
 
             //The SMSS is the size of the largest segment that the sender
             //can transmit
@@ -369,6 +435,37 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
             newSocket->rcvUser = 0;
             newSocket->rcvWnd = newSocket->rxBufferSize;
 
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+            //Window scaling is only used if the peer sent the Window
+            //Scale option in its SYN segment
+            if(queueItem->wndScaleEnabled)
+            {
+               newSocket->wndScaleEnabled = TRUE;
+               newSocket->sndWndShift = queueItem->wndShift;
+               newSocket->rcvWndShift = tcpGetWindowShift(newSocket->rxBufferSize);
+            }
+#endif
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+            //SACK is only used if the peer sent the SACK Permitted option
+            newSocket->sackPermitted = queueItem->sackPermitted;
+#endif
+
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+            //Timestamps are only used if the peer sent the Timestamps
+            //option in its SYN segment
+            if(queueItem->tsEnabled)
+            {
+               newSocket->tsEnabled = TRUE;
+               newSocket->tsRecent = queueItem->tsVal;
+               newSocket->tsRecentAge = osGetSystemTime();
+
+               //The option takes room in every segment, so the amount
+               //of data per segment must be reduced accordingly
+               newSocket->smss -= TCP_TIMESTAMPS_OPTION_SIZE;
+            }
+#endif
+
             //Default retransmission timeout
             newSocket->rto = TCP_INITIAL_RTO;
 
@@ -378,9 +475,12 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
             //Initial congestion window
             newSocket->cwnd = MIN(TCP_INITIAL_WINDOW * newSocket->smss, newSocket->txBufferSize);
             //Slow start threshold should be set arbitrarily high
-            newSocket->ssthresh = UINT16_MAX;
+            newSocket->ssthresh = UINT32_MAX;
             //Recover is set to the initial send sequence number
             newSocket->recover = newSocket->iss;
+            //Inherit the congestion control algorithm from the listening socket
+            newSocket->congestOps = socket->congestOps;
+            newSocket->congestOps->cwndEvent(newSocket, TCP_CONGEST_EVENT_INIT);
 #endif
             //Send a SYN ACK control segment
             error = tcpSendSegment(newSocket, TCP_FLAG_SYN | TCP_FLAG_ACK,
@@ -657,8 +757,18 @@ error_t tcpReceive(Socket *socket, uint8_t *data,
 
       //Calculate the number of bytes to read at a time
       n = MIN(socket->rcvUser, size - *received);
-      //Copy data from circular buffer
-      tcpReadRxBuffer(socket, seqNum, data, n);
+
+      //Data pending in the receive queue?
+      if(socket->rxQueue != NULL)
+      {
+         //Copy data from the loaned buffers
+         n = tcpReadRxQueue(socket, data, n);
+      }
+      else
+      {
+         //Copy data from circular buffer
+         tcpReadRxBuffer(socket, seqNum, data, n);
+      }
 
       //Read data until a break character is encountered?
       if(flags & SOCKET_FLAG_BREAK_CHAR)
@@ -673,6 +783,8 @@ error_t tcpReceive(Socket *socket, uint8_t *data,
       *received += n;
       //Remaining data still available in the receive buffer
       socket->rcvUser -= n;
+      //Release the loaned buffers that have been fully consumed
+      tcpConsumeRxQueue(socket, n);
 
       //Update the receive window
       tcpUpdateReceiveWindow(socket);
@@ -703,6 +815,138 @@ error_t tcpReceive(Socket *socket, uint8_t *data,
 }
 
 
+/**
+ * @brief Receive data from a connected socket without copying
+ *
+ * On success, the function returns a pointer to the next contiguous block of
+ * data held by the socket. The data remain valid until they are released
+ * using tcpReleaseBuffer()
+ *
+ * @param[in] socket Handle that identifies a connected socket
+ * @param[out] data Pointer to the first byte of data
+ * @param[out] length Number of contiguous bytes available
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t tcpReceiveZeroCopy(Socket *socket, const uint8_t **data,
+   size_t *length, uint_t flags)
+{
+   uint_t event;
+   uint32_t seqNum;
+   systime_t timeout;
+   uint8_t *p;
+
+   //No data has been read yet
+   *data = NULL;
+   *length = 0;
+
+   //Check whether the socket is in the listening state
+   if(socket->state == TCP_STATE_LISTEN)
+      return ERROR_NOT_CONNECTED;
+
+   //The SOCKET_FLAG_DONT_WAIT enables non-blocking operation
+   timeout = (flags & SOCKET_FLAG_DONT_WAIT) ? 0 : socket->timeout;
+   //Wait for data to be available for reading
+   event = tcpWaitForEvents(socket, SOCKET_EVENT_RX_READY, timeout);
+
+   //A timeout exception occurred?
+   if(event != SOCKET_EVENT_RX_READY)
+      return ERROR_TIMEOUT;
+
+   //Check current TCP state
+   switch(socket->state)
+   {
+   //ESTABLISHED, FIN-WAIT-1 or FIN-WAIT-2 state?
+   case TCP_STATE_ESTABLISHED:
+   case TCP_STATE_FIN_WAIT_1:
+   case TCP_STATE_FIN_WAIT_2:
+      //Sequence number of the first byte to read
+      seqNum = socket->rcvNxt - socket->rcvUser;
+      break;
+
+   //CLOSE-WAIT, LAST-ACK, CLOSING or TIME-WAIT state?
+   case TCP_STATE_CLOSE_WAIT:
+   case TCP_STATE_LAST_ACK:
+   case TCP_STATE_CLOSING:
+   case TCP_STATE_TIME_WAIT:
+      //The user must be satisfied with data already on hand
+      if(!socket->rcvUser)
+         return ERROR_END_OF_STREAM;
+
+      //Sequence number of the first byte to read
+      seqNum = (socket->rcvNxt - 1) - socket->rcvUser;
+      break;
+
+   //CLOSED state?
+   default:
+      //The connection was reset by remote side?
+      if(socket->resetFlag)
+         return ERROR_CONNECTION_RESET;
+      //The connection has not yet been established?
+      if(!socket->closedFlag)
+         return ERROR_NOT_CONNECTED;
+
+      //The user must be satisfied with data already on hand
+      if(!socket->rcvUser)
+         return ERROR_END_OF_STREAM;
+
+      //Sequence number of the first byte to read
+      seqNum = (socket->rcvNxt - 1) - socket->rcvUser;
+      break;
+   }
+
+   //Sanity check
+   if(!socket->rcvUser)
+      return ERROR_FAILURE;
+
+   //Data pending in the receive queue?
+   if(socket->rxQueue != NULL)
+   {
+      //Return the data held by the first loaned buffer
+      *data = socket->rxQueue->data;
+      *length = socket->rxQueue->length;
+   }
+   else
+   {
+      //Point to the data held by the circular buffer
+      *length = tcpGetRxBufferData(socket, seqNum, socket->rcvUser, &p);
+      *data = p;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release data previously obtained with tcpReceiveZeroCopy()
+ * @param[in] socket Handle that identifies a connected socket
+ * @param[in] length Number of bytes that have been consumed
+ * @return Error code
+ **/
+
+error_t tcpReleaseBuffer(Socket *socket, size_t length)
+{
+   //Make sure the data are still available
+   if(length > socket->rcvUser)
+      return ERROR_INVALID_LENGTH;
+
+   //Remaining data still available in the receive buffer
+   socket->rcvUser -= length;
+   //Release the loaned buffers that have been fully consumed
+   tcpConsumeRxQueue(socket, length);
+
+   //Update the receive window
+   tcpUpdateReceiveWindow(socket);
+   //Update RX event state
+   tcpUpdateEvents(socket);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Shutdown gracefully reception, transmission, or both
  *
@@ -886,6 +1130,8 @@ error_t tcpAbort(Socket *socket)
       tcpChangeState(socket, TCP_STATE_CLOSED);
       //Delete TCB
       tcpDeleteControlBlock(socket);
+      //Remove the socket from the demultiplexing tables
+      socketRemoveHashEntry(socket);
       //Mark the socket as closed
       socket->type = SOCKET_TYPE_UNUSED;
       //Return status code
@@ -904,6 +1150,8 @@ error_t tcpAbort(Socket *socket)
       tcpChangeState(socket, TCP_STATE_CLOSED);
       //Delete TCB
       tcpDeleteControlBlock(socket);
+      //Remove the socket from the demultiplexing tables
+      socketRemoveHashEntry(socket);
       //Mark the socket as closed
       socket->type = SOCKET_TYPE_UNUSED;
       //No error to report
@@ -916,6 +1164,8 @@ error_t tcpAbort(Socket *socket)
       tcpChangeState(socket, TCP_STATE_CLOSED);
       //Delete TCB
       tcpDeleteControlBlock(socket);
+      //Remove the socket from the demultiplexing tables
+      socketRemoveHashEntry(socket);
       //Mark the socket as closed
       socket->type = SOCKET_TYPE_UNUSED;
       //No error to report
@@ -948,6 +1198,37 @@ TcpState tcpGetState(Socket *socket)
 }
 
 
+/**
+ * @brief Retrieve the operations of a congestion control algorithm
+ * @param[in] algo Congestion control algorithm
+ * @return Pointer to the corresponding operations, or NULL if the
+ *   algorithm is not supported
+ **/
+
+const TcpCongestOps *tcpGetCongestOps(TcpCongestAlgo algo)
+{
+   const TcpCongestOps *ops;
+
+#if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+   //Check congestion control algorithm
+   if(algo == TCP_CONGEST_ALGO_NEW_RENO)
+      ops = &tcpNewRenoOps;
+#if (TCP_CUBIC_SUPPORT == ENABLED)
+   else if(algo == TCP_CONGEST_ALGO_CUBIC)
+      ops = &tcpCubicOps;
+#endif
+   else
+      ops = NULL;
+#else
+   //Congestion control is not implemented
+   ops = NULL;
+#endif
+
+   //Return the operations of the algorithm
+   return ops;
+}
+
+
 /**
  * @brief Kill the oldest socket in the TIME-WAIT state
  * @return Handle identifying the oldest TCP connection in the TIME-WAIT state.
@@ -998,6 +1279,8 @@ Socket *tcpKillOldestConnection(void)
       tcpChangeState(oldestSocket, TCP_STATE_CLOSED);
       //Delete TCB
       tcpDeleteControlBlock(oldestSocket);
+      //Remove the socket from the demultiplexing tables
+      socketRemoveHashEntry(oldestSocket);
       //Mark the socket as closed
       oldestSocket->type = SOCKET_TYPE_UNUSED;
    }
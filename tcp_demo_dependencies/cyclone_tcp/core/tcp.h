@@ -40,10 +40,10 @@
    #error TCP_SUPPORT parameter is not valid
 #endif
 
-//TCP tick interval
+//TCP tick interval (resolution of the timing wheel)
 #ifndef TCP_TICK_INTERVAL
    #define TCP_TICK_INTERVAL 100
-#elif (TCP_TICK_INTERVAL < 10)
+#elif (TCP_TICK_INTERVAL < 1)
    #error TCP_TICK_INTERVAL parameter is not valid
 #endif
 
@@ -82,7 +82,8 @@
    #error TCP_DEFAULT_RX_BUFFER_SIZE parameter is not valid
 #endif
 
-//Maximum acceptable size for the receive buffer
+//Maximum acceptable size for the receive buffer. Sizes above 65535 are
+//only advertised in full when TCP_WINDOW_SCALE_SUPPORT is enabled
 #ifndef TCP_MAX_RX_BUFFER_SIZE
    #define TCP_MAX_RX_BUFFER_SIZE 22880
 #elif (TCP_MAX_RX_BUFFER_SIZE < 536)
@@ -159,6 +160,18 @@
    #error TCP_LOSS_WINDOW parameter is not valid
 #endif
 
+//CUBIC congestion control algorithm
+#ifndef TCP_CUBIC_SUPPORT
+   #define TCP_CUBIC_SUPPORT DISABLED
+#elif (TCP_CUBIC_SUPPORT != ENABLED && TCP_CUBIC_SUPPORT != DISABLED)
+   #error TCP_CUBIC_SUPPORT parameter is not valid
+#endif
+
+//Congestion control algorithm used by newly created sockets
+#ifndef TCP_DEFAULT_CONGEST_ALGO
+   #define TCP_DEFAULT_CONGEST_ALGO TCP_CONGEST_ALGO_NEW_RENO
+#endif
+
 //Default interval between successive window probes
 #ifndef TCP_DEFAULT_PROBE_INTERVAL
    #define TCP_DEFAULT_PROBE_INTERVAL 1000
@@ -194,6 +207,20 @@
    #error TCP_2MSL_TIMER parameter is not valid
 #endif
 
+//Delayed acknowledgment support
+#ifndef TCP_DELAYED_ACK_SUPPORT
+   #define TCP_DELAYED_ACK_SUPPORT DISABLED
+#elif (TCP_DELAYED_ACK_SUPPORT != ENABLED && TCP_DELAYED_ACK_SUPPORT != DISABLED)
+   #error TCP_DELAYED_ACK_SUPPORT parameter is not valid
+#endif
+
+//Delayed ACK timeout (must be less than 0.5 seconds)
+#ifndef TCP_DELAYED_ACK_TIMEOUT
+   #define TCP_DELAYED_ACK_TIMEOUT 200
+#elif (TCP_DELAYED_ACK_TIMEOUT < TCP_TICK_INTERVAL || TCP_DELAYED_ACK_TIMEOUT >= 500)
+   #error TCP_DELAYED_ACK_TIMEOUT parameter is not valid
+#endif
+
 //Selective acknowledgment support
 #ifndef TCP_SACK_SUPPORT
    #define TCP_SACK_SUPPORT DISABLED
@@ -201,6 +228,22 @@
    #error TCP_SACK_SUPPORT parameter is not valid
 #endif
 
+//Window scale option support. Disabled by default since the default
+//buffers fit in the 16-bit window field. Enable it together with a larger
+//TCP_MAX_RX_BUFFER_SIZE on targets that can afford windows above 64 KB
+#ifndef TCP_WINDOW_SCALE_SUPPORT
+   #define TCP_WINDOW_SCALE_SUPPORT DISABLED
+#elif (TCP_WINDOW_SCALE_SUPPORT != ENABLED && TCP_WINDOW_SCALE_SUPPORT != DISABLED)
+   #error TCP_WINDOW_SCALE_SUPPORT parameter is not valid
+#endif
+
+//Timestamps option support
+#ifndef TCP_TIMESTAMPS_SUPPORT
+   #define TCP_TIMESTAMPS_SUPPORT DISABLED
+#elif (TCP_TIMESTAMPS_SUPPORT != ENABLED && TCP_TIMESTAMPS_SUPPORT != DISABLED)
+   #error TCP_TIMESTAMPS_SUPPORT parameter is not valid
+#endif
+
 //Number of SACK blocks
 #ifndef TCP_MAX_SACK_BLOCKS
    #define TCP_MAX_SACK_BLOCKS 4
@@ -208,10 +251,30 @@
    #error TCP_MAX_SACK_BLOCKS parameter is not valid
 #endif
 
+//Maximum number of loaned buffers in the receive queue of a socket
+#ifndef TCP_MAX_RX_QUEUE_SIZE
+   #define TCP_MAX_RX_QUEUE_SIZE 8
+#elif (TCP_MAX_RX_QUEUE_SIZE < 1)
+   #error TCP_MAX_RX_QUEUE_SIZE parameter is not valid
+#endif
+
+//Counter block for fast-path statistics
+#ifndef TCP_COUNTER_BLOCK_SUPPORT
+   #define TCP_COUNTER_BLOCK_SUPPORT ENABLED
+#elif (TCP_COUNTER_BLOCK_SUPPORT != ENABLED && TCP_COUNTER_BLOCK_SUPPORT != DISABLED)
+   #error TCP_COUNTER_BLOCK_SUPPORT parameter is not valid
+#endif
+
 //Maximum TCP header length
 #define TCP_MAX_HEADER_LENGTH 60
 //Default maximum segment size
 #define TCP_DEFAULT_MSS 536
+//Maximum window scale factor (refer to RFC 7323, section 2.3)
+#define TCP_MAX_WINDOW_SCALE 14
+//Space taken by the Timestamps option, including padding
+#define TCP_TIMESTAMPS_OPTION_SIZE 12
+//Timestamps older than 24 days are invalid (refer to RFC 7323, section 5.5)
+#define TCP_PAWS_IDLE_TIMEOUT 2073600000
 
 //Sequence number comparison macro
 #define TCP_CMP_SEQ(a, b) ((int32_t) ((a) - (b)))
@@ -254,6 +317,28 @@ typedef enum
 } TcpCongestState;
 
 
+/**
+ * @brief TCP congestion control algorithms
+ **/
+
+typedef enum
+{
+   TCP_CONGEST_ALGO_NEW_RENO = 0,
+   TCP_CONGEST_ALGO_CUBIC    = 1
+} TcpCongestAlgo;
+
+
+/**
+ * @brief Congestion window events
+ **/
+
+typedef enum
+{
+   TCP_CONGEST_EVENT_INIT          = 0,
+   TCP_CONGEST_EVENT_RECOVERY_EXIT = 1
+} TcpCongestEvent;
+
+
 /**
  * @brief TCP control flags
  **/
@@ -341,14 +426,33 @@ typedef __start_packed struct
  * @brief TCP timer
  **/
 
-typedef struct
+typedef struct _TcpTimer
 {
    bool_t running;
    systime_t startTime;
    systime_t interval;
+   struct _TcpTimer **slot;
+   struct _TcpTimer *prev;
+   struct _TcpTimer *next;
+   struct _Socket *socket;
+   void (*handler)(struct _Socket *socket);
 } TcpTimer;
 
 
+/**
+ * @brief Congestion control algorithm operations
+ **/
+
+typedef struct
+{
+   TcpCongestAlgo algo;
+   void (*onAck)(struct _Socket *socket, uint_t n, bool_t rttFlag);
+   void (*onLoss)(struct _Socket *socket);
+   void (*onRto)(struct _Socket *socket);
+   void (*cwndEvent)(struct _Socket *socket, TcpCongestEvent event);
+} TcpCongestOps;
+
+
 /**
  * @brief Retransmission queue item
  **/
@@ -358,6 +462,7 @@ typedef struct _TcpQueueItem
    struct _TcpQueueItem *next;
    uint_t length;
    uint_t sacked;
+   uint_t retransmitted;
    IpPseudoHeader pseudoHeader;
    uint8_t header[TCP_MAX_HEADER_LENGTH];
 } TcpQueueItem;
@@ -376,9 +481,27 @@ typedef struct _TcpSynQueueItem
    IpAddr destAddr;
    uint32_t isn;
    uint16_t mss;
+   bool_t wndScaleEnabled;
+   uint8_t wndShift;
+   bool_t tsEnabled;
+   uint32_t tsVal;
+   bool_t sackPermitted;
 } TcpSynQueueItem;
 
 
+/**
+ * @brief Receive queue item (zero-copy receive)
+ **/
+
+typedef struct _TcpRxQueueItem
+{
+   struct _TcpRxQueueItem *next;
+   void *buffer;
+   uint8_t *data;
+   size_t length;
+} TcpRxQueueItem;
+
+
 /**
  * @brief SACK block
  **/
@@ -414,12 +537,30 @@ typedef struct
 } TcpRxBuffer;
 
 
-//Tick counter to handle periodic operations
-extern systime_t tcpTickCounter;
+/**
+ * @brief TCP counter block
+ *
+ * Statistics updated for every segment are accumulated here and added to
+ * the MIB-II and TCP-MIB counters by tcpFoldCounters()
+ **/
+
+typedef struct
+{
+   uint32_t inSegs;      ///<Segments received, including those received in error
+   uint32_t outSegs;     ///<Segments sent, excluding those containing only retransmitted octets
+   uint32_t retransSegs; ///<Segments retransmitted
+} TcpCounters;
+
+
+//TCP counter block
+#if (TCP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   extern TcpCounters tcpCounters;
+#endif
 
 //TCP related functions
 error_t tcpInit(void);
 uint16_t tcpGetDynamicPort(void);
+void tcpFoldCounters(void);
 
 error_t tcpConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePort);
 error_t tcpListen(Socket *socket, uint_t backlog);
@@ -431,10 +572,16 @@ error_t tcpSend(Socket *socket, const uint8_t *data,
 error_t tcpReceive(Socket *socket, uint8_t *data,
    size_t size, size_t *received, uint_t flags);
 
+error_t tcpReceiveZeroCopy(Socket *socket, const uint8_t **data,
+   size_t *length, uint_t flags);
+
+error_t tcpReleaseBuffer(Socket *socket, size_t length);
+
 error_t tcpShutdown(Socket *socket, uint_t how);
 error_t tcpAbort(Socket *socket);
 
 TcpState tcpGetState(Socket *socket);
+const TcpCongestOps *tcpGetCongestOps(TcpCongestAlgo algo);
 
 Socket *tcpKillOldestConnection(void);
 
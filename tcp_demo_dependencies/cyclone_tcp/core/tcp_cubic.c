@@ -0,0 +1,313 @@
+/**
+ * @file tcp_cubic.c
+ * @brief CUBIC congestion control
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * CUBIC grows the congestion window as a cubic function of the time elapsed
+ * since the last congestion event, which makes it far more effective than
+ * NewReno on paths with a large bandwidth-delay product. Refer to RFC 8312
+ * for complete details
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8a
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "core/socket.h"
+#include "core/tcp.h"
+#include "core/tcp_cubic.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED && TCP_CONGEST_CONTROL_SUPPORT == ENABLED && \
+   TCP_CUBIC_SUPPORT == ENABLED)
+
+/**
+ * @brief CUBIC congestion control
+ **/
+
+const TcpCongestOps tcpCubicOps =
+{
+   TCP_CONGEST_ALGO_CUBIC,
+   tcpCubicOnAck,
+   tcpCubicOnLoss,
+   tcpCubicOnRto,
+   tcpCubicCwndEvent
+};
+
+
+/**
+ * @brief Update the congestion window upon receipt of new acknowledgment
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] n Number of bytes acknowledged by the incoming ACK
+ * @param[in] rttFlag TRUE if a whole round-trip has elapsed
+ **/
+
+void tcpCubicOnAck(Socket *socket, uint_t n, bool_t rttFlag)
+{
+   systime_t time;
+   uint32_t target;
+   uint64_t thresh;
+
+   //Slow start algorithm is used when cwnd is lower than ssthresh
+   if(socket->cwnd < socket->ssthresh)
+   {
+      //During slow start, TCP increments cwnd by at most SMSS bytes
+      //for each ACK received that cumulatively acknowledges new data
+      socket->cwnd += MIN(n, socket->smss);
+   }
+   //Congestion avoidance algorithm is used when cwnd exceeds ssthres
+   else
+   {
+      //Get current time
+      time = osGetSystemTime();
+
+      //First ACK of a new congestion avoidance epoch?
+      if(!socket->cubicEpochStart)
+      {
+         //Record the beginning of the epoch (zero means no epoch)
+         socket->cubicEpochStart = MAX(time, 1);
+         //Reset the byte counter
+         socket->cubicAckCount = 0;
+         //The TCP-friendly estimate starts from the current window
+         socket->cubicEstWnd = socket->cwnd;
+         socket->cubicEstAckCount = 0;
+
+         //Check whether the window is below the point of the last reduction
+         if(socket->cwnd < socket->cubicWmax)
+         {
+            //Compute the time needed to get back to Wmax (in milliseconds)
+            socket->cubicK = tcpCubicRoot((uint64_t) (socket->cubicWmax -
+               socket->cwnd) * 2500000000ULL / socket->smss);
+            //The cubic function plateaus at Wmax
+            socket->cubicOrigin = socket->cubicWmax;
+         }
+         else
+         {
+            //Start probing immediately from the current window
+            socket->cubicK = 0;
+            socket->cubicOrigin = socket->cwnd;
+         }
+      }
+
+      //The target window is the value of the cubic function one RTT ahead
+      target = tcpCubicGetTarget(socket, time - socket->cubicEpochStart +
+         socket->srtt);
+      //The window must not grow by more than half its size per RTT
+      target = MIN(target, socket->cwnd + socket->cwnd / 2);
+
+      //Standard TCP would grow by 3 * (1 - beta) / (1 + beta) segments per
+      //RTT with the same decrease factor, i.e. by one SMSS every time
+      //17/9 of its window has been acknowledged
+      thresh = (uint64_t) socket->cubicEstWnd * 17 / 9;
+
+      //Clamp the resulting value
+      thresh = MAX(thresh, 1);
+      thresh = MIN(thresh, UINT32_MAX);
+
+      //Bytes acknowledged since the last increase of the estimate. The
+      //remainder is carried across ACKs so that large windows still grow
+      socket->cubicEstAckCount += n;
+
+      //Time to increase the estimated window?
+      if(socket->cubicEstAckCount >= thresh)
+      {
+         //Increment the estimate by one SMSS for each threshold crossed
+         socket->cubicEstWnd += socket->smss *
+            (socket->cubicEstAckCount / (uint32_t) thresh);
+         socket->cubicEstAckCount %= (uint32_t) thresh;
+      }
+
+      //In the TCP-friendly region, CUBIC must be at least as aggressive as
+      //standard TCP
+      target = MAX(target, socket->cubicEstWnd);
+
+      //Compute the number of bytes to be acknowledged before cwnd can be
+      //incremented by one SMSS
+      if(target > socket->cwnd)
+         thresh = (uint64_t) socket->cwnd * socket->smss / (target - socket->cwnd);
+      else
+         thresh = (uint64_t) socket->cwnd * 100;
+
+      //Clamp the resulting value
+      thresh = MAX(thresh, 1);
+      thresh = MIN(thresh, UINT32_MAX);
+
+      //Total number of bytes acknowledged during the epoch
+      socket->cubicAckCount += n;
+
+      //Time to increase the congestion window?
+      if(socket->cubicAckCount >= thresh)
+      {
+         //Increment cwnd by one SMSS for each threshold crossed
+         socket->cwnd += socket->smss * (socket->cubicAckCount / (uint32_t) thresh);
+         socket->cubicAckCount %= (uint32_t) thresh;
+      }
+   }
+}
+
+
+/**
+ * @brief Adjust the slow start threshold after 3 duplicate ACKs
+ * @param[in] socket Handle referencing the current socket
+ **/
+
+void tcpCubicOnLoss(Socket *socket)
+{
+   //End the current congestion avoidance epoch
+   socket->cubicEpochStart = 0;
+
+   //Fast convergence: when the window did not reach the previous Wmax,
+   //release some bandwidth for new flows (refer to RFC 8312, section 4.6)
+   if(socket->cwnd < socket->cubicWmax)
+   {
+      socket->cubicWmax = (uint64_t) socket->cwnd *
+         (TCP_CUBIC_BETA_DEN + TCP_CUBIC_BETA_NUM) / (2 * TCP_CUBIC_BETA_DEN);
+   }
+   else
+   {
+      socket->cubicWmax = socket->cwnd;
+   }
+
+   //Multiplicative decrease
+   socket->ssthresh = (uint64_t) socket->cwnd * TCP_CUBIC_BETA_NUM / TCP_CUBIC_BETA_DEN;
+   socket->ssthresh = MAX(socket->ssthresh, 2 * socket->smss);
+}
+
+
+/**
+ * @brief Adjust the congestion window after a retransmission timeout
+ * @param[in] socket Handle referencing the current socket
+ **/
+
+void tcpCubicOnRto(Socket *socket)
+{
+   //The window is only reduced once per loss event
+   if(!socket->retransmitCount)
+      tcpCubicOnLoss(socket);
+
+   //End the current congestion avoidance epoch
+   socket->cubicEpochStart = 0;
+
+   //Upon a timeout cwnd must be set to no more than the loss window
+   socket->cwnd = MIN(TCP_LOSS_WINDOW * socket->smss, socket->txBufferSize);
+}
+
+
+/**
+ * @brief Process congestion window events
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] event Congestion window event
+ **/
+
+void tcpCubicCwndEvent(Socket *socket, TcpCongestEvent event)
+{
+   //Check event type
+   if(event == TCP_CONGEST_EVENT_INIT)
+   {
+      //Reset CUBIC state
+      socket->cubicWmax = 0;
+      socket->cubicOrigin = 0;
+      socket->cubicK = 0;
+      socket->cubicEpochStart = 0;
+      socket->cubicEstWnd = 0;
+      socket->cubicEstAckCount = 0;
+      socket->cubicAckCount = 0;
+   }
+   else if(event == TCP_CONGEST_EVENT_RECOVERY_EXIT)
+   {
+      //A new epoch starts with the next ACK
+      socket->cubicEpochStart = 0;
+   }
+}
+
+
+/**
+ * @brief Evaluate the cubic window growth function
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] t Time elapsed since the beginning of the epoch, in milliseconds
+ * @return Target congestion window, in bytes
+ **/
+
+uint32_t tcpCubicGetTarget(Socket *socket, systime_t t)
+{
+   int64_t d;
+   int64_t w;
+
+   //Distance to the plateau, in milliseconds
+   d = (int64_t) t - (int64_t) socket->cubicK;
+
+   //Keep the cube within 64-bit range
+   d = MIN(d, 1 << 20);
+   d = MAX(d, -(1 << 20));
+
+   //W(t) = C * (t - K)^3 + Wmax with C = 0.4 (in thousandths of segment)
+   w = 4 * d * d * d / 10000000;
+   //Convert the offset to bytes
+   w = w * socket->smss / 1000;
+   //Add the origin point
+   w += socket->cubicOrigin;
+
+   //Return the target window
+   return (uint32_t) MAX(MIN(w, UINT32_MAX), 0);
+}
+
+
+/**
+ * @brief Integer cube root
+ * @param[in] x Input value
+ * @return Largest integer whose cube does not exceed x
+ **/
+
+uint32_t tcpCubicRoot(uint64_t x)
+{
+   int_t s;
+   uint64_t y;
+   uint64_t b;
+
+   //Initialize result
+   y = 0;
+
+   //Compute the root one bit at a time
+   for(s = 63; s >= 0; s -= 3)
+   {
+      y += y;
+      b = 3 * y * (y + 1) + 1;
+
+      if((x >> s) >= b)
+      {
+         x -= b << s;
+         y++;
+      }
+   }
+
+   //Return the cube root
+   return (uint32_t) y;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file tcp_cubic.h
+ * @brief CUBIC congestion control
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8a
+ **/
+
+#ifndef _TCP_CUBIC_H
+#define _TCP_CUBIC_H
+
+//Dependencies
+#include "core/tcp.h"
+
+//Multiplicative decrease factor (beta = 0.7)
+#define TCP_CUBIC_BETA_NUM 7
+#define TCP_CUBIC_BETA_DEN 10
+
+//C++ guard
+#ifdef __cplusplus
+   extern "C" {
+#endif
+
+//CUBIC congestion control
+extern const TcpCongestOps tcpCubicOps;
+
+//CUBIC related functions
+void tcpCubicOnAck(Socket *socket, uint_t n, bool_t rttFlag);
+void tcpCubicOnLoss(Socket *socket);
+void tcpCubicOnRto(Socket *socket);
+void tcpCubicCwndEvent(Socket *socket, TcpCongestEvent event);
+
+uint32_t tcpCubicGetTarget(Socket *socket, systime_t t);
+uint32_t tcpCubicRoot(uint64_t x);
+
+//C++ guard
+#ifdef __cplusplus
+   }
+#endif
+
+#endif
@@ -72,14 +72,20 @@ void tcpProcessSegment(NetInterface *interface,
 {
    uint_t i;
    size_t length;
+   IpAddr srcIpAddr;
    Socket *socket;
    Socket *passiveSocket;
+   Socket *chain[2];
    TcpHeader *segment;
 
    //Total number of segments received, including those received in error
+#if (TCP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   TCP_INC_COUNTER(inSegs, 1);
+#else
    MIB2_INC_COUNTER32(tcpGroup.tcpInSegs, 1);
    TCP_MIB_INC_COUNTER32(tcpInSegs, 1);
    TCP_MIB_INC_COUNTER64(tcpHCInSegs, 1);
+#endif
 
    //A TCP implementation must silently discard an incoming
    //segment that is addressed to a broadcast or multicast
@@ -147,8 +153,9 @@ void tcpProcessSegment(NetInterface *interface,
       return;
    }
 
-   //Verify TCP checksum
-   if(ipCalcUpperLayerChecksumEx(pseudoHeader->data,
+   //Verify TCP checksum (unless the hardware already did it)
+   if(!ipIsRxChecksumOffloaded(interface, pseudoHeader) &&
+      ipCalcUpperLayerChecksumEx(pseudoHeader->data,
       pseudoHeader->length, buffer, offset, length) != 0x0000)
    {
       //Debug message
@@ -162,99 +169,133 @@ void tcpProcessSegment(NetInterface *interface,
       return;
    }
 
+#if (IPV4_SUPPORT == ENABLED)
+   //An IPv4 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //Save the source IPv4 address
+      srcIpAddr.length = sizeof(Ipv4Addr);
+      srcIpAddr.ipv4Addr = pseudoHeader->ipv4Data.srcAddr;
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //An IPv6 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+   {
+      //Save the source IPv6 address
+      srcIpAddr.length = sizeof(Ipv6Addr);
+      srcIpAddr.ipv6Addr = pseudoHeader->ipv6Data.srcAddr;
+   }
+   else
+#endif
+   //An invalid packet was received?
+   {
+      //This should never occur...
+      srcIpAddr = IP_ADDR_ANY;
+   }
+
+   //Connected sockets are searched first, then listening sockets
+   chain[0] = socketGetConnHashChain(ntohs(segment->destPort),
+      &srcIpAddr, ntohs(segment->srcPort));
+   chain[1] = socketGetPortHashChain(ntohs(segment->destPort));
+
    //No matching socket in the LISTEN state for the moment
    passiveSocket = NULL;
+   //No matching socket for the moment
+   socket = NULL;
 
-   //Look through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   //Loop through the relevant hash chains
+   for(i = 0; i < arraysize(chain) && socket == NULL; i++)
    {
-      //Point to the current socket
-      socket = socketTable + i;
-
-      //TCP socket found?
-      if(socket->type != SOCKET_TYPE_STREAM)
-         continue;
-      //Check whether the socket is bound to a particular interface
-      if(socket->interface && socket->interface != interface)
-         continue;
-      //Check destination port number
-      if(socket->localPort != ntohs(segment->destPort))
-         continue;
+      //Look through the sockets of the current chain
+      for(socket = chain[i]; socket != NULL; socket = socket->hashNext)
+      {
+         //TCP socket found?
+         if(socket->type != SOCKET_TYPE_STREAM)
+            continue;
+         //Check whether the socket is bound to a particular interface
+         if(socket->interface && socket->interface != interface)
+            continue;
+         //Check destination port number
+         if(socket->localPort != ntohs(segment->destPort))
+            continue;
 
 #if (IPV4_SUPPORT == ENABLED)
-      //An IPv4 packet was received?
-      if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
-      {
-         //Destination IP address filtering
-         if(socket->localIpAddr.length)
-         {
-            //An IPv4 address is expected
-            if(socket->localIpAddr.length != sizeof(Ipv4Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(socket->localIpAddr.ipv4Addr != pseudoHeader->ipv4Data.destAddr)
-               continue;
-         }
-         //Source IP address filtering
-         if(socket->remoteIpAddr.length)
+         //An IPv4 packet was received?
+         if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
          {
-            //An IPv4 address is expected
-            if(socket->remoteIpAddr.length != sizeof(Ipv4Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(socket->remoteIpAddr.ipv4Addr != pseudoHeader->ipv4Data.srcAddr)
-               continue;
+            //Destination IP address filtering
+            if(socket->localIpAddr.length)
+            {
+               //An IPv4 address is expected
+               if(socket->localIpAddr.length != sizeof(Ipv4Addr))
+                  continue;
+               //Filter out non-matching addresses
+               if(socket->localIpAddr.ipv4Addr != pseudoHeader->ipv4Data.destAddr)
+                  continue;
+            }
+            //Source IP address filtering
+            if(socket->remoteIpAddr.length)
+            {
+               //An IPv4 address is expected
+               if(socket->remoteIpAddr.length != sizeof(Ipv4Addr))
+                  continue;
+               //Filter out non-matching addresses
+               if(socket->remoteIpAddr.ipv4Addr != pseudoHeader->ipv4Data.srcAddr)
+                  continue;
+            }
          }
-      }
-      else
+         else
 #endif
 #if (IPV6_SUPPORT == ENABLED)
-      //An IPv6 packet was received?
-      if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
-      {
-         //Destination IP address filtering
-         if(socket->localIpAddr.length)
+         //An IPv6 packet was received?
+         if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
          {
-            //An IPv6 address is expected
-            if(socket->localIpAddr.length != sizeof(Ipv6Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(!ipv6CompAddr(&socket->localIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.destAddr))
-               continue;
+            //Destination IP address filtering
+            if(socket->localIpAddr.length)
+            {
+               //An IPv6 address is expected
+               if(socket->localIpAddr.length != sizeof(Ipv6Addr))
+                  continue;
+               //Filter out non-matching addresses
+               if(!ipv6CompAddr(&socket->localIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.destAddr))
+                  continue;
+            }
+            //Source IP address filtering
+            if(socket->remoteIpAddr.length)
+            {
+               //An IPv6 address is expected
+               if(socket->remoteIpAddr.length != sizeof(Ipv6Addr))
+                  continue;
+               //Filter out non-matching addresses
+               if(!ipv6CompAddr(&socket->remoteIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.srcAddr))
+                  continue;
+            }
          }
-         //Source IP address filtering
-         if(socket->remoteIpAddr.length)
+         else
+#endif
+         //An invalid packet was received?
          {
-            //An IPv6 address is expected
-            if(socket->remoteIpAddr.length != sizeof(Ipv6Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(!ipv6CompAddr(&socket->remoteIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.srcAddr))
-               continue;
+            //This should never occur...
+            continue;
          }
-      }
-      else
-#endif
-      //An invalid packet was received?
-      {
-         //This should never occur...
-         continue;
-      }
 
-      //Keep track of the first matching socket in the LISTEN state
-      if(socket->state == TCP_STATE_LISTEN && !passiveSocket)
-         passiveSocket = socket;
-      //Source port filtering
-      if(socket->remotePort != ntohs(segment->srcPort))
-         continue;
+         //Keep track of the first matching socket in the LISTEN state
+         if(socket->state == TCP_STATE_LISTEN && !passiveSocket)
+            passiveSocket = socket;
+         //Source port filtering
+         if(socket->remotePort != ntohs(segment->srcPort))
+            continue;
 
-      //A matching socket has been found
-      break;
+         //A matching socket has been found
+         break;
+      }
    }
 
    //If no matching socket has been found then try to
    //use the first matching socket in the LISTEN state
-   if(i >= SOCKET_MAX_COUNT)
+   if(socket == NULL)
       socket = passiveSocket;
 
    //Offset to the first data byte
@@ -418,6 +459,9 @@ void tcpStateListen(Socket *socket, NetInterface *interface,
    uint_t i;
    TcpOption *option;
    TcpSynQueueItem *queueItem;
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   uint32_t tsEcr;
+#endif
 
    //Debug message
    TRACE_DEBUG("TCP FSM: LISTEN state\r\n");
@@ -531,6 +575,33 @@ void tcpStateListen(Socket *socket, NetInterface *interface,
          queueItem->mss = MAX(queueItem->mss, TCP_MIN_MSS);
       }
 
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //Check whether the peer is willing to use window scaling
+      queueItem->wndScaleEnabled = tcpGetWindowScaleOption(segment,
+         &queueItem->wndShift);
+#else
+      //Window scaling is not supported
+      queueItem->wndScaleEnabled = FALSE;
+#endif
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //Check whether the peer is willing to receive SACK options
+      option = tcpGetOption(segment, TCP_OPTION_SACK_PERMITTED);
+      queueItem->sackPermitted = (option != NULL && option->length == 2);
+#else
+      //SACK is not supported
+      queueItem->sackPermitted = FALSE;
+#endif
+
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+      //Check whether the peer is willing to use timestamps
+      queueItem->tsEnabled = tcpGetTimestampOption(segment,
+         &queueItem->tsVal, &tsEcr);
+#else
+      //Timestamps are not supported
+      queueItem->tsEnabled = FALSE;
+#endif
+
       //Notify user that a connection request is pending
       tcpUpdateEvents(socket);
 
@@ -554,6 +625,10 @@ void tcpStateListen(Socket *socket, NetInterface *interface,
 void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
 {
    TcpOption *option;
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   uint32_t tsVal;
+   uint32_t tsEcr;
+#endif
 
    //Debug message
    TRACE_DEBUG("TCP FSM: SYN-SENT state\r\n");
@@ -604,6 +679,31 @@ void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
       if(segment->flags & TCP_FLAG_ACK)
          socket->sndUna = segment->ackNum;
 
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //SACK is in effect only if both sides sent the SACK Permitted option
+      option = tcpGetOption(segment, TCP_OPTION_SACK_PERMITTED);
+      socket->sackPermitted = (option != NULL && option->length == 2);
+#endif
+
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+      //Timestamps are in effect only if both sides sent the option
+      if(tcpGetTimestampOption(segment, &tsVal, &tsEcr))
+      {
+         //Save the timestamp to be echoed
+         socket->tsRecent = tsVal;
+         socket->tsRecentAge = osGetSystemTime();
+
+         //The echoed timestamp provides the first RTT sample
+         if((segment->flags & TCP_FLAG_ACK) && tsEcr != 0)
+            tcpUpdateRttEstimator(socket, osGetSystemTime() - tsEcr);
+      }
+      else
+      {
+         //Do not send the option in subsequent segments
+         socket->tsEnabled = FALSE;
+      }
+#endif
+
       //Compute retransmission timeout
       tcpComputeRto(socket);
 
@@ -630,6 +730,23 @@ void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
          socket->smss = MAX(socket->smss, TCP_MIN_MSS);
       }
 
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //Window scaling is in effect only if both sides sent the option
+      if(!tcpGetWindowScaleOption(segment, &socket->sndWndShift))
+      {
+         socket->wndScaleEnabled = FALSE;
+         socket->sndWndShift = 0;
+         socket->rcvWndShift = 0;
+      }
+#endif
+
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+      //The Timestamps option takes room in every segment, so the amount
+      //of data per segment must be reduced accordingly
+      if(socket->tsEnabled)
+         socket->smss -= TCP_TIMESTAMPS_OPTION_SIZE;
+#endif
+
 #if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
       //Initial congestion window
       socket->cwnd = MIN(TCP_INITIAL_WINDOW * socket->smss, socket->txBufferSize);
@@ -720,12 +837,12 @@ void tcpStateSynReceived(Socket *socket, TcpHeader *segment,
    }
 
    //Update the send window before entering ESTABLISHED state (see RFC 1122 4.2.2.20)
-   socket->sndWnd = segment->window;
+   socket->sndWnd = (uint32_t) segment->window << socket->sndWndShift;
    socket->sndWl1 = segment->seqNum;
    socket->sndWl2 = segment->ackNum;
 
    //Maximum send window it has seen so far on the connection
-   socket->maxSndWnd = segment->window;
+   socket->maxSndWnd = socket->sndWnd;
 
    //Enter ESTABLISHED state
    tcpChangeState(socket, TCP_STATE_ESTABLISHED);
@@ -1148,6 +1265,8 @@ void tcpStateTimeWait(Socket *socket, TcpHeader *segment, size_t length)
       {
          //Delete the TCB
          tcpDeleteControlBlock(socket);
+         //Remove the socket from the demultiplexing tables
+         socketRemoveHashEntry(socket);
          //Mark the socket as closed
          socket->type = SOCKET_TYPE_UNUSED;
       }
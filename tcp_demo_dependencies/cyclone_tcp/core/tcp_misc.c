@@ -70,6 +70,9 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    TcpHeader *segment;
    TcpQueueItem *queueItem;
    IpPseudoHeader pseudoHeader;
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   uint32_t timestamps[2];
+#endif
 
    //Maximum segment size
    uint16_t mss = HTONS(socket->rmss);
@@ -92,7 +95,7 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    segment->dataOffset = 5;
    segment->flags = flags;
    segment->reserved2 = 0;
-   segment->window = htons(socket->rcvWnd);
+   segment->window = htons(tcpGetAdvertisedWindow(socket, flags));
    segment->checksum = 0;
    segment->urgentPointer = 0;
 
@@ -103,10 +106,65 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
       tcpAddOption(segment, TCP_OPTION_MAX_SEGMENT_SIZE, &mss, sizeof(mss));
 
 #if (TCP_SACK_SUPPORT == ENABLED)
-      //Append SACK Permitted option
-      tcpAddOption(segment, TCP_OPTION_SACK_PERMITTED, NULL, 0);
+      //A SYN-ACK may only carry the SACK Permitted option if the peer sent it
+      if(socket->sackPermitted)
+      {
+         //Append SACK Permitted option
+         tcpAddOption(segment, TCP_OPTION_SACK_PERMITTED, NULL, 0);
+      }
+#endif
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //A SYN-ACK may only carry the Window Scale option if the peer sent it
+      if(socket->wndScaleEnabled)
+      {
+         //Append Window Scale option
+         tcpAddOption(segment, TCP_OPTION_WINDOW_SCALE_FACTOR,
+            &socket->rcvWndShift, sizeof(uint8_t));
+      }
+#endif
+   }
+
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   //Once negotiated, the Timestamps option must be sent in every
+   //non-RST segment (refer to RFC 7323, section 3.2)
+   if(socket->tsEnabled && !(flags & TCP_FLAG_RST))
+   {
+      //TSval carries the current value of the timestamp clock
+      timestamps[0] = htonl(osGetSystemTime());
+      //TSecr is only valid when the ACK bit is set
+      timestamps[1] = (flags & TCP_FLAG_ACK) ? htonl(socket->tsRecent) : 0;
+
+      //Append Timestamps option
+      tcpAddOption(segment, TCP_OPTION_TIMESTAMP, timestamps, sizeof(timestamps));
+   }
+
+   //Record the last acknowledgment number sent (Last.ACK.sent)
+   if(flags & TCP_FLAG_ACK)
+      socket->lastAckSent = ackNum;
+#endif
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //The acknowledgment is piggybacked on the outgoing segment, so
+   //there is no need to send a delayed ACK anymore
+   if((flags & TCP_FLAG_ACK) && ackNum == socket->rcvNxt)
+   {
+      socket->ackPendingLength = 0;
+      tcpTimerStop(&socket->delayedAckTimer);
+   }
 #endif
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //Report the out-of-order blocks in pure acknowledgments. Segments kept in
+   //the retransmission queue do not carry the option, as the information
+   //would be stale by the time they are retransmitted
+   if(socket->sackPermitted && socket->sackBlockCount > 0 &&
+      (flags & TCP_FLAG_ACK) && !(flags & TCP_FLAG_SYN) && !addToQueue)
+   {
+      //Append SACK option
+      tcpAddSackOption(socket, segment);
    }
+#endif
 
    //Adjust the length of the multi-part buffer
    netBufferSetLength(buffer, offset + segment->dataOffset * 4);
@@ -141,9 +199,14 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
       pseudoHeader.ipv4Data.protocol = IPV4_PROTOCOL_TCP;
       pseudoHeader.ipv4Data.length = htons(totalLength);
 
-      //Calculate TCP header checksum
-      segment->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv4Data,
-         sizeof(Ipv4PseudoHeader), buffer, offset, totalLength);
+      //TCP checksum calculation not supported by hardware?
+      if(!ipv4IsTxChecksumOffloaded(socket->interface,
+         IPV4_PROTOCOL_TCP, totalLength))
+      {
+         //Calculate TCP header checksum
+         segment->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv4Data,
+            sizeof(Ipv4PseudoHeader), buffer, offset, totalLength);
+      }
    }
    else
 #endif
@@ -176,25 +239,8 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    //Add current segment to retransmission queue?
    if(addToQueue)
    {
-      //Empty retransmission queue?
-      if(!socket->retransmitQueue)
-      {
-         //Create a new item
-         queueItem = memPoolAlloc(sizeof(TcpQueueItem));
-         //Add the newly created item to the queue
-         socket->retransmitQueue = queueItem;
-      }
-      else
-      {
-         //Point to the very first item
-         queueItem = socket->retransmitQueue;
-         //Reach the last item of the retransmission queue
-         while(queueItem->next) queueItem = queueItem->next;
-         //Create a new item
-         queueItem->next = memPoolAlloc(sizeof(TcpQueueItem));
-         //Point to the newly created item
-         queueItem = queueItem->next;
-      }
+      //Create a new item
+      queueItem = memPoolAlloc(sizeof(TcpQueueItem));
 
       //Failed to allocate memory?
       if(queueItem == NULL)
@@ -205,10 +251,26 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
          return ERROR_OUT_OF_MEMORY;
       }
 
+      //Empty retransmission queue?
+      if(socket->retransmitQueue == NULL)
+      {
+         //Add the newly created item to the queue
+         socket->retransmitQueue = queueItem;
+      }
+      else
+      {
+         //Append the newly created item to the tail of the queue
+         socket->retransmitQueueTail->next = queueItem;
+      }
+
+      //The newly created item is now the last item of the queue
+      socket->retransmitQueueTail = queueItem;
+
       //Retransmission mechanism requires additional information
       queueItem->next = NULL;
       queueItem->length = length;
       queueItem->sacked = FALSE;
+      queueItem->retransmitted = FALSE;
       //Save TCP header
       memcpy(queueItem->header, segment, segment->dataOffset * 4);
       //Save pseudo header
@@ -242,9 +304,13 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    }
 
    //Total number of segments sent
+#if (TCP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   TCP_INC_COUNTER(outSegs, 1);
+#else
    MIB2_INC_COUNTER32(tcpGroup.tcpOutSegs, 1);
    TCP_MIB_INC_COUNTER32(tcpOutSegs, 1);
    TCP_MIB_INC_COUNTER64(tcpHCOutSegs, 1);
+#endif
 
    //RST flag set?
    if(flags & TCP_FLAG_RST)
@@ -261,8 +327,14 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    //Dump TCP header contents for debugging purpose
    tcpDumpHeader(segment, length, socket->iss, socket->irs);
 
+#if (IPV4_SUPPORT == ENABLED && IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   //Send TCP segment using the destination cache slot of the socket
+   error = ipSendDatagram(socket->interface, &pseudoHeader, buffer, offset, 0,
+      &socket->destCacheEntry);
+#else
    //Send TCP segment
-   error = ipSendDatagram(socket->interface, &pseudoHeader, buffer, offset, 0);
+   error = ipSendDatagram(socket->interface, &pseudoHeader, buffer, offset, 0, NULL);
+#endif
 
    //Free previously allocated memory
    netBufferFree(buffer);
@@ -350,9 +422,14 @@ error_t tcpSendResetSegment(NetInterface *interface,
       pseudoHeader2.ipv4Data.protocol = IPV4_PROTOCOL_TCP;
       pseudoHeader2.ipv4Data.length = HTONS(sizeof(TcpHeader));
 
-      //Calculate TCP header checksum
-      segment2->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader2.ipv4Data,
-         sizeof(Ipv4PseudoHeader), buffer, offset, sizeof(TcpHeader));
+      //TCP checksum calculation not supported by hardware?
+      if(!ipv4IsTxChecksumOffloaded(interface,
+         IPV4_PROTOCOL_TCP, sizeof(TcpHeader)))
+      {
+         //Calculate TCP header checksum
+         segment2->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader2.ipv4Data,
+            sizeof(Ipv4PseudoHeader), buffer, offset, sizeof(TcpHeader));
+      }
    }
    else
 #endif
@@ -383,9 +460,13 @@ error_t tcpSendResetSegment(NetInterface *interface,
    }
 
    //Total number of segments sent
+#if (TCP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   TCP_INC_COUNTER(outSegs, 1);
+#else
    MIB2_INC_COUNTER32(tcpGroup.tcpOutSegs, 1);
    TCP_MIB_INC_COUNTER32(tcpOutSegs, 1);
    TCP_MIB_INC_COUNTER64(tcpHCOutSegs, 1);
+#endif
 
    //Number of TCP segments sent containing the RST flag
    MIB2_INC_COUNTER32(tcpGroup.tcpOutRsts, 1);
@@ -398,7 +479,7 @@ error_t tcpSendResetSegment(NetInterface *interface,
    tcpDumpHeader(segment2, length, 0, 0);
 
    //Send TCP segment
-   error = ipSendDatagram(interface, &pseudoHeader2, buffer, offset, 0);
+   error = ipSendDatagram(interface, &pseudoHeader2, buffer, offset, 0, NULL);
 
    //Free previously allocated memory
    netBufferFree(buffer);
@@ -407,6 +488,181 @@ error_t tcpSendResetSegment(NetInterface *interface,
 }
 
 
+/**
+ * @brief Compute the value of the window field of an outgoing segment
+ * @param[in] socket Handle referencing the socket
+ * @param[in] flags Value of the control flags of the segment
+ * @return Window to be advertised, in the units expected by the peer
+ **/
+
+uint16_t tcpGetAdvertisedWindow(Socket *socket, uint8_t flags)
+{
+   uint32_t window;
+
+   //The window field in a SYN segment is never scaled (refer to
+   //RFC 7323, section 2.2)
+   if(flags & TCP_FLAG_SYN)
+      window = socket->rcvWnd;
+   else
+      window = socket->rcvWnd >> socket->rcvWndShift;
+
+   //The window field is 16 bits wide
+   return MIN(window, UINT16_MAX);
+}
+
+
+/**
+ * @brief Select the shift count used to advertise a receive buffer
+ * @param[in] size Size of the receive buffer
+ * @return Window scale factor
+ **/
+
+uint8_t tcpGetWindowShift(size_t size)
+{
+   uint8_t shift;
+
+   //Use the smallest scale factor that allows the whole buffer to be advertised
+   for(shift = 0; shift < TCP_MAX_WINDOW_SCALE; shift++)
+   {
+      if((size >> shift) <= UINT16_MAX)
+         break;
+   }
+
+   //Return the scale factor
+   return shift;
+}
+
+
+/**
+ * @brief Parse the Window Scale option of an incoming SYN segment
+ * @param[in] segment Pointer to the TCP header
+ * @param[out] shift Scale factor requested by the peer
+ * @return TRUE if the option is present, else FALSE
+ **/
+
+bool_t tcpGetWindowScaleOption(TcpHeader *segment, uint8_t *shift)
+{
+   TcpOption *option;
+
+   //Search the TCP header for the Window Scale option
+   option = tcpGetOption(segment, TCP_OPTION_WINDOW_SCALE_FACTOR);
+
+   //Malformed or missing option?
+   if(option == NULL || option->length != 3)
+      return FALSE;
+
+   //If a shift count greater than 14 is received, it must be interpreted
+   //as 14 (refer to RFC 7323, section 2.3)
+   *shift = MIN(option->value[0], TCP_MAX_WINDOW_SCALE);
+
+   //The option is present
+   return TRUE;
+}
+
+
+/**
+ * @brief Parse the Timestamps option of an incoming segment
+ * @param[in] segment Pointer to the TCP header
+ * @param[out] tsVal Timestamp value field (TSval)
+ * @param[out] tsEcr Timestamp echo reply field (TSecr)
+ * @return TRUE if the option is present, else FALSE
+ **/
+
+bool_t tcpGetTimestampOption(TcpHeader *segment, uint32_t *tsVal, uint32_t *tsEcr)
+{
+   TcpOption *option;
+
+   //Search the TCP header for the Timestamps option
+   option = tcpGetOption(segment, TCP_OPTION_TIMESTAMP);
+
+   //Malformed or missing option?
+   if(option == NULL || option->length != 10)
+      return FALSE;
+
+   //Retrieve TSval and TSecr fields
+   memcpy(tsVal, option->value, 4);
+   memcpy(tsEcr, option->value + 4, 4);
+
+   //Convert from network byte order to host byte order
+   *tsVal = ntohl(*tsVal);
+   *tsEcr = ntohl(*tsEcr);
+
+   //The option is present
+   return TRUE;
+}
+
+
+/**
+ * @brief Refresh the header of a segment being retransmitted
+ *
+ * The ACK number and the Timestamps option are brought up to date, so that
+ * the peer does not discard the retransmission as carrying an old ACK
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] buffer Multi-part buffer containing the TCP segment
+ * @param[in] offset Offset to the first byte of the TCP header
+ * @param[in] pseudoHeader TCP pseudo header
+ **/
+
+void tcpRefreshSegment(Socket *socket, NetBuffer *buffer,
+   size_t offset, const IpPseudoHeader *pseudoHeader)
+{
+   TcpHeader *segment;
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   uint32_t value;
+   TcpOption *option;
+#endif
+
+   //Point to the TCP header
+   segment = netBufferAt(buffer, offset);
+
+   //Acknowledge the data received since the original transmission
+   if(segment->flags & TCP_FLAG_ACK)
+      segment->ackNum = htonl(socket->rcvNxt);
+
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   //Search the TCP header for the Timestamps option
+   option = tcpGetOption(segment, TCP_OPTION_TIMESTAMP);
+
+   //Well-formed option?
+   if(socket->tsEnabled && option != NULL && option->length == 10)
+   {
+      //Update TSval with the current value of the timestamp clock
+      value = htonl(osGetSystemTime());
+      memcpy(option->value, &value, 4);
+
+      //Echo the most recent timestamp received from the peer
+      if(segment->flags & TCP_FLAG_ACK)
+      {
+         value = htonl(socket->tsRecent);
+         memcpy(option->value + 4, &value, 4);
+      }
+   }
+#endif
+
+   //Clear the checksum field before recomputing it
+   segment->checksum = 0;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //The checksum of IPv4 segments may be inserted by hardware
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //TCP checksum calculation supported by hardware?
+      if(ipv4IsTxChecksumOffloaded(socket->interface, IPV4_PROTOCOL_TCP,
+         netBufferGetLength(buffer) - offset))
+      {
+         //The hardware will compute the checksum
+         return;
+      }
+   }
+#endif
+
+   //Recalculate TCP header checksum
+   segment->checksum = ipCalcUpperLayerChecksumEx(pseudoHeader->data,
+      pseudoHeader->length, buffer, offset, netBufferGetLength(buffer) - offset);
+}
+
+
 /**
  * @brief Append an option to a TCP segment
  * @param[in] segment Pointer to the TCP header
@@ -521,9 +777,41 @@ TcpOption *tcpGetOption(TcpHeader *segment, uint8_t kind)
 
 error_t tcpCheckSequenceNumber(Socket *socket, TcpHeader *segment, size_t length)
 {
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   bool_t tsPresent;
+   uint32_t tsVal;
+   uint32_t tsEcr;
+#endif
+
    //Acceptability test for an incoming segment
    bool_t acceptable = FALSE;
 
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   //Retrieve the timestamps carried by the incoming segment
+   if(socket->tsEnabled)
+      tsPresent = tcpGetTimestampOption(segment, &tsVal, &tsEcr);
+   else
+      tsPresent = FALSE;
+
+   //PAWS check (refer to RFC 7323, section 5.3)
+   if(tsPresent && !(segment->flags & TCP_FLAG_RST) &&
+      TCP_CMP_SEQ(tsVal, socket->tsRecent) < 0)
+   {
+      //If the connection has been idle for more than 24 days, TS.Recent
+      //is invalid and the segment must not be discarded
+      if((osGetSystemTime() - socket->tsRecentAge) < TCP_PAWS_IDLE_TIMEOUT)
+      {
+         //Debug message
+         TRACE_WARNING("Segment rejected by PAWS!\r\n");
+
+         //Send an acknowledgment in reply and drop the segment
+         tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+         //Return status code
+         return ERROR_FAILURE;
+      }
+   }
+#endif
+
    //Case where both segment length and receive window are zero
    if(!length && !socket->rcvWnd)
    {
@@ -575,6 +863,21 @@ error_t tcpCheckSequenceNumber(Socket *socket, TcpHeader *segment, size_t length
       return ERROR_FAILURE;
    }
 
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   //Update TS.Recent if SEG.TSval >= TS.Recent and SEG.SEQ <= Last.ACK.sent
+   //(refer to RFC 7323, section 4.3)
+   if(tsPresent)
+   {
+      if(TCP_CMP_SEQ(tsVal, socket->tsRecent) >= 0 &&
+         TCP_CMP_SEQ(segment->seqNum, socket->lastAckSent) <= 0)
+      {
+         //Save the timestamp to be echoed
+         socket->tsRecent = tsVal;
+         socket->tsRecentAge = osGetSystemTime();
+      }
+   }
+#endif
+
    //Sequence number is acceptable
    return NO_ERROR;
 }
@@ -624,6 +927,10 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
    uint_t thresh;
    bool_t duplicateFlag;
    bool_t updateFlag;
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+   uint32_t tsVal;
+   uint32_t tsEcr;
+#endif
 
    //If the ACK bit is off drop the segment and return
    if(!(segment->flags & TCP_FLAG_ACK))
@@ -652,6 +959,12 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
    //The send window should be updated
    tcpUpdateSendWindow(socket, segment);
 
+#if (TCP_SACK_SUPPORT == ENABLED && TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+   //Record the blocks selectively acknowledged by the peer
+   if(socket->sackPermitted)
+      tcpUpdateScoreboard(socket, segment);
+#endif
+
    //The incoming ACK segment acknowledges new data?
    if(TCP_CMP_SEQ(segment->ackNum, socket->sndUna) > 0)
    {
@@ -672,6 +985,17 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
       //Compute retransmission timeout
       updateFlag = tcpComputeRto(socket);
 
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+      //When timestamps are in use, every ACK that acknowledges new data
+      //provides an RTT sample, including during retransmissions
+      if(socket->tsEnabled && tcpGetTimestampOption(segment, &tsVal, &tsEcr))
+      {
+         //A zero TSecr cannot be used for RTT measurement
+         if(tsEcr != 0)
+            tcpUpdateRttEstimator(socket, osGetSystemTime() - tsEcr);
+      }
+#endif
+
       //Any segments on the retransmission queue which are thereby
       //entirely acknowledged are removed
       tcpUpdateRetransmitQueue(socket);
@@ -695,23 +1019,8 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
             tcpFastLossRecovery(socket, segment);
          }
 
-         //Slow start algorithm is used when cwnd is lower than ssthresh
-         if(socket->cwnd < socket->ssthresh)
-         {
-            //During slow start, TCP increments cwnd by at most SMSS bytes
-            //for each ACK received that cumulatively acknowledges new data
-            socket->cwnd += MIN(n, socket->smss);
-         }
-         //Congestion avoidance algorithm is used when cwnd exceeds ssthres
-         else
-         {
-            //Congestion window is updated once per RTT
-            if(updateFlag)
-            {
-               //TCP must not increment cwnd by more than SMSS bytes
-               socket->cwnd += MIN(socket->n, socket->smss);
-            }
-         }
+         //Let the congestion control algorithm open the window
+         socket->congestOps->onAck(socket, n, updateFlag);
       }
 
       //Limit the size of the congestion window
@@ -757,6 +1066,16 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
                thresh = 2;
          }
 
+#if (TCP_SACK_SUPPORT == ENABLED)
+         //With SACK, the first unacknowledged segment may also be deemed
+         //lost from the scoreboard (refer to RFC 6675, section 5)
+         if(socket->sackPermitted && socket->retransmitQueue != NULL &&
+            tcpIsSegmentLost(socket, socket->retransmitQueue))
+         {
+            thresh = 0;
+         }
+#endif
+
          //Check the number of duplicate ACKs that have been received
          if(socket->dupAckCount >= thresh)
          {
@@ -776,8 +1095,9 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
       }
       else if(socket->congestState == TCP_CONGEST_STATE_RECOVERY)
       {
-         //Duplicate ACK received?
-         if(duplicateFlag)
+         //Duplicate ACK received? SACK-based recovery relies on the pipe
+         //estimate instead of inflating the congestion window
+         if(duplicateFlag && !socket->sackPermitted)
          {
             //For each additional duplicate ACK received (after the third),
             //cwnd must be incremented by SMSS. This artificially inflates
@@ -828,7 +1148,7 @@ bool_t tcpIsDuplicateAck(Socket *socket, TcpHeader *segment, size_t length)
             {
                //The advertised window in the incoming acknowledgment equals the
                //advertised window in the last incoming acknowledgment
-               if(segment->window == socket->sndWnd)
+               if(((uint32_t) segment->window << socket->sndWndShift) == socket->sndWnd)
                {
                   //Duplicate ACK
                   flag = TRUE;
@@ -851,12 +1171,8 @@ bool_t tcpIsDuplicateAck(Socket *socket, TcpHeader *segment, size_t length)
 void tcpFastRetransmit(Socket *socket)
 {
 #if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
-   uint_t flightSize;
-
-   //Amount of data that has been sent but not yet acknowledged
-   flightSize = socket->sndNxt - socket->sndUna;
    //After receiving 3 duplicate ACKs, ssthresh must be adjusted
-   socket->ssthresh = MAX(flightSize / 2, 2 * socket->smss);
+   socket->congestOps->onLoss(socket);
 
    //The value of recover is incremented to the value of the highest
    //sequence number transmitted by the TCP so far
@@ -865,14 +1181,49 @@ void tcpFastRetransmit(Socket *socket)
    //Debug message
    TRACE_INFO("TCP fast retransmit...\r\n");
 
-   //TCP performs a retransmission of what appears to be the missing segment,
-   //without waiting for the retransmission timer to expire
-   tcpRetransmitSegment(socket);
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //SACK-based loss recovery (refer to RFC 6675, section 5)
+   if(socket->sackPermitted)
+   {
+      TcpQueueItem *queueItem;
+
+      //Forget about the retransmissions of a previous recovery episode
+      for(queueItem = socket->retransmitQueue; queueItem != NULL;
+         queueItem = queueItem->next)
+      {
+         queueItem->retransmitted = FALSE;
+      }
+
+      //No retransmitted segment is in flight
+      socket->retransBytes = 0;
+      //The search for the next segment starts over from SND.UNA
+      socket->nextSegItem = NULL;
+
+      //The congestion window is not inflated, since the pipe estimate
+      //accounts for the segments that have left the network
+      socket->cwnd = socket->ssthresh;
+
+      //Retransmit the first unacknowledged segment
+      if(socket->retransmitQueue != NULL)
+         tcpRetransmitQueueItem(socket, socket->retransmitQueue);
+
+      //Update HighRxt
+      socket->highRxt = socket->sndUna;
+      if(socket->retransmitQueue != NULL)
+         socket->highRxt += socket->retransmitQueue->length;
+   }
+   else
+#endif
+   {
+      //TCP performs a retransmission of what appears to be the missing segment,
+      //without waiting for the retransmission timer to expire
+      tcpRetransmitSegment(socket);
 
-   //cwnd must set to ssthresh plus 3*SMSS. This artificially inflates the
-   //congestion window by the number of segments (three) that have left
-   //the network and which the receiver has buffered
-   socket->cwnd = socket->ssthresh + TCP_FAST_RETRANSMIT_THRES * socket->smss;
+      //cwnd must set to ssthresh plus 3*SMSS. This artificially inflates the
+      //congestion window by the number of segments (three) that have left
+      //the network and which the receiver has buffered
+      socket->cwnd = socket->ssthresh + TCP_FAST_RETRANSMIT_THRES * socket->smss;
+   }
 
    //Enter the fast recovery procedure
    socket->congestState = TCP_CONGEST_STATE_RECOVERY;
@@ -901,6 +1252,8 @@ void tcpFastRecovery(Socket *socket, TcpHeader *segment, uint_t n)
       socket->cwnd = socket->ssthresh;
       //Exit the fast recovery procedure
       socket->congestState = TCP_CONGEST_STATE_IDLE;
+      //Notify the congestion control algorithm
+      socket->congestOps->cwndEvent(socket, TCP_CONGEST_EVENT_RECOVERY_EXIT);
    }
    else
    {
@@ -908,20 +1261,25 @@ void tcpFastRecovery(Socket *socket, TcpHeader *segment, uint_t n)
       //recover, then this is a partial ACK
       TRACE_INFO("TCP partial acknowledgment\r\n");
 
-      //Retransmit the first unacknowledged segment
-      tcpRetransmitSegment(socket);
-
-      //Deflate the congestion window by the amount of new data acknowledged
-      //by the cumulative acknowledgment field
-      if(socket->cwnd > n)
-         socket->cwnd -= n;
-
-      //If the partial ACK acknowledges at least one SMSS of new data, then
-      //add back SMSS bytes to the congestion window. This artificially
-      //inflates the congestion window in order to reflect the additional
-      //segment that has left the network
-      if(n >= socket->smss)
-         socket->cwnd += socket->smss;
+      //With SACK, the holes are repaired by tcpSackRecoveryTransmit()
+      //according to the scoreboard
+      if(!socket->sackPermitted)
+      {
+         //Retransmit the first unacknowledged segment
+         tcpRetransmitSegment(socket);
+
+         //Deflate the congestion window by the amount of new data acknowledged
+         //by the cumulative acknowledgment field
+         if(socket->cwnd > n)
+            socket->cwnd -= n;
+
+         //If the partial ACK acknowledges at least one SMSS of new data, then
+         //add back SMSS bytes to the congestion window. This artificially
+         //inflates the congestion window in order to reflect the additional
+         //segment that has left the network
+         if(n >= socket->smss)
+            socket->cwnd += socket->smss;
+      }
 
       //Do not exit the fast recovery procedure...
       socket->congestState = TCP_CONGEST_STATE_RECOVERY;
@@ -948,6 +1306,8 @@ void tcpFastLossRecovery(Socket *socket, TcpHeader *segment)
 
       //Exit the fast loss recovery procedure
       socket->congestState = TCP_CONGEST_STATE_IDLE;
+      //Notify the congestion control algorithm
+      socket->congestOps->cwndEvent(socket, TCP_CONGEST_EVENT_RECOVERY_EXIT);
    }
    else
    {
@@ -977,6 +1337,7 @@ void tcpFastLossRecovery(Socket *socket, TcpHeader *segment)
 void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
    const NetBuffer *buffer, size_t offset, size_t length)
 {
+   bool_t quickAck;
    uint32_t leftEdge;
    uint32_t rightEdge;
 
@@ -999,8 +1360,26 @@ void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
       rightEdge = socket->rcvNxt + socket->rcvWnd;
    }
 
-   //Copy the incoming data to the receive buffer
-   tcpWriteRxBuffer(socket, leftEdge, buffer, offset, rightEdge - leftEdge);
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   //In-order data may be left in the buffer of the driver as long as all the
+   //unread data are held by the receive queue. The circular buffer is indexed
+   //by sequence number, so any other data can always be copied there
+   if(TCP_CMP_SEQ(leftEdge, socket->rcvNxt) == 0 &&
+      socket->rxQueueLength == socket->rcvUser &&
+      tcpQueueRxData(socket, buffer, offset, rightEdge - leftEdge) == NO_ERROR)
+   {
+      //The buffer that holds the data has been loaned to the socket
+   }
+   else
+#endif
+   {
+      //Copy the incoming data to the receive buffer
+      tcpWriteRxBuffer(socket, leftEdge, buffer, offset, rightEdge - leftEdge);
+   }
+
+   //A segment that fills in a gap in the sequence space should be
+   //acknowledged immediately (refer to RFC 5681, section 4.2)
+   quickAck = (socket->sackBlockCount > 0);
 
    //Update the list of non-contiguous blocks of data that
    //have been received and queued
@@ -1025,14 +1404,53 @@ void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
       //Update the receive window
       socket->rcvWnd -= length;
 
-      //Acknowledge the received data (delayed ACK not supported)
-      tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+      //Acknowledge the received data
+      tcpDelayAck(socket, length, quickAck);
       //Notify user task that data is available
       tcpUpdateEvents(socket);
    }
 }
 
 
+/**
+ * @brief Acknowledge in-order data, possibly after a delay
+ *
+ * An ACK is sent for at least every second full-sized segment, and no ACK
+ * is delayed for more than TCP_DELAYED_ACK_TIMEOUT (refer to RFC 1122
+ * 4.2.3.2 and RFC 5681 4.2). The pending acknowledgment is cancelled
+ * whenever it can be piggybacked on an outgoing segment
+ *
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] length Number of contiguous bytes that have been received
+ * @param[in] quickAck The data must be acknowledged immediately
+ * @return Error code
+ **/
+
+error_t tcpDelayAck(Socket *socket, size_t length, bool_t quickAck)
+{
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //More data waiting to be acknowledged
+   socket->ackPendingLength += length;
+
+   //Delay the acknowledgment until two full-sized segments have been
+   //received. Small segments do not count as full-sized ones
+   if(socket->delayedAckEnabled && !quickAck &&
+      socket->ackPendingLength < (2U * socket->rmss))
+   {
+      //Start the delayed ACK timer, if not already running
+      if(!tcpTimerRunning(&socket->delayedAckTimer))
+         tcpTimerStart(&socket->delayedAckTimer, TCP_DELAYED_ACK_TIMEOUT);
+
+      //The ACK will be sent later
+      return NO_ERROR;
+   }
+#endif
+
+   //Send an acknowledgment immediately
+   return tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+}
+
+
 /**
  * @brief Delete TCB structure
  * @param[in] socket Handle referencing the socket
@@ -1051,6 +1469,9 @@ void tcpDeleteControlBlock(Socket *socket)
 
    //Release receive buffer
    netBufferSetLength((NetBuffer *) &socket->rxBuffer, 0);
+
+   //Release loaned buffers
+   tcpFlushRxQueue(socket);
 }
 
 
@@ -1062,17 +1483,20 @@ void tcpDeleteControlBlock(Socket *socket)
 void tcpUpdateRetransmitQueue(Socket *socket)
 {
    size_t length;
-   TcpQueueItem *prevQueueItem;
+   bool_t acked;
    TcpQueueItem *queueItem;
    TcpHeader *header;
 
-   //Point to the first item of the retransmission queue
-   prevQueueItem = NULL;
-   queueItem = socket->retransmitQueue;
+   //No segment acknowledged so far
+   acked = FALSE;
 
-   //Loop through retransmission queue
-   while(queueItem != NULL)
+   //The queue is sorted by sequence number, so the acknowledged
+   //segments are always found at the head of the queue
+   while(socket->retransmitQueue != NULL)
    {
+      //Point to the first item of the retransmission queue
+      queueItem = socket->retransmitQueue;
+
       //Point to the TCP header
       header = (TcpHeader *) queueItem->header;
 
@@ -1086,49 +1510,42 @@ void tcpUpdateRetransmitQueue(Socket *socket)
       else
          length = queueItem->length;
 
+      //The remaining segments have not been acknowledged yet
+      if(TCP_CMP_SEQ(socket->sndUna, ntohl(header->seqNum) + length) < 0)
+         break;
+
+#if (TCP_SACK_SUPPORT == ENABLED && TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+      //Keep the scoreboard consistent with the retransmission queue
+      tcpRemoveFromScoreboard(socket, queueItem);
+#endif
+
       //If an acknowledgment is received for a segment before its timer
       //expires, the segment is removed from the retransmission queue
-      if(TCP_CMP_SEQ(socket->sndUna, ntohl(header->seqNum) + length) >= 0)
-      {
-         //First item of the queue?
-         if(prevQueueItem == NULL)
-         {
-            //Remove the current item from the queue
-            socket->retransmitQueue = queueItem->next;
-            //The item can now be safely deleted
-            memPoolFree(queueItem);
-            //Point to the next item
-            queueItem = socket->retransmitQueue;
-         }
-         else
-         {
-            //Remove the current item from the queue
-            prevQueueItem->next = queueItem->next;
-            //The item can now be safely deleted
-            memPoolFree(queueItem);
-            //Point to the next item
-            queueItem = prevQueueItem->next;
-         }
+      socket->retransmitQueue = queueItem->next;
+      //The item can now be safely deleted
+      memPoolFree(queueItem);
 
-         //When an ACK is received that acknowledges new data, restart the
-         //retransmission timer so that it will expire after RTO seconds
-         tcpTimerStart(&socket->retransmitTimer, socket->rto);
-         //Reset retransmission counter
-         socket->retransmitCount = 0;
-      }
-      //No acknowledgment received for the current segment...
-      else
-      {
-         //Point to the next item
-         prevQueueItem = queueItem;
-         queueItem = queueItem->next;
-      }
+      //New data has been acknowledged
+      acked = TRUE;
    }
 
    //When all outstanding data has been acknowledged,
    //turn off the retransmission timer
    if(socket->retransmitQueue == NULL)
+   {
+      //The queue is now empty
+      socket->retransmitQueueTail = NULL;
+      //Stop the retransmission timer
       tcpTimerStop(&socket->retransmitTimer);
+   }
+   else if(acked)
+   {
+      //When an ACK is received that acknowledges new data, restart the
+      //retransmission timer so that it will expire after RTO seconds
+      tcpTimerStart(&socket->retransmitTimer, socket->rto);
+      //Reset retransmission counter
+      socket->retransmitCount = 0;
+   }
 }
 
 
@@ -1155,6 +1572,12 @@ void tcpFlushRetransmitQueue(Socket *socket)
 
    //The retransmission queue is now flushed
    socket->retransmitQueue = NULL;
+   socket->retransmitQueueTail = NULL;
+
+#if (TCP_SACK_SUPPORT == ENABLED && TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+   //The scoreboard is now empty
+   tcpResetScoreboard(socket);
+#endif
 
    //Turn off the retransmission timer
    tcpTimerStop(&socket->retransmitTimer);
@@ -1242,29 +1665,484 @@ void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge
 
 
 /**
- * @brief Update send window
+ * @brief Append a SACK option reporting the out-of-order blocks
  * @param[in] socket Handle referencing the socket
- * @param[in] segment Pointer to the incoming TCP segment
+ * @param[in] segment Pointer to the TCP header
+ **/
+
+void tcpAddSackOption(Socket *socket, TcpHeader *segment)
+{
+   uint_t i;
+   uint_t n;
+   uint32_t edges[2 * TCP_MAX_SACK_BLOCKS];
+
+   //Space left in the TCP header
+   n = TCP_MAX_HEADER_LENGTH - segment->dataOffset * 4;
+   //Each block takes 8 bytes, in addition to the kind, length and padding
+   n = (n >= 4) ? (n - 4) / 8 : 0;
+   //Report as many blocks as possible, the most recent one first
+   n = MIN(n, socket->sackBlockCount);
+
+   //Any block to report?
+   if(n > 0)
+   {
+      //Format the left and right edges of each block
+      for(i = 0; i < n; i++)
+      {
+         edges[2 * i] = htonl(socket->sackBlock[i].leftEdge);
+         edges[2 * i + 1] = htonl(socket->sackBlock[i].rightEdge);
+      }
+
+      //Append SACK option
+      tcpAddOption(segment, TCP_OPTION_SACK, edges, n * 8);
+   }
+}
+
+
+#if (TCP_SACK_SUPPORT == ENABLED && TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+
+/**
+ * @brief Update the SACK scoreboard with the blocks reported by the peer
+ *
+ * The number of SACKed bytes, lost bytes and retransmitted bytes are kept
+ * up to date, so that the pipe can be computed without walking the queue.
+ * Since SACK information only accumulates until the next retransmission
+ * timeout, the loss boundary never moves backward. Each block is searched
+ * from the closest known segment below its left edge (highest SACKed
+ * segment or loss boundary), so that a block extending the highest SACKed
+ * range only visits the newly covered segments
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] segment Pointer to the incoming TCP segment
+ **/
+
+void tcpUpdateScoreboard(Socket *socket, TcpHeader *segment)
+{
+   uint_t i;
+   uint_t n;
+   uint_t length;
+   uint32_t seqNum;
+   uint32_t leftEdge;
+   uint32_t rightEdge;
+   TcpOption *option;
+   TcpQueueItem *queueItem;
+   TcpQueueItem *startItem;
+
+   //Search the TCP header for the SACK option
+   option = tcpGetOption(segment, TCP_OPTION_SACK);
+
+   //Malformed or missing option?
+   if(option == NULL || option->length < 10 || ((option->length - 2) % 8) != 0)
+      return;
+
+   //Loop through the blocks
+   for(i = 0; i < (option->length - 2U) / 8; i++)
+   {
+      //Retrieve the edges of the current block
+      memcpy(&leftEdge, option->value + 8 * i, 4);
+      memcpy(&rightEdge, option->value + 8 * i + 4, 4);
+
+      //Convert from network byte order to host byte order
+      leftEdge = ntohl(leftEdge);
+      rightEdge = ntohl(rightEdge);
+
+      //By default, the search starts at the head of the queue
+      startItem = socket->retransmitQueue;
+
+      //Resume from the highest SACKed segment when the block lies above it
+      if(socket->highSackedItem != NULL && TCP_CMP_SEQ(leftEdge,
+         ntohl(((TcpHeader *) socket->highSackedItem->header)->seqNum)) >= 0)
+      {
+         startItem = socket->highSackedItem;
+      }
+      //Otherwise resume from the loss boundary when the block lies above it
+      else if(socket->lostItem != NULL && TCP_CMP_SEQ(leftEdge,
+         ntohl(((TcpHeader *) socket->lostItem->header)->seqNum)) >= 0)
+      {
+         startItem = socket->lostItem;
+      }
+
+      //Mark the segments entirely covered by the block
+      for(queueItem = startItem; queueItem != NULL;
+         queueItem = queueItem->next)
+      {
+         //Sequence number of the first byte of the segment
+         seqNum = ntohl(((TcpHeader *) queueItem->header)->seqNum);
+
+         //The queue is sorted by sequence number
+         if(TCP_CMP_SEQ(seqNum, rightEdge) >= 0)
+            break;
+
+         //Check whether the segment has been selectively acknowledged
+         if(!queueItem->sacked && queueItem->length > 0 &&
+            TCP_CMP_SEQ(seqNum, leftEdge) >= 0 &&
+            TCP_CMP_SEQ(seqNum + queueItem->length, rightEdge) <= 0)
+         {
+            //Keep track of the highest SACKed sequence number
+            if(socket->sackedCount == 0 ||
+               TCP_CMP_SEQ(seqNum + queueItem->length, socket->highSacked) > 0)
+            {
+               socket->highSacked = seqNum + queueItem->length;
+               socket->highSackedItem = queueItem;
+            }
+
+            //Mark the segment as SACKed
+            queueItem->sacked = TRUE;
+            socket->sackedCount++;
+            socket->sackedBytes += queueItem->length;
+
+            //A retransmitted segment has now left the network
+            if(queueItem->retransmitted)
+               socket->retransBytes -= queueItem->length;
+
+            //A segment below the loss boundary is no longer deemed lost
+            if(tcpIsSegmentLost(socket, queueItem))
+            {
+               socket->lostBytes -= queueItem->length;
+               socket->lostSackedCount++;
+               socket->lostSackedBytes += queueItem->length;
+            }
+         }
+      }
+   }
+
+   //Point to the first segment above the loss boundary
+   if(socket->lostItem != NULL)
+      queueItem = socket->lostItem->next;
+   else
+      queueItem = socket->retransmitQueue;
+
+   //Move the loss boundary forward
+   while(queueItem != NULL)
+   {
+      //Number of segments and bytes SACKed up to the current segment
+      n = socket->lostSackedCount + (queueItem->sacked ? 1 : 0);
+      length = socket->lostSackedBytes + (queueItem->sacked ? queueItem->length : 0);
+
+      //The segment is lost if either DupThresh discontiguous segments or
+      //more than (DupThresh - 1) * SMSS bytes have been SACKed above it
+      if((socket->sackedCount - n) < TCP_FAST_RETRANSMIT_THRES &&
+         (socket->sackedBytes - length) <= (TCP_FAST_RETRANSMIT_THRES - 1) * socket->smss)
+      {
+         break;
+      }
+
+      //The current segment now lies below the loss boundary
+      socket->lostItem = queueItem;
+      socket->lostSackedCount = n;
+      socket->lostSackedBytes = length;
+
+      //Bytes that have not been SACKed are deemed lost
+      if(!queueItem->sacked)
+         socket->lostBytes += queueItem->length;
+
+      //Point to the next segment
+      queueItem = queueItem->next;
+   }
+}
+
+
+/**
+ * @brief Remove an acknowledged segment from the scoreboard
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem First segment of the retransmission queue
+ **/
+
+void tcpRemoveFromScoreboard(Socket *socket, TcpQueueItem *queueItem)
+{
+   //Selectively acknowledged segment?
+   if(queueItem->sacked)
+   {
+      socket->sackedCount--;
+      socket->sackedBytes -= queueItem->length;
+   }
+   else if(queueItem->retransmitted)
+   {
+      //The retransmitted segment has left the network
+      socket->retransBytes -= queueItem->length;
+   }
+
+   //The first segment of the queue lies below the loss boundary, if any
+   if(socket->lostItem != NULL)
+   {
+      //Update the number of segments and bytes up to the loss boundary
+      if(queueItem->sacked)
+      {
+         socket->lostSackedCount--;
+         socket->lostSackedBytes -= queueItem->length;
+      }
+      else
+      {
+         socket->lostBytes -= queueItem->length;
+      }
+
+      //The loss boundary itself is being removed?
+      if(queueItem == socket->lostItem)
+      {
+         socket->lostItem = NULL;
+         socket->lostSackedCount = 0;
+         socket->lostSackedBytes = 0;
+         socket->lostBytes = 0;
+      }
+   }
+
+   //The cursors must not point to a deleted segment
+   if(queueItem == socket->nextSegItem)
+      socket->nextSegItem = NULL;
+   if(queueItem == socket->highSackedItem)
+      socket->highSackedItem = NULL;
+}
+
+
+/**
+ * @brief Discard the SACK information held in the scoreboard
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpResetScoreboard(Socket *socket)
+{
+   TcpQueueItem *queueItem;
+
+   //After a retransmission timeout, the receiver may have reneged on
+   //previously SACKed data (refer to RFC 2018, section 8)
+   for(queueItem = socket->retransmitQueue; queueItem != NULL;
+      queueItem = queueItem->next)
+   {
+      queueItem->sacked = FALSE;
+      queueItem->retransmitted = FALSE;
+   }
+
+   //Clear the scoreboard
+   socket->highSacked = socket->sndUna;
+   socket->sackedCount = 0;
+   socket->sackedBytes = 0;
+   socket->lostBytes = 0;
+   socket->retransBytes = 0;
+   socket->lostItem = NULL;
+   socket->lostSackedCount = 0;
+   socket->lostSackedBytes = 0;
+   socket->nextSegItem = NULL;
+   socket->highSackedItem = NULL;
+}
+
+
+/**
+ * @brief Determine whether a segment is deemed lost (IsLost)
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem Segment of the retransmission queue
+ * @return TRUE if the segment is lost, else FALSE
+ **/
+
+bool_t tcpIsSegmentLost(Socket *socket, TcpQueueItem *queueItem)
+{
+   uint32_t seqNum;
+
+   //No segment is deemed lost?
+   if(socket->lostItem == NULL)
+      return FALSE;
+
+   //Sequence number of the first byte of the segment
+   seqNum = ntohl(((TcpHeader *) queueItem->header)->seqNum);
+
+   //All the segments up to the loss boundary are deemed lost
+   return (TCP_CMP_SEQ(seqNum,
+      ntohl(((TcpHeader *) socket->lostItem->header)->seqNum)) <= 0);
+}
+
+
+/**
+ * @brief Estimate the number of bytes outstanding in the network (SetPipe)
+ * @param[in] socket Handle referencing the socket
+ * @return Value of the pipe
+ **/
+
+uint_t tcpGetPipe(Socket *socket)
+{
+   uint_t pipe;
+
+   //Amount of data sent but not yet acknowledged
+   pipe = socket->sndNxt - socket->sndUna;
+
+   //Bytes that have been neither SACKed nor deemed lost are in flight
+   pipe -= MIN(pipe, socket->sackedBytes + socket->lostBytes);
+   //Retransmitted bytes are also in flight (refer to RFC 6675, section 4)
+   pipe += socket->retransBytes;
+
+   //Return the estimated number of bytes in flight
+   return pipe;
+}
+
+
+/**
+ * @brief Select the next segment to be retransmitted (NextSeg)
+ *
+ * Segments that are SACKed, already retransmitted or below HighRxt are never
+ * eligible again during the same recovery episode, so the search resumes
+ * from where the previous one ended
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] lostOnly Only consider segments that are deemed lost (rule 1).
+ *   Otherwise any unSACKed segment below the highest SACKed one (rule 3)
+ * @return Segment to be retransmitted, or NULL if there is none
+ **/
+
+TcpQueueItem *tcpGetNextSeg(Socket *socket, bool_t lostOnly)
+{
+   uint32_t seqNum;
+   TcpQueueItem *queueItem;
+
+   //Resume the search from the scoreboard cursor
+   queueItem = socket->nextSegItem;
+
+   //Start from the beginning of the retransmission queue if necessary
+   if(queueItem == NULL)
+      queueItem = socket->retransmitQueue;
+
+   //Skip the segments that are not eligible
+   while(queueItem != NULL)
+   {
+      //Save the position of the cursor
+      socket->nextSegItem = queueItem;
+
+      //Sequence number of the first byte of the segment
+      seqNum = ntohl(((TcpHeader *) queueItem->header)->seqNum);
+
+      //The segment must be unSACKed, not yet retransmitted and above HighRxt
+      if(!queueItem->sacked && !queueItem->retransmitted &&
+         queueItem->length > 0 && TCP_CMP_SEQ(seqNum, socket->highRxt) >= 0)
+      {
+         break;
+      }
+
+      //Point to the next segment
+      queueItem = queueItem->next;
+   }
+
+   //No eligible segment?
+   if(queueItem == NULL)
+      return NULL;
+
+   //The segment must lie below the highest SACKed sequence number
+   if(TCP_CMP_SEQ(seqNum + queueItem->length, socket->highSacked) > 0)
+      return NULL;
+
+   //Rule 1 only selects segments that are deemed lost. Since lost segments
+   //are all located below the loss boundary, no segment above the first
+   //eligible one can be selected either
+   if(lostOnly && !tcpIsSegmentLost(socket, queueItem))
+      return NULL;
+
+   //Return the selected segment
+   return queueItem;
+}
+
+
+/**
+ * @brief Transmit segments during SACK-based loss recovery
+ * @param[in] socket Handle referencing the socket
+ * @return Error code
+ **/
+
+error_t tcpSackRecoveryTransmit(Socket *socket)
+{
+   error_t error;
+   uint_t n;
+   TcpQueueItem *queueItem;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Segments can be sent as long as cwnd - pipe >= SMSS (refer to
+   //RFC 6675, section 5, step C). The pipe is kept up to date by the
+   //scoreboard as segments are sent, SACKed and acknowledged
+   while((tcpGetPipe(socket) + socket->smss) <= socket->cwnd)
+   {
+      //Rule 1: retransmit the first segment that is deemed lost
+      queueItem = tcpGetNextSeg(socket, TRUE);
+
+      //Rule 2: otherwise send new data if the receive window permits
+      if(queueItem == NULL && socket->sndUser > 0 &&
+         socket->sndWnd > (socket->sndNxt - socket->sndUna))
+      {
+         //Calculate the number of bytes to send at a time
+         n = socket->sndWnd - (socket->sndNxt - socket->sndUna);
+         n = MIN(n, socket->sndUser);
+         n = MIN(n, socket->smss);
+
+         //Send TCP segment
+         error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
+            socket->sndNxt, socket->rcvNxt, n, TRUE);
+         //Failed to send TCP segment?
+         if(error)
+            break;
+
+         //Advance SND.NXT pointer
+         socket->sndNxt += n;
+         //Update the number of data buffered but not yet sent
+         socket->sndUser -= n;
+      }
+      else
+      {
+         //Rule 3: retransmit an unSACKed segment below the highest SACKed one
+         if(queueItem == NULL)
+            queueItem = tcpGetNextSeg(socket, FALSE);
+
+         //Nothing left to send?
+         if(queueItem == NULL)
+            break;
+
+         //Retransmit the selected segment
+         error = tcpRetransmitQueueItem(socket, queueItem);
+         //Failed to retransmit the segment?
+         if(error)
+            break;
+
+         //Update HighRxt
+         socket->highRxt = ntohl(((TcpHeader *) queueItem->header)->seqNum) +
+            queueItem->length;
+      }
+   }
+
+   //Check whether the transmitter can accept more data
+   tcpUpdateEvents(socket);
+
+   //Return status code
+   return error;
+}
+
+#endif
+
+
+/**
+ * @brief Update send window
+ * @param[in] socket Handle referencing the socket
+ * @param[in] segment Pointer to the incoming TCP segment
  **/
 
 void tcpUpdateSendWindow(Socket *socket, TcpHeader *segment)
 {
+   uint32_t window;
+
+   //The window field of a non-SYN segment is scaled by the shift count
+   //negotiated with the peer (refer to RFC 7323, section 2.3)
+   window = (uint32_t) segment->window << socket->sndWndShift;
+
    //Case where neither the sequence nor the acknowledgment number is increased
    if(segment->seqNum == socket->sndWl1 && segment->ackNum == socket->sndWl2)
    {
       //TCP may ignore a window update with a smaller window than
       //previously offered if neither the sequence number nor the
       //acknowledgment number is increased (see RFC 1122 4.2.2.16)
-      if(segment->window > socket->sndWnd)
+      if(window > socket->sndWnd)
       {
          //Update the send window and record the sequence number and
          //the acknowledgment number used to update SND.WND
-         socket->sndWnd = segment->window;
+         socket->sndWnd = window;
          socket->sndWl1 = segment->seqNum;
          socket->sndWl2 = segment->ackNum;
 
          //Maximum send window it has seen so far on the connection
-         socket->maxSndWnd = MAX(socket->maxSndWnd, segment->window);
+         socket->maxSndWnd = MAX(socket->maxSndWnd, window);
       }
    }
    //Case where the sequence or the acknowledgment number is increased
@@ -1272,7 +2150,7 @@ void tcpUpdateSendWindow(Socket *socket, TcpHeader *segment)
       TCP_CMP_SEQ(segment->ackNum, socket->sndWl2) >= 0)
    {
       //The remote host advertises a zero window?
-      if(!segment->window && socket->sndWnd)
+      if(!window && socket->sndWnd)
       {
          //Start the persist timer
          socket->wndProbeCount = 0;
@@ -1282,12 +2160,12 @@ void tcpUpdateSendWindow(Socket *socket, TcpHeader *segment)
 
       //Update the send window and record the sequence number and
       //the acknowledgment number used to update SND.WND
-      socket->sndWnd = segment->window;
+      socket->sndWnd = window;
       socket->sndWl1 = segment->seqNum;
       socket->sndWl2 = segment->ackNum;
 
       //Maximum send window it has seen so far on the connection
-      socket->maxSndWnd = MAX(socket->maxSndWnd, segment->window);
+      socket->maxSndWnd = MAX(socket->maxSndWnd, window);
    }
 }
 
@@ -1299,7 +2177,7 @@ void tcpUpdateSendWindow(Socket *socket, TcpHeader *segment)
 
 void tcpUpdateReceiveWindow(Socket *socket)
 {
-   uint16_t reduction;
+   uint32_t reduction;
 
    //Space available but not yet advertised
    reduction = socket->rxBufferSize - socket->rcvUser - socket->rcvWnd;
@@ -1338,7 +2216,6 @@ bool_t tcpComputeRto(Socket *socket)
 {
    bool_t flag;
    systime_t r;
-   systime_t delta;
 
    //Clear flag
    flag = FALSE;
@@ -1349,40 +2226,17 @@ bool_t tcpComputeRto(Socket *socket)
       //Ensure the incoming ACK number covers the expected sequence number
       if(TCP_CMP_SEQ(socket->sndUna, socket->rttSeqNum) > 0)
       {
-         //Calculate round-time trip
-         r = osGetSystemTime() - socket->rttStartTime;
-
-         //First RTT measurement?
-         if(!socket->srtt && !socket->rttvar)
-         {
-            //Initialize RTO calculation algorithm
-            socket->srtt = r;
-            socket->rttvar = r / 2;
-         }
-         else
+#if (TCP_TIMESTAMPS_SUPPORT == ENABLED)
+         //RTT samples are taken from the echoed timestamps instead
+         if(!socket->tsEnabled)
+#endif
          {
-            //Calculate the difference between the measured value and the
-            //current RTT estimator
-            delta = (r > socket->srtt) ? (r - socket->srtt) : (socket->srtt - r);
-
-            //Implement Van Jacobson's algorithm (as specified in RFC 6298 2.3)
-            socket->rttvar = (3 * socket->rttvar + delta) / 4;
-            socket->srtt = (7 * socket->srtt + r) / 8;
+            //Calculate round-time trip
+            r = osGetSystemTime() - socket->rttStartTime;
+            //Update RTT estimator
+            tcpUpdateRttEstimator(socket, r);
          }
 
-         //Calculate the next retransmission timeout
-         socket->rto = socket->srtt + 4 * socket->rttvar;
-
-         //Whenever RTO is computed, if it is less than 1 second, then
-         //the RTO should be rounded up to 1 second
-         socket->rto = MAX(socket->rto, TCP_MIN_RTO);
-         //A maximum value may be placed on RTO provided it is at least 60 seconds
-         socket->rto = MIN(socket->rto, TCP_MAX_RTO);
-
-         //Debug message
-         TRACE_DEBUG("R=%" PRIu32 ", SRTT=%" PRIu32 ", RTTVAR=%" PRIu32 ", RTO=%" PRIu32 "\r\n",
-            r, socket->srtt, socket->rttvar, socket->rto);
-
          //RTT measurement is complete
          socket->rttBusy = FALSE;
          //Set flag
@@ -1395,6 +2249,49 @@ bool_t tcpComputeRto(Socket *socket)
 }
 
 
+/**
+ * @brief Update the RTT estimator with a new sample
+ * @param[in] socket Handle referencing the socket
+ * @param[in] r Round-trip time measurement
+ **/
+
+void tcpUpdateRttEstimator(Socket *socket, systime_t r)
+{
+   systime_t delta;
+
+   //First RTT measurement?
+   if(!socket->srtt && !socket->rttvar)
+   {
+      //Initialize RTO calculation algorithm
+      socket->srtt = r;
+      socket->rttvar = r / 2;
+   }
+   else
+   {
+      //Calculate the difference between the measured value and the
+      //current RTT estimator
+      delta = (r > socket->srtt) ? (r - socket->srtt) : (socket->srtt - r);
+
+      //Implement Van Jacobson's algorithm (as specified in RFC 6298 2.3)
+      socket->rttvar = (3 * socket->rttvar + delta) / 4;
+      socket->srtt = (7 * socket->srtt + r) / 8;
+   }
+
+   //Calculate the next retransmission timeout
+   socket->rto = socket->srtt + 4 * socket->rttvar;
+
+   //Whenever RTO is computed, if it is less than 1 second, then
+   //the RTO should be rounded up to 1 second
+   socket->rto = MAX(socket->rto, TCP_MIN_RTO);
+   //A maximum value may be placed on RTO provided it is at least 60 seconds
+   socket->rto = MIN(socket->rto, TCP_MAX_RTO);
+
+   //Debug message
+   TRACE_DEBUG("R=%" PRIu32 ", SRTT=%" PRIu32 ", RTTVAR=%" PRIu32 ", RTO=%" PRIu32 "\r\n",
+      r, socket->srtt, socket->rttvar, socket->rto);
+}
+
+
 /**
  * @brief TCP segment retransmission
  * @param[in] socket Handle referencing the socket
@@ -1404,11 +2301,8 @@ bool_t tcpComputeRto(Socket *socket)
 error_t tcpRetransmitSegment(Socket *socket)
 {
    error_t error;
-   size_t offset;
    size_t length;
-   NetBuffer *buffer;
    TcpQueueItem *queueItem;
-   TcpHeader *header;
 
    //Initialize error code
    error = NO_ERROR;
@@ -1421,74 +2315,118 @@ error_t tcpRetransmitSegment(Socket *socket)
    //Any segment in the retransmission queue?
    while(queueItem != NULL)
    {
-      //Total number of bytes that have been retransmitted
-      length += queueItem->length;
-
-      //The amount of data that can be sent cannot exceed the MSS
-      if(length > socket->smss)
-      {
-         //We are done
-         error = NO_ERROR;
-         //Exit immediately
-         break;
-      }
-
-      //Point to the TCP header
-      header = (TcpHeader *) queueItem->header;
-
-      //Allocate a memory buffer to hold the TCP segment
-      buffer = ipAllocBuffer(0, &offset);
-      //Failed to allocate memory?
-      if(buffer == NULL)
+      //Segments that have been selectively acknowledged need not be resent
+      if(!queueItem->sacked)
       {
-         //Report an error
-         error = ERROR_OUT_OF_MEMORY;
-         //Exit immediately
-         break;
-      }
+         //Total number of bytes that have been retransmitted
+         length += queueItem->length;
 
-      //Start of exception handling block
-      do
-      {
-         //Copy TCP header
-         error = netBufferAppend(buffer, header, header->dataOffset * 4);
-         //Any error to report?
-         if(error)
+         //The amount of data that can be sent cannot exceed the MSS
+         if(length > socket->smss)
+         {
+            //We are done
+            error = NO_ERROR;
+            //Exit immediately
             break;
+         }
 
-         //Copy data from send buffer
-         error = tcpReadTxBuffer(socket, ntohl(header->seqNum), buffer, queueItem->length);
+         //Retransmit the current segment
+         error = tcpRetransmitQueueItem(socket, queueItem);
          //Any error to report?
          if(error)
+         {
+            //Exit immediately
             break;
+         }
+      }
 
-         //Total number of segments retransmitted
-         MIB2_INC_COUNTER32(tcpGroup.tcpRetransSegs, 1);
-         TCP_MIB_INC_COUNTER32(tcpRetransSegs, 1);
+      //Point to the next segment in the queue
+      queueItem = queueItem->next;
+   }
 
-         //Dump TCP header contents for debugging purpose
-         tcpDumpHeader(header, queueItem->length, socket->iss, socket->irs);
+   //Return status code
+   return error;
+}
 
-         //Retransmit the lost segment without waiting for the
-         //retransmission timer to expire
-         error = ipSendDatagram(socket->interface,
-            &queueItem->pseudoHeader, buffer, offset, 0);
 
-         //End of exception handling block
-      } while(0);
+/**
+ * @brief Retransmit a given segment of the retransmission queue
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem Segment to be retransmitted
+ * @return Error code
+ **/
 
-      //Free previously allocated memory
-      netBufferFree(buffer);
+error_t tcpRetransmitQueueItem(Socket *socket, TcpQueueItem *queueItem)
+{
+   error_t error;
+   size_t offset;
+   NetBuffer *buffer;
+   TcpHeader *header;
 
+   //Point to the TCP header
+   header = (TcpHeader *) queueItem->header;
+
+   //Allocate a memory buffer to hold the TCP segment
+   buffer = ipAllocBuffer(0, &offset);
+   //Failed to allocate memory?
+   if(buffer == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Start of exception handling block
+   do
+   {
+      //Copy TCP header
+      error = netBufferAppend(buffer, header, header->dataOffset * 4);
       //Any error to report?
       if(error)
-      {
-         //Exit immediately
          break;
-      }
 
-      //Point to the next segment in the queue
-      queueItem = queueItem->next;
+      //Copy data from send buffer
+      error = tcpReadTxBuffer(socket, ntohl(header->seqNum), buffer, queueItem->length);
+      //Any error to report?
+      if(error)
+         break;
+
+      //The retransmitted segment must carry the current ACK number and a
+      //fresh timestamp so that the echoed value identifies this transmission
+      tcpRefreshSegment(socket, buffer, offset, &queueItem->pseudoHeader);
+
+      //Total number of segments retransmitted
+#if (TCP_COUNTER_BLOCK_SUPPORT == ENABLED)
+      TCP_INC_COUNTER(retransSegs, 1);
+#else
+      MIB2_INC_COUNTER32(tcpGroup.tcpRetransSegs, 1);
+      TCP_MIB_INC_COUNTER32(tcpRetransSegs, 1);
+#endif
+
+      //Dump TCP header contents for debugging purpose
+      tcpDumpHeader(header, queueItem->length, socket->iss, socket->irs);
+
+      //Retransmit the lost segment without waiting for the
+      //retransmission timer to expire
+#if (IPV4_SUPPORT == ENABLED && IPV4_DEST_CACHE_SUPPORT == ENABLED)
+      error = ipSendDatagram(socket->interface, &queueItem->pseudoHeader,
+         buffer, offset, 0, &socket->destCacheEntry);
+#else
+      error = ipSendDatagram(socket->interface, &queueItem->pseudoHeader,
+         buffer, offset, 0, NULL);
+#endif
+
+      //End of exception handling block
+   } while(0);
+
+   //Free previously allocated memory
+   netBufferFree(buffer);
+
+   //The segment has been retransmitted
+   if(!error)
+   {
+#if (TCP_SACK_SUPPORT == ENABLED && TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+      //The retransmitted segment is in flight again
+      if(!queueItem->retransmitted && !queueItem->sacked)
+         socket->retransBytes += queueItem->length;
+#endif
+      queueItem->retransmitted = TRUE;
    }
 
    //Return status code
@@ -1509,6 +2447,13 @@ error_t tcpNagleAlgo(Socket *socket, uint_t flags)
    uint_t n;
    uint_t u;
 
+#if (TCP_SACK_SUPPORT == ENABLED && TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+   //During SACK-based loss recovery, the transmission of both new data and
+   //retransmissions is governed by the pipe estimate
+   if(socket->sackPermitted && socket->congestState == TCP_CONGEST_STATE_RECOVERY)
+      return tcpSackRecoveryTransmit(socket);
+#endif
+
    //The amount of data that can be sent at any given time is
    //limited by the receiver window and the congestion window
    n = MIN(socket->sndWnd, socket->txBufferSize);
@@ -1965,6 +2910,223 @@ void tcpReadRxBuffer(Socket *socket, uint32_t seqNum, uint8_t *data, size_t leng
 }
 
 
+/**
+ * @brief Get a pointer to contiguous data in the receive buffer
+ * @param[in] socket Handle referencing the socket
+ * @param[in] seqNum Sequence number of the first data to read
+ * @param[in] length Maximum number of data to read
+ * @param[out] data Pointer to the first data byte
+ * @return Number of contiguous bytes available at the specified location
+ **/
+
+size_t tcpGetRxBufferData(Socket *socket, uint32_t seqNum,
+   size_t length, uint8_t **data)
+{
+   uint_t i;
+   size_t offset;
+
+   //Offset of the first byte to read in the circular buffer
+   offset = (seqNum - socket->irs - 1) % socket->rxBufferSize;
+   //Data cannot cross the boundaries of the circular buffer
+   length = MIN(length, socket->rxBufferSize - offset);
+
+   //Loop through chunks
+   for(i = 0; i < socket->rxBuffer.chunkCount; i++)
+   {
+      //The data starts in the current chunk?
+      if(offset < socket->rxBuffer.chunk[i].length)
+      {
+         //Point to the first data byte
+         *data = (uint8_t *) socket->rxBuffer.chunk[i].address + offset;
+         //Data cannot cross chunk boundaries
+         return MIN(length, socket->rxBuffer.chunk[i].length - offset);
+      }
+
+      //Jump to the next chunk
+      offset -= socket->rxBuffer.chunk[i].length;
+   }
+
+   //Invalid offset
+   *data = NULL;
+   return 0;
+}
+
+
+/**
+ * @brief Append in-order data to the receive queue
+ *
+ * The buffer that holds the incoming data is kept by the socket whenever
+ * the network driver allows it. Otherwise, the caller copies the data to
+ * the circular receive buffer
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] buffer Multi-part buffer containing the incoming data
+ * @param[in] offset Offset to the first data byte
+ * @param[in] length Number of data to queue
+ * @return Error code
+ **/
+
+error_t tcpQueueRxData(Socket *socket, const NetBuffer *buffer,
+   size_t offset, size_t length)
+{
+   uint8_t *p;
+   void *block;
+   TcpRxQueueItem *newItem;
+
+   //Nothing to queue?
+   if(length == 0)
+      return NO_ERROR;
+
+   //Limit the number of buffers held by the socket
+   if(socket->rxQueueCount >= TCP_MAX_RX_QUEUE_SIZE)
+      return ERROR_RECEIVE_QUEUE_FULL;
+
+   //Point to the first data byte
+   p = netBufferAt(buffer, offset);
+   //Invalid offset?
+   if(p == NULL)
+      return ERROR_FAILURE;
+
+   //Try to keep the buffer that holds the incoming data
+   newItem = nicLoanRxBuffer(p, length, sizeof(TcpRxQueueItem), &block);
+   //The buffer cannot be loaned?
+   if(newItem == NULL)
+      return ERROR_FAILURE;
+
+   //The data is left in place
+   newItem->buffer = block;
+   newItem->data = p;
+   newItem->length = length;
+   //This item is the last one of the queue
+   newItem->next = NULL;
+
+   //Append the new item to the receive queue
+   if(socket->rxQueueTail != NULL)
+      socket->rxQueueTail->next = newItem;
+   else
+      socket->rxQueue = newItem;
+
+   //Update the tail of the receive queue
+   socket->rxQueueTail = newItem;
+   socket->rxQueueCount++;
+   socket->rxQueueLength += length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Copy data from the receive queue
+ * @param[in] socket Handle referencing the socket
+ * @param[out] data Pointer to the output buffer
+ * @param[in] length Maximum number of data to read
+ * @return Number of data that have been copied
+ **/
+
+size_t tcpReadRxQueue(Socket *socket, uint8_t *data, size_t length)
+{
+   size_t n;
+   size_t total;
+   TcpRxQueueItem *queueItem;
+
+   //Number of data copied so far
+   total = 0;
+   //Point to the first item of the receive queue
+   queueItem = socket->rxQueue;
+
+   //Copy as much data as possible
+   while(queueItem != NULL && total < length)
+   {
+      //Number of bytes to copy from the current item
+      n = MIN(queueItem->length, length - total);
+      //Copy data
+      memcpy(data + total, queueItem->data, n);
+
+      //Total number of bytes copied
+      total += n;
+      //Point to the next item
+      queueItem = queueItem->next;
+   }
+
+   //Return the number of bytes copied
+   return total;
+}
+
+
+/**
+ * @brief Remove data from the head of the receive queue
+ * @param[in] socket Handle referencing the socket
+ * @param[in] length Number of data that have been consumed
+ **/
+
+void tcpConsumeRxQueue(Socket *socket, size_t length)
+{
+   size_t n;
+   TcpRxQueueItem *queueItem;
+
+   //Loop through the receive queue
+   while(socket->rxQueue != NULL && length > 0)
+   {
+      //Point to the first item
+      queueItem = socket->rxQueue;
+
+      //Number of bytes consumed from the current item
+      n = MIN(queueItem->length, length);
+
+      //Advance data pointer
+      queueItem->data += n;
+      queueItem->length -= n;
+      socket->rxQueueLength -= n;
+      length -= n;
+
+      //All the data of the current item have been consumed?
+      if(queueItem->length == 0)
+      {
+         //Remove the item from the receive queue
+         socket->rxQueue = queueItem->next;
+         socket->rxQueueCount--;
+
+         //The receive queue is now empty?
+         if(socket->rxQueue == NULL)
+            socket->rxQueueTail = NULL;
+
+         //Release the corresponding buffer
+         memPoolFree(queueItem->buffer);
+      }
+   }
+}
+
+
+/**
+ * @brief Flush receive queue
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpFlushRxQueue(Socket *socket)
+{
+   //Point to the first item in the receive queue
+   TcpRxQueueItem *queueItem = socket->rxQueue;
+
+   //Loop through the receive queue
+   while(queueItem != NULL)
+   {
+      //Keep track of the next item in the queue
+      TcpRxQueueItem *nextQueueItem = queueItem->next;
+      //Free previously allocated memory
+      memPoolFree(queueItem->buffer);
+      //Point to the next item
+      queueItem = nextQueueItem;
+   }
+
+   //The receive queue is now flushed
+   socket->rxQueue = NULL;
+   socket->rxQueueTail = NULL;
+   socket->rxQueueCount = 0;
+   socket->rxQueueLength = 0;
+}
+
+
 /**
  * @brief Dump TCP header for debugging purpose
  * @param[in] segment Pointer to the TCP header
@@ -31,6 +31,15 @@
 
 //Dependencies
 #include "core/tcp.h"
+#include "mibs/mib2_module.h"
+#include "mibs/tcp_mib_module.h"
+
+//Fast-path statistics are accumulated in the TCP counter block
+#if (TCP_COUNTER_BLOCK_SUPPORT == ENABLED && (MIB2_SUPPORT == ENABLED || TCP_MIB_SUPPORT == ENABLED))
+   #define TCP_INC_COUNTER(name, value) tcpCounters.name += value
+#else
+   #define TCP_INC_COUNTER(name, value)
+#endif
 
 //C++ guard
 #ifdef __cplusplus
@@ -44,6 +53,14 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
 error_t tcpSendResetSegment(NetInterface *interface,
    IpPseudoHeader *pseudoHeader, TcpHeader *segment, size_t length);
 
+uint16_t tcpGetAdvertisedWindow(Socket *socket, uint8_t flags);
+uint8_t tcpGetWindowShift(size_t size);
+bool_t tcpGetWindowScaleOption(TcpHeader *segment, uint8_t *shift);
+bool_t tcpGetTimestampOption(TcpHeader *segment, uint32_t *tsVal, uint32_t *tsEcr);
+
+void tcpRefreshSegment(Socket *socket, NetBuffer *buffer,
+   size_t offset, const IpPseudoHeader *pseudoHeader);
+
 error_t tcpAddOption(TcpHeader *segment, uint8_t kind, const void *value, uint8_t length);
 TcpOption *tcpGetOption(TcpHeader *segment, uint8_t kind);
 
@@ -60,6 +77,8 @@ void tcpFastLossRecovery(Socket *socket, TcpHeader *segment);
 void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
    const NetBuffer *buffer, size_t offset, size_t length);
 
+error_t tcpDelayAck(Socket *socket, size_t length, bool_t quickAck);
+
 void tcpDeleteControlBlock(Socket *socket);
 
 void tcpUpdateRetransmitQueue(Socket *socket);
@@ -68,11 +87,22 @@ void tcpFlushRetransmitQueue(Socket *socket);
 void tcpFlushSynQueue(Socket *socket);
 
 void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge);
+void tcpAddSackOption(Socket *socket, TcpHeader *segment);
+
+void tcpUpdateScoreboard(Socket *socket, TcpHeader *segment);
+void tcpRemoveFromScoreboard(Socket *socket, TcpQueueItem *queueItem);
+void tcpResetScoreboard(Socket *socket);
+bool_t tcpIsSegmentLost(Socket *socket, TcpQueueItem *queueItem);
+uint_t tcpGetPipe(Socket *socket);
+TcpQueueItem *tcpGetNextSeg(Socket *socket, bool_t lostOnly);
+error_t tcpSackRecoveryTransmit(Socket *socket);
 void tcpUpdateSendWindow(Socket *socket, TcpHeader *segment);
 void tcpUpdateReceiveWindow(Socket *socket);
 
 bool_t tcpComputeRto(Socket *socket);
+void tcpUpdateRttEstimator(Socket *socket, systime_t r);
 error_t tcpRetransmitSegment(Socket *socket);
+error_t tcpRetransmitQueueItem(Socket *socket, TcpQueueItem *queueItem);
 error_t tcpNagleAlgo(Socket *socket, uint_t flags);
 
 void tcpChangeState(Socket *socket, TcpState newState);
@@ -91,6 +121,16 @@ void tcpWriteRxBuffer(Socket *socket, uint32_t seqNum,
 
 void tcpReadRxBuffer(Socket *socket, uint32_t seqNum, uint8_t *data, size_t length);
 
+size_t tcpGetRxBufferData(Socket *socket, uint32_t seqNum,
+   size_t length, uint8_t **data);
+
+error_t tcpQueueRxData(Socket *socket, const NetBuffer *buffer,
+   size_t offset, size_t length);
+
+size_t tcpReadRxQueue(Socket *socket, uint8_t *data, size_t length);
+void tcpConsumeRxQueue(Socket *socket, size_t length);
+void tcpFlushRxQueue(Socket *socket);
+
 void tcpDumpHeader(const TcpHeader *segment, size_t length, uint32_t iss, uint32_t irs);
 
 //C++ guard
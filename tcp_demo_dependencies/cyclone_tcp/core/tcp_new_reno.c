@@ -0,0 +1,144 @@
+/**
+ * @file tcp_new_reno.c
+ * @brief NewReno congestion control
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Standard TCP congestion control (slow start and congestion avoidance)
+ * as described in RFC 5681. The fast recovery procedure itself (refer to
+ * RFC 6582) is shared by all the algorithms and lives in tcp_misc.c
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8a
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "core/socket.h"
+#include "core/tcp.h"
+#include "core/tcp_new_reno.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED && TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
+
+/**
+ * @brief NewReno congestion control
+ **/
+
+const TcpCongestOps tcpNewRenoOps =
+{
+   TCP_CONGEST_ALGO_NEW_RENO,
+   tcpNewRenoOnAck,
+   tcpNewRenoOnLoss,
+   tcpNewRenoOnRto,
+   tcpNewRenoCwndEvent
+};
+
+
+/**
+ * @brief Update the congestion window upon receipt of new acknowledgment
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] n Number of bytes acknowledged by the incoming ACK
+ * @param[in] rttFlag TRUE if a whole round-trip has elapsed
+ **/
+
+void tcpNewRenoOnAck(Socket *socket, uint_t n, bool_t rttFlag)
+{
+   //Slow start algorithm is used when cwnd is lower than ssthresh
+   if(socket->cwnd < socket->ssthresh)
+   {
+      //During slow start, TCP increments cwnd by at most SMSS bytes
+      //for each ACK received that cumulatively acknowledges new data
+      socket->cwnd += MIN(n, socket->smss);
+   }
+   //Congestion avoidance algorithm is used when cwnd exceeds ssthres
+   else
+   {
+      //Congestion window is updated once per RTT
+      if(rttFlag)
+      {
+         //TCP must not increment cwnd by more than SMSS bytes
+         socket->cwnd += MIN(socket->n, socket->smss);
+      }
+   }
+}
+
+
+/**
+ * @brief Adjust the slow start threshold after 3 duplicate ACKs
+ * @param[in] socket Handle referencing the current socket
+ **/
+
+void tcpNewRenoOnLoss(Socket *socket)
+{
+   uint_t flightSize;
+
+   //Amount of data that has been sent but not yet acknowledged
+   flightSize = socket->sndNxt - socket->sndUna;
+   //After receiving 3 duplicate ACKs, ssthresh must be adjusted
+   socket->ssthresh = MAX(flightSize / 2, 2 * socket->smss);
+}
+
+
+/**
+ * @brief Adjust the congestion window after a retransmission timeout
+ * @param[in] socket Handle referencing the current socket
+ **/
+
+void tcpNewRenoOnRto(Socket *socket)
+{
+   uint_t flightSize;
+
+   //When a TCP sender detects segment loss using the retransmission
+   //timer and the given segment has not yet been resent by way of
+   //the retransmission timer, the value of ssthresh must be updated
+   if(!socket->retransmitCount)
+   {
+      //Amount of data that has been sent but not yet acknowledged
+      flightSize = socket->sndNxt - socket->sndUna;
+      //Adjust ssthresh value
+      socket->ssthresh = MAX(flightSize / 2, 2 * socket->smss);
+   }
+
+   //Furthermore, upon a timeout cwnd must be set to no more than
+   //the loss window, LW, which equals 1 full-sized segment
+   socket->cwnd = MIN(TCP_LOSS_WINDOW * socket->smss, socket->txBufferSize);
+}
+
+
+/**
+ * @brief Process congestion window events
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] event Congestion window event
+ **/
+
+void tcpNewRenoCwndEvent(Socket *socket, TcpCongestEvent event)
+{
+   //NewReno does not keep any state of its own
+}
+
+#endif
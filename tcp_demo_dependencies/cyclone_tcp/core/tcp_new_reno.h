@@ -0,0 +1,54 @@
+/**
+ * @file tcp_new_reno.h
+ * @brief NewReno congestion control
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8a
+ **/
+
+#ifndef _TCP_NEW_RENO_H
+#define _TCP_NEW_RENO_H
+
+//Dependencies
+#include "core/tcp.h"
+
+//C++ guard
+#ifdef __cplusplus
+   extern "C" {
+#endif
+
+//NewReno congestion control
+extern const TcpCongestOps tcpNewRenoOps;
+
+//NewReno related functions
+void tcpNewRenoOnAck(Socket *socket, uint_t n, bool_t rttFlag);
+void tcpNewRenoOnLoss(Socket *socket);
+void tcpNewRenoOnRto(Socket *socket);
+void tcpNewRenoCwndEvent(Socket *socket, TcpCongestEvent event);
+
+//C++ guard
+#ifdef __cplusplus
+   }
+#endif
+
+#endif
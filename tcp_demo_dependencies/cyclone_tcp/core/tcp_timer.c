@@ -30,6 +30,7 @@
 #define TRACE_LEVEL TCP_TRACE_LEVEL
 
 //Dependencies
+#include <string.h>
 #include "core/net.h"
 #include "core/socket.h"
 #include "core/tcp.h"
@@ -43,222 +44,611 @@
 //Check TCP/IP stack configuration
 #if (TCP_SUPPORT == ENABLED)
 
+//Number of levels of the timing wheel
+#define TCP_TIMER_WHEEL_LEVELS 3
+//Number of bits used to index a slot within a level
+#define TCP_TIMER_WHEEL_BITS 6
+//Number of slots per level
+#define TCP_TIMER_WHEEL_SIZE (1 << TCP_TIMER_WHEEL_BITS)
+
+//Timing wheel (list of pending timers for each slot of each level)
+static TcpTimer *tcpTimerWheel[TCP_TIMER_WHEEL_LEVELS][TCP_TIMER_WHEEL_SIZE];
+//Current position of the timing wheel, in ticks
+static uint32_t tcpTimerWheelPos;
+//Time corresponding to the current position of the timing wheel
+static systime_t tcpTimerWheelTime;
+//Number of timers linked to the timing wheel
+static uint_t tcpTimerWheelCount;
+//Time at which netTask is due to process the timing wheel
+static systime_t tcpTimerWheelWakeupTime;
+//netTask is waiting for a TCP timer to expire
+static bool_t tcpTimerWheelWakeupSet;
+
+
+/**
+ * @brief Initialize the timing wheel
+ **/
+
+void tcpInitTimerWheel(void)
+{
+   //No timer is pending
+   memset(tcpTimerWheel, 0, sizeof(tcpTimerWheel));
+   tcpTimerWheelCount = 0;
+
+   //The wheel starts at the current time
+   tcpTimerWheelPos = 0;
+   tcpTimerWheelTime = osGetSystemTime();
+
+   //The first timer to be started must wake up netTask
+   tcpTimerWheelWakeupSet = FALSE;
+}
+
 
 /**
  * @brief TCP timer handler
  *
- * This routine must be periodically called by the TCP/IP stack to
- * handle retransmissions and TCP related timers (persist timer,
- * FIN-WAIT-2 timer and TIME-WAIT timer)
+ * This routine must be called by the TCP/IP stack to handle the expired
+ * TCP timers (retransmission timer, persist timer, override timer,
+ * FIN-WAIT-2 timer, TIME-WAIT timer and delayed ACK timer). Timers are
+ * kept in a hierarchical timing wheel, so that only the expired timers
+ * are visited
  *
  **/
 
 void tcpTick(void)
 {
-   error_t error;
-   uint_t i;
-   uint_t n;
-   uint_t u;
+   uint_t level;
+   systime_t time;
+   TcpTimer *timer;
 
-   //Loop through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   //Get current time
+   time = osGetSystemTime();
+
+   //Advance the timing wheel up to the current time
+   while(timeCompare(time, tcpTimerWheelTime + TCP_TICK_INTERVAL) >= 0)
    {
-      //Shortcut to the current socket
-      Socket *socket = socketTable + i;
-      //Check socket type
-      if(socket->type != SOCKET_TYPE_STREAM)
-         continue;
-      //Check the current state of the TCP state machine
-      if(socket->state == TCP_STATE_CLOSED)
-         continue;
-
-      //Is there any packet in the retransmission queue?
-      if(socket->retransmitQueue != NULL)
+      //Next tick
+      tcpTimerWheelPos++;
+      tcpTimerWheelTime += TCP_TICK_INTERVAL;
+
+      //Cascade the higher levels whenever the levels below wrap around
+      for(level = TCP_TIMER_WHEEL_LEVELS - 1; level > 0; level--)
       {
-         //Retransmission timeout?
-         if(tcpTimerElapsed(&socket->retransmitTimer))
+         //The levels below have completed a revolution?
+         if(!(tcpTimerWheelPos & ((1UL << (TCP_TIMER_WHEEL_BITS * level)) - 1)))
          {
+            tcpTimerWheelCascade(level, (tcpTimerWheelPos >>
+               (TCP_TIMER_WHEEL_BITS * level)) & (TCP_TIMER_WHEEL_SIZE - 1));
+         }
+      }
+
+      //Process the timers of the current slot
+      while((timer = tcpTimerWheel[0][tcpTimerWheelPos & (TCP_TIMER_WHEEL_SIZE - 1)]) != NULL)
+      {
+         //Unlink the timer
+         tcpTimerWheelRemove(timer);
+
+         //Invoke the relevant handler
+         if(timer->handler != NULL)
+            timer->handler(timer->socket);
+
+         //The handler did not restart the timer? A timer that is not linked
+         //to the wheel will never fire again, so it must not be reported as
+         //running. Otherwise the callers that only start the timer when it
+         //is not already running would never re-arm it
+         if(timer->slot == NULL)
+            timer->running = FALSE;
+      }
+   }
+}
+
+
+/**
+ * @brief Get the delay before the next TCP timer expires
+ * @return Maximum time the TCP/IP stack may sleep
+ **/
+
+systime_t tcpGetNextTimeout(void)
+{
+   uint_t i;
+   systime_t time;
+   systime_t expiry;
+
+   //No pending timer?
+   if(tcpTimerWheelCount == 0)
+   {
+      //The next timer to be started must wake up netTask
+      tcpTimerWheelWakeupSet = FALSE;
+      //netTask may sleep until an event occurs
+      return INFINITE_DELAY;
+   }
+
+   //Search the lowest level for the next non-empty slot
+   for(i = 1; i < TCP_TIMER_WHEEL_SIZE; i++)
+   {
+      if(tcpTimerWheel[0][(tcpTimerWheelPos + i) & (TCP_TIMER_WHEEL_SIZE - 1)] != NULL)
+         break;
+   }
+
+   //Otherwise, wake up when the higher levels are cascaded
+   if(i >= TCP_TIMER_WHEEL_SIZE)
+      i = TCP_TIMER_WHEEL_SIZE - (tcpTimerWheelPos & (TCP_TIMER_WHEEL_SIZE - 1));
+
+   //Time at which the slot will be processed
+   expiry = tcpTimerWheelTime + i * TCP_TICK_INTERVAL;
+   //Get current time
+   time = osGetSystemTime();
+
+   //Timers that expire earlier must wake up netTask
+   tcpTimerWheelWakeupTime = expiry;
+   tcpTimerWheelWakeupSet = TRUE;
+
+   //Compute the remaining delay
+   if(timeCompare(expiry, time) > 0)
+      return expiry - time;
+   else
+      return 0;
+}
+
+
+/**
+ * @brief Bind the TCP timers of a socket to their handlers
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpInitTimers(Socket *socket)
+{
+   //Retransmission timer
+   socket->retransmitTimer.socket = socket;
+   socket->retransmitTimer.handler = tcpRetransmitTimerHandler;
+
+   //Persist timer
+   socket->persistTimer.socket = socket;
+   socket->persistTimer.handler = tcpPersistTimerHandler;
+
+   //Override timer
+   socket->overrideTimer.socket = socket;
+   socket->overrideTimer.handler = tcpOverrideTimerHandler;
+
+   //FIN-WAIT-2 timer
+   socket->finWait2Timer.socket = socket;
+   socket->finWait2Timer.handler = tcpFinWait2TimerHandler;
+
+   //TIME-WAIT timer
+   socket->timeWaitTimer.socket = socket;
+   socket->timeWaitTimer.handler = tcpTimeWaitTimerHandler;
+
+   //Delayed ACK timer
+   socket->delayedAckTimer.socket = socket;
+   socket->delayedAckTimer.handler = tcpDelayedAckTimerHandler;
+}
+
+
+/**
+ * @brief Stop all the TCP timers of a socket
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpStopTimers(Socket *socket)
+{
+   //Unlink the timers from the timing wheel
+   tcpTimerStop(&socket->retransmitTimer);
+   tcpTimerStop(&socket->persistTimer);
+   tcpTimerStop(&socket->overrideTimer);
+   tcpTimerStop(&socket->finWait2Timer);
+   tcpTimerStop(&socket->timeWaitTimer);
+   tcpTimerStop(&socket->delayedAckTimer);
+}
+
+
+/**
+ * @brief Retransmission timer handler
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpRetransmitTimerHandler(Socket *socket)
+{
+   //Check socket type
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return;
+   //Check the current state of the TCP state machine
+   if(socket->state == TCP_STATE_CLOSED)
+      return;
+
+   //Is there any packet in the retransmission queue?
+   if(socket->retransmitQueue != NULL)
+   {
 #if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
-            //When a TCP sender detects segment loss using the retransmission
-            //timer and the given segment has not yet been resent by way of
-            //the retransmission timer, the value of ssthresh must be updated
-            if(!socket->retransmitCount)
-            {
-               //Amount of data that has been sent but not yet acknowledged
-               uint_t flightSize = socket->sndNxt - socket->sndUna;
-               //Adjust ssthresh value
-               socket->ssthresh = MAX(flightSize / 2, 2 * socket->smss);
-            }
-
-            //Furthermore, upon a timeout cwnd must be set to no more than
-            //the loss window, LW, which equals 1 full-sized segment
-            socket->cwnd = MIN(TCP_LOSS_WINDOW * socket->smss, socket->txBufferSize);
-
-            //After a retransmit timeout, record the highest sequence number
-            //transmitted in the variable recover
-            socket->recover = socket->sndNxt - 1;
-
-            //Enter the fast loss recovery procedure
-            socket->congestState = TCP_CONGEST_STATE_LOSS_RECOVERY;
+      //Let the congestion control algorithm adjust ssthresh and
+      //collapse the congestion window
+      socket->congestOps->onRto(socket);
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //The receiver may have discarded data it previously SACKed
+      if(socket->sackPermitted)
+         tcpResetScoreboard(socket);
 #endif
-            //Make sure the maximum number of retransmissions has not been reached
-            if(socket->retransmitCount < TCP_MAX_RETRIES)
-            {
-               //Debug message
-               TRACE_INFO("%s: TCP segment retransmission #%u (%u data bytes)...\r\n",
-                  formatSystemTime(osGetSystemTime(), NULL), socket->retransmitCount + 1,
-                  socket->retransmitQueue->length);
-
-               //Retransmit the earliest segment that has not been
-               //acknowledged by the TCP receiver
-               tcpRetransmitSegment(socket);
-
-               //Use exponential back-off algorithm to calculate the new RTO
-               socket->rto = MIN(socket->rto * 2, TCP_MAX_RTO);
-               //Restart retransmission timer
-               tcpTimerStart(&socket->retransmitTimer, socket->rto);
-               //Increment retransmission counter
-               socket->retransmitCount++;
-            }
-            else
-            {
-               //The maximum number of retransmissions has been exceeded
-               tcpChangeState(socket, TCP_STATE_CLOSED);
-               //Turn off the retransmission timer
-               tcpTimerStop(&socket->retransmitTimer);
-            }
-
-            //TCP must use Karn's algorithm for taking RTT samples. That is, RTT
-            //samples must not be made using segments that were retransmitted
-            socket->rttBusy = FALSE;
-         }
+
+      //After a retransmit timeout, record the highest sequence number
+      //transmitted in the variable recover
+      socket->recover = socket->sndNxt - 1;
+
+      //Enter the fast loss recovery procedure
+      socket->congestState = TCP_CONGEST_STATE_LOSS_RECOVERY;
+#endif
+      //Make sure the maximum number of retransmissions has not been reached
+      if(socket->retransmitCount < TCP_MAX_RETRIES)
+      {
+         //Debug message
+         TRACE_INFO("%s: TCP segment retransmission #%u (%u data bytes)...\r\n",
+            formatSystemTime(osGetSystemTime(), NULL), socket->retransmitCount + 1,
+            socket->retransmitQueue->length);
+
+         //Retransmit the earliest segment that has not been
+         //acknowledged by the TCP receiver
+         tcpRetransmitSegment(socket);
+
+         //Use exponential back-off algorithm to calculate the new RTO
+         socket->rto = MIN(socket->rto * 2, TCP_MAX_RTO);
+         //Restart retransmission timer
+         tcpTimerStart(&socket->retransmitTimer, socket->rto);
+         //Increment retransmission counter
+         socket->retransmitCount++;
+      }
+      else
+      {
+         //The maximum number of retransmissions has been exceeded
+         tcpChangeState(socket, TCP_STATE_CLOSED);
+         //Turn off the retransmission timer
+         tcpTimerStop(&socket->retransmitTimer);
       }
 
-      //Check the current state of the TCP state machine
-      if(socket->state == TCP_STATE_CLOSED)
-         continue;
+      //TCP must use Karn's algorithm for taking RTT samples. That is, RTT
+      //samples must not be made using segments that were retransmitted
+      socket->rttBusy = FALSE;
+   }
+}
+
 
-      //The persist timer is used when the remote host advertises
-      //a window size of zero
-      if(!socket->sndWnd && socket->wndProbeInterval)
+/**
+ * @brief Persist timer handler
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpPersistTimerHandler(Socket *socket)
+{
+   //Check socket type
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return;
+   //Check the current state of the TCP state machine
+   if(socket->state == TCP_STATE_CLOSED)
+      return;
+
+   //The persist timer is used when the remote host advertises
+   //a window size of zero
+   if(!socket->sndWnd && socket->wndProbeInterval)
+   {
+      //Make sure the maximum number of retransmissions has not been reached
+      if(socket->wndProbeCount < TCP_MAX_RETRIES)
       {
-         //Time to send a new probe?
-         if(tcpTimerElapsed(&socket->persistTimer))
-         {
-            //Make sure the maximum number of retransmissions has not been reached
-            if(socket->wndProbeCount < TCP_MAX_RETRIES)
-            {
-               //Debug message
-               TRACE_INFO("%s: TCP zero window probe #%u...\r\n",
-                  formatSystemTime(osGetSystemTime(), NULL), socket->wndProbeCount + 1);
-
-               //Zero window probes usually have the sequence number one less than expected
-               tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt - 1, socket->rcvNxt, 0, FALSE);
-               //The interval between successive probes should be increased exponentially
-               socket->wndProbeInterval = MIN(socket->wndProbeInterval * 2, TCP_MAX_PROBE_INTERVAL);
-               //Restart the persist timer
-               tcpTimerStart(&socket->persistTimer, socket->wndProbeInterval);
-               //Increment window probe counter
-               socket->wndProbeCount++;
-            }
-            else
-            {
-               //Enter CLOSED state
-               tcpChangeState(socket, TCP_STATE_CLOSED);
-            }
-         }
+         //Debug message
+         TRACE_INFO("%s: TCP zero window probe #%u...\r\n",
+            formatSystemTime(osGetSystemTime(), NULL), socket->wndProbeCount + 1);
+
+         //Zero window probes usually have the sequence number one less than expected
+         tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt - 1, socket->rcvNxt, 0, FALSE);
+         //The interval between successive probes should be increased exponentially
+         socket->wndProbeInterval = MIN(socket->wndProbeInterval * 2, TCP_MAX_PROBE_INTERVAL);
+         //Restart the persist timer
+         tcpTimerStart(&socket->persistTimer, socket->wndProbeInterval);
+         //Increment window probe counter
+         socket->wndProbeCount++;
       }
+      else
+      {
+         //Enter CLOSED state
+         tcpChangeState(socket, TCP_STATE_CLOSED);
+      }
+   }
+}
+
+
+/**
+ * @brief Override timer handler
+ *
+ * To avoid a deadlock, it is necessary to have a timeout to force
+ * transmission of data, overriding the SWS avoidance algorithm. In
+ * practice, this timeout should seldom occur (see RFC 1122 4.2.3.4)
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpOverrideTimerHandler(Socket *socket)
+{
+   error_t error;
+   uint_t n;
+   uint_t u;
 
-      //To avoid a deadlock, it is necessary to have a timeout to force
-      //transmission of data, overriding the SWS avoidance algorithm. In
-      //practice, this timeout should seldom occur (see RFC 1122 4.2.3.4)
-      if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+   //Check socket type
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return;
+
+   //The override timer is only relevant in the ESTABLISHED and CLOSE-WAIT states
+   if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+   {
+      //Any data buffered but not yet sent?
+      if(socket->sndUser)
       {
-         //The override timeout occurred?
-         if(socket->sndUser && tcpTimerElapsed(&socket->overrideTimer))
-         {
-            //The amount of data that can be sent at any given time is
-            //limited by the receiver window and the congestion window
-            n = MIN(socket->sndWnd, socket->txBufferSize);
+         //The amount of data that can be sent at any given time is
+         //limited by the receiver window and the congestion window
+         n = MIN(socket->sndWnd, socket->txBufferSize);
 
 #if (TCP_CONGEST_CONTROL_SUPPORT == ENABLED)
-            //Check the congestion window
-            n = MIN(n, socket->cwnd);
+         //Check the congestion window
+         n = MIN(n, socket->cwnd);
 #endif
-            //Retrieve the size of the usable window
-            u = n - (socket->sndNxt - socket->sndUna);
-
-            //Send as much data as possible
-            while(socket->sndUser > 0)
-            {
-               //The usable window size may become zero or negative,
-               //preventing packet transmission
-               if((int_t) u <= 0)
-                  break;
-
-               //Calculate the number of bytes to send at a time
-               n = MIN(u, socket->sndUser);
-               n = MIN(n, socket->smss);
-
-               //Send TCP segment
-               error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
-                  socket->sndNxt, socket->rcvNxt, n, TRUE);
-               //Failed to send TCP segment?
-               if(error)
-                  break;
-
-               //Advance SND.NXT pointer
-               socket->sndNxt += n;
-               //Adjust the number of bytes buffered but not yet sent
-               socket->sndUser -= n;
-               //Update the size of the usable window
-               u -= n;
-            }
-
-            //Check whether the transmitter can accept more data
-            tcpUpdateEvents(socket);
-
-            //Restart override timer if necessary
-            if(socket->sndUser > 0)
-               tcpTimerStart(&socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
+         //Retrieve the size of the usable window
+         u = n - (socket->sndNxt - socket->sndUna);
+
+         //Send as much data as possible
+         while(socket->sndUser > 0)
+         {
+            //The usable window size may become zero or negative,
+            //preventing packet transmission
+            if((int_t) u <= 0)
+               break;
+
+            //Calculate the number of bytes to send at a time
+            n = MIN(u, socket->sndUser);
+            n = MIN(n, socket->smss);
+
+            //Send TCP segment
+            error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
+               socket->sndNxt, socket->rcvNxt, n, TRUE);
+            //Failed to send TCP segment?
+            if(error)
+               break;
+
+            //Advance SND.NXT pointer
+            socket->sndNxt += n;
+            //Adjust the number of bytes buffered but not yet sent
+            socket->sndUser -= n;
+            //Update the size of the usable window
+            u -= n;
          }
+
+         //Check whether the transmitter can accept more data
+         tcpUpdateEvents(socket);
+
+         //Restart override timer if necessary
+         if(socket->sndUser > 0)
+            tcpTimerStart(&socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
       }
+   }
+}
+
+
+/**
+ * @brief FIN-WAIT-2 timer handler
+ *
+ * The FIN-WAIT-2 timer prevents the connection from staying
+ * in the FIN-WAIT-2 state forever
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpFinWait2TimerHandler(Socket *socket)
+{
+   //Check socket type
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return;
+
+   //Maximum FIN-WAIT-2 time has elapsed?
+   if(socket->state == TCP_STATE_FIN_WAIT_2)
+   {
+      //Debug message
+      TRACE_WARNING("TCP FIN-WAIT-2 timer elapsed...\r\n");
+      //Enter CLOSED state
+      tcpChangeState(socket, TCP_STATE_CLOSED);
+   }
+}
+
+
+/**
+ * @brief TIME-WAIT timer handler
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpTimeWaitTimerHandler(Socket *socket)
+{
+   //Check socket type
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return;
 
-      //The FIN-WAIT-2 timer prevents the connection
-      //from staying in the FIN-WAIT-2 state forever
-      if(socket->state == TCP_STATE_FIN_WAIT_2)
+   //2MSL time has elapsed?
+   if(socket->state == TCP_STATE_TIME_WAIT)
+   {
+      //Debug message
+      TRACE_WARNING("TCP 2MSL timer elapsed (socket %u)...\r\n", socket->descriptor);
+      //Enter CLOSED state
+      tcpChangeState(socket, TCP_STATE_CLOSED);
+
+      //Dispose the socket if the user does not have the ownership anymore
+      if(!socket->ownedFlag)
       {
-         //Maximum FIN-WAIT-2 time has elapsed?
-         if(tcpTimerElapsed(&socket->finWait2Timer))
-         {
-            //Debug message
-            TRACE_WARNING("TCP FIN-WAIT-2 timer elapsed...\r\n");
-            //Enter CLOSED state
-            tcpChangeState(socket, TCP_STATE_CLOSED);
-         }
+         //Delete the TCB
+         tcpDeleteControlBlock(socket);
+         //Remove the socket from the demultiplexing tables
+         socketRemoveHashEntry(socket);
+         //Mark the socket as closed
+         socket->type = SOCKET_TYPE_UNUSED;
       }
+   }
+}
+
+
+/**
+ * @brief Delayed ACK timer handler
+ *
+ * The delayed ACK timer bounds the time an acknowledgment may be
+ * withheld while waiting for outgoing data to piggyback it on
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpDelayedAckTimerHandler(Socket *socket)
+{
+   //Check socket type
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return;
 
-      //TIME-WAIT timer
-      if(socket->state == TCP_STATE_TIME_WAIT)
+   //Any data waiting to be acknowledged?
+   if(socket->ackPendingLength > 0)
+   {
+      //Data can only be received in a synchronized state
+      if(socket->state == TCP_STATE_ESTABLISHED ||
+         socket->state == TCP_STATE_FIN_WAIT_1 ||
+         socket->state == TCP_STATE_FIN_WAIT_2)
       {
-         //2MSL time has elapsed?
-         if(tcpTimerElapsed(&socket->timeWaitTimer))
-         {
-            //Debug message
-            TRACE_WARNING("TCP 2MSL timer elapsed (socket %u)...\r\n", i);
-            //Enter CLOSED state
-            tcpChangeState(socket, TCP_STATE_CLOSED);
-
-            //Dispose the socket if the user does not have the ownership anymore
-            if(!socket->ownedFlag)
-            {
-               //Delete the TCB
-               tcpDeleteControlBlock(socket);
-               //Mark the socket as closed
-               socket->type = SOCKET_TYPE_UNUSED;
-            }
-         }
+         //Send the delayed acknowledgment
+         tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
       }
+
+      //Clear the counter
+      socket->ackPendingLength = 0;
+   }
+}
+
+
+/**
+ * @brief Link a running timer to the relevant slot of the timing wheel
+ * @param[in] timer Pointer to the timer structure
+ **/
+
+void tcpTimerWheelInsert(TcpTimer *timer)
+{
+   uint_t level;
+   uint32_t ticks;
+   uint32_t pos;
+   systime_t expiry;
+
+   //Compute the expiration time
+   expiry = timer->startTime + timer->interval;
+
+   //Number of ticks before the timer expires (rounded up). A timer that
+   //has already expired is processed at the next tick
+   if(timeCompare(expiry, tcpTimerWheelTime) <= 0)
+      ticks = 1;
+   else
+      ticks = (expiry - tcpTimerWheelTime + TCP_TICK_INTERVAL - 1) / TCP_TICK_INTERVAL;
+
+   //Timers that expire beyond the range of the wheel are parked in the
+   //highest level and re-inserted when their slot is cascaded
+   ticks = MIN(ticks, (1UL << (TCP_TIMER_WHEEL_BITS * TCP_TIMER_WHEEL_LEVELS)) - 1);
+
+   //Select the lowest level whose range covers the expiration time
+   for(level = 0; level < (TCP_TIMER_WHEEL_LEVELS - 1); level++)
+   {
+      if(ticks < (1UL << (TCP_TIMER_WHEEL_BITS * (level + 1))))
+         break;
+   }
+
+   //Index of the slot within the selected level
+   pos = ((tcpTimerWheelPos + ticks) >> (TCP_TIMER_WHEEL_BITS * level)) &
+      (TCP_TIMER_WHEEL_SIZE - 1);
+
+   //Insert the timer at the head of the list
+   timer->slot = &tcpTimerWheel[level][pos];
+   timer->prev = NULL;
+   timer->next = *timer->slot;
+
+   //Update the list
+   if(timer->next != NULL)
+      timer->next->prev = timer;
+
+   *timer->slot = timer;
+
+   //Update the number of pending timers
+   tcpTimerWheelCount++;
+
+   //Time at which the slot will be processed
+   expiry = tcpTimerWheelTime + ticks * TCP_TICK_INTERVAL;
+
+   //netTask sleeps until the next expiration time. A timer that expires
+   //earlier, typically started by an application task, must wake it up
+   if(!tcpTimerWheelWakeupSet || timeCompare(expiry, tcpTimerWheelWakeupTime) < 0)
+   {
+      //Update the time at which netTask is due to process the wheel
+      tcpTimerWheelWakeupTime = expiry;
+      tcpTimerWheelWakeupSet = TRUE;
+
+      //Notify the TCP/IP stack
+      osSetEvent(&netEvent);
+   }
+}
+
+
+/**
+ * @brief Suspend the wake-up notifications of the timing wheel
+ *
+ * netTask calls this function before handling events or expired timers.
+ * The timers started in the meantime do not need to wake it up, since it
+ * computes the expiration time of the next timer before going back to sleep
+ **/
+
+void tcpSuspendWakeup(void)
+{
+   //Only the timers that have already expired would wake up netTask
+   tcpTimerWheelWakeupTime = osGetSystemTime();
+   tcpTimerWheelWakeupSet = TRUE;
+}
+
+
+/**
+ * @brief Unlink a timer from the timing wheel
+ * @param[in] timer Pointer to the timer structure
+ **/
+
+void tcpTimerWheelRemove(TcpTimer *timer)
+{
+   //The timer is not linked to the wheel?
+   if(timer->slot == NULL)
+      return;
+
+   //Remove the timer from the list
+   if(timer->prev != NULL)
+      timer->prev->next = timer->next;
+   else
+      *timer->slot = timer->next;
+
+   if(timer->next != NULL)
+      timer->next->prev = timer->prev;
+
+   //The timer is no longer linked
+   timer->slot = NULL;
+   timer->prev = NULL;
+   timer->next = NULL;
+
+   //Update the number of pending timers
+   tcpTimerWheelCount--;
+}
+
+
+/**
+ * @brief Move the timers of a slot to the lower levels of the wheel
+ * @param[in] level Level of the slot
+ * @param[in] pos Index of the slot
+ **/
+
+void tcpTimerWheelCascade(uint_t level, uint_t pos)
+{
+   TcpTimer *timer;
+
+   //Re-insert each timer according to its remaining time
+   while((timer = tcpTimerWheel[level][pos]) != NULL)
+   {
+      tcpTimerWheelRemove(timer);
+      tcpTimerWheelInsert(timer);
    }
 }
 
@@ -271,12 +661,18 @@ void tcpTick(void)
 
 void tcpTimerStart(TcpTimer *timer, systime_t delay)
 {
+   //Unlink the timer if it was already running
+   tcpTimerWheelRemove(timer);
+
    //Start timer
    timer->startTime = osGetSystemTime();
    timer->interval = delay;
 
    //The timer is now running...
    timer->running = TRUE;
+
+   //Link the timer to the timing wheel
+   tcpTimerWheelInsert(timer);
 }
 
 
@@ -289,6 +685,9 @@ void tcpTimerStop(TcpTimer *timer)
 {
    //Stop timer
    timer->running = FALSE;
+
+   //Unlink the timer from the timing wheel
+   tcpTimerWheelRemove(timer);
 }
 
 
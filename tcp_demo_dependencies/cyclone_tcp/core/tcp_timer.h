@@ -35,7 +35,24 @@
 #endif
 
 //TCP timer related functions
+void tcpInitTimerWheel(void);
 void tcpTick(void);
+systime_t tcpGetNextTimeout(void);
+void tcpSuspendWakeup(void);
+
+void tcpInitTimers(Socket *socket);
+void tcpStopTimers(Socket *socket);
+
+void tcpRetransmitTimerHandler(Socket *socket);
+void tcpPersistTimerHandler(Socket *socket);
+void tcpOverrideTimerHandler(Socket *socket);
+void tcpFinWait2TimerHandler(Socket *socket);
+void tcpTimeWaitTimerHandler(Socket *socket);
+void tcpDelayedAckTimerHandler(Socket *socket);
+
+void tcpTimerWheelInsert(TcpTimer *timer);
+void tcpTimerWheelRemove(TcpTimer *timer);
+void tcpTimerWheelCascade(uint_t level, uint_t pos);
 
 void tcpTimerStart(TcpTimer *timer, systime_t delay);
 void tcpTimerStop(TcpTimer *timer);
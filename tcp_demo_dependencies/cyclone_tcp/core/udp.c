@@ -52,6 +52,18 @@ OsMutex udpCallbackMutex;
 //Table that holds the registered user callbacks
 UdpRxCallbackDesc udpCallbackTable[UDP_CALLBACK_TABLE_SIZE];
 
+//Statistics not yet folded into the MIB counters
+#if (UDP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   UdpCounters udpCounters;
+#endif
+
+//Fast-path statistics are accumulated in the UDP counter block
+#if (UDP_COUNTER_BLOCK_SUPPORT == ENABLED && (MIB2_SUPPORT == ENABLED || UDP_MIB_SUPPORT == ENABLED))
+   #define UDP_INC_COUNTER(name, value) udpCounters.name += value
+#else
+   #define UDP_INC_COUNTER(name, value)
+#endif
+
 
 /**
  * @brief UDP related initialization
@@ -73,6 +85,11 @@ error_t udpInit(void)
    //Initialize callback table
    memset(udpCallbackTable, 0, sizeof(udpCallbackTable));
 
+#if (UDP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   //Clear the counter block
+   memset(&udpCounters, 0, sizeof(UdpCounters));
+#endif
+
    //Successful initialization
    return NO_ERROR;
 }
@@ -115,6 +132,31 @@ uint16_t udpGetDynamicPort(void)
 }
 
 
+/**
+ * @brief Fold the UDP counter block into the MIB counters
+ *
+ * Called by netFoldCounters() with exclusive access to the TCP/IP stack
+ **/
+
+void udpFoldCounters(void)
+{
+#if (UDP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   //Total number of UDP datagrams delivered to UDP users
+   MIB2_INC_COUNTER32(udpGroup.udpInDatagrams, udpCounters.inDatagrams);
+   UDP_MIB_INC_COUNTER32(udpInDatagrams, udpCounters.inDatagrams);
+   UDP_MIB_INC_COUNTER64(udpHCInDatagrams, udpCounters.inDatagrams);
+
+   //Total number of UDP datagrams sent from this entity
+   MIB2_INC_COUNTER32(udpGroup.udpOutDatagrams, udpCounters.outDatagrams);
+   UDP_MIB_INC_COUNTER32(udpOutDatagrams, udpCounters.outDatagrams);
+   UDP_MIB_INC_COUNTER64(udpHCOutDatagrams, udpCounters.outDatagrams);
+
+   //The counter block is now empty
+   memset(&udpCounters, 0, sizeof(UdpCounters));
+#endif
+}
+
+
 /**
  * @brief Incoming UDP datagram processing
  * @param[in] interface Underlying network interface
@@ -164,8 +206,9 @@ error_t udpProcessDatagram(NetInterface *interface,
    //When UDP runs over IPv6, the checksum is mandatory
    if(header->checksum != 0x0000 || pseudoHeader->length == sizeof(Ipv6PseudoHeader))
    {
-      //Verify UDP checksum
-      if(ipCalcUpperLayerChecksumEx(pseudoHeader->data,
+      //Verify UDP checksum (unless the hardware already did it)
+      if(!ipIsRxChecksumOffloaded(interface, pseudoHeader) &&
+         ipCalcUpperLayerChecksumEx(pseudoHeader->data,
          pseudoHeader->length, buffer, offset, length) != 0x0000)
       {
          //Debug message
@@ -181,12 +224,10 @@ error_t udpProcessDatagram(NetInterface *interface,
       }
    }
 
-   //Loop through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   //Loop through the sockets bound to the same port hash
+   for(socket = socketGetPortHashChain(ntohs(header->destPort));
+      socket != NULL; socket = socket->hashNext)
    {
-      //Point to the current socket
-      socket = socketTable + i;
-
       //UDP socket found?
       if(socket->type != SOCKET_TYPE_DGRAM)
          continue;
@@ -271,7 +312,7 @@ error_t udpProcessDatagram(NetInterface *interface,
    length -= sizeof(UdpHeader);
 
    //No matching socket found?
-   if(i >= SOCKET_MAX_COUNT)
+   if(socket == NULL)
    {
       //Invoke user callback, if any
       error = udpInvokeRxCallback(interface, pseudoHeader, header, buffer, offset);
@@ -374,9 +415,13 @@ error_t udpProcessDatagram(NetInterface *interface,
    udpUpdateEvents(socket);
 
    //Total number of UDP datagrams delivered to UDP users
+#if (UDP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   UDP_INC_COUNTER(inDatagrams, 1);
+#else
    MIB2_INC_COUNTER32(udpGroup.udpInDatagrams, 1);
    UDP_MIB_INC_COUNTER32(udpInDatagrams, 1);
    UDP_MIB_INC_COUNTER64(udpHCInDatagrams, 1);
+#endif
 
    //Successful processing
    return NO_ERROR;
@@ -450,6 +495,7 @@ error_t udpSendDatagramEx(NetInterface *interface, uint16_t srcPort, const IpAdd
 {
    error_t error;
    size_t length;
+   bool_t offload;
    UdpHeader *header;
    IpPseudoHeader pseudoHeader;
 
@@ -505,9 +551,16 @@ error_t udpSendDatagramEx(NetInterface *interface, uint16_t srcPort, const IpAdd
       pseudoHeader.ipv4Data.protocol = IPV4_PROTOCOL_UDP;
       pseudoHeader.ipv4Data.length = htons(length);
 
-      //Calculate UDP header checksum
-      header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv4Data,
-         sizeof(Ipv4PseudoHeader), buffer, offset, length);
+      //Check whether the UDP checksum is inserted by hardware
+      offload = ipv4IsTxChecksumOffloaded(interface, IPV4_PROTOCOL_UDP, length);
+
+      //UDP checksum calculation not supported by hardware?
+      if(!offload)
+      {
+         //Calculate UDP header checksum
+         header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv4Data,
+            sizeof(Ipv4PseudoHeader), buffer, offset, length);
+      }
    }
    else
 #endif
@@ -530,6 +583,9 @@ error_t udpSendDatagramEx(NetInterface *interface, uint16_t srcPort, const IpAdd
       pseudoHeader.ipv6Data.reserved = 0;
       pseudoHeader.ipv6Data.nextHeader = IPV6_UDP_HEADER;
 
+      //The checksum is always computed in software
+      offload = FALSE;
+
       //Calculate UDP header checksum
       header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv6Data,
          sizeof(Ipv6PseudoHeader), buffer, offset, length);
@@ -544,14 +600,18 @@ error_t udpSendDatagramEx(NetInterface *interface, uint16_t srcPort, const IpAdd
 
    //If the computed checksum is zero, it is transmitted as all ones. An all
    //zero transmitted checksum value means that the transmitter generated no
-   //checksum
-   if(header->checksum == 0x0000)
+   //checksum. The hardware takes care of this when checksum offload is used
+   if(!offload && header->checksum == 0x0000)
       header->checksum = 0xFFFF;
 
    //Total number of UDP datagrams sent from this entity
+#if (UDP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   UDP_INC_COUNTER(outDatagrams, 1);
+#else
    MIB2_INC_COUNTER32(udpGroup.udpOutDatagrams, 1);
    UDP_MIB_INC_COUNTER32(udpOutDatagrams, 1);
    UDP_MIB_INC_COUNTER64(udpHCOutDatagrams, 1);
+#endif
 
    //Debug message
    TRACE_INFO("Sending UDP datagram (%" PRIuSIZE " bytes)\r\n", length);
@@ -559,7 +619,7 @@ error_t udpSendDatagramEx(NetInterface *interface, uint16_t srcPort, const IpAdd
    udpDumpHeader(header);
 
    //Send UDP datagram
-   error = ipSendDatagram(interface, &pseudoHeader, buffer, offset, ttl);
+   error = ipSendDatagram(interface, &pseudoHeader, buffer, offset, ttl, NULL);
    //Return status code
    return error;
 }
@@ -882,9 +942,13 @@ error_t udpInvokeRxCallback(NetInterface *interface, const IpPseudoHeader *pseud
    else
    {
       //Total number of UDP datagrams delivered to UDP users
+#if (UDP_COUNTER_BLOCK_SUPPORT == ENABLED)
+      UDP_INC_COUNTER(inDatagrams, 1);
+#else
       MIB2_INC_COUNTER32(udpGroup.udpInDatagrams, 1);
       UDP_MIB_INC_COUNTER32(udpInDatagrams, 1);
       UDP_MIB_INC_COUNTER64(udpHCInDatagrams, 1);
+#endif
    }
 
    //Return status code
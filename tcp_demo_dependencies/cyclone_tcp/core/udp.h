@@ -55,6 +55,13 @@
    #error UDP_RX_QUEUE_SIZE parameter is not valid
 #endif
 
+//Counter block for fast-path statistics
+#ifndef UDP_COUNTER_BLOCK_SUPPORT
+   #define UDP_COUNTER_BLOCK_SUPPORT ENABLED
+#elif (UDP_COUNTER_BLOCK_SUPPORT != ENABLED && UDP_COUNTER_BLOCK_SUPPORT != DISABLED)
+   #error UDP_COUNTER_BLOCK_SUPPORT parameter is not valid
+#endif
+
 //C++ guard
 #ifdef __cplusplus
    extern "C" {
@@ -108,13 +115,32 @@ typedef struct
 } UdpRxCallbackDesc;
 
 
+/**
+ * @brief UDP counter block
+ *
+ * Statistics updated for every datagram are accumulated here and added to
+ * the MIB-II and UDP-MIB counters by udpFoldCounters()
+ **/
+
+typedef struct
+{
+   uint32_t inDatagrams;  ///<Datagrams delivered to UDP users
+   uint32_t outDatagrams; ///<Datagrams sent from this entity
+} UdpCounters;
+
+
 //Global variables
 extern OsMutex udpCallbackMutex;
 extern UdpRxCallbackDesc udpCallbackTable[UDP_CALLBACK_TABLE_SIZE];
 
+#if (UDP_COUNTER_BLOCK_SUPPORT == ENABLED)
+   extern UdpCounters udpCounters;
+#endif
+
 //UDP related functions
 error_t udpInit(void);
 uint16_t udpGetDynamicPort(void);
+void udpFoldCounters(void);
 
 error_t udpProcessDatagram(NetInterface *interface,
    IpPseudoHeader *pseudoHeader, const NetBuffer *buffer, size_t offset);
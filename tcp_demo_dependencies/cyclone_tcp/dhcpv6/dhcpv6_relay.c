@@ -390,6 +390,8 @@ void dhcpv6RelayTask(void *param)
          //The DHCPv6 relay agent is about to stop
          context->stopRequest = FALSE;
          context->running = FALSE;
+         //Return the buffers cached on behalf of the task
+         memPoolFlushCache(NULL);
          //Acknowledge the reception of the user request
          osSetEvent(&context->ackEvent);
          //Kill ourselves
@@ -747,6 +747,10 @@ void ksz8851ClearBit(NetInterface *interface, uint8_t address, uint16_t mask)
 
 /**
  * @brief CRC calculation
+ *
+ * The result is the bit-reversed, non-complemented Ethernet FCS, as
+ * computed by the controller for the hash filter
+ *
  * @param[in] data Pointer to the data over which to calculate the CRC
  * @param[in] length Number of bytes to process
  * @return Resulting CRC value
@@ -754,30 +758,9 @@ void ksz8851ClearBit(NetInterface *interface, uint8_t address, uint16_t mask)
 
 uint32_t ksz8851CalcCrc(const void *data, size_t length)
 {
-   uint_t i;
-   uint_t j;
-
-   //Point to the data over which to calculate the CRC
-   const uint8_t *p = (uint8_t *) data;
-   //CRC preset value
-   uint32_t crc = 0xFFFFFFFF;
-
-   //Loop through data
-   for(i = 0; i < length; i++)
-   {
-      //The message is processed bit by bit
-      for(j = 0; j < 8; j++)
-      {
-         //Update CRC value
-         if(((crc >> 31) ^ (p[i] >> j)) & 0x01)
-            crc = (crc << 1) ^ 0x04C11DB7;
-         else
-            crc = crc << 1;
-      }
-   }
-
-   //Return CRC value
-   return crc;
+   //The controller shifts the CRC register in the opposite direction to
+   //the Ethernet FCS and does not complement the result
+   return reverseInt32(ethUpdateCrc(0xFFFFFFFF, data, length));
 }
 
 
@@ -0,0 +1,387 @@
+/**
+ * @file loopback_driver.c
+ * @brief Loopback driver connecting two network interfaces
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8a
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL NIC_TRACE_LEVEL
+
+//Dependencies
+#include "core/net.h"
+#include "drivers/loopback_driver.h"
+#include "debug.h"
+
+
+/**
+ * @brief Packet descriptor
+ **/
+
+typedef struct
+{
+   size_t length;
+   uint8_t *data;
+} LoopbackDriverPacket;
+
+
+/**
+ * @brief Loopback driver context
+ **/
+
+typedef struct
+{
+   NetInterface *peer;
+   LoopbackDriverLossHook lossHook;
+   void *lossParam;
+   uint_t writeIndex;
+   uint_t readIndex;
+   uint_t count;
+   LoopbackDriverPacket queue[LOOPBACK_DRIVER_QUEUE_SIZE];
+   LoopbackDriverStats stats;
+} LoopbackDriverContext;
+
+
+//Driver context of each network interface
+static LoopbackDriverContext loopbackDriverContext[NET_INTERFACE_COUNT];
+
+
+/**
+ * @brief Loopback driver
+ **/
+
+const NicDriver loopbackDriver =
+{
+   NIC_TYPE_ETHERNET,
+   ETH_MTU,
+   loopbackDriverInit,
+   loopbackDriverTick,
+   loopbackDriverEnableIrq,
+   loopbackDriverDisableIrq,
+   loopbackDriverEventHandler,
+   loopbackDriverSendPacket,
+   loopbackDriverSetMulticastFilter,
+   NULL,
+   NULL,
+   NULL,
+   TRUE,
+   TRUE,
+   TRUE,
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   TRUE
+#else
+   FALSE
+#endif
+};
+
+
+/**
+ * @brief Loopback driver initialization
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t loopbackDriverInit(NetInterface *interface)
+{
+   LoopbackDriverContext *context;
+
+   //Debug message
+   TRACE_INFO("Initializing loopback driver...\r\n");
+
+   //Point to the driver context
+   context = &loopbackDriverContext[interface->index];
+
+   //The receive queue is empty
+   context->writeIndex = 0;
+   context->readIndex = 0;
+   context->count = 0;
+
+   //Clear statistics
+   memset(&context->stats, 0, sizeof(LoopbackDriverStats));
+
+   //Accept any packets from the upper layer
+   osSetEvent(&interface->nicTxEvent);
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Loopback driver timer handler
+ * @param[in] interface Underlying network interface
+ **/
+
+void loopbackDriverTick(NetInterface *interface)
+{
+   //Not implemented
+}
+
+
+/**
+ * @brief Enable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void loopbackDriverEnableIrq(NetInterface *interface)
+{
+   //Not implemented
+}
+
+
+/**
+ * @brief Disable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void loopbackDriverDisableIrq(NetInterface *interface)
+{
+   //Not implemented
+}
+
+
+/**
+ * @brief Loopback driver event handler
+ *
+ * The frames queued by the peer interface are passed to the upper layer,
+ * which may keep the memory pool blocks that hold them
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void loopbackDriverEventHandler(NetInterface *interface)
+{
+   LoopbackDriverPacket *packet;
+   LoopbackDriverContext *context;
+
+   //Point to the driver context
+   context = &loopbackDriverContext[interface->index];
+
+   //Process all pending packets
+   while(context->count > 0)
+   {
+      //Point to the oldest packet
+      packet = &context->queue[context->readIndex];
+
+      //Pass the packet to the upper layer, which may keep the buffer
+      if(nicProcessLoanablePacket(interface, packet->data, packet->length,
+         LOOPBACK_DRIVER_MAX_PACKET_SIZE))
+      {
+         //The buffer now belongs to the upper layer
+         context->stats.loanCount++;
+      }
+      else
+      {
+         //Release the buffer
+         memPoolFree(packet->data);
+      }
+
+      //Release the current packet descriptor
+      packet->data = NULL;
+      packet->length = 0;
+
+      //Point to the next packet descriptor
+      context->readIndex = (context->readIndex + 1) % LOOPBACK_DRIVER_QUEUE_SIZE;
+      context->count--;
+   }
+}
+
+
+/**
+ * @brief Send a packet
+ *
+ * The frame is copied to a memory pool block and queued on the peer
+ * interface, whose event handler delivers it during the next pass of
+ * the TCP/IP stack task
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+error_t loopbackDriverSendPacket(NetInterface *interface,
+   const NetBuffer *buffer, size_t offset)
+{
+   size_t length;
+   uint8_t *p;
+   LoopbackDriverPacket *packet;
+   LoopbackDriverContext *context;
+   LoopbackDriverContext *peerContext;
+
+   //Point to the driver context
+   context = &loopbackDriverContext[interface->index];
+
+   //The transmitter can accept another packet
+   osSetEvent(&interface->nicTxEvent);
+
+   //Retrieve the length of the packet
+   length = netBufferGetLength(buffer) - offset;
+
+   //Check the frame length
+   if(length > LOOPBACK_DRIVER_MAX_PACKET_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //Make sure the interface is connected to a peer
+   if(context->peer == NULL)
+      return ERROR_FAILURE;
+
+   //Point to the context of the peer interface
+   peerContext = &loopbackDriverContext[context->peer->index];
+
+   //Total number of frames sent
+   context->stats.txPacketCount++;
+
+   //Allocate a buffer from the memory pool
+   p = memPoolAlloc(LOOPBACK_DRIVER_MAX_PACKET_SIZE);
+   //Failed to allocate memory?
+   if(p == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Copy the frame
+   netBufferRead(p, buffer, offset, length);
+
+   //Let the loss hook drop the frame, as a lossy link would do
+   if(context->lossHook != NULL &&
+      context->lossHook(interface, p, length, context->lossParam))
+   {
+      //The frame is silently lost
+      context->stats.lostCount++;
+      memPoolFree(p);
+      return NO_ERROR;
+   }
+
+   //The receive queue of the peer is full?
+   if(peerContext->count >= LOOPBACK_DRIVER_QUEUE_SIZE)
+   {
+      //The frame is dropped, as a real controller would do
+      context->stats.overflowCount++;
+      memPoolFree(p);
+      return NO_ERROR;
+   }
+
+   //Queue the frame on the peer interface
+   packet = &peerContext->queue[peerContext->writeIndex];
+   packet->data = p;
+   packet->length = length;
+
+   //Point to the next packet descriptor
+   peerContext->writeIndex = (peerContext->writeIndex + 1) % LOOPBACK_DRIVER_QUEUE_SIZE;
+   peerContext->count++;
+
+   //Notify the TCP/IP stack of the incoming frame
+   context->peer->nicEvent = TRUE;
+   osSetEvent(&netEvent);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Configure multicast MAC address filtering
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t loopbackDriverSetMulticastFilter(NetInterface *interface)
+{
+   //Every frame is delivered to the peer interface
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Connect two interfaces that use the loopback driver
+ *
+ * Each frame sent over one interface is received by the other one. This
+ * function must be called before the interfaces are configured
+ *
+ * @param[in] interface1 First network interface
+ * @param[in] interface2 Second network interface
+ **/
+
+void loopbackDriverConnect(NetInterface *interface1, NetInterface *interface2)
+{
+   //Pair the interfaces
+   loopbackDriverContext[interface1->index].peer = interface2;
+   loopbackDriverContext[interface2->index].peer = interface1;
+}
+
+
+/**
+ * @brief Register a hook deciding which frames are lost
+ * @param[in] interface Sending interface the hook applies to
+ * @param[in] hook Loss hook (NULL to disable losses)
+ * @param[in] param Opaque pointer passed to the hook
+ **/
+
+void loopbackDriverSetLossHook(NetInterface *interface,
+   LoopbackDriverLossHook hook, void *param)
+{
+   LoopbackDriverContext *context;
+
+   //Point to the driver context
+   context = &loopbackDriverContext[interface->index];
+
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
+   //Save the hook
+   context->lossHook = hook;
+   context->lossParam = param;
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+}
+
+
+/**
+ * @brief Get the statistics of an interface
+ * @param[in] interface Underlying network interface
+ * @param[out] stats Copy of the statistics
+ **/
+
+void loopbackDriverGetStats(NetInterface *interface, LoopbackDriverStats *stats)
+{
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
+   //Copy statistics
+   *stats = loopbackDriverContext[interface->index].stats;
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+}
@@ -0,0 +1,117 @@
+/**
+ * @file loopback_driver.h
+ * @brief Loopback driver connecting two network interfaces
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8a
+ **/
+
+#ifndef _LOOPBACK_DRIVER_H
+#define _LOOPBACK_DRIVER_H
+
+//Dependencies
+#include "core/nic.h"
+
+//Maximum packet size
+#ifndef LOOPBACK_DRIVER_MAX_PACKET_SIZE
+   #define LOOPBACK_DRIVER_MAX_PACKET_SIZE 1536
+#elif (LOOPBACK_DRIVER_MAX_PACKET_SIZE < 1)
+   #error LOOPBACK_DRIVER_MAX_PACKET_SIZE parameter is not valid
+#endif
+
+//Maximum number of packets in the receive queue
+#ifndef LOOPBACK_DRIVER_QUEUE_SIZE
+   #define LOOPBACK_DRIVER_QUEUE_SIZE 64
+#elif (LOOPBACK_DRIVER_QUEUE_SIZE < 1)
+   #error LOOPBACK_DRIVER_QUEUE_SIZE parameter is not valid
+#endif
+
+//Received packets are held in memory pool blocks
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED && NET_MEM_POOL_SUPPORT == ENABLED)
+   #if (NET_MEM_POOL_BUFFER_SIZE < LOOPBACK_DRIVER_MAX_PACKET_SIZE)
+      #error NET_MEM_POOL_BUFFER_SIZE is too small for zero-copy receive
+   #endif
+#endif
+
+//C++ guard
+#ifdef __cplusplus
+   extern "C" {
+#endif
+
+
+/**
+ * @brief Loss hook
+ *
+ * The hook is invoked for every frame sent over the interface. The frame
+ * is dropped when the hook returns TRUE. Otherwise it is delivered as the
+ * hook left it, so that the hook can also alter the frame
+ **/
+
+typedef bool_t (*LoopbackDriverLossHook)(NetInterface *interface,
+   uint8_t *frame, size_t length, void *param);
+
+
+/**
+ * @brief Loopback driver statistics
+ **/
+
+typedef struct
+{
+   uint_t txPacketCount; ///<Frames sent over the interface
+   uint_t lostCount;     ///<Frames dropped by the loss hook
+   uint_t overflowCount; ///<Frames dropped because the peer queue was full
+   uint_t loanCount;     ///<Receive buffers kept by the upper layers
+} LoopbackDriverStats;
+
+
+//Loopback driver
+extern const NicDriver loopbackDriver;
+
+//Loopback driver related functions
+error_t loopbackDriverInit(NetInterface *interface);
+
+void loopbackDriverTick(NetInterface *interface);
+
+void loopbackDriverEnableIrq(NetInterface *interface);
+void loopbackDriverDisableIrq(NetInterface *interface);
+
+void loopbackDriverEventHandler(NetInterface *interface);
+
+error_t loopbackDriverSendPacket(NetInterface *interface,
+   const NetBuffer *buffer, size_t offset);
+
+error_t loopbackDriverSetMulticastFilter(NetInterface *interface);
+
+void loopbackDriverConnect(NetInterface *interface1, NetInterface *interface2);
+
+void loopbackDriverSetLossHook(NetInterface *interface,
+   LoopbackDriverLossHook hook, void *param);
+
+void loopbackDriverGetStats(NetInterface *interface, LoopbackDriverStats *stats);
+
+//C++ guard
+#ifdef __cplusplus
+   }
+#endif
+
+#endif
@@ -32,6 +32,11 @@
 //Dependencies
 #include <stdlib.h>
 #include "core/net.h"
+#include "core/ip.h"
+#include "core/tcp.h"
+#include "core/udp.h"
+#include "ipv4/ipv4.h"
+#include "ipv4/icmp.h"
 #include "drivers/pcap_driver.h"
 #include "debug.h"
 
@@ -56,7 +61,11 @@
 typedef struct
 {
    size_t length;
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   uint8_t *data;
+#else
    uint8_t data[PCAP_DRIVER_MAX_PACKET_SIZE];
+#endif
 } PcapDriverPacket;
 
 
@@ -94,7 +103,35 @@ const NicDriver pcapDriver =
    TRUE,
    TRUE,
    TRUE,
+   TRUE,
+#if (PCAP_DRIVER_CHECKSUM_OFFLOAD == ENABLED)
+   TRUE,
+   TRUE,
+   FALSE,
+   FALSE,
+   TRUE,
+   TRUE,
+   TRUE,
+   TRUE,
+   TRUE,
+   TRUE,
+#else
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+#endif
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
    TRUE
+#else
+   FALSE
+#endif
 };
 
 
@@ -361,9 +398,20 @@ void pcapDriverEventHandler(NetInterface *interface)
    //Process all pending packets
    while(context->queue[context->readIndex].length > 0)
    {
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+      //Pass the packet to the upper layer, which may keep the buffer
+      if(nicProcessLoanablePacket(interface, context->queue[context->readIndex].data,
+         context->queue[context->readIndex].length, PCAP_DRIVER_MAX_PACKET_SIZE))
+      {
+         //The buffer now belongs to the upper layer. A new one will be
+         //allocated when the packet descriptor is reused
+         context->queue[context->readIndex].data = NULL;
+      }
+#else
       //Pass the packet to the upper layer
       nicProcessPacket(interface, context->queue[context->readIndex].data,
          context->queue[context->readIndex].length);
+#endif
 
       //Compute the index of the next packet descriptor
       n = (context->readIndex + 1) % PCAP_DRIVER_QUEUE_SIZE;
@@ -410,6 +458,11 @@ error_t pcapDriverSendPacket(NetInterface *interface,
    //Copy the packet to the transmit buffer
    netBufferRead(temp, buffer, offset, length);
 
+#if (PCAP_DRIVER_CHECKSUM_OFFLOAD == ENABLED)
+   //Emulate the transmit checksum offload engine
+   pcapDriverProcessChecksum(temp, length, TRUE);
+#endif
+
    //Send packet
    ret = pcap_sendpacket(context->handle, temp, length);
 
@@ -437,6 +490,120 @@ error_t pcapDriverSetMulticastFilter(NetInterface *interface)
 }
 
 
+/**
+ * @brief Emulate the checksum offload engine of a NIC
+ *
+ * The IPv4 header checksum and the TCP, UDP or ICMP checksum of unfragmented
+ * datagrams are either inserted or verified, as a real controller would do
+ *
+ * @param[in,out] frame Pointer to the Ethernet frame
+ * @param[in] length Length of the frame, in bytes
+ * @param[in] insert TRUE to insert the checksums, FALSE to verify them
+ * @return Error code
+ **/
+
+error_t pcapDriverProcessChecksum(uint8_t *frame, size_t length, bool_t insert)
+{
+   size_t n;
+   uint8_t *payload;
+   uint8_t *checksum;
+   uint16_t value;
+   EthHeader *ethHeader;
+   Ipv4Header *ipHeader;
+   Ipv4PseudoHeader pseudoHeader;
+
+   //Point to the Ethernet header
+   ethHeader = (EthHeader *) frame;
+
+   //Only IPv4 packets are processed by the checksum offload engine
+   if(length < (sizeof(EthHeader) + sizeof(Ipv4Header)))
+      return NO_ERROR;
+   if(ethHeader->type != htons(ETH_TYPE_IPV4))
+      return NO_ERROR;
+
+   //Point to the IPv4 header
+   ipHeader = (Ipv4Header *) ethHeader->data;
+   //Retrieve the length of the header
+   n = ipHeader->headerLength * 4;
+
+   //Malformed packets are bypassed
+   if(ipHeader->version != IPV4_VERSION || n < sizeof(Ipv4Header))
+      return NO_ERROR;
+   if(ntohs(ipHeader->totalLength) < n)
+      return NO_ERROR;
+   if(ntohs(ipHeader->totalLength) > (length - sizeof(EthHeader)))
+      return NO_ERROR;
+
+   //Insert or verify the IPv4 header checksum
+   if(insert)
+   {
+      ipHeader->headerChecksum = 0;
+      ipHeader->headerChecksum = ipCalcChecksum(ipHeader, n);
+   }
+   else if(ipCalcChecksum(ipHeader, n) != 0x0000)
+   {
+      return ERROR_WRONG_CHECKSUM;
+   }
+
+   //Fragmented packets are bypassed
+   if(ntohs(ipHeader->fragmentOffset) & (IPV4_FLAG_MF | IPV4_OFFSET_MASK))
+      return NO_ERROR;
+
+   //Point to the payload
+   payload = (uint8_t *) ipHeader + n;
+   //Compute the length of the payload
+   n = ntohs(ipHeader->totalLength) - n;
+
+   //Check the protocol field
+   if(ipHeader->protocol == IPV4_PROTOCOL_ICMP && n >= sizeof(IcmpHeader))
+      checksum = payload + offsetof(IcmpHeader, checksum);
+   else if(ipHeader->protocol == IPV4_PROTOCOL_TCP && n >= sizeof(TcpHeader))
+      checksum = payload + offsetof(TcpHeader, checksum);
+   else if(ipHeader->protocol == IPV4_PROTOCOL_UDP && n >= sizeof(UdpHeader))
+      checksum = payload + offsetof(UdpHeader, checksum);
+   else
+      return NO_ERROR;
+
+   //An all zero UDP checksum means that the transmitter generated no checksum
+   if(ipHeader->protocol == IPV4_PROTOCOL_UDP && !insert &&
+      checksum[0] == 0 && checksum[1] == 0)
+   {
+      return NO_ERROR;
+   }
+
+   //Clear the checksum field before computing the checksum
+   if(insert)
+      memset(checksum, 0, sizeof(uint16_t));
+
+   //Form the IPv4 pseudo header
+   pseudoHeader.srcAddr = ipHeader->srcAddr;
+   pseudoHeader.destAddr = ipHeader->destAddr;
+   pseudoHeader.reserved = 0;
+   pseudoHeader.protocol = ipHeader->protocol;
+   pseudoHeader.length = htons(n);
+
+   //The ICMP checksum does not cover any pseudo header
+   if(ipHeader->protocol == IPV4_PROTOCOL_ICMP)
+      value = ipCalcChecksum(payload, n);
+   else
+      value = ipCalcUpperLayerChecksum(&pseudoHeader, sizeof(Ipv4PseudoHeader), payload, n);
+
+   //Verify the checksum?
+   if(!insert)
+      return (value == 0x0000) ? NO_ERROR : ERROR_WRONG_CHECKSUM;
+
+   //A computed UDP checksum of zero is transmitted as all ones
+   if(ipHeader->protocol == IPV4_PROTOCOL_UDP && value == 0x0000)
+      value = 0xFFFF;
+
+   //Insert the checksum
+   memcpy(checksum, &value, sizeof(uint16_t));
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief PCAP receive task
  * @param[in] interface Underlying network interface
@@ -478,8 +645,32 @@ void pcapDriverTask(NetInterface *interface)
                //Ensure the receive queue is not full
                if(n != context->readIndex)
                {
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+                  //The packet is captured directly into a buffer that may
+                  //later be loaned to the upper layer
+                  if(context->queue[context->writeIndex].data == NULL)
+                  {
+                     context->queue[context->writeIndex].data =
+                        memPoolAlloc(PCAP_DRIVER_MAX_PACKET_SIZE);
+                  }
+
+                  //Failed to allocate memory?
+                  if(context->queue[context->writeIndex].data == NULL)
+                     continue;
+#endif
                   //Copy the incoming packet
                   memcpy(context->queue[context->writeIndex].data, data, length);
+
+#if (PCAP_DRIVER_CHECKSUM_OFFLOAD == ENABLED)
+                  //Emulate the receive checksum offload engine (frames
+                  //with a bad checksum are silently dropped)
+                  if(pcapDriverProcessChecksum(context->queue[context->writeIndex].data,
+                     length, FALSE))
+                  {
+                     continue;
+                  }
+#endif
+
                   //Save the length of the packet
                   context->queue[context->writeIndex].length = length;
 
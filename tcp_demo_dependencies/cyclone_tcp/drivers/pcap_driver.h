@@ -53,6 +53,13 @@
    #error PCAP_DRIVER_TIMEOUT parameter is not valid
 #endif
 
+//Checksum offload emulation
+#ifndef PCAP_DRIVER_CHECKSUM_OFFLOAD
+   #define PCAP_DRIVER_CHECKSUM_OFFLOAD DISABLED
+#elif (PCAP_DRIVER_CHECKSUM_OFFLOAD != ENABLED && PCAP_DRIVER_CHECKSUM_OFFLOAD != DISABLED)
+   #error PCAP_DRIVER_CHECKSUM_OFFLOAD parameter is not valid
+#endif
+
 //C++ guard
 #ifdef __cplusplus
    extern "C" {
@@ -76,6 +83,8 @@ error_t pcapDriverSendPacket(NetInterface *interface,
 
 error_t pcapDriverSetMulticastFilter(NetInterface *interface);
 
+error_t pcapDriverProcessChecksum(uint8_t *frame, size_t length, bool_t insert);
+
 void pcapDriverTask(NetInterface *interface);
 
 //C++ guard
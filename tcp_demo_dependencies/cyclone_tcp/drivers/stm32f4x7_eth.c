@@ -33,42 +33,66 @@
 #include "stm32f4xx.h"
 #include "core/net.h"
 #include "drivers/stm32f4x7_eth.h"
+#include "mibs/mib2_module.h"
+#include "mibs/if_mib_module.h"
 #include "debug.h"
 
 //Underlying network interface
 static NetInterface *nicDriverInterface;
+//Interrupt and polling statistics
+static Stm32f4x7EthStats nicStats;
 
 //IAR EWARM compiler?
 #if defined(__ICCARM__)
 
-//Transmit buffer
+//Transmit buffer (not needed when zero-copy transmit is used)
+#if (NET_ZERO_COPY_TX_SUPPORT == DISABLED)
 #pragma data_alignment = 4
+#ifdef STM32F4X7_ETH_RAM_SECTION
+#pragma location = STM32F4X7_ETH_RAM_SECTION
+#endif
 static uint8_t txBuffer[STM32F4X7_ETH_TX_BUFFER_COUNT][STM32F4X7_ETH_TX_BUFFER_SIZE];
-//Receive buffer
+#endif
+//Receive buffer (allocated from the memory pool when zero-copy receive is used)
+#if (NET_ZERO_COPY_RX_SUPPORT == DISABLED)
 #pragma data_alignment = 4
+#ifdef STM32F4X7_ETH_RAM_SECTION
+#pragma location = STM32F4X7_ETH_RAM_SECTION
+#endif
 static uint8_t rxBuffer[STM32F4X7_ETH_RX_BUFFER_COUNT][STM32F4X7_ETH_RX_BUFFER_SIZE];
+#endif
 //Transmit DMA descriptors
 #pragma data_alignment = 4
+#ifdef STM32F4X7_ETH_RAM_SECTION
+#pragma location = STM32F4X7_ETH_RAM_SECTION
+#endif
 static Stm32f4x7TxDmaDesc txDmaDesc[STM32F4X7_ETH_TX_BUFFER_COUNT];
 //Receive DMA descriptors
 #pragma data_alignment = 4
+#ifdef STM32F4X7_ETH_RAM_SECTION
+#pragma location = STM32F4X7_ETH_RAM_SECTION
+#endif
 static Stm32f4x7RxDmaDesc rxDmaDesc[STM32F4X7_ETH_RX_BUFFER_COUNT];
 
 //Keil MDK-ARM or GCC compiler?
 #else
 
-//Transmit buffer
+//Transmit buffer (not needed when zero-copy transmit is used)
+#if (NET_ZERO_COPY_TX_SUPPORT == DISABLED)
 static uint8_t txBuffer[STM32F4X7_ETH_TX_BUFFER_COUNT][STM32F4X7_ETH_TX_BUFFER_SIZE]
-   __attribute__((aligned(4)));
-//Receive buffer
+   __attribute__((aligned(4))) STM32F4X7_ETH_RAM_ATTRIBUTE;
+#endif
+//Receive buffer (allocated from the memory pool when zero-copy receive is used)
+#if (NET_ZERO_COPY_RX_SUPPORT == DISABLED)
 static uint8_t rxBuffer[STM32F4X7_ETH_RX_BUFFER_COUNT][STM32F4X7_ETH_RX_BUFFER_SIZE]
-   __attribute__((aligned(4)));
+   __attribute__((aligned(4))) STM32F4X7_ETH_RAM_ATTRIBUTE;
+#endif
 //Transmit DMA descriptors
 static Stm32f4x7TxDmaDesc txDmaDesc[STM32F4X7_ETH_TX_BUFFER_COUNT]
-   __attribute__((aligned(4)));
+   __attribute__((aligned(4))) STM32F4X7_ETH_RAM_ATTRIBUTE;
 //Receive DMA descriptors
 static Stm32f4x7RxDmaDesc rxDmaDesc[STM32F4X7_ETH_RX_BUFFER_COUNT]
-   __attribute__((aligned(4)));
+   __attribute__((aligned(4))) STM32F4X7_ETH_RAM_ATTRIBUTE;
 
 #endif
 
@@ -77,6 +101,20 @@ static Stm32f4x7TxDmaDesc *txCurDmaDesc;
 //Pointer to the current RX DMA descriptor
 static Stm32f4x7RxDmaDesc *rxCurDmaDesc;
 
+//Zero-copy receive?
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+//Buffer used to replace a receive buffer kept by the upper layers
+static uint8_t *rxSpareBuffer;
+#endif
+
+//Zero-copy transmit?
+#if (NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+//Bookkeeping of the TX DMA descriptors
+static NicTxRing txRing;
+//Memory pool references held by each TX DMA descriptor (buffer 1 and 2)
+static void *txHeldBuffer[STM32F4X7_ETH_TX_BUFFER_COUNT][2];
+#endif
+
 
 /**
  * @brief STM32F407/417/427/437 Ethernet MAC driver
@@ -99,7 +137,35 @@ const NicDriver stm32f4x7EthDriver =
    TRUE,
    TRUE,
    TRUE,
+   FALSE,
+#if (STM32F4X7_ETH_CHECKSUM_OFFLOAD == ENABLED)
+   TRUE,
+   TRUE,
+   FALSE,
+   FALSE,
+   TRUE,
+   TRUE,
+   TRUE,
+   TRUE,
+   TRUE,
+   TRUE,
+#else
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+#endif
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   TRUE
+#else
    FALSE
+#endif
 };
 
 
@@ -156,8 +222,14 @@ error_t stm32f4x7EthInit(NetInterface *interface)
    if(error)
       return error;
 
+#if (STM32F4X7_ETH_CHECKSUM_OFFLOAD == ENABLED)
+   //Use default MAC configuration and enable the receive checksum offload
+   //engine (frames with a bad IPv4 header or payload checksum are dropped)
+   ETH->MACCR = ETH_MACCR_ROD | ETH_MACCR_IPCO;
+#else
    //Use default MAC configuration
    ETH->MACCR = ETH_MACCR_ROD;
+#endif
 
    //Set the MAC address
    ETH->MACA0LR = interface->macAddr.w[0] | (interface->macAddr.w[1] << 16);
@@ -171,7 +243,8 @@ error_t stm32f4x7EthInit(NetInterface *interface)
    ETH->MACFFR = ETH_MACFFR_HPF | ETH_MACFFR_HM;
    //Disable flow control
    ETH->MACFCR = 0;
-   //Enable store and forward mode
+   //Enable store and forward mode (required by the transmit checksum
+   //offload engine, which needs the whole frame to insert the checksums)
    ETH->DMAOMR = ETH_DMAOMR_RSF | ETH_DMAOMR_TSF;
 
    //Configure DMA bus mode
@@ -179,7 +252,10 @@ error_t stm32f4x7EthInit(NetInterface *interface)
       ETH_DMABMR_RTPR_1_1 | ETH_DMABMR_PBL_1Beat | ETH_DMABMR_EDE;
 
    //Initialize DMA descriptor lists
-   stm32f4x7EthInitDmaDesc(interface);
+   error = stm32f4x7EthInitDmaDesc(interface);
+   //Failed to allocate receive buffers?
+   if(error)
+      return error;
 
    //Prevent interrupts from being generated when the transmit statistic
    //counters reach half their maximum value
@@ -670,15 +746,50 @@ void stm32f4x7EthInitGpio(NetInterface *interface)
  * @param[in] interface Underlying network interface
  **/
 
-void stm32f4x7EthInitDmaDesc(NetInterface *interface)
+error_t stm32f4x7EthInitDmaDesc(NetInterface *interface)
 {
    uint_t i;
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   uint8_t *p;
+#endif
 
+#if (NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+   //Initialize TX DMA descriptor list
+   for(i = 0; i < STM32F4X7_ETH_TX_BUFFER_COUNT; i++)
+   {
+      //Use ring structure so that both buffers of a descriptor can be used
+      txDmaDesc[i].tdes0 = 0;
+      //Initialize transmit buffer sizes
+      txDmaDesc[i].tdes1 = 0;
+      //Transmit buffer addresses are set on a per-frame basis
+      txDmaDesc[i].tdes2 = 0;
+      txDmaDesc[i].tdes3 = 0;
+      //Reserved fields
+      txDmaDesc[i].tdes4 = 0;
+      txDmaDesc[i].tdes5 = 0;
+      //Transmit frame time stamp
+      txDmaDesc[i].tdes6 = 0;
+      txDmaDesc[i].tdes7 = 0;
+   }
+
+   //The last descriptor of the ring
+   txDmaDesc[i - 1].tdes0 = ETH_TDES0_TER;
+   //Point to the very first descriptor
+   txCurDmaDesc = &txDmaDesc[0];
+
+   //All the descriptors are available
+   nicTxRingInit(&txRing, txHeldBuffer, STM32F4X7_ETH_TX_BUFFER_COUNT);
+#else
    //Initialize TX DMA descriptor list
    for(i = 0; i < STM32F4X7_ETH_TX_BUFFER_COUNT; i++)
    {
       //Use chain structure rather than ring structure
       txDmaDesc[i].tdes0 = ETH_TDES0_IC | ETH_TDES0_TCH;
+#if (STM32F4X7_ETH_CHECKSUM_OFFLOAD == ENABLED)
+      //Insert IPv4 header checksum and TCP/UDP/ICMP checksum (including
+      //the pseudo header) in hardware
+      txDmaDesc[i].tdes0 |= ETH_TDES0_CIC;
+#endif
       //Initialize transmit buffer size
       txDmaDesc[i].tdes1 = 0;
       //Transmit buffer address
@@ -697,16 +808,28 @@ void stm32f4x7EthInitDmaDesc(NetInterface *interface)
    txDmaDesc[i - 1].tdes3 = (uint32_t) &txDmaDesc[0];
    //Point to the very first descriptor
    txCurDmaDesc = &txDmaDesc[0];
+#endif
 
    //Initialize RX DMA descriptor list
    for(i = 0; i < STM32F4X7_ETH_RX_BUFFER_COUNT; i++)
    {
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+      //Receive buffers may be kept by the upper layers
+      p = memPoolAlloc(STM32F4X7_ETH_RX_BUFFER_SIZE);
+      //Failed to allocate memory?
+      if(p == NULL)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Receive buffer address
+      rxDmaDesc[i].rdes2 = (uint32_t) p;
+#else
+      //Receive buffer address
+      rxDmaDesc[i].rdes2 = (uint32_t) rxBuffer[i];
+#endif
       //The descriptor is initially owned by the DMA
       rxDmaDesc[i].rdes0 = ETH_RDES0_OWN;
       //Use chain structure rather than ring structure
       rxDmaDesc[i].rdes1 = ETH_RDES1_RCH | (STM32F4X7_ETH_RX_BUFFER_SIZE & ETH_RDES1_RBS1);
-      //Receive buffer address
-      rxDmaDesc[i].rdes2 = (uint32_t) rxBuffer[i];
       //Next descriptor address
       rxDmaDesc[i].rdes3 = (uint32_t) &rxDmaDesc[i + 1];
       //Extended status
@@ -727,6 +850,14 @@ void stm32f4x7EthInitDmaDesc(NetInterface *interface)
    ETH->DMATDLAR = (uint32_t) txDmaDesc;
    //Start location of the RX descriptor list
    ETH->DMARDLAR = (uint32_t) rxDmaDesc;
+
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   //Allocate a replacement buffer
+   rxSpareBuffer = memPoolAlloc(STM32F4X7_ETH_RX_BUFFER_SIZE);
+#endif
+
+   //Successful initialization
+   return NO_ERROR;
 }
 
 
@@ -741,6 +872,14 @@ void stm32f4x7EthInitDmaDesc(NetInterface *interface)
 
 void stm32f4x7EthTick(NetInterface *interface)
 {
+   //Collect the missed frame and overflow counters
+   stm32f4x7EthUpdateStats(interface);
+
+#if (NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+   //Release the buffers of the frames that have been transmitted
+   stm32f4x7EthReclaimTxDesc(interface);
+#endif
+
    //Handle periodic operations
    interface->phyDriver->tick(interface);
 }
@@ -792,6 +931,9 @@ void ETH_IRQHandler(void)
    //Read DMA status register
    status = ETH->DMASR;
 
+   //Update statistics
+   nicStats.irqCount++;
+
    //A packet has been transmitted?
    if(status & ETH_DMASR_TS)
    {
@@ -809,7 +951,11 @@ void ETH_IRQHandler(void)
    //A packet has been received?
    if(status & ETH_DMASR_RS)
    {
-      //Disable RIE interrupt
+      //Update statistics
+      nicStats.rxIrqCount++;
+
+      //Disable RIE interrupt (the interrupt remains masked until the
+      //event handler has processed the RX ring)
       ETH->DMAIER &= ~ETH_DMAIER_RIE;
 
       //Set event flag
@@ -834,7 +980,30 @@ void ETH_IRQHandler(void)
 void stm32f4x7EthEventHandler(NetInterface *interface)
 {
    error_t error;
+#if (STM32F4X7_ETH_RX_POLLING_SUPPORT == ENABLED)
+   uint_t n;
+
+   //A deferred pass is not triggered by the RS flag, so the ring must be
+   //checked even if the flag is not set
+   ETH->DMASR = ETH_DMASR_RS;
+
+   //Update statistics
+   nicStats.pollCount++;
+
+   //Process at most STM32F4X7_ETH_RX_POLL_BUDGET packets
+   for(n = 0; n < STM32F4X7_ETH_RX_POLL_BUDGET; n++)
+   {
+      //Read incoming packet
+      error = stm32f4x7EthReceivePacket(interface);
 
+      //No more data in the receive buffer?
+      if(error == ERROR_BUFFER_EMPTY)
+         break;
+
+      //Update statistics
+      nicStats.rxPacketCount++;
+   }
+#else
    //Packet received?
    if(ETH->DMASR & ETH_DMASR_RS)
    {
@@ -847,9 +1016,36 @@ void stm32f4x7EthEventHandler(NetInterface *interface)
          //Read incoming packet
          error = stm32f4x7EthReceivePacket(interface);
 
+         //Update statistics
+         if(error != ERROR_BUFFER_EMPTY)
+            nicStats.rxPacketCount++;
+
          //No more data in the receive buffer?
       } while(error != ERROR_BUFFER_EMPTY);
    }
+#endif
+
+#if (NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+   //Release the buffers of the frames that have been transmitted
+   stm32f4x7EthReclaimTxDesc(interface);
+#endif
+
+   //Collect the missed frame and overflow counters before they wrap
+   stm32f4x7EthUpdateStats(interface);
+
+#if (STM32F4X7_ETH_RX_POLLING_SUPPORT == ENABLED)
+   //The budget has been exhausted before the RX ring was drained?
+   if(n >= STM32F4X7_ETH_RX_POLL_BUDGET)
+   {
+      //Update statistics
+      nicStats.budgetExhaustedCount++;
+
+      //Leave the event pending without signaling it. The TCP/IP task
+      //processes the remaining packets once the other tasks have had a
+      //chance to run, unless a new packet raises RIE in the meantime
+      interface->nicEvent = TRUE;
+   }
+#endif
 
    //Re-enable DMA interrupts
    ETH->DMAIER |= ETH_DMAIER_NISE | ETH_DMAIER_RIE | ETH_DMAIER_TIE;
@@ -867,7 +1063,19 @@ void stm32f4x7EthEventHandler(NetInterface *interface)
 error_t stm32f4x7EthSendPacket(NetInterface *interface,
    const NetBuffer *buffer, size_t offset)
 {
+#if (NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+   uint_t i;
+   uint_t n;
+   uint32_t tdes0;
    size_t length;
+   uint8_t *p;
+   Stm32f4x7TxDmaDesc *desc;
+
+   //Release the buffers of the frames that have been transmitted
+   stm32f4x7EthReclaimTxDesc(interface);
+#else
+   size_t length;
+#endif
 
    //Retrieve the length of the packet
    length = netBufferGetLength(buffer) - offset;
@@ -881,6 +1089,97 @@ error_t stm32f4x7EthSendPacket(NetInterface *interface,
       return ERROR_INVALID_LENGTH;
    }
 
+#if (NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+   //Make sure the current descriptor is available for writing
+   if(nicTxRingGetFreeCount(&txRing) == 0)
+      return ERROR_FAILURE;
+
+   //Attach the chunks of the multi-part buffer to the DMA descriptors
+   n = stm32f4x7EthMapTxBuffer(buffer, offset);
+
+   //The chunks cannot be handed to the DMA?
+   if(n == 0)
+   {
+      //Allocate a buffer from the memory pool
+      p = memPoolAlloc(STM32F4X7_ETH_TX_BUFFER_SIZE);
+
+      //Failed to allocate memory?
+      if(p == NULL)
+      {
+         //The transmitter can accept another packet
+         osSetEvent(&interface->nicTxEvent);
+         //Report an error
+         return ERROR_OUT_OF_MEMORY;
+      }
+
+      //Copy user data to the transmit buffer
+      netBufferRead(p, buffer, offset, length);
+
+      //The buffer will be released when the transmission is complete
+      nicTxRingAttachBuffer(&txRing, 0, p);
+      //Transmit buffer address
+      txCurDmaDesc->tdes2 = (uint32_t) p;
+      txCurDmaDesc->tdes3 = 0;
+      //Write the number of bytes to send
+      txCurDmaDesc->tdes1 = length & ETH_TDES1_TBS1;
+
+      //The data fits in a single buffer
+      n = 1;
+   }
+
+   //Each descriptor holds up to two buffers
+   n = (n + 1) / 2;
+
+   //Set the control bits of each descriptor, starting with the last one
+   for(i = n; i > 0; i--)
+   {
+      //Point to the relevant descriptor
+      desc = &txDmaDesc[(txRing.curIndex + i - 1) % STM32F4X7_ETH_TX_BUFFER_COUNT];
+
+      //Keep the end of ring marker
+      tdes0 = desc->tdes0 & ETH_TDES0_TER;
+
+      //First segment of the frame?
+      if(i == 1)
+      {
+         tdes0 |= ETH_TDES0_FS;
+#if (STM32F4X7_ETH_CHECKSUM_OFFLOAD == ENABLED)
+         //Insert IPv4 header checksum and TCP/UDP/ICMP checksum (including
+         //the pseudo header) in hardware
+         tdes0 |= ETH_TDES0_CIC;
+#endif
+      }
+      //Last segment of the frame?
+      if(i == n)
+         tdes0 |= ETH_TDES0_LS | ETH_TDES0_IC;
+
+      //The first descriptor is handed to the DMA once the whole chain is ready
+      if(i > 1)
+         tdes0 |= ETH_TDES0_OWN;
+
+      //Update TDES0 field
+      desc->tdes0 = tdes0;
+   }
+
+   //Give the ownership of the first descriptor to the DMA
+   txCurDmaDesc->tdes0 |= ETH_TDES0_OWN;
+
+   //Clear TBUS flag to resume processing
+   ETH->DMASR = ETH_DMASR_TBUS;
+   //Instruct the DMA to poll the transmit descriptor list
+   ETH->DMATPDR = 0;
+
+   //Point to the next free descriptor
+   nicTxRingCommit(&txRing, n);
+   txCurDmaDesc = &txDmaDesc[txRing.curIndex];
+
+   //Check whether the next descriptor is available for writing
+   if(nicTxRingGetFreeCount(&txRing) > 0)
+   {
+      //The transmitter can accept another packet
+      osSetEvent(&interface->nicTxEvent);
+   }
+#else
    //Make sure the current buffer is available for writing
    if(txCurDmaDesc->tdes0 & ETH_TDES0_OWN)
       return ERROR_FAILURE;
@@ -909,12 +1208,119 @@ error_t stm32f4x7EthSendPacket(NetInterface *interface,
       //The transmitter can accept another packet
       osSetEvent(&interface->nicTxEvent);
    }
+#endif
 
    //Data successfully written
    return NO_ERROR;
 }
 
 
+//Zero-copy transmit?
+#if (NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+
+/**
+ * @brief Attach the chunks of a multi-part buffer to the free TX descriptors
+ *
+ * Each chunk is mapped onto buffer 1 or buffer 2 of a descriptor, starting
+ * with the current descriptor. A reference is taken on the memory pool
+ * block of each chunk so that the data remains valid until the DMA has
+ * transmitted the frame
+ *
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Number of DMA buffers used, or 0 if the data must be copied
+ **/
+
+uint_t stm32f4x7EthMapTxBuffer(const NetBuffer *buffer, size_t offset)
+{
+   uint_t i;
+   uint_t j;
+   size_t n;
+   uint8_t *p;
+   Stm32f4x7TxDmaDesc *desc;
+
+   //Number of DMA buffers used so far
+   j = 0;
+
+   //Loop through data chunks
+   for(i = 0; i < buffer->chunkCount; i++)
+   {
+      //Skip the beginning of the buffer
+      if(offset >= buffer->chunk[i].length)
+      {
+         offset -= buffer->chunk[i].length;
+         continue;
+      }
+
+      //Point to the first byte to be sent
+      p = (uint8_t *) buffer->chunk[i].address + offset;
+      //Number of bytes in the current chunk
+      n = buffer->chunk[i].length - offset;
+      //Process the next chunk from its beginning
+      offset = 0;
+
+      //Make sure a free descriptor is available and hold the memory
+      //pool block that contains the chunk
+      if(j >= (nicTxRingGetFreeCount(&txRing) * 2) || !memPoolHold(p))
+      {
+         //Drop the references taken so far
+         nicTxRingDetachBuffers(&txRing, j);
+         //The data must be copied to an intermediate buffer
+         return 0;
+      }
+
+      //The reference will be dropped when the transmission is complete
+      desc = &txDmaDesc[nicTxRingAttachBuffer(&txRing, j, p)];
+
+      //Even chunks use buffer 1 while odd chunks use buffer 2
+      if(!(j % 2))
+      {
+         desc->tdes2 = (uint32_t) p;
+         desc->tdes3 = 0;
+         desc->tdes1 = n & ETH_TDES1_TBS1;
+      }
+      else
+      {
+         desc->tdes3 = (uint32_t) p;
+         desc->tdes1 |= (n << 16) & ETH_TDES1_TBS2;
+      }
+
+      //Next DMA buffer
+      j++;
+   }
+
+   //Return the number of DMA buffers used
+   return j;
+}
+
+
+/**
+ * @brief Release the buffers of the frames that have been transmitted
+ * @param[in] interface Underlying network interface
+ **/
+
+void stm32f4x7EthReclaimTxDesc(NetInterface *interface)
+{
+   //Process the descriptors in the order they were handed to the DMA
+   nicTxRingReclaim(&txRing, stm32f4x7EthIsTxDescOwned);
+}
+
+
+/**
+ * @brief Check whether the DMA owns a TX descriptor
+ * @param[in] index Index of the descriptor
+ * @return TRUE if the descriptor has not yet been processed by the DMA
+ **/
+
+bool_t stm32f4x7EthIsTxDescOwned(uint_t index)
+{
+   //Check the OWN bit
+   return (txDmaDesc[index].tdes0 & ETH_TDES0_OWN) ? TRUE : FALSE;
+}
+
+#endif
+
+
 /**
  * @brief Receive a packet
  * @param[in] interface Underlying network interface
@@ -933,16 +1339,41 @@ error_t stm32f4x7EthReceivePacket(NetInterface *interface)
       if((rxCurDmaDesc->rdes0 & ETH_RDES0_FS) && (rxCurDmaDesc->rdes0 & ETH_RDES0_LS))
       {
          //Make sure no error occurred
-         if(!(rxCurDmaDesc->rdes0 & ETH_RDES0_ES))
+         if(!(rxCurDmaDesc->rdes0 & ETH_RDES0_ES) &&
+            !stm32f4x7EthCheckRxChecksum(rxCurDmaDesc, &interface->nicRxChecksumBypassed))
          {
             //Retrieve the length of the frame
             n = (rxCurDmaDesc->rdes0 & ETH_RDES0_FL) >> 16;
             //Limit the number of data to read
             n = MIN(n, STM32F4X7_ETH_RX_BUFFER_SIZE);
 
-            //Pass the packet to the upper layer
-            nicProcessPacket(interface, (uint8_t *) rxCurDmaDesc->rdes2, n);
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+            //Make sure a replacement buffer is available
+            if(rxSpareBuffer == NULL)
+               rxSpareBuffer = memPoolAlloc(STM32F4X7_ETH_RX_BUFFER_SIZE);
+
+            //The upper layer may keep the buffer only if it can be replaced
+            if(rxSpareBuffer != NULL)
+            {
+               //Pass the packet to the upper layer
+               if(nicProcessLoanablePacket(interface, (uint8_t *) rxCurDmaDesc->rdes2,
+                  n, STM32F4X7_ETH_RX_BUFFER_SIZE))
+               {
+                  //Attach the replacement buffer to the descriptor
+                  rxCurDmaDesc->rdes2 = (uint32_t) rxSpareBuffer;
+                  //A new replacement buffer will be allocated later
+                  rxSpareBuffer = NULL;
+               }
+            }
+            else
+#endif
+            {
+               //Pass the packet to the upper layer
+               nicProcessPacket(interface, (uint8_t *) rxCurDmaDesc->rdes2, n);
+            }
 
+            //The checksum status only applies to the current frame
+            interface->nicRxChecksumBypassed = FALSE;
             //Valid packet received
             error = NO_ERROR;
          }
@@ -979,6 +1410,56 @@ error_t stm32f4x7EthReceivePacket(NetInterface *interface)
 }
 
 
+/**
+ * @brief Check the status reported by the receive checksum offload engine
+ *
+ * The checksum offload engine skips the frames it cannot parse (non-IPv4
+ * frames, IP fragments, unknown payload types). Such frames are reported
+ * as bypassed so that the upper layers verify their checksums in software
+ *
+ * @param[in] desc Pointer to the current RX DMA descriptor
+ * @param[out] bypassed TRUE if the checksums have not been verified by hardware
+ * @return Error code (ERROR_WRONG_CHECKSUM if the frame must be discarded)
+ **/
+
+error_t stm32f4x7EthCheckRxChecksum(const Stm32f4x7RxDmaDesc *desc,
+   bool_t *bypassed)
+{
+#if (STM32F4X7_ETH_CHECKSUM_OFFLOAD == ENABLED)
+   //Enhanced descriptors are used, so bit 0 of RDES0 is the ESA flag. The
+   //checksum status is only valid when the extended status is available
+   if(desc->rdes0 & ETH_RDES0_ESA)
+   {
+      //IP header or payload checksum error?
+      if(desc->rdes4 & (ETH_RDES4_IPHE | ETH_RDES4_IPPE))
+      {
+         //Debug message
+         TRACE_WARNING("Wrong checksum detected by hardware!\r\n");
+         //The frame must be discarded
+         return ERROR_WRONG_CHECKSUM;
+      }
+
+      //The IPv4 header and the TCP, UDP or ICMP payload have been verified
+      //unless the engine was bypassed or did not recognize the payload
+      *bypassed = (!(desc->rdes4 & ETH_RDES4_IPV4PR) ||
+         (desc->rdes4 & ETH_RDES4_IPCB) || !(desc->rdes4 & ETH_RDES4_IPPT)) ?
+         TRUE : FALSE;
+   }
+   else
+   {
+      //No checksum status is available for this frame
+      *bypassed = TRUE;
+   }
+#else
+   //The checksums are always verified in software
+   *bypassed = FALSE;
+#endif
+
+   //No checksum error
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Configure multicast MAC address filtering
  * @param[in] interface Underlying network interface
@@ -1130,6 +1611,10 @@ uint16_t stm32f4x7EthReadPhyReg(uint8_t phyAddr, uint8_t regAddr)
 
 /**
  * @brief CRC calculation
+ *
+ * The result is the bit-reversed Ethernet FCS, as computed by the MAC
+ * for the hash filter
+ *
  * @param[in] data Pointer to the data over which to calculate the CRC
  * @param[in] length Number of bytes to process
  * @return Resulting CRC value
@@ -1137,28 +1622,61 @@ uint16_t stm32f4x7EthReadPhyReg(uint8_t phyAddr, uint8_t regAddr)
 
 uint32_t stm32f4x7EthCalcCrc(const void *data, size_t length)
 {
-   uint_t i;
-   uint_t j;
+   //The MAC shifts the CRC register in the opposite direction to the
+   //Ethernet FCS, so the same table-driven computation can be used
+   return reverseInt32(ethCalcCrc(data, length));
+}
 
-   //Point to the data over which to calculate the CRC
-   const uint8_t *p = (uint8_t *) data;
-   //CRC preset value
-   uint32_t crc = 0xFFFFFFFF;
 
-   //Loop through data
-   for(i = 0; i < length; i++)
+/**
+ * @brief Collect the missed frame and FIFO overflow counters
+ * @param[in] interface Underlying network interface
+ **/
+
+void stm32f4x7EthUpdateStats(NetInterface *interface)
+{
+   uint32_t value;
+   uint32_t missed;
+   uint32_t overflow;
+
+   //Read the counters (the register is cleared on read)
+   value = ETH->DMAMFBOCR;
+
+   //Frames missed by the controller because no RX descriptor was available
+   missed = value & ETH_DMAMFBOCR_MFC;
+   //Frames missed because of an RX FIFO overflow
+   overflow = (value & ETH_DMAMFBOCR_MFA) >> 17;
+
+   //The counter has overflowed since the last read?
+   if(value & ETH_DMAMFBOCR_OMFC)
+      missed += (ETH_DMAMFBOCR_MFC + 1);
+   //The counter has overflowed since the last read?
+   if(value & ETH_DMAMFBOCR_OFOC)
+      overflow += (ETH_DMAMFBOCR_MFA >> 17) + 1;
+
+   //Any frame missed?
+   if(missed > 0 || overflow > 0)
    {
-      //The message is processed bit by bit
-      for(j = 0; j < 8; j++)
-      {
-         //Update CRC value
-         if(((crc >> 31) ^ (p[i] >> j)) & 0x01)
-            crc = (crc << 1) ^ 0x04C11DB7;
-         else
-            crc = crc << 1;
-      }
+      //Update statistics
+      nicStats.missedFrameCount += missed;
+      nicStats.fifoOverflowCount += overflow;
+
+      //Number of inbound packets which were chosen to be discarded
+      //even though no errors had been detected
+      MIB2_INC_COUNTER32(ifGroup.ifTable[interface->index].ifInDiscards, missed + overflow);
+      IF_MIB_INC_COUNTER32(ifTable[interface->index].ifInDiscards, missed + overflow);
    }
+}
+
+
+/**
+ * @brief Retrieve interrupt and polling statistics
+ * @param[out] stats Pointer to the structure that receives the statistics
+ **/
 
-   //Return CRC value
-   return ~crc;
+void stm32f4x7EthGetStats(Stm32f4x7EthStats *stats)
+{
+   //Take a snapshot of the counters (each 32-bit counter is read
+   //atomically, but the snapshot as a whole is not)
+   *stats = nicStats;
 }
@@ -32,9 +32,14 @@
 //Dependencies
 #include "core/nic.h"
 
-//Number of TX buffers
+//Number of TX buffers (number of TX descriptors when zero-copy transmit is
+//used). The rings are statically allocated and sized at compile time only
 #ifndef STM32F4X7_ETH_TX_BUFFER_COUNT
-   #define STM32F4X7_ETH_TX_BUFFER_COUNT 3
+   #if (NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+      #define STM32F4X7_ETH_TX_BUFFER_COUNT 16
+   #else
+      #define STM32F4X7_ETH_TX_BUFFER_COUNT 3
+   #endif
 #elif (STM32F4X7_ETH_TX_BUFFER_COUNT < 1)
    #error STM32F4X7_ETH_TX_BUFFER_COUNT parameter is not valid
 #endif
@@ -46,7 +51,7 @@
    #error STM32F4X7_ETH_TX_BUFFER_SIZE parameter is not valid
 #endif
 
-//Number of RX buffers
+//Number of RX buffers (compile-time only, like the TX ring)
 #ifndef STM32F4X7_ETH_RX_BUFFER_COUNT
    #define STM32F4X7_ETH_RX_BUFFER_COUNT 6
 #elif (STM32F4X7_ETH_RX_BUFFER_COUNT < 1)
@@ -60,6 +65,59 @@
    #error STM32F4X7_ETH_RX_BUFFER_SIZE parameter is not valid
 #endif
 
+//Zero-copy receive requires memory pool blocks large enough for a frame
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED && NET_MEM_POOL_SUPPORT == ENABLED)
+   #if (NET_MEM_POOL_BUFFER_SIZE < STM32F4X7_ETH_RX_BUFFER_SIZE)
+      #error NET_MEM_POOL_BUFFER_SIZE is too small for zero-copy receive
+   #endif
+#endif
+
+//Zero-copy transmit relies on reference-counted memory pool blocks
+#if (NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+   #if (NET_MEM_POOL_SUPPORT == DISABLED)
+      #error NET_ZERO_COPY_TX_SUPPORT requires NET_MEM_POOL_SUPPORT
+   #elif (NET_MEM_POOL_BUFFER_SIZE < STM32F4X7_ETH_TX_BUFFER_SIZE)
+      #error NET_MEM_POOL_BUFFER_SIZE is too small for zero-copy transmit
+   #endif
+#endif
+
+//Linker section holding the DMA descriptors and buffers (the Ethernet
+//DMA cannot reach the CCM data RAM, use SRAM1/SRAM2 or FSMC memory)
+#ifdef STM32F4X7_ETH_RAM_SECTION
+   #define STM32F4X7_ETH_RAM_ATTRIBUTE __attribute__((section(STM32F4X7_ETH_RAM_SECTION)))
+#else
+   #define STM32F4X7_ETH_RAM_ATTRIBUTE
+#endif
+
+//With zero-copy receive or transmit, the DMA accesses the memory pool
+//directly. NET_MEM_POOL_RAM_SECTION must then name the same section
+#if defined(STM32F4X7_ETH_RAM_SECTION) && !defined(NET_MEM_POOL_RAM_SECTION)
+   #if (NET_ZERO_COPY_RX_SUPPORT == ENABLED || NET_ZERO_COPY_TX_SUPPORT == ENABLED)
+      #error NET_MEM_POOL_RAM_SECTION must be set to STM32F4X7_ETH_RAM_SECTION
+   #endif
+#endif
+
+//Hardware checksum offload
+#ifndef STM32F4X7_ETH_CHECKSUM_OFFLOAD
+   #define STM32F4X7_ETH_CHECKSUM_OFFLOAD DISABLED
+#elif (STM32F4X7_ETH_CHECKSUM_OFFLOAD != ENABLED && STM32F4X7_ETH_CHECKSUM_OFFLOAD != DISABLED)
+   #error STM32F4X7_ETH_CHECKSUM_OFFLOAD parameter is not valid
+#endif
+
+//Budgeted polling of the RX ring
+#ifndef STM32F4X7_ETH_RX_POLLING_SUPPORT
+   #define STM32F4X7_ETH_RX_POLLING_SUPPORT DISABLED
+#elif (STM32F4X7_ETH_RX_POLLING_SUPPORT != ENABLED && STM32F4X7_ETH_RX_POLLING_SUPPORT != DISABLED)
+   #error STM32F4X7_ETH_RX_POLLING_SUPPORT parameter is not valid
+#endif
+
+//Maximum number of packets processed per polling iteration
+#ifndef STM32F4X7_ETH_RX_POLL_BUDGET
+   #define STM32F4X7_ETH_RX_POLL_BUDGET 4
+#elif (STM32F4X7_ETH_RX_POLL_BUDGET < 1)
+   #error STM32F4X7_ETH_RX_POLL_BUDGET parameter is not valid
+#endif
+
 //Interrupt priority grouping
 #ifndef STM32F4X7_ETH_IRQ_PRIORITY_GROUPING
    #define STM32F4X7_ETH_IRQ_PRIORITY_GROUPING 3
@@ -134,6 +192,7 @@
 #define ETH_RDES0_DBE    0x00000004
 #define ETH_RDES0_CE     0x00000002
 #define ETH_RDES0_PCE    0x00000001
+#define ETH_RDES0_ESA    0x00000001
 #define ETH_RDES1_DIC    0x80000000
 #define ETH_RDES1_RBS2   0x1FFF0000
 #define ETH_RDES1_RER    0x00008000
@@ -193,13 +252,29 @@ typedef struct
 } Stm32f4x7RxDmaDesc;
 
 
+/**
+ * @brief Interrupt and polling statistics
+ **/
+
+typedef struct
+{
+   uint32_t irqCount;             ///<Number of Ethernet interrupts
+   uint32_t rxIrqCount;           ///<Number of receive interrupts
+   uint32_t pollCount;            ///<Number of RX ring polling iterations
+   uint32_t rxPacketCount;        ///<Number of packets read from the RX ring
+   uint32_t budgetExhaustedCount; ///<Number of polls that exhausted the budget
+   uint32_t missedFrameCount;     ///<Frames missed because no RX descriptor was available
+   uint32_t fifoOverflowCount;    ///<Frames missed because of an RX FIFO overflow
+} Stm32f4x7EthStats;
+
+
 //STM32F407/417/427/437 Ethernet MAC driver
 extern const NicDriver stm32f4x7EthDriver;
 
 //STM32F407/417/427/437 Ethernet MAC related functions
 error_t stm32f4x7EthInit(NetInterface *interface);
 void stm32f4x7EthInitGpio(NetInterface *interface);
-void stm32f4x7EthInitDmaDesc(NetInterface *interface);
+error_t stm32f4x7EthInitDmaDesc(NetInterface *interface);
 
 void stm32f4x7EthTick(NetInterface *interface);
 
@@ -210,7 +285,13 @@ void stm32f4x7EthEventHandler(NetInterface *interface);
 error_t stm32f4x7EthSendPacket(NetInterface *interface,
    const NetBuffer *buffer, size_t offset);
 
+uint_t stm32f4x7EthMapTxBuffer(const NetBuffer *buffer, size_t offset);
+void stm32f4x7EthReclaimTxDesc(NetInterface *interface);
+bool_t stm32f4x7EthIsTxDescOwned(uint_t index);
+
 error_t stm32f4x7EthReceivePacket(NetInterface *interface);
+error_t stm32f4x7EthCheckRxChecksum(const Stm32f4x7RxDmaDesc *desc,
+   bool_t *bypassed);
 
 error_t stm32f4x7EthSetMulticastFilter(NetInterface *interface);
 error_t stm32f4x7EthUpdateMacConfig(NetInterface *interface);
@@ -220,6 +301,9 @@ uint16_t stm32f4x7EthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
 
 uint32_t stm32f4x7EthCalcCrc(const void *data, size_t length);
 
+void stm32f4x7EthUpdateStats(NetInterface *interface);
+void stm32f4x7EthGetStats(Stm32f4x7EthStats *stats);
+
 //C++ guard
 #ifdef __cplusplus
    }
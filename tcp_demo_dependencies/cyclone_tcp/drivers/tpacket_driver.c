@@ -0,0 +1,966 @@
+/**
+ * @file tpacket_driver.c
+ * @brief Linux AF_PACKET driver (TPACKET_V3 memory-mapped rings)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The receive and transmit rings are shared with the kernel. Incoming frames
+ * are handed to the TCP/IP stack straight from the receive ring, a whole
+ * block at a time. Outgoing frames are queued in the transmit ring and
+ * handed to the kernel in batches, using a single system call. The driver
+ * requires Linux 4.11 or later and the CAP_NET_RAW capability
+ *
+ * Frames larger than TPACKET_DRIVER_MAX_PACKET_SIZE are dropped. When the
+ * stack is attached to a veth or TAP interface, segmentation offloads must
+ * be turned off on the host side of the link (ethtool -K <if> tso off gso off),
+ * otherwise bulk TCP traffic from the host arrives as super-frames
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8a
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL NIC_TRACE_LEVEL
+
+//Dependencies
+#include <stdlib.h>
+#include "core/net.h"
+#include "core/ip.h"
+#include "core/tcp.h"
+#include "core/udp.h"
+#include "ipv4/ipv4.h"
+#include "ipv6/ipv6.h"
+#include "drivers/tpacket_driver.h"
+#include "mibs/mib2_module.h"
+#include "mibs/if_mib_module.h"
+#include "debug.h"
+
+//Undefine conflicting definitions
+#undef Socket
+#undef htons
+#undef htonl
+#undef ntohs
+#undef ntohl
+#undef sleep
+#undef usleep
+
+//Linux dependencies
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+
+//Offset of the frame data within a transmit slot
+#define TPACKET_DRIVER_TX_DATA_OFFSET TPACKET_ALIGN(sizeof(struct tpacket3_hdr))
+
+//Number of frame slots in the receive ring (the receive ring uses the
+//same frame size as the transmit ring)
+#define TPACKET_DRIVER_RX_FRAME_COUNT (TPACKET_DRIVER_RX_BLOCK_COUNT * \
+   (TPACKET_DRIVER_BLOCK_SIZE / TPACKET_DRIVER_TX_FRAME_SIZE))
+
+//Number of blocks in the transmit ring
+#define TPACKET_DRIVER_TX_BLOCK_COUNT (TPACKET_DRIVER_TX_FRAME_COUNT * \
+   TPACKET_DRIVER_TX_FRAME_SIZE / TPACKET_DRIVER_BLOCK_SIZE)
+
+
+/**
+ * @brief TPACKET driver context
+ **/
+
+typedef struct
+{
+   int_t fd;
+   uint8_t *map;
+   size_t mapSize;
+   uint8_t *rxRing;
+   uint8_t *txRing;
+   uint_t rxBlockIndex;
+   uint_t txFrameIndex;
+   uint_t txPending;
+   OsEvent rxEvent;
+   MacAddr filterMacAddr;
+   uint_t rxDropCount;
+} TpacketDriverContext;
+
+
+/**
+ * @brief TPACKET driver
+ **/
+
+const NicDriver tpacketDriver =
+{
+   NIC_TYPE_ETHERNET,
+   ETH_MTU,
+   tpacketDriverInit,
+   tpacketDriverTick,
+   tpacketDriverEnableIrq,
+   tpacketDriverDisableIrq,
+   tpacketDriverEventHandler,
+   tpacketDriverSendPacket,
+   tpacketDriverSetMulticastFilter,
+   NULL,
+   NULL,
+   NULL,
+   TRUE,
+   TRUE,
+   TRUE,
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE,
+   FALSE
+};
+
+
+/**
+ * @brief TPACKET driver initialization
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t tpacketDriverInit(NetInterface *interface)
+{
+   error_t error;
+   int_t ret;
+   int_t value;
+   uint_t ifIndex;
+   struct tpacket_req3 req;
+   struct sockaddr_ll addr;
+   struct packet_mreq mreq;
+   TpacketDriverContext *context;
+#if !defined(TPACKET_DRIVER_IF_NAME)
+   uint_t i;
+   uint_t j;
+   struct if_nameindex *device;
+   struct if_nameindex *deviceList;
+#endif
+#if (NET_RTOS_SUPPORT == ENABLED)
+   OsTask *task;
+#endif
+
+   //Debug message
+   TRACE_INFO("Initializing TPACKET driver...\r\n");
+
+   //Allocate TPACKET driver context
+   context = (TpacketDriverContext *) malloc(sizeof(TpacketDriverContext));
+
+   //Failed to allocate memory?
+   if(context == NULL)
+   {
+      //Debug message
+      printf("Failed to allocate context!\r\n");
+
+      //Report an error
+      return ERROR_FAILURE;
+   }
+
+   //Attach the TPACKET driver context to the network interface
+   *((TpacketDriverContext **) interface->nicContext) = context;
+   //Clear TPACKET driver context
+   memset(context, 0, sizeof(TpacketDriverContext));
+
+   //Invalid handles
+   context->fd = -1;
+   context->map = MAP_FAILED;
+
+   //Start of exception handling block
+   do
+   {
+#if defined(TPACKET_DRIVER_IF_NAME)
+      //Retrieve the index of the host network interface
+      ifIndex = if_nametoindex(TPACKET_DRIVER_IF_NAME);
+#else
+      //Find all the devices
+      deviceList = if_nameindex();
+
+      //No network adapter found?
+      if(deviceList == NULL || deviceList[0].if_index == 0)
+      {
+         //Debug message
+         printf("No network adapter found!\r\n");
+
+         //Clean up side effects
+         if(deviceList != NULL)
+            if_freenameindex(deviceList);
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //Network adapter selection
+      while(1)
+      {
+         //Debug message
+         printf("Network adapters:\r\n");
+
+         //Loop through the list of devices
+         for(i = 0, device = deviceList; device->if_index != 0; i++, device++)
+         {
+            //Display the name of the device
+            printf("  %-2u %s\r\n", i + 1, device->if_name);
+         }
+
+         //Display message
+         printf("Select network adapter for %s interface (1-%u):", interface->name, i);
+         //Get user choice
+         scanf("%u", &j);
+
+         //Valid selection?
+         if(j >= 1 && j <= i)
+            break;
+      }
+
+      //Retrieve the index of the desired network adapter
+      ifIndex = deviceList[j - 1].if_index;
+      //Free the device list
+      if_freenameindex(deviceList);
+#endif
+
+      //Unknown network adapter?
+      if(ifIndex == 0)
+      {
+         //Debug message
+         printf("Failed to find device!\r\n");
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //Open a raw packet socket
+      context->fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+
+      //Failed to open socket?
+      if(context->fd < 0)
+      {
+         //Debug message
+         printf("Failed to open socket!\r\n");
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //Select TPACKET_V3 frame format
+      value = TPACKET_V3;
+      ret = setsockopt(context->fd, SOL_PACKET, PACKET_VERSION, &value, sizeof(value));
+
+      //Any error to report?
+      if(ret < 0)
+      {
+         //Debug message
+         printf("Failed to select TPACKET_V3!\r\n");
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //Incoming frames are stored in blocks that the kernel retires when
+      //they are full or when the timeout elapses
+      memset(&req, 0, sizeof(req));
+      req.tp_block_size = TPACKET_DRIVER_BLOCK_SIZE;
+      req.tp_block_nr = TPACKET_DRIVER_RX_BLOCK_COUNT;
+      req.tp_frame_size = TPACKET_DRIVER_TX_FRAME_SIZE;
+      req.tp_frame_nr = TPACKET_DRIVER_RX_FRAME_COUNT;
+      req.tp_retire_blk_tov = TPACKET_DRIVER_TIMEOUT;
+
+      //Set up the receive ring
+      ret = setsockopt(context->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req));
+
+      //Any error to report?
+      if(ret < 0)
+      {
+         //Debug message
+         printf("Failed to set up receive ring!\r\n");
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //Outgoing frames use fixed-size slots
+      memset(&req, 0, sizeof(req));
+      req.tp_block_size = TPACKET_DRIVER_BLOCK_SIZE;
+      req.tp_block_nr = TPACKET_DRIVER_TX_BLOCK_COUNT;
+      req.tp_frame_size = TPACKET_DRIVER_TX_FRAME_SIZE;
+      req.tp_frame_nr = TPACKET_DRIVER_TX_FRAME_COUNT;
+
+      //Set up the transmit ring
+      ret = setsockopt(context->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req));
+
+      //Any error to report?
+      if(ret < 0)
+      {
+         //Debug message
+         printf("Failed to set up transmit ring!\r\n");
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //Both rings are mapped at once, the receive ring comes first
+      context->mapSize = (TPACKET_DRIVER_RX_BLOCK_COUNT +
+         TPACKET_DRIVER_TX_BLOCK_COUNT) * TPACKET_DRIVER_BLOCK_SIZE;
+
+      //Map the rings into the address space of the process
+      context->map = mmap(NULL, context->mapSize, PROT_READ | PROT_WRITE,
+         MAP_SHARED, context->fd, 0);
+
+      //Failed to map the rings?
+      if(context->map == MAP_FAILED)
+      {
+         //Debug message
+         printf("Failed to map rings!\r\n");
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //Point to the receive and transmit rings
+      context->rxRing = context->map;
+      context->txRing = context->map + TPACKET_DRIVER_RX_BLOCK_COUNT *
+         TPACKET_DRIVER_BLOCK_SIZE;
+
+      //Only accept frames sent to the MAC address of the interface or to
+      //a group address. The filter is attached before the socket is bound
+      error = tpacketDriverUpdateMacAddrFilter(interface);
+      //Any error to report?
+      if(error)
+         break;
+
+      //Bind the socket to the selected network adapter
+      memset(&addr, 0, sizeof(addr));
+      addr.sll_family = AF_PACKET;
+      addr.sll_protocol = htons(ETH_P_ALL);
+      addr.sll_ifindex = ifIndex;
+
+      //Bind socket
+      ret = bind(context->fd, (struct sockaddr *) &addr, sizeof(addr));
+
+      //Any error to report?
+      if(ret < 0)
+      {
+         //Debug message
+         printf("Failed to bind socket!\r\n");
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //The MAC address of the interface differs from the one of the host
+      memset(&mreq, 0, sizeof(mreq));
+      mreq.mr_ifindex = ifIndex;
+      mreq.mr_type = PACKET_MR_PROMISC;
+
+      //Enable promiscuous mode
+      ret = setsockopt(context->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP,
+         &mreq, sizeof(mreq));
+
+      //Any error to report?
+      if(ret < 0)
+      {
+         //Debug message
+         printf("Failed to enable promiscuous mode!\r\n");
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //Create an event object used to resume the receive task
+      if(!osCreateEvent(&context->rxEvent))
+      {
+         //Debug message
+         printf("Failed to create event!\r\n");
+
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+         break;
+      }
+
+#if (NET_RTOS_SUPPORT == ENABLED)
+      //Create the receive task
+      task = osCreateTask("TPACKET", (OsTaskCode) tpacketDriverTask, interface, 0, 0);
+
+      //Failed to create the task?
+      if(task == OS_INVALID_HANDLE)
+      {
+         //Debug message
+         printf("Failed to create task!\r\n");
+
+         //Clean up side effects
+         osDeleteEvent(&context->rxEvent);
+
+         //Report an error
+         error = ERROR_FAILURE;
+         break;
+      }
+#endif
+
+      //Successful initialization
+      error = NO_ERROR;
+
+      //End of exception handling block
+   } while(0);
+
+   //Any error to report?
+   if(error)
+   {
+      //Unmap the rings
+      if(context->map != MAP_FAILED)
+         munmap(context->map, context->mapSize);
+
+      //Close the socket
+      if(context->fd >= 0)
+         close(context->fd);
+
+      //Release the context
+      free(context);
+
+      //Report an error
+      return error;
+   }
+
+   //Accept any packets from the upper layer
+   osSetEvent(&interface->nicTxEvent);
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief TPACKET timer handler
+ *
+ * This routine is periodically called by the TCP/IP stack to
+ * handle periodic operations such as polling the link state
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void tpacketDriverTick(NetInterface *interface)
+{
+   TpacketDriverContext *context;
+
+   //Point to the TPACKET driver context
+   context = *((TpacketDriverContext **) interface->nicContext);
+
+   //The MAC address may have been changed with netSetMacAddr()
+   if(!macCompAddr(&context->filterMacAddr, &interface->macAddr))
+   {
+      //Rebuild the filter attached to the socket
+      tpacketDriverUpdateMacAddrFilter(interface);
+   }
+}
+
+
+/**
+ * @brief Enable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void tpacketDriverEnableIrq(NetInterface *interface)
+{
+   //Not implemented
+}
+
+
+/**
+ * @brief Disable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void tpacketDriverDisableIrq(NetInterface *interface)
+{
+   //Not implemented
+}
+
+
+/**
+ * @brief TPACKET event handler
+ *
+ * Frames are passed to the upper layer straight from the receive ring. Each
+ * block is returned to the kernel as soon as all its frames have been processed
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void tpacketDriverEventHandler(NetInterface *interface)
+{
+   uint_t i;
+   size_t length;
+   uint8_t *frame;
+   struct sockaddr_ll *addr;
+   struct tpacket3_hdr *header;
+   struct tpacket_block_desc *block;
+   TpacketDriverContext *context;
+
+   //Point to the TPACKET driver context
+   context = *((TpacketDriverContext **) interface->nicContext);
+
+   //Process all the blocks retired by the kernel
+   while(1)
+   {
+      //Point to the current block
+      block = (struct tpacket_block_desc *) (context->rxRing +
+         context->rxBlockIndex * TPACKET_DRIVER_BLOCK_SIZE);
+
+      //The block is still owned by the kernel?
+      if(!(block->hdr.bh1.block_status & TP_STATUS_USER))
+         break;
+
+      //Make sure the contents of the block are read after its status
+      __sync_synchronize();
+
+      //Point to the first frame of the block
+      header = (struct tpacket3_hdr *) ((uint8_t *) block +
+         block->hdr.bh1.offset_to_first_pkt);
+
+      //Loop through the frames
+      for(i = 0; i < block->hdr.bh1.num_pkts; i++)
+      {
+         //Point to the link-layer address that follows the frame header
+         addr = (struct sockaddr_ll *) ((uint8_t *) header +
+            TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+
+         //Point to the frame
+         frame = (uint8_t *) header + header->tp_mac;
+         //Retrieve the length of the frame
+         length = header->tp_snaplen;
+
+         //Frames sent by the host itself are discarded
+         if(addr->sll_pkttype == PACKET_OUTGOING || !interface->linkState)
+         {
+            //Ignore the frame
+         }
+         //Truncated or oversized frame?
+         else if(length == 0 || length > TPACKET_DRIVER_MAX_PACKET_SIZE ||
+            header->tp_len != header->tp_snaplen)
+         {
+            //Number of inbound packets which were chosen to be discarded
+            MIB2_INC_COUNTER32(ifGroup.ifTable[interface->index].ifInDiscards, 1);
+            IF_MIB_INC_COUNTER32(ifTable[interface->index].ifInDiscards, 1);
+
+            //The first drop is most likely caused by segmentation offloads
+            if(context->rxDropCount++ == 0)
+            {
+               //Debug message
+               TRACE_WARNING("TPACKET: Oversized frame dropped (%" PRIuSIZE
+                  " bytes), check that TSO/GSO are disabled on the host side!\r\n",
+                  (size_t) header->tp_len);
+            }
+         }
+         else
+         {
+            //Frames sent by the host over a virtual interface (veth, TAP)
+            //may carry a transport checksum that has not been computed yet
+            if(header->tp_status & TP_STATUS_CSUMNOTREADY)
+               tpacketDriverCompleteChecksum(frame, length);
+
+            //Pass the packet to the upper layer
+            nicProcessPacket(interface, frame, length);
+         }
+
+         //Point to the next frame
+         header = (struct tpacket3_hdr *) ((uint8_t *) header +
+            header->tp_next_offset);
+      }
+
+      //Make sure the block is no longer accessed once it has been released
+      __sync_synchronize();
+      //Give the block back to the kernel
+      block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+
+      //Point to the next block
+      context->rxBlockIndex = (context->rxBlockIndex + 1) %
+         TPACKET_DRIVER_RX_BLOCK_COUNT;
+   }
+
+   //Resume the receive task
+   osSetEvent(&context->rxEvent);
+
+   //Send the frames queued while processing the incoming traffic
+   if(context->txPending > 0)
+      tpacketDriverFlush(interface, FALSE);
+}
+
+
+/**
+ * @brief Send a packet
+ *
+ * The frame is queued in the transmit ring. The kernel is notified when
+ * TPACKET_DRIVER_TX_BATCH_SIZE frames are pending, at the end of each
+ * event handler pass, or after at most TPACKET_DRIVER_TIMEOUT milliseconds
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+error_t tpacketDriverSendPacket(NetInterface *interface,
+   const NetBuffer *buffer, size_t offset)
+{
+   size_t length;
+   struct tpacket3_hdr *header;
+   TpacketDriverContext *context;
+
+   //Point to the TPACKET driver context
+   context = *((TpacketDriverContext **) interface->nicContext);
+
+   //Retrieve the length of the packet
+   length = netBufferGetLength(buffer) - offset;
+
+   //Check the frame length
+   if(length > TPACKET_DRIVER_MAX_PACKET_SIZE ||
+      length > (TPACKET_DRIVER_TX_FRAME_SIZE - TPACKET_DRIVER_TX_DATA_OFFSET))
+   {
+      //The transmitter can accept another packet
+      osSetEvent(&interface->nicTxEvent);
+      //Report an error
+      return ERROR_INVALID_LENGTH;
+   }
+
+   //Point to the current frame slot
+   header = (struct tpacket3_hdr *) (context->txRing +
+      context->txFrameIndex * TPACKET_DRIVER_TX_FRAME_SIZE);
+
+   //The transmit ring is full?
+   if(header->tp_status != TP_STATUS_AVAILABLE &&
+      header->tp_status != TP_STATUS_WRONG_FORMAT)
+   {
+      //Wait for the kernel to send the pending frames
+      tpacketDriverFlush(interface, TRUE);
+
+      //The slot is still in use?
+      if(header->tp_status != TP_STATUS_AVAILABLE &&
+         header->tp_status != TP_STATUS_WRONG_FORMAT)
+      {
+         //The transmitter can accept another packet
+         osSetEvent(&interface->nicTxEvent);
+         //Report an error
+         return ERROR_FAILURE;
+      }
+   }
+
+   //Copy the packet to the frame slot
+   netBufferRead((uint8_t *) header + TPACKET_DRIVER_TX_DATA_OFFSET,
+      buffer, offset, length);
+
+   //Set the length of the frame
+   header->tp_len = length;
+   header->tp_snaplen = length;
+   header->tp_next_offset = 0;
+
+   //Make sure the frame is written before it is handed to the kernel
+   __sync_synchronize();
+   //Give the ownership of the slot to the kernel
+   header->tp_status = TP_STATUS_SEND_REQUEST;
+
+   //Point to the next frame slot
+   context->txFrameIndex = (context->txFrameIndex + 1) %
+      TPACKET_DRIVER_TX_FRAME_COUNT;
+
+   //Send the whole batch with a single system call
+   if(++context->txPending >= TPACKET_DRIVER_TX_BATCH_SIZE)
+      tpacketDriverFlush(interface, FALSE);
+
+   //The transmitter can accept another packet
+   osSetEvent(&interface->nicTxEvent);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Attach a filter that matches the MAC address of the interface
+ *
+ * Only frames sent to the MAC address of the interface or to a group address
+ * are passed to the receive ring. Other frames are dropped by the kernel
+ *
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t tpacketDriverUpdateMacAddrFilter(NetInterface *interface)
+{
+   int_t ret;
+   uint32_t macAddr0123;
+   uint32_t macAddr45;
+   struct sock_fprog filterProg;
+   struct sock_filter filterCode[8];
+   TpacketDriverContext *context;
+
+   //Point to the TPACKET driver context
+   context = *((TpacketDriverContext **) interface->nicContext);
+
+   //Retrieve the MAC address of the interface
+   macAddr0123 = LOAD32BE(interface->macAddr.b);
+   macAddr45 = LOAD16BE(interface->macAddr.b + 4);
+
+   //Accept group addresses and frames sent to the MAC address of the interface
+   filterCode[0] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0);
+   filterCode[1] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x01, 4, 0);
+   filterCode[2] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 0);
+   filterCode[3] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, macAddr0123, 0, 3);
+   filterCode[4] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 4);
+   filterCode[5] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, macAddr45, 0, 1);
+   filterCode[6] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 0xFFFF);
+   filterCode[7] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 0);
+
+   //Point to the filter code
+   filterProg.len = arraysize(filterCode);
+   filterProg.filter = filterCode;
+
+   //Attach the filter (any previous filter is replaced)
+   ret = setsockopt(context->fd, SOL_SOCKET, SO_ATTACH_FILTER,
+      &filterProg, sizeof(filterProg));
+
+   //Any error to report?
+   if(ret < 0)
+   {
+      //Debug message
+      printf("Failed to set filter!\r\n");
+      //Report an error
+      return ERROR_FAILURE;
+   }
+
+   //Save the MAC address the filter has been built for
+   context->filterMacAddr = interface->macAddr;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Configure multicast MAC address filtering
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t tpacketDriverSetMulticastFilter(NetInterface *interface)
+{
+   //Not implemented
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Hand the frames queued in the transmit ring to the kernel
+ *
+ * The caller must hold netMutex, which also protects the pending frame
+ * counter updated by tpacketDriverSendPacket()
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] wait Wait for the kernel to send all the pending frames
+ **/
+
+void tpacketDriverFlush(NetInterface *interface, bool_t wait)
+{
+   TpacketDriverContext *context;
+
+   //Point to the TPACKET driver context
+   context = *((TpacketDriverContext **) interface->nicContext);
+
+   //All the pending frames are about to be sent
+   context->txPending = 0;
+
+   //The kernel sends every slot whose status is TP_STATUS_SEND_REQUEST
+   sendto(context->fd, NULL, 0, wait ? 0 : MSG_DONTWAIT, NULL, 0);
+}
+
+
+/**
+ * @brief Complete the transport checksum of an incoming frame
+ *
+ * When the sender relies on checksum offloading, the TCP or UDP checksum
+ * field only holds the checksum of the pseudo header. The checksum of the
+ * transport header and payload is computed over that field to obtain
+ * the final value
+ *
+ * @param[in,out] frame Pointer to the Ethernet frame
+ * @param[in] length Length of the frame, in bytes
+ **/
+
+void tpacketDriverCompleteChecksum(uint8_t *frame, size_t length)
+{
+   size_t n;
+   bool_t tcp;
+   bool_t udp;
+   uint8_t *payload;
+   uint16_t value;
+   EthHeader *ethHeader;
+   Ipv4Header *ipv4Header;
+   Ipv6Header *ipv6Header;
+
+   //Point to the Ethernet header
+   ethHeader = (EthHeader *) frame;
+   //Retrieve the length of the Ethernet payload
+   length -= MIN(length, sizeof(EthHeader));
+
+   //IPv4 packet?
+   if(length >= sizeof(Ipv4Header) && ethHeader->type == htons(ETH_TYPE_IPV4))
+   {
+      //Point to the IPv4 header
+      ipv4Header = (Ipv4Header *) ethHeader->data;
+      //Retrieve the length of the header
+      n = ipv4Header->headerLength * 4;
+
+      //Malformed packets are bypassed
+      if(n < sizeof(Ipv4Header) || ntohs(ipv4Header->totalLength) < n)
+         return;
+      if(ntohs(ipv4Header->totalLength) > length)
+         return;
+
+      //Point to the transport header
+      payload = (uint8_t *) ipv4Header + n;
+      //Compute the length of the transport header and payload
+      n = ntohs(ipv4Header->totalLength) - n;
+      //Check whether the packet carries a TCP segment or a UDP datagram
+      tcp = (ipv4Header->protocol == IPV4_PROTOCOL_TCP);
+      udp = (ipv4Header->protocol == IPV4_PROTOCOL_UDP);
+   }
+   //IPv6 packet?
+   else if(length >= sizeof(Ipv6Header) && ethHeader->type == htons(ETH_TYPE_IPV6))
+   {
+      //Point to the IPv6 header
+      ipv6Header = (Ipv6Header *) ethHeader->data;
+
+      //Malformed packets are bypassed
+      if(ntohs(ipv6Header->payloadLength) > (length - sizeof(Ipv6Header)))
+         return;
+
+      //Point to the transport header
+      payload = ipv6Header->payload;
+      //Compute the length of the transport header and payload
+      n = ntohs(ipv6Header->payloadLength);
+      //Extension headers are not supported
+      tcp = (ipv6Header->nextHeader == IPV6_TCP_HEADER);
+      udp = (ipv6Header->nextHeader == IPV6_UDP_HEADER);
+   }
+   else
+   {
+      //Other packets are bypassed
+      return;
+   }
+
+   //Compute the checksum over the transport header and payload
+   if(tcp && n >= sizeof(TcpHeader))
+   {
+      value = ipCalcChecksum(payload, n);
+      //Insert the checksum
+      ((TcpHeader *) payload)->checksum = value;
+   }
+   else if(udp && n >= sizeof(UdpHeader))
+   {
+      value = ipCalcChecksum(payload, n);
+      //A computed UDP checksum of zero is transmitted as all ones
+      ((UdpHeader *) payload)->checksum = (value == 0x0000) ? 0xFFFF : value;
+   }
+}
+
+
+/**
+ * @brief TPACKET receive task
+ * @param[in] interface Underlying network interface
+ **/
+
+void tpacketDriverTask(NetInterface *interface)
+{
+   struct pollfd fds;
+   struct tpacket_block_desc *block;
+   TpacketDriverContext *context;
+
+   //Point to the TPACKET driver context
+   context = *((TpacketDriverContext **) interface->nicContext);
+
+   //Process events
+   while(1)
+   {
+      //Point to the next block to be processed by the event handler
+      block = (struct tpacket_block_desc *) (context->rxRing +
+         context->rxBlockIndex * TPACKET_DRIVER_BLOCK_SIZE);
+
+      //Any block retired by the kernel?
+      if(block->hdr.bh1.block_status & TP_STATUS_USER)
+      {
+         //Set event flag
+         interface->nicEvent = TRUE;
+         //Notify the TCP/IP stack of the event
+         osSetEvent(&netEvent);
+
+#if (NET_RTOS_SUPPORT == ENABLED)
+         //Wait for the event handler to process the block
+         osWaitForEvent(&context->rxEvent, TPACKET_DRIVER_TIMEOUT);
+#else
+         //Exit immediately
+         break;
+#endif
+      }
+      else
+      {
+         //Wait for the kernel to retire a block
+         fds.fd = context->fd;
+         fds.events = POLLIN | POLLERR;
+         fds.revents = 0;
+
+#if (NET_RTOS_SUPPORT == ENABLED)
+         //Wait for incoming traffic
+         poll(&fds, 1, TPACKET_DRIVER_TIMEOUT);
+#else
+         //Check for incoming traffic without blocking
+         if(poll(&fds, 1, 0) <= 0)
+            break;
+#endif
+      }
+
+      //The pending frame counter is protected by the stack mutex
+      osAcquireMutex(&netMutex);
+
+      //Frames queued by the upper layer must not wait for a full batch
+      if(context->txPending > 0)
+         tpacketDriverFlush(interface, FALSE);
+
+      //Release exclusive access
+      osReleaseMutex(&netMutex);
+   }
+}
@@ -0,0 +1,120 @@
+/**
+ * @file tpacket_driver.h
+ * @brief Linux AF_PACKET driver (TPACKET_V3 memory-mapped rings)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8a
+ **/
+
+#ifndef _TPACKET_DRIVER_H
+#define _TPACKET_DRIVER_H
+
+//Dependencies
+#include "core/nic.h"
+
+//Maximum packet size (larger frames are dropped, so TSO and GSO must be
+//disabled on the host side of the link: ethtool -K <if> tso off gso off)
+#ifndef TPACKET_DRIVER_MAX_PACKET_SIZE
+   #define TPACKET_DRIVER_MAX_PACKET_SIZE 1536
+#elif (TPACKET_DRIVER_MAX_PACKET_SIZE < 1)
+   #error TPACKET_DRIVER_MAX_PACKET_SIZE parameter is not valid
+#endif
+
+//Size of a ring block (must be a multiple of the page size)
+#ifndef TPACKET_DRIVER_BLOCK_SIZE
+   #define TPACKET_DRIVER_BLOCK_SIZE 65536
+#elif (TPACKET_DRIVER_BLOCK_SIZE < 4096 || (TPACKET_DRIVER_BLOCK_SIZE % 4096) != 0)
+   #error TPACKET_DRIVER_BLOCK_SIZE parameter is not valid
+#endif
+
+//Number of blocks in the receive ring
+#ifndef TPACKET_DRIVER_RX_BLOCK_COUNT
+   #define TPACKET_DRIVER_RX_BLOCK_COUNT 16
+#elif (TPACKET_DRIVER_RX_BLOCK_COUNT < 1)
+   #error TPACKET_DRIVER_RX_BLOCK_COUNT parameter is not valid
+#endif
+
+//Size of a transmit frame slot
+#ifndef TPACKET_DRIVER_TX_FRAME_SIZE
+   #define TPACKET_DRIVER_TX_FRAME_SIZE 2048
+#elif (TPACKET_DRIVER_TX_FRAME_SIZE < 64 || (TPACKET_DRIVER_BLOCK_SIZE % TPACKET_DRIVER_TX_FRAME_SIZE) != 0)
+   #error TPACKET_DRIVER_TX_FRAME_SIZE parameter is not valid
+#endif
+
+//Number of frame slots in the transmit ring
+#ifndef TPACKET_DRIVER_TX_FRAME_COUNT
+   #define TPACKET_DRIVER_TX_FRAME_COUNT 256
+#elif (TPACKET_DRIVER_TX_FRAME_COUNT < 1 || ((TPACKET_DRIVER_TX_FRAME_COUNT * \
+   TPACKET_DRIVER_TX_FRAME_SIZE) % TPACKET_DRIVER_BLOCK_SIZE) != 0)
+   #error TPACKET_DRIVER_TX_FRAME_COUNT parameter is not valid
+#endif
+
+//Number of queued frames that triggers a transmission
+#ifndef TPACKET_DRIVER_TX_BATCH_SIZE
+   #define TPACKET_DRIVER_TX_BATCH_SIZE 16
+#elif (TPACKET_DRIVER_TX_BATCH_SIZE < 1 || TPACKET_DRIVER_TX_BATCH_SIZE > TPACKET_DRIVER_TX_FRAME_COUNT)
+   #error TPACKET_DRIVER_TX_BATCH_SIZE parameter is not valid
+#endif
+
+//Block retire timeout and polling interval in milliseconds
+#ifndef TPACKET_DRIVER_TIMEOUT
+   #define TPACKET_DRIVER_TIMEOUT 1
+#elif (TPACKET_DRIVER_TIMEOUT < 1)
+   #error TPACKET_DRIVER_TIMEOUT parameter is not valid
+#endif
+
+//C++ guard
+#ifdef __cplusplus
+   extern "C" {
+#endif
+
+//TPACKET driver
+extern const NicDriver tpacketDriver;
+
+//TPACKET related functions
+error_t tpacketDriverInit(NetInterface *interface);
+
+void tpacketDriverTick(NetInterface *interface);
+
+void tpacketDriverEnableIrq(NetInterface *interface);
+void tpacketDriverDisableIrq(NetInterface *interface);
+
+void tpacketDriverEventHandler(NetInterface *interface);
+
+error_t tpacketDriverSendPacket(NetInterface *interface,
+   const NetBuffer *buffer, size_t offset);
+
+error_t tpacketDriverUpdateMacAddrFilter(NetInterface *interface);
+error_t tpacketDriverSetMulticastFilter(NetInterface *interface);
+
+void tpacketDriverFlush(NetInterface *interface, bool_t wait);
+void tpacketDriverCompleteChecksum(uint8_t *frame, size_t length);
+
+void tpacketDriverTask(NetInterface *interface);
+
+//C++ guard
+#ifdef __cplusplus
+   }
+#endif
+
+#endif
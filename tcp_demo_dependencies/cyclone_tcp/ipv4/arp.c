@@ -56,9 +56,30 @@ systime_t arpTickCounter;
 
 error_t arpInit(NetInterface *interface)
 {
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   uint_t i;
+#endif
+
    //Initialize the ARP cache
    memset(interface->arpCache, 0, sizeof(interface->arpCache));
 
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   //Clear hash table
+   memset(interface->arpHashTable, 0, sizeof(interface->arpHashTable));
+
+   //All the entries are initially free and linked together in the LRU list
+   for(i = 0; i < ARP_CACHE_SIZE; i++)
+   {
+      //Link the current entry to its neighbors
+      interface->arpCache[i].lruPrev = (i > 0) ? &interface->arpCache[i - 1] : NULL;
+      interface->arpCache[i].lruNext = (i < (ARP_CACHE_SIZE - 1)) ? &interface->arpCache[i + 1] : NULL;
+   }
+
+   //Point to the first and last entries of the LRU list
+   interface->arpLruHead = &interface->arpCache[0];
+   interface->arpLruTail = &interface->arpCache[ARP_CACHE_SIZE - 1];
+#endif
+
    //Successful initialization
    return NO_ERROR;
 }
@@ -80,10 +101,9 @@ void arpFlushCache(NetInterface *interface)
       //Point to the current entry
       entry = &interface->arpCache[i];
 
-      //Drop packets that are waiting for address resolution
-      arpFlushQueuedPackets(interface, entry);
-      //Release ARP entry
-      entry->state = ARP_STATE_NONE;
+      //Release ARP entry and drop packets waiting for address resolution
+      if(entry->state != ARP_STATE_NONE)
+         arpDeleteEntry(interface, entry);
    }
 }
 
@@ -91,14 +111,68 @@ void arpFlushCache(NetInterface *interface)
 /**
  * @brief Create a new entry in the ARP cache
  * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv4 address associated with the new entry
  * @return Pointer to the newly created entry
  **/
 
-ArpCacheEntry *arpCreateEntry(NetInterface *interface)
+ArpCacheEntry *arpCreateEntry(NetInterface *interface, Ipv4Addr ipAddr)
 {
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   uint_t k;
+   ArpCacheEntry *entry;
+   ArpCacheEntry *lruPrev;
+   ArpCacheEntry *lruNext;
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   uint_t generation;
+#endif
+
+   //Free entries and least recently used entries are found at the
+   //tail of the LRU list
+   entry = interface->arpLruTail;
+
+   //The least recently used entry is removed whenever the table runs
+   //out of space
+   if(entry->state != ARP_STATE_NONE)
+      arpDeleteEntry(interface, entry);
+
+   //Save LRU links
+   lruPrev = entry->lruPrev;
+   lruNext = entry->lruNext;
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   //Destination cache entries recorded for a previous use of the entry
+   //must remain invalid
+   generation = entry->generation;
+#endif
+   //Erase contents
+   memset(entry, 0, sizeof(ArpCacheEntry));
+   //Restore LRU links
+   entry->lruPrev = lruPrev;
+   entry->lruNext = lruNext;
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   //Restore generation counter
+   entry->generation = generation;
+#endif
+
+   //Record the IPv4 address
+   entry->ipAddr = ipAddr;
+
+   //Insert the entry at the head of the matching hash bucket
+   k = arpHashAddr(ipAddr);
+   entry->hashNext = interface->arpHashTable[k];
+   interface->arpHashTable[k] = entry;
+
+   //The new entry is now the most recently used one
+   arpTouchEntry(interface, entry);
+
+   //Return a pointer to the ARP entry
+   return entry;
+#else
    uint_t i;
    ArpCacheEntry *entry;
    ArpCacheEntry *oldestEntry;
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   uint_t generation;
+#endif
 
    //Keep track of the oldest entry
    oldestEntry = &interface->arpCache[0];
@@ -111,24 +185,37 @@ ArpCacheEntry *arpCreateEntry(NetInterface *interface)
 
       //Check whether the entry is currently in used or not
       if(entry->state == ARP_STATE_NONE)
-      {
-         //Erase contents
-         memset(entry, 0, sizeof(ArpCacheEntry));
-         //Return a pointer to the ARP entry
-         return entry;
-      }
+         break;
 
       //Keep track of the oldest entry in the table
       if(timeCompare(entry->timestamp, oldestEntry->timestamp) < 0)
          oldestEntry = entry;
    }
 
-   //Drop any pending packets
-   arpFlushQueuedPackets(interface, oldestEntry);
    //The oldest entry is removed whenever the table runs out of space
-   memset(oldestEntry, 0, sizeof(ArpCacheEntry));
+   if(i >= ARP_CACHE_SIZE)
+   {
+      entry = oldestEntry;
+      arpDeleteEntry(interface, entry);
+   }
+
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   //Destination cache entries recorded for a previous use of the entry
+   //must remain invalid
+   generation = entry->generation;
+#endif
+   //Erase contents
+   memset(entry, 0, sizeof(ArpCacheEntry));
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   //Restore generation counter
+   entry->generation = generation;
+#endif
+
+   //Record the IPv4 address
+   entry->ipAddr = ipAddr;
    //Return a pointer to the ARP entry
-   return oldestEntry;
+   return entry;
+#endif
 }
 
 
@@ -142,6 +229,21 @@ ArpCacheEntry *arpCreateEntry(NetInterface *interface)
 
 ArpCacheEntry *arpFindEntry(NetInterface *interface, Ipv4Addr ipAddr)
 {
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   ArpCacheEntry *entry;
+
+   //Only the entries that are in use are linked in the hash table
+   for(entry = interface->arpHashTable[arpHashAddr(ipAddr)];
+      entry != NULL; entry = entry->hashNext)
+   {
+      //Current entry matches the specified address?
+      if(entry->ipAddr == ipAddr)
+         return entry;
+   }
+
+   //No matching entry in ARP cache...
+   return NULL;
+#else
    uint_t i;
    ArpCacheEntry *entry;
 
@@ -162,9 +264,163 @@ ArpCacheEntry *arpFindEntry(NetInterface *interface, Ipv4Addr ipAddr)
 
    //No matching entry in ARP cache...
    return NULL;
+#endif
 }
 
 
+/**
+ * @brief Remove an entry from the ARP cache
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP cache entry to be deleted
+ **/
+
+void arpDeleteEntry(NetInterface *interface, ArpCacheEntry *entry)
+{
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   ArpCacheEntry **p;
+#endif
+
+   //Drop packets that are waiting for address resolution
+   arpFlushQueuedPackets(interface, entry);
+
+   //Destination cache entries may refer to the link-layer address
+   arpInvalidateEntry(entry);
+
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   //Search the hash bucket for the entry
+   for(p = &interface->arpHashTable[arpHashAddr(entry->ipAddr)];
+      *p != NULL; p = &(*p)->hashNext)
+   {
+      //Matching entry?
+      if(*p == entry)
+      {
+         //Remove the entry from the hash table
+         *p = entry->hashNext;
+         break;
+      }
+   }
+
+   //Unlink the entry from the hash bucket
+   entry->hashNext = NULL;
+
+   //Remove the entry from the LRU list
+   arpUnlinkLruEntry(interface, entry);
+
+   //Free entries are reused first, so move the entry to the tail
+   entry->lruPrev = interface->arpLruTail;
+   entry->lruNext = NULL;
+
+   //Update the tail of the LRU list
+   if(interface->arpLruTail != NULL)
+      interface->arpLruTail->lruNext = entry;
+   else
+      interface->arpLruHead = entry;
+
+   interface->arpLruTail = entry;
+#endif
+
+   //Release ARP entry
+   entry->state = ARP_STATE_NONE;
+}
+
+
+/**
+ * @brief Invalidate the destination cache entries that use an ARP entry
+ *
+ * Destination cache entries record the generation of the ARP entry their
+ * next hop was resolved with. Bumping it only invalidates the entries
+ * whose next hop is the IPv4 address of this ARP entry
+ *
+ * @param[in] entry Pointer to the ARP cache entry
+ **/
+
+void arpInvalidateEntry(ArpCacheEntry *entry)
+{
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   //Move to the next generation
+   entry->generation++;
+#endif
+}
+
+
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+
+/**
+ * @brief Map an IPv4 address to a bucket of the ARP hash table
+ * @param[in] ipAddr IPv4 address
+ * @return Index of the hash bucket
+ **/
+
+uint_t arpHashAddr(Ipv4Addr ipAddr)
+{
+   uint32_t h;
+
+   //Hosts on the same subnet differ in the low-order bits of the address,
+   //so a multiplicative hash is used to spread them across the upper bits
+   h = ntohl(ipAddr) * 0x9E3779B1;
+
+   //Return the index of the hash bucket
+   return (h >> 16) % ARP_HASH_TABLE_SIZE;
+}
+
+
+/**
+ * @brief Mark an ARP cache entry as the most recently used one
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP cache entry
+ **/
+
+void arpTouchEntry(NetInterface *interface, ArpCacheEntry *entry)
+{
+   //The entry is already at the head of the LRU list?
+   if(interface->arpLruHead == entry)
+      return;
+
+   //Remove the entry from the LRU list
+   arpUnlinkLruEntry(interface, entry);
+
+   //Insert the entry at the head of the LRU list
+   entry->lruPrev = NULL;
+   entry->lruNext = interface->arpLruHead;
+
+   //Update the head of the LRU list
+   if(interface->arpLruHead != NULL)
+      interface->arpLruHead->lruPrev = entry;
+   else
+      interface->arpLruTail = entry;
+
+   interface->arpLruHead = entry;
+}
+
+
+/**
+ * @brief Remove an ARP cache entry from the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP cache entry
+ **/
+
+void arpUnlinkLruEntry(NetInterface *interface, ArpCacheEntry *entry)
+{
+   //Update the link of the previous entry
+   if(entry->lruPrev != NULL)
+      entry->lruPrev->lruNext = entry->lruNext;
+   else
+      interface->arpLruHead = entry->lruNext;
+
+   //Update the link of the next entry
+   if(entry->lruNext != NULL)
+      entry->lruNext->lruPrev = entry->lruPrev;
+   else
+      interface->arpLruTail = entry->lruPrev;
+
+   //The entry is no longer part of the list
+   entry->lruPrev = NULL;
+   entry->lruNext = NULL;
+}
+
+#endif
+
+
 /**
  * @brief Send packets that are waiting for address resolution
  * @param[in] interface Underlying network interface
@@ -279,18 +535,21 @@ error_t arpResolve(NetInterface *interface, Ipv4Addr ipAddr, MacAddr *macAddr)
          //Successful address resolution
          error = NO_ERROR;
       }
+
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+      //Keep the entry away from the tail of the LRU list
+      arpTouchEntry(interface, entry);
+#endif
    }
    else
    {
-      //If no entry exists, then create a new one
-      entry = arpCreateEntry(interface);
+      //If no entry exists, then create a new one for the IPv4
+      //address whose MAC address is unknown
+      entry = arpCreateEntry(interface, ipAddr);
 
       //ARP cache entry successfully created?
       if(entry != NULL)
       {
-         //Record the IPv4 address whose MAC address is unknown
-         entry->ipAddr = ipAddr;
-
          //Reset retransmission counter
          entry->retransmitCount = 0;
          //No packet are pending in the transmit queue
@@ -416,65 +675,122 @@ error_t arpEnqueuePacket(NetInterface *interface,
 
 void arpTick(NetInterface *interface)
 {
-   uint_t i;
    systime_t time;
    ArpCacheEntry *entry;
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   ArpCacheEntry *nextEntry;
+#else
+   uint_t i;
+#endif
 
    //Get current time
    time = osGetSystemTime();
 
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   //Free entries are kept at the tail of the LRU list, so the entries in
+   //use are found at its head
+   for(entry = interface->arpLruHead; entry != NULL &&
+      entry->state != ARP_STATE_NONE; entry = nextEntry)
+   {
+      //A deleted entry is moved to the tail of the list
+      nextEntry = entry->lruNext;
+      //Manage the current entry
+      arpTickEntry(interface, entry, time);
+   }
+#else
    //Go through ARP cache
    for(i = 0; i < ARP_CACHE_SIZE; i++)
    {
       //Point to the current entry
       entry = &interface->arpCache[i];
+      //Manage the current entry
+      arpTickEntry(interface, entry, time);
+   }
+#endif
+}
 
-      //INCOMPLETE state?
-      if(entry->state == ARP_STATE_INCOMPLETE)
+
+/**
+ * @brief Manage the timers of an ARP cache entry
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP cache entry
+ * @param[in] time Current time
+ **/
+
+void arpTickEntry(NetInterface *interface, ArpCacheEntry *entry, systime_t time)
+{
+   //INCOMPLETE state?
+   if(entry->state == ARP_STATE_INCOMPLETE)
+   {
+      //The request timed out?
+      if(timeCompare(time, entry->timestamp + entry->timeout) >= 0)
       {
-         //The request timed out?
-         if(timeCompare(time, entry->timestamp + entry->timeout) >= 0)
+         //Increment retransmission counter
+         entry->retransmitCount++;
+
+         //Check whether the maximum number of retransmissions has been exceeded
+         if(entry->retransmitCount < ARP_MAX_REQUESTS)
          {
-            //Increment retransmission counter
-            entry->retransmitCount++;
-
-            //Check whether the maximum number of retransmissions has been exceeded
-            if(entry->retransmitCount < ARP_MAX_REQUESTS)
-            {
-               //Retransmit ARP request
-               arpSendRequest(interface, entry->ipAddr, &MAC_BROADCAST_ADDR);
-
-               //Save the time at which the packet was sent
-               entry->timestamp = time;
-               //Set timeout value
-               entry->timeout = ARP_REQUEST_TIMEOUT;
-            }
-            else
-            {
-               //Drop packets that are waiting for address resolution
-               arpFlushQueuedPackets(interface, entry);
-               //The entry should be deleted since address resolution has failed
-               entry->state = ARP_STATE_NONE;
-            }
+            //Retransmit ARP request
+            arpSendRequest(interface, entry->ipAddr, &MAC_BROADCAST_ADDR);
+
+            //Save the time at which the packet was sent
+            entry->timestamp = time;
+            //Set timeout value
+            entry->timeout = ARP_REQUEST_TIMEOUT;
          }
-      }
-      //REACHABLE state?
-      else if(entry->state == ARP_STATE_REACHABLE)
-      {
-         //Periodically time out ARP cache entries
-         if(timeCompare(time, entry->timestamp + entry->timeout) >= 0)
+         else
          {
-            //Save current time
-            entry->timestamp = osGetSystemTime();
-            //Enter STALE state
-            entry->state = ARP_STATE_STALE;
+            //The entry should be deleted since address resolution has
+            //failed (pending packets are dropped)
+            arpDeleteEntry(interface, entry);
          }
       }
-      //DELAY state?
-      else if(entry->state == ARP_STATE_DELAY)
+   }
+   //REACHABLE state?
+   else if(entry->state == ARP_STATE_REACHABLE)
+   {
+      //Periodically time out ARP cache entries
+      if(timeCompare(time, entry->timestamp + entry->timeout) >= 0)
+      {
+         //Save current time
+         entry->timestamp = osGetSystemTime();
+         //Enter STALE state
+         entry->state = ARP_STATE_STALE;
+
+         //The next packet to this neighbor must go through arpResolve()
+         //so that reachability confirmation can take place
+         arpInvalidateEntry(entry);
+      }
+   }
+   //DELAY state?
+   else if(entry->state == ARP_STATE_DELAY)
+   {
+      //Wait for the specified delay before sending the first probe
+      if(timeCompare(time, entry->timestamp + entry->timeout) >= 0)
       {
-         //Wait for the specified delay before sending the first probe
-         if(timeCompare(time, entry->timestamp + entry->timeout) >= 0)
+         //Send a point-to-point ARP request to the host
+         arpSendRequest(interface, entry->ipAddr, &entry->macAddr);
+
+         //Save the time at which the packet was sent
+         entry->timestamp = time;
+         //Set timeout value
+         entry->timeout = ARP_PROBE_TIMEOUT;
+         //Switch to the PROBE state
+         entry->state = ARP_STATE_PROBE;
+      }
+   }
+   //PROBE state?
+   else if(entry->state == ARP_STATE_PROBE)
+   {
+      //The request timed out?
+      if(timeCompare(time, entry->timestamp + entry->timeout) >= 0)
+      {
+         //Increment retransmission counter
+         entry->retransmitCount++;
+
+         //Check whether the maximum number of retransmissions has been exceeded
+         if(entry->retransmitCount < ARP_MAX_PROBES)
          {
             //Send a point-to-point ARP request to the host
             arpSendRequest(interface, entry->ipAddr, &entry->macAddr);
@@ -483,35 +799,11 @@ void arpTick(NetInterface *interface)
             entry->timestamp = time;
             //Set timeout value
             entry->timeout = ARP_PROBE_TIMEOUT;
-            //Switch to the PROBE state
-            entry->state = ARP_STATE_PROBE;
          }
-      }
-      //PROBE state?
-      else if(entry->state == ARP_STATE_PROBE)
-      {
-         //The request timed out?
-         if(timeCompare(time, entry->timestamp + entry->timeout) >= 0)
+         else
          {
-            //Increment retransmission counter
-            entry->retransmitCount++;
-
-            //Check whether the maximum number of retransmissions has been exceeded
-            if(entry->retransmitCount < ARP_MAX_PROBES)
-            {
-               //Send a point-to-point ARP request to the host
-               arpSendRequest(interface, entry->ipAddr, &entry->macAddr);
-
-               //Save the time at which the packet was sent
-               entry->timestamp = time;
-               //Set timeout value
-               entry->timeout = ARP_PROBE_TIMEOUT;
-            }
-            else
-            {
-               //The entry should be deleted since the host is not reachable anymore
-               entry->state = ARP_STATE_NONE;
-            }
+            //The entry should be deleted since the host is not reachable anymore
+            arpDeleteEntry(interface, entry);
          }
       }
    }
@@ -712,10 +1004,16 @@ void arpProcessReply(NetInterface *interface, ArpPacket *arpReply)
          {
             //Enter STALE state
             entry->state = ARP_STATE_STALE;
+            //Stop using the cached link-layer address
+            arpInvalidateEntry(entry);
          }
       }
       else if(entry->state == ARP_STATE_PROBE)
       {
+         //The link-layer address has changed?
+         if(!macCompAddr(&arpReply->sha, &entry->macAddr))
+            arpInvalidateEntry(entry);
+
          //Record IPv4/MAC address pair
          entry->ipAddr = arpReply->spa;
          entry->macAddr = arpReply->sha;
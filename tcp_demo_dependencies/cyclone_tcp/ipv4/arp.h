@@ -46,6 +46,20 @@
    #error ARP_CACHE_SIZE parameter is not valid
 #endif
 
+//Hashed ARP cache with LRU replacement
+#ifndef ARP_CACHE_HASH_SUPPORT
+   #define ARP_CACHE_HASH_SUPPORT ENABLED
+#elif (ARP_CACHE_HASH_SUPPORT != ENABLED && ARP_CACHE_HASH_SUPPORT != DISABLED)
+   #error ARP_CACHE_HASH_SUPPORT parameter is not valid
+#endif
+
+//Number of buckets in the ARP hash table
+#ifndef ARP_HASH_TABLE_SIZE
+   #define ARP_HASH_TABLE_SIZE 16
+#elif (ARP_HASH_TABLE_SIZE < 1 || ARP_HASH_TABLE_SIZE > 65536)
+   #error ARP_HASH_TABLE_SIZE parameter is not valid
+#endif
+
 //Maximum number of packets waiting for address resolution to complete
 #ifndef ARP_MAX_PENDING_PACKETS
    #define ARP_MAX_PENDING_PACKETS 2
@@ -178,7 +192,7 @@ typedef struct
  * @brief ARP cache entry
  **/
 
-typedef struct
+typedef struct _ArpCacheEntry
 {
    ArpState state;                              //Reachability state
    Ipv4Addr ipAddr;                             //Unicast IPv4 address
@@ -188,6 +202,14 @@ typedef struct
    uint_t retransmitCount;                      //Retransmission counter
    ArpQueueItem queue[ARP_MAX_PENDING_PACKETS]; //Packets waiting for address resolution to complete
    uint_t queueSize;                            //Number of queued packets
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   uint_t generation;                           //Bumped whenever the IPv4/MAC mapping is invalidated
+#endif
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   struct _ArpCacheEntry *hashNext;             //Next entry in the same hash bucket
+   struct _ArpCacheEntry *lruPrev;              //Previous entry in the LRU list
+   struct _ArpCacheEntry *lruNext;              //Next entry in the LRU list
+#endif
 } ArpCacheEntry;
 
 
@@ -198,8 +220,14 @@ extern systime_t arpTickCounter;
 error_t arpInit(NetInterface *interface);
 void arpFlushCache(NetInterface *interface);
 
-ArpCacheEntry *arpCreateEntry(NetInterface *interface);
+ArpCacheEntry *arpCreateEntry(NetInterface *interface, Ipv4Addr ipAddr);
 ArpCacheEntry *arpFindEntry(NetInterface *interface, Ipv4Addr ipAddr);
+void arpDeleteEntry(NetInterface *interface, ArpCacheEntry *entry);
+void arpInvalidateEntry(ArpCacheEntry *entry);
+
+uint_t arpHashAddr(Ipv4Addr ipAddr);
+void arpTouchEntry(NetInterface *interface, ArpCacheEntry *entry);
+void arpUnlinkLruEntry(NetInterface *interface, ArpCacheEntry *entry);
 
 void arpSendQueuedPackets(NetInterface *interface, ArpCacheEntry *entry);
 void arpFlushQueuedPackets(NetInterface *interface, ArpCacheEntry *entry);
@@ -210,6 +238,7 @@ error_t arpEnqueuePacket(NetInterface *interface,
    Ipv4Addr ipAddr, NetBuffer *buffer, size_t offset);
 
 void arpTick(NetInterface *interface);
+void arpTickEntry(NetInterface *interface, ArpCacheEntry *entry, systime_t time);
 
 void arpProcessPacket(NetInterface *interface, ArpPacket *arpPacket, size_t length);
 void arpProcessRequest(NetInterface *interface, ArpPacket *arpRequest);
@@ -87,8 +87,10 @@ void icmpProcessMessage(NetInterface *interface,
    //Dump message contents for debugging purpose
    icmpDumpMessage(header);
 
-   //Verify checksum value
-   if(ipCalcChecksumEx(buffer, offset, length) != 0x0000)
+   //Verify checksum value (unless the hardware already did it)
+   if((!interface->nicDriver->autoIcmpChecksumVerif ||
+      interface->nicRxChecksumBypassed) &&
+      ipCalcChecksumEx(buffer, offset, length) != 0x0000)
    {
       //Debug message
       TRACE_WARNING("Wrong ICMP header checksum!\r\n");
@@ -189,8 +191,13 @@ void icmpProcessEchoRequest(NetInterface *interface,
    {
       //Get the length of the resulting message
       replyLength = netBufferGetLength(reply) - replyOffset;
-      //Calculate ICMP header checksum
-      replyHeader->checksum = ipCalcChecksumEx(reply, replyOffset, replyLength);
+
+      //ICMP checksum calculation not supported by hardware?
+      if(!ipv4IsTxChecksumOffloaded(interface, IPV4_PROTOCOL_ICMP, replyLength))
+      {
+         //Calculate ICMP header checksum
+         replyHeader->checksum = ipCalcChecksumEx(reply, replyOffset, replyLength);
+      }
 
       //Format IPv4 pseudo header
       pseudoHeader.srcAddr = interface->ipv4Context.addr;
@@ -208,7 +215,7 @@ void icmpProcessEchoRequest(NetInterface *interface,
       icmpDumpEchoMessage(replyHeader);
 
       //Send Echo Reply message
-      ipv4SendDatagram(interface, &pseudoHeader, reply, replyOffset, IPV4_DEFAULT_TTL);
+      ipv4SendDatagram(interface, &pseudoHeader, reply, replyOffset, IPV4_DEFAULT_TTL, NULL);
    }
 
    //Free previously allocated memory block
@@ -286,8 +293,13 @@ error_t icmpSendErrorMessage(NetInterface *interface, uint8_t type, uint8_t code
    {
       //Get the length of the resulting message
       length = netBufferGetLength(icmpMessage) - offset;
-      //Message checksum calculation
-      icmpHeader->checksum = ipCalcChecksumEx(icmpMessage, offset, length);
+
+      //ICMP checksum calculation not supported by hardware?
+      if(!ipv4IsTxChecksumOffloaded(interface, IPV4_PROTOCOL_ICMP, length))
+      {
+         //Message checksum calculation
+         icmpHeader->checksum = ipCalcChecksumEx(icmpMessage, offset, length);
+      }
 
       //Format IPv4 pseudo header
       pseudoHeader.srcAddr = ipHeader->destAddr;
@@ -306,7 +318,7 @@ error_t icmpSendErrorMessage(NetInterface *interface, uint8_t type, uint8_t code
 
       //Send ICMP Error message
       error = ipv4SendDatagram(interface, &pseudoHeader,
-         icmpMessage, offset, IPV4_DEFAULT_TTL);
+         icmpMessage, offset, IPV4_DEFAULT_TTL, NULL);
    }
 
    //Free previously allocated memory
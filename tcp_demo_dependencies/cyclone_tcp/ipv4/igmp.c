@@ -524,7 +524,7 @@ error_t igmpSendReportMessage(NetInterface *interface, Ipv4Addr ipAddr)
    igmpDumpMessage(message);
 
    //The Membership Report message is sent to the group being reported
-   error = ipv4SendDatagram(interface, &pseudoHeader, buffer, offset, IGMP_TTL);
+   error = ipv4SendDatagram(interface, &pseudoHeader, buffer, offset, IGMP_TTL, NULL);
 
    //Free previously allocated memory
    netBufferFree(buffer);
@@ -593,7 +593,7 @@ error_t igmpSendLeaveGroupMessage(NetInterface *interface, Ipv4Addr ipAddr)
    igmpDumpMessage(message);
 
    //The Leave Group message is sent to the all-routers multicast group
-   error = ipv4SendDatagram(interface, &pseudoHeader, buffer, offset, IGMP_TTL);
+   error = ipv4SendDatagram(interface, &pseudoHeader, buffer, offset, IGMP_TTL, NULL);
 
    //Free previously allocated memory
    netBufferFree(buffer);
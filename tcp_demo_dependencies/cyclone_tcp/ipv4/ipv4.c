@@ -59,6 +59,13 @@
 //Check TCP/IP stack configuration
 #if (IPV4_SUPPORT == ENABLED)
 
+//Fast-path statistics are accumulated in the counter block of the interface
+#if (IPV4_COUNTER_BLOCK_SUPPORT == ENABLED && (MIB2_SUPPORT == ENABLED || IP_MIB_SUPPORT == ENABLED))
+   #define IPV4_INC_COUNTER(interface, name, value) interface->ipv4Context.counters.name += value
+#else
+   #define IPV4_INC_COUNTER(interface, name, value)
+#endif
+
 
 /**
  * @brief IPv4 related initialization
@@ -94,6 +101,13 @@ error_t ipv4Init(NetInterface *interface)
    memset(context->fragQueue, 0, sizeof(context->fragQueue));
 #endif
 
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   //Initialize the destination cache
+   memset(context->destCache, 0, sizeof(context->destCache));
+   //Generation 0 is reserved for entries that have never been used
+   context->destCacheGeneration = 1;
+#endif
+
    //Successful initialization
    return NO_ERROR;
 }
@@ -400,6 +414,11 @@ void ipv4LinkChangeEvent(NetInterface *interface)
    arpFlushCache(interface);
 #endif
 
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   //Flush destination cache
+   ipv4FlushDestCache(interface);
+#endif
+
 #if (IPV4_FRAG_SUPPORT == ENABLED)
    //Flush the reassembly queue
    ipv4FlushFragQueue(interface);
@@ -431,6 +450,12 @@ void ipv4LinkChangeEvent(NetInterface *interface)
 
 void ipv4ProcessPacket(NetInterface *interface, Ipv4Header *packet, size_t length)
 {
+#if (IPV4_COUNTER_BLOCK_SUPPORT == ENABLED)
+   //Total number of input datagrams received, including those received in error
+   IPV4_INC_COUNTER(interface, inReceives, 1);
+   //Total number of octets received in input IP datagrams
+   IPV4_INC_COUNTER(interface, inOctets, length);
+#else
    //Total number of input datagrams received, including those received in error
    MIB2_INC_COUNTER32(ipGroup.ipInReceives, 1);
    IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsInReceives, 1);
@@ -443,6 +468,7 @@ void ipv4ProcessPacket(NetInterface *interface, Ipv4Header *packet, size_t lengt
    IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCInOctets, length);
    IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsInOctets, length);
    IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCInOctets, length);
+#endif
 
    //Ensure the packet length is greater than 20 bytes
    if(length < sizeof(Ipv4Header))
@@ -565,8 +591,11 @@ void ipv4ProcessPacket(NetInterface *interface, Ipv4Header *packet, size_t lengt
 
    //The host must verify the IP header checksum on every received
    //datagram and silently discard every datagram that has a bad
-   //checksum (see RFC 1122 3.2.1.2)
-   if(ipCalcChecksum(packet, packet->headerLength * 4) != 0x0000)
+   //checksum (see RFC 1122 3.2.1.2). This check is skipped when the
+   //hardware has already discarded the frames with a bad checksum
+   if((!interface->nicDriver->autoIpv4ChecksumVerif ||
+      interface->nicRxChecksumBypassed) &&
+      ipCalcChecksum(packet, packet->headerLength * 4) != 0x0000)
    {
       //Debug message
       TRACE_WARNING("Wrong IP header checksum!\r\n");
@@ -736,11 +765,15 @@ void ipv4ProcessDatagram(NetInterface *interface, const NetBuffer *buffer)
    {
       //Total number of input datagrams successfully delivered to IP
       //user-protocols
+#if (IPV4_COUNTER_BLOCK_SUPPORT == ENABLED)
+      IPV4_INC_COUNTER(interface, inDelivers, 1);
+#else
       MIB2_INC_COUNTER32(ipGroup.ipInDelivers, 1);
       IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsInDelivers, 1);
       IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCInDelivers, 1);
       IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsInDelivers, 1);
       IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCInDelivers, 1);
+#endif
    }
 
    //Unreachable port?
@@ -760,11 +793,12 @@ void ipv4ProcessDatagram(NetInterface *interface, const NetBuffer *buffer)
  * @param[in] buffer Multi-part buffer containing the payload
  * @param[in] offset Offset to the first byte of the payload
  * @param[in] ttl TTL value. Default Time-To-Live is used when this parameter is zero
+ * @param[in] destCacheSlot Destination cache slot of the sender, if any
  * @return Error code
  **/
 
 error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   NetBuffer *buffer, size_t offset, uint8_t ttl)
+   NetBuffer *buffer, size_t offset, uint8_t ttl, Ipv4DestCacheEntry *destCacheSlot)
 {
    error_t error;
    size_t length;
@@ -772,11 +806,15 @@ error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader
 
    //Total number of IP datagrams which local IP user-protocols supplied to IP
    //in requests for transmission
+#if (IPV4_COUNTER_BLOCK_SUPPORT == ENABLED)
+   IPV4_INC_COUNTER(interface, outRequests, 1);
+#else
    MIB2_INC_COUNTER32(ipGroup.ipOutRequests, 1);
    IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsOutRequests, 1);
    IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCOutRequests, 1);
    IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsOutRequests, 1);
    IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCOutRequests, 1);
+#endif
 
    //Retrieve the length of payload
    length = netBufferGetLength(buffer) - offset;
@@ -798,7 +836,7 @@ error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader
    {
       //Send data as is
       error = ipv4SendPacket(interface,
-         pseudoHeader, id, 0, buffer, offset, ttl);
+         pseudoHeader, id, 0, buffer, offset, ttl, destCacheSlot);
    }
    //If the payload length exceeds the network interface MTU
    //then the device must fragment the data
@@ -807,7 +845,7 @@ error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader
 #if (IPV4_FRAG_SUPPORT == ENABLED)
       //Fragment IP datagram into smaller packets
       error = ipv4FragmentDatagram(interface,
-         pseudoHeader, id, buffer, offset, ttl);
+         pseudoHeader, id, buffer, offset, ttl, destCacheSlot);
 #else
       //Fragmentation is not supported
       error = ERROR_MESSAGE_TOO_LONG;
@@ -828,15 +866,20 @@ error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader
  * @param[in] buffer Multi-part buffer containing the payload
  * @param[in] offset Offset to the first byte of the payload
  * @param[in] ttl Time-To-Live value
+ * @param[in] destCacheSlot Destination cache slot of the sender, if any
  * @return Error code
  **/
 
 error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   uint16_t fragId, size_t fragOffset, NetBuffer *buffer, size_t offset, uint8_t ttl)
+   uint16_t fragId, size_t fragOffset, NetBuffer *buffer, size_t offset,
+   uint8_t ttl, Ipv4DestCacheEntry *destCacheSlot)
 {
    error_t error;
    size_t length;
    Ipv4Header *packet;
+#if (ETH_SUPPORT == ENABLED && IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   Ipv4DestCacheEntry *entry;
+#endif
 
    //Is there enough space for the IPv4 header?
    if(offset < sizeof(Ipv4Header))
@@ -847,6 +890,30 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
    //Calculate the size of the entire packet, including header and data
    length = netBufferGetLength(buffer) - offset;
 
+#if (ETH_SUPPORT == ENABLED && IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   //No destination cache entry for the moment
+   entry = NULL;
+
+   //Ethernet interface?
+   if(interface->nicDriver->type == NIC_TYPE_ETHERNET)
+   {
+      //Search the destination cache for the source/destination pair
+      entry = ipv4FindDestCacheEntry(interface, destCacheSlot,
+         pseudoHeader->srcAddr, pseudoHeader->destAddr);
+
+      //The prebuilt header can be used as long as the protocol and the TTL
+      //match those of the packet the entry was created for
+      if(entry != NULL && entry->header.protocol == pseudoHeader->protocol &&
+         entry->header.timeToLive == ttl)
+      {
+         //The addresses were checked and the next hop was resolved when
+         //the entry was created
+         return ipv4SendCachedPacket(interface, entry, fragId, fragOffset,
+            buffer, offset);
+      }
+   }
+#endif
+
    //Point to the IPv4 header
    packet = netBufferAt(buffer, offset);
 
@@ -863,8 +930,12 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
    packet->srcAddr = pseudoHeader->srcAddr;
    packet->destAddr = pseudoHeader->destAddr;
 
-   //Calculate IP header checksum
-   packet->headerChecksum = ipCalcChecksumEx(buffer, offset, packet->headerLength * 4);
+   //IP header checksum calculation not supported by hardware?
+   if(!interface->nicDriver->autoIpv4ChecksumCalc)
+   {
+      //Calculate IP header checksum
+      packet->headerChecksum = ipCalcChecksumEx(buffer, offset, packet->headerLength * 4);
+   }
 
    //Ensure the source address is valid
    error = ipv4CheckSourceAddr(interface, pseudoHeader->srcAddr);
@@ -895,10 +966,31 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
    {
       Ipv4Addr destIpAddr;
       MacAddr destMacAddr;
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+      bool_t cacheable;
+
+      //Only unicast next hops are recorded in the destination cache
+      cacheable = FALSE;
+#endif
 
       //Get the destination IPv4 address
       destIpAddr = pseudoHeader->destAddr;
 
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+      //The next hop has already been resolved?
+      if(entry != NULL)
+      {
+         //Use the cached next hop and link-layer address
+         destIpAddr = entry->nextHop;
+         destMacAddr = entry->macAddr;
+
+         //The prebuilt header is replaced with one for this protocol
+         cacheable = TRUE;
+         //No error to report
+         error = NO_ERROR;
+      }
+      else
+#endif
       //Destination address is a broadcast address?
       if(ipv4IsBroadcastAddr(interface, destIpAddr))
       {
@@ -920,12 +1012,22 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
          //Packets with a link-local source or destination address are not
          //routable off the link
          error = arpResolve(interface, destIpAddr, &destMacAddr);
+
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+         //The next hop can be cached
+         cacheable = TRUE;
+#endif
       }
       //Destination host is on the local subnet?
       else if(ipv4IsOnLocalSubnet(interface, destIpAddr))
       {
          //Resolve destination address before sending the packet
          error = arpResolve(interface, destIpAddr, &destMacAddr);
+
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+         //The next hop can be cached
+         cacheable = TRUE;
+#endif
       }
       //Destination host is outside the local subnet?
       else
@@ -937,6 +1039,11 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
             destIpAddr = interface->ipv4Context.defaultGateway;
             //Perform address resolution
             error = arpResolve(interface, destIpAddr, &destMacAddr);
+
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+            //The next hop can be cached
+            cacheable = TRUE;
+#endif
          }
          else
          {
@@ -953,6 +1060,15 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
       //Successful address resolution?
       if(!error)
       {
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+         //Record the resolved next hop for subsequent packets
+         if(cacheable)
+         {
+            ipv4AddDestCacheEntry(interface, destCacheSlot, packet,
+               arpFindEntry(interface, destIpAddr));
+         }
+#endif
+
          //Update IP statistics
          ipv4UpdateOutStats(interface, destIpAddr, length);
 
@@ -1012,6 +1128,85 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
 }
 
 
+#if (ETH_SUPPORT == ENABLED && IPV4_DEST_CACHE_SUPPORT == ENABLED)
+
+/**
+ * @brief Send an IPv4 packet using a destination cache entry
+ *
+ * The header is copied from the template held by the entry and only the
+ * fields that change from one packet to the next are filled in. The header
+ * checksum is updated incrementally (refer to RFC 1624)
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Destination cache entry
+ * @param[in] fragId Fragment identification field
+ * @param[in] fragOffset Fragment offset field
+ * @param[in] buffer Multi-part buffer containing the payload
+ * @param[in] offset Offset to the first byte of the IPv4 header
+ * @return Error code
+ **/
+
+error_t ipv4SendCachedPacket(NetInterface *interface, Ipv4DestCacheEntry *entry,
+   uint16_t fragId, size_t fragOffset, NetBuffer *buffer, size_t offset)
+{
+   uint32_t temp;
+   size_t length;
+   Ipv4Header *packet;
+
+   //Calculate the size of the entire packet, including header and data
+   length = netBufferGetLength(buffer) - offset;
+   //Point to the IPv4 header
+   packet = netBufferAt(buffer, offset);
+
+   //Copy the prebuilt header
+   *packet = entry->header;
+   //Fill in the variable fields
+   packet->totalLength = htons(length);
+   packet->identification = htons(fragId);
+   packet->fragmentOffset = htons(fragOffset);
+
+   //IP header checksum calculation not supported by hardware?
+   if(!interface->nicDriver->autoIpv4ChecksumCalc)
+   {
+      //The template checksum covers the fields that were left to zero
+      temp = (uint16_t) ~entry->header.headerChecksum;
+      temp += packet->totalLength;
+      temp += packet->identification;
+      temp += packet->fragmentOffset;
+
+      //Fold 32-bit sum to 16 bits
+      temp = (temp & 0xFFFF) + (temp >> 16);
+      temp = (temp & 0xFFFF) + (temp >> 16);
+
+      //Update IP header checksum
+      packet->headerChecksum = (uint16_t) ~temp;
+   }
+   else
+   {
+      //The checksum is computed by the hardware
+      packet->headerChecksum = 0;
+   }
+
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   //Keep the ARP entry of an active next hop away from eviction
+   arpTouchEntry(interface, entry->arpEntry);
+#endif
+
+   //Update IP statistics
+   ipv4UpdateOutStats(interface, entry->nextHop, length);
+
+   //Debug message
+   TRACE_INFO("Sending IPv4 packet (%" PRIuSIZE " bytes)...\r\n", length);
+   //Dump IP header contents for debugging purpose
+   ipv4DumpHeader(packet);
+
+   //Send Ethernet frame
+   return ethSendFrame(interface, &entry->macAddr, buffer, offset, ETH_TYPE_IPV4);
+}
+
+#endif
+
+
 /**
  * @brief Source IPv4 address filtering
  * @param[in] interface Underlying network interface
@@ -1257,6 +1452,43 @@ bool_t ipv4IsBroadcastAddr(NetInterface *interface, Ipv4Addr ipAddr)
 }
 
 
+/**
+ * @brief Check whether the checksum of an outgoing datagram is computed by hardware
+ *
+ * The checksum offload engine only processes unfragmented datagrams. The
+ * upper layer protocol must compute the checksum in software whenever the
+ * datagram is going to be fragmented
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] protocol Upper layer protocol (ICMP, TCP or UDP)
+ * @param[in] length Length of the upper layer message
+ * @return TRUE if the checksum is inserted by hardware, else FALSE
+ **/
+
+bool_t ipv4IsTxChecksumOffloaded(NetInterface *interface,
+   uint8_t protocol, size_t length)
+{
+   bool_t offload;
+
+   //Check upper layer protocol
+   if(protocol == IPV4_PROTOCOL_ICMP)
+      offload = interface->nicDriver->autoIcmpChecksumCalc;
+   else if(protocol == IPV4_PROTOCOL_TCP)
+      offload = interface->nicDriver->autoTcpChecksumCalc;
+   else if(protocol == IPV4_PROTOCOL_UDP)
+      offload = interface->nicDriver->autoUdpChecksumCalc;
+   else
+      offload = FALSE;
+
+   //Fragmented datagrams are not processed by the checksum offload engine
+   if((length + sizeof(Ipv4Header)) > interface->ipv4Context.linkMtu)
+      offload = FALSE;
+
+   //Return TRUE if the checksum is computed by hardware
+   return offload;
+}
+
+
 /**
  * @brief Retrieve the scope of an IPv4 address
  * @param[in] ipAddr IPv4 address
@@ -1528,6 +1760,191 @@ error_t ipv4MapMulticastAddrToMac(Ipv4Addr ipAddr, MacAddr *macAddr)
 }
 
 
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+
+/**
+ * @brief Map a destination address to a slot of the destination cache
+ * @param[in] destAddr Destination IPv4 address
+ * @return Index of the slot
+ **/
+
+uint_t ipv4HashDestAddr(Ipv4Addr destAddr)
+{
+   uint32_t h;
+
+   //Multiplicative hash. Consecutive addresses only differ in the upper
+   //bits of the product, which are the ones used to select the slot
+   h = ntohl(destAddr) * 0x9E3779B1;
+
+   //Return the index of the slot
+   return (uint_t) (((uint64_t) h * IPV4_DEST_CACHE_SIZE) >> 32);
+}
+
+
+/**
+ * @brief Search the destination cache for a given source/destination pair
+ *
+ * The slot of the sender, if any, is checked first. This saves connected
+ * sockets from colliding with each other in the shared direct-mapped table
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] destCacheSlot Destination cache slot of the sender, if any
+ * @param[in] srcAddr Source IPv4 address
+ * @param[in] destAddr Destination IPv4 address
+ * @return A pointer to the matching entry is returned. NULL is returned
+ *   if no valid entry could be found
+ **/
+
+Ipv4DestCacheEntry *ipv4FindDestCacheEntry(NetInterface *interface,
+   Ipv4DestCacheEntry *destCacheSlot, Ipv4Addr srcAddr, Ipv4Addr destAddr)
+{
+   Ipv4DestCacheEntry *entry;
+
+   //Check the slot of the sender
+   if(destCacheSlot != NULL)
+   {
+      //Matching entry?
+      if(ipv4CheckDestCacheEntry(interface, destCacheSlot, srcAddr, destAddr))
+         return destCacheSlot;
+   }
+
+   //The destination cache is direct-mapped
+   entry = &interface->ipv4Context.destCache[ipv4HashDestAddr(destAddr)];
+
+   //No matching entry?
+   if(!ipv4CheckDestCacheEntry(interface, entry, srcAddr, destAddr))
+      return NULL;
+
+   //Save a copy of the entry in the slot of the sender
+   if(destCacheSlot != NULL)
+      *destCacheSlot = *entry;
+
+   //Return a pointer to the matching entry
+   return entry;
+}
+
+
+/**
+ * @brief Record a resolved next hop in the destination cache
+ * @param[in] interface Underlying network interface
+ * @param[in] destCacheSlot Destination cache slot of the sender, if any
+ * @param[in] packet IPv4 header of the packet being sent
+ * @param[in] arpEntry ARP entry of the next hop
+ **/
+
+void ipv4AddDestCacheEntry(NetInterface *interface, Ipv4DestCacheEntry *destCacheSlot,
+   const Ipv4Header *packet, ArpCacheEntry *arpEntry)
+{
+   Ipv4Context *context;
+   Ipv4DestCacheEntry *entry;
+
+   //The next hop must have been resolved
+   if(arpEntry == NULL)
+      return;
+
+   //Point to the IPv4 context
+   context = &interface->ipv4Context;
+
+   //The new entry replaces any entry that maps to the same slot
+   entry = &context->destCache[ipv4HashDestAddr(packet->destAddr)];
+
+   //Save source and destination addresses
+   entry->srcAddr = packet->srcAddr;
+   entry->destAddr = packet->destAddr;
+   //Save the next hop and its link-layer address
+   entry->nextHop = arpEntry->ipAddr;
+   entry->macAddr = arpEntry->macAddr;
+   //Save the routing parameters the next hop was computed with
+   entry->subnetMask = context->subnetMask;
+   entry->defaultGateway = context->defaultGateway;
+   //The entry is valid until the generation counter is bumped
+   entry->generation = context->destCacheGeneration;
+   //or until the ARP entry of the next hop changes
+   entry->arpEntry = arpEntry;
+   entry->arpGeneration = arpEntry->generation;
+
+   //Save the header of the packet as a template for the next ones
+   entry->header = *packet;
+   entry->header.totalLength = 0;
+   entry->header.identification = 0;
+   entry->header.fragmentOffset = 0;
+   entry->header.headerChecksum = 0;
+   //Checksum of the template
+   entry->header.headerChecksum = ipCalcChecksum(&entry->header, sizeof(Ipv4Header));
+
+   //Save a copy of the entry in the slot of the sender
+   if(destCacheSlot != NULL)
+      *destCacheSlot = *entry;
+}
+
+
+/**
+ * @brief Check whether a destination cache entry is valid
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the destination cache entry
+ * @param[in] srcAddr Source IPv4 address
+ * @param[in] destAddr Destination IPv4 address
+ * @return TRUE if the entry matches the source/destination pair and has
+ *   not been invalidated, else FALSE
+ **/
+
+bool_t ipv4CheckDestCacheEntry(NetInterface *interface,
+   const Ipv4DestCacheEntry *entry, Ipv4Addr srcAddr, Ipv4Addr destAddr)
+{
+   Ipv4Context *context;
+
+   //Point to the IPv4 context
+   context = &interface->ipv4Context;
+
+   //The entry is invalidated whenever the generation counter is bumped
+   if(entry->generation != context->destCacheGeneration)
+      return FALSE;
+
+   //Check source and destination addresses
+   if(entry->destAddr != destAddr || entry->srcAddr != srcAddr)
+      return FALSE;
+
+   //The link-layer address of the next hop must not have been invalidated
+   if(entry->arpEntry->generation != entry->arpGeneration)
+      return FALSE;
+
+   //The next hop depends on the subnet mask and the default gateway
+   if(entry->subnetMask != context->subnetMask ||
+      entry->defaultGateway != context->defaultGateway)
+   {
+      return FALSE;
+   }
+
+   //The entry is valid
+   return TRUE;
+}
+
+
+/**
+ * @brief Flush destination cache
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipv4FlushDestCache(NetInterface *interface)
+{
+   //Invalidate all the entries at once
+   interface->ipv4Context.destCacheGeneration++;
+
+   //Generation 0 is reserved for entries that have never been used
+   if(interface->ipv4Context.destCacheGeneration == 0)
+   {
+      //Clear the destination cache
+      memset(interface->ipv4Context.destCache, 0,
+         sizeof(interface->ipv4Context.destCache));
+
+      //Restart the generation counter
+      interface->ipv4Context.destCacheGeneration = 1;
+   }
+}
+
+#endif
+
+
 /**
  * @brief Update IPv4 input statistics
  * @param[in] interface Underlying network interface
@@ -1596,6 +2013,14 @@ void ipv4UpdateOutStats(NetInterface *interface, Ipv4Addr destIpAddr, size_t len
       IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCOutMcastOctets, length);
    }
 
+#if (IPV4_COUNTER_BLOCK_SUPPORT == ENABLED)
+   //Total number of IP datagrams that this entity supplied to the lower
+   //layers for transmission
+   IPV4_INC_COUNTER(interface, outTransmits, 1);
+   //Total number of octets in IP datagrams delivered to the lower layers
+   //for transmission
+   IPV4_INC_COUNTER(interface, outOctets, length);
+#else
    //Total number of IP datagrams that this entity supplied to the lower
    //layers for transmission
    IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsOutTransmits, 1);
@@ -1609,6 +2034,74 @@ void ipv4UpdateOutStats(NetInterface *interface, Ipv4Addr destIpAddr, size_t len
    IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCOutOctets, length);
    IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsOutOctets, length);
    IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCOutOctets, length);
+#endif
+}
+
+
+/**
+ * @brief Fold the counter block of an interface into the MIB counters
+ *
+ * The SNMP agent calls this function (through netFoldCounters) before it
+ * reads any MIB object, and the TCP/IP stack calls it on every tick so
+ * that the 32-bit block counters cannot wrap between two folds
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipv4FoldCounters(NetInterface *interface)
+{
+#if (IPV4_COUNTER_BLOCK_SUPPORT == ENABLED)
+   Ipv4Counters *counters;
+
+   //Point to the counter block of the interface
+   counters = &interface->ipv4Context.counters;
+
+   //Total number of input datagrams received, including those received in error
+   MIB2_INC_COUNTER32(ipGroup.ipInReceives, counters->inReceives);
+   IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsInReceives, counters->inReceives);
+   IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCInReceives, counters->inReceives);
+   IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsInReceives, counters->inReceives);
+   IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCInReceives, counters->inReceives);
+
+   //Total number of octets received in input IP datagrams
+   IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsInOctets, counters->inOctets);
+   IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCInOctets, counters->inOctets);
+   IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsInOctets, counters->inOctets);
+   IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCInOctets, counters->inOctets);
+
+   //Total number of input datagrams successfully delivered to IP
+   //user-protocols
+   MIB2_INC_COUNTER32(ipGroup.ipInDelivers, counters->inDelivers);
+   IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsInDelivers, counters->inDelivers);
+   IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCInDelivers, counters->inDelivers);
+   IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsInDelivers, counters->inDelivers);
+   IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCInDelivers, counters->inDelivers);
+
+   //Total number of IP datagrams which local IP user-protocols supplied to IP
+   //in requests for transmission
+   MIB2_INC_COUNTER32(ipGroup.ipOutRequests, counters->outRequests);
+   IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsOutRequests, counters->outRequests);
+   IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCOutRequests, counters->outRequests);
+   IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsOutRequests, counters->outRequests);
+   IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCOutRequests, counters->outRequests);
+
+   //Total number of IP datagrams that this entity supplied to the lower
+   //layers for transmission
+   IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsOutTransmits, counters->outTransmits);
+   IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCOutTransmits, counters->outTransmits);
+   IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsOutTransmits, counters->outTransmits);
+   IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCOutTransmits, counters->outTransmits);
+
+   //Total number of octets in IP datagrams delivered to the lower layers
+   //for transmission
+   IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsOutOctets, counters->outOctets);
+   IP_MIB_INC_COUNTER64(ipv4SystemStats.ipSystemStatsHCOutOctets, counters->outOctets);
+   IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsOutOctets, counters->outOctets);
+   IP_MIB_INC_COUNTER64(ipv4IfStatsTable[interface->index].ipIfStatsHCOutOctets, counters->outOctets);
+
+   //The counter block is now empty
+   memset(counters, 0, sizeof(Ipv4Counters));
+#endif
 }
 
 
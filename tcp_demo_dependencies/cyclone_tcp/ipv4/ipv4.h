@@ -36,6 +36,9 @@ struct _Ipv4Header;
 struct _Ipv4PseudoHeader;
 #define Ipv4PseudoHeader struct _Ipv4PseudoHeader
 
+struct _Ipv4DestCacheEntry;
+#define Ipv4DestCacheEntry struct _Ipv4DestCacheEntry
+
 //Dependencies
 #include <string.h>
 #include "core/net.h"
@@ -70,6 +73,27 @@ struct _Ipv4PseudoHeader;
    #error IPV4_MULTICAST_FILTER_SIZE parameter is not valid
 #endif
 
+//Destination cache support
+#ifndef IPV4_DEST_CACHE_SUPPORT
+   #define IPV4_DEST_CACHE_SUPPORT DISABLED
+#elif (IPV4_DEST_CACHE_SUPPORT != ENABLED && IPV4_DEST_CACHE_SUPPORT != DISABLED)
+   #error IPV4_DEST_CACHE_SUPPORT parameter is not valid
+#endif
+
+//Size of the destination cache
+#ifndef IPV4_DEST_CACHE_SIZE
+   #define IPV4_DEST_CACHE_SIZE 8
+#elif (IPV4_DEST_CACHE_SIZE < 1)
+   #error IPV4_DEST_CACHE_SIZE parameter is not valid
+#endif
+
+//Per-interface counter blocks for fast-path statistics
+#ifndef IPV4_COUNTER_BLOCK_SUPPORT
+   #define IPV4_COUNTER_BLOCK_SUPPORT ENABLED
+#elif (IPV4_COUNTER_BLOCK_SUPPORT != ENABLED && IPV4_COUNTER_BLOCK_SUPPORT != DISABLED)
+   #error IPV4_COUNTER_BLOCK_SUPPORT parameter is not valid
+#endif
+
 //Version number for IPv4
 #define IPV4_VERSION 4
 //Minimum MTU
@@ -308,6 +332,43 @@ typedef struct
 } Ipv4FilterEntry;
 
 
+/**
+ * @brief Destination cache entry
+ **/
+
+struct _Ipv4DestCacheEntry
+{
+   Ipv4Addr srcAddr;        ///<Source IPv4 address
+   Ipv4Addr destAddr;       ///<Destination IPv4 address
+   Ipv4Addr nextHop;        ///<IPv4 address of the next hop
+   MacAddr macAddr;         ///<Link-layer address of the next hop
+   Ipv4Addr subnetMask;     ///<Subnet mask the entry was computed with
+   Ipv4Addr defaultGateway; ///<Default gateway the entry was computed with
+   uint_t generation;       ///<Generation counter value at creation time
+   struct _ArpCacheEntry *arpEntry; ///<ARP entry the next hop was resolved with
+   uint_t arpGeneration;    ///<Generation of the ARP entry at creation time
+   Ipv4Header header;       ///<Prebuilt IPv4 header (length, identification and fragment offset set to zero)
+};
+
+
+/**
+ * @brief IPv4 counter block
+ *
+ * Statistics updated for every datagram are accumulated here and added to
+ * the MIB-II and IP-MIB counters by ipv4FoldCounters()
+ **/
+
+typedef struct
+{
+   uint32_t inReceives;   ///<Input datagrams received, including those received in error
+   uint32_t inOctets;     ///<Octets received in input datagrams
+   uint32_t inDelivers;   ///<Input datagrams delivered to IP user-protocols
+   uint32_t outRequests;  ///<Datagrams supplied to IP in requests for transmission
+   uint32_t outTransmits; ///<Datagrams supplied to the lower layers for transmission
+   uint32_t outOctets;    ///<Octets supplied to the lower layers for transmission
+} Ipv4Counters;
+
+
 /**
  * @brief IPv4 context
  **/
@@ -327,6 +388,13 @@ typedef struct
 #if (IPV4_FRAG_SUPPORT == ENABLED)
    Ipv4FragDesc fragQueue[IPV4_MAX_FRAG_DATAGRAMS];             ///<IPv4 fragment reassembly queue
 #endif
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   Ipv4DestCacheEntry destCache[IPV4_DEST_CACHE_SIZE];          ///<Destination cache
+   uint_t destCacheGeneration;                                  ///<Destination cache generation counter
+#endif
+#if (IPV4_COUNTER_BLOCK_SUPPORT == ENABLED)
+   Ipv4Counters counters;                                       ///<Statistics not yet folded into the MIB counters
+#endif
 } Ipv4Context;
 
 
@@ -353,10 +421,14 @@ void ipv4ProcessPacket(NetInterface *interface, Ipv4Header *packet, size_t lengt
 void ipv4ProcessDatagram(NetInterface *interface, const NetBuffer *buffer);
 
 error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   NetBuffer *buffer, size_t offset, uint8_t ttl);
+   NetBuffer *buffer, size_t offset, uint8_t ttl, Ipv4DestCacheEntry *destCacheSlot);
 
 error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   uint16_t fragId, size_t fragOffset, NetBuffer *buffer, size_t offset, uint8_t ttl);
+   uint16_t fragId, size_t fragOffset, NetBuffer *buffer, size_t offset,
+   uint8_t ttl, Ipv4DestCacheEntry *destCacheSlot);
+
+error_t ipv4SendCachedPacket(NetInterface *interface, Ipv4DestCacheEntry *entry,
+   uint16_t fragId, size_t fragOffset, NetBuffer *buffer, size_t offset);
 
 error_t ipv4CheckSourceAddr(NetInterface *interface, Ipv4Addr ipAddr);
 error_t ipv4CheckDestAddr(NetInterface *interface, Ipv4Addr ipAddr);
@@ -366,6 +438,9 @@ error_t ipv4SelectSourceAddr(NetInterface **interface,
 
 bool_t ipv4IsBroadcastAddr(NetInterface *interface, Ipv4Addr ipAddr);
 
+bool_t ipv4IsTxChecksumOffloaded(NetInterface *interface,
+   uint8_t protocol, size_t length);
+
 uint_t ipv4GetAddrScope(Ipv4Addr ipAddr);
 uint_t ipv4GetPrefixLength(Ipv4Addr mask);
 
@@ -374,8 +449,22 @@ error_t ipv4LeaveMulticastGroup(NetInterface *interface, Ipv4Addr groupAddr);
 
 error_t ipv4MapMulticastAddrToMac(Ipv4Addr ipAddr, MacAddr *macAddr);
 
+uint_t ipv4HashDestAddr(Ipv4Addr destAddr);
+
+Ipv4DestCacheEntry *ipv4FindDestCacheEntry(NetInterface *interface,
+   Ipv4DestCacheEntry *destCacheSlot, Ipv4Addr srcAddr, Ipv4Addr destAddr);
+
+void ipv4AddDestCacheEntry(NetInterface *interface, Ipv4DestCacheEntry *destCacheSlot,
+   const Ipv4Header *packet, struct _ArpCacheEntry *arpEntry);
+
+bool_t ipv4CheckDestCacheEntry(NetInterface *interface,
+   const Ipv4DestCacheEntry *entry, Ipv4Addr srcAddr, Ipv4Addr destAddr);
+
+void ipv4FlushDestCache(NetInterface *interface);
+
 void ipv4UpdateInStats(NetInterface *interface, Ipv4Addr destIpAddr, size_t length);
 void ipv4UpdateOutStats(NetInterface *interface, Ipv4Addr destIpAddr, size_t length);
+void ipv4FoldCounters(NetInterface *interface);
 
 error_t ipv4StringToAddr(const char_t *str, Ipv4Addr *ipAddr);
 char_t *ipv4AddrToString(Ipv4Addr ipAddr, char_t *str);
@@ -44,6 +44,7 @@
 #include "ipv4/ipv4.h"
 #include "ipv4/ipv4_frag.h"
 #include "ipv4/icmp.h"
+#include "core/udp.h"
 #include "mibs/mib2_module.h"
 #include "mibs/ip_mib_module.h"
 #include "debug.h"
@@ -63,11 +64,13 @@ systime_t ipv4FragTickCounter;
  * @param[in] payload Multi-part buffer containing the payload
  * @param[in] payloadOffset Offset to the first payload byte
  * @param[in] timeToLive TTL value
+ * @param[in] destCacheSlot Destination cache slot of the sender, if any
  * @return Error code
  **/
 
 error_t ipv4FragmentDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   uint16_t id, const NetBuffer *payload, size_t payloadOffset, uint8_t timeToLive)
+   uint16_t id, const NetBuffer *payload, size_t payloadOffset, uint8_t timeToLive,
+   Ipv4DestCacheEntry *destCacheSlot)
 {
    error_t error;
    size_t offset;
@@ -117,7 +120,7 @@ error_t ipv4FragmentDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHe
 
          //Do not set the MF flag for the last fragment
          error = ipv4SendPacket(interface, pseudoHeader, id,
-            offset / 8, fragment, fragmentOffset, timeToLive);
+            offset / 8, fragment, fragmentOffset, timeToLive, destCacheSlot);
       }
       else
       {
@@ -127,8 +130,8 @@ error_t ipv4FragmentDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHe
          netBufferConcat(fragment, payload, payloadOffset + offset, length);
 
          //Fragmented packets must have the MF flag set
-         error = ipv4SendPacket(interface, pseudoHeader, id,
-            IPV4_FLAG_MF | (offset / 8), fragment, fragmentOffset, timeToLive);
+         error = ipv4SendPacket(interface, pseudoHeader, id, IPV4_FLAG_MF |
+            (offset / 8), fragment, fragmentOffset, timeToLive, destCacheSlot);
       }
 
       //Failed to send current IP packet?
@@ -180,6 +183,7 @@ void ipv4ReassembleDatagram(NetInterface *interface,
    uint16_t offset;
    uint16_t dataFirst;
    uint16_t dataLast;
+   size_t n;
    Ipv4FragDesc *frag;
    Ipv4HoleDesc *hole;
    Ipv4HoleDesc *prevHole;
@@ -226,6 +230,44 @@ void ipv4ReassembleDatagram(NetInterface *interface,
       return;
    }
 
+   //Number of bytes of the fragment that fall into a hole
+   n = 0;
+
+   //Loop through the hole descriptor list
+   for(hole = ipv4FindHole(frag, frag->firstHole); hole != NULL;
+      hole = ipv4FindHole(frag, hole->next))
+   {
+      //Check whether the fragment interacts with the current hole
+      if(dataFirst < hole->last && dataLast > hole->first)
+         n += MIN(dataLast, hole->last) - MAX(dataFirst, hole->first);
+   }
+
+#if (IPV4_FRAG_DROP_OVERLAPPING == ENABLED)
+   //The fragment only carries data that has already been received?
+   if(n == 0 && length > 0)
+   {
+      //Exact or contained duplicates are commonly caused by retransmissions
+      //in the network and are silently ignored
+      return;
+   }
+   //Part of the fragment overlaps data that has already been received?
+   else if(n < length)
+   {
+      //Debug message
+      TRACE_WARNING("Overlapping IPv4 fragment!\r\n");
+
+      //Number of failures detected by the IP reassembly algorithm
+      MIB2_INC_COUNTER32(ipGroup.ipReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+      //Drop the whole datagram
+      netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+      //Exit immediately
+      return;
+   }
+#endif
+
    //The very first fragment requires special handling
    if(!(offset & IPV4_OFFSET_MASK))
    {
@@ -283,9 +325,29 @@ void ipv4ReassembleDatagram(NetInterface *interface,
          return;
       }
 
-      //Adjust the size of the reconstructed datagram
-      error = netBufferSetLength((NetBuffer *) &frag->buffer,
-         frag->headerLength + dataLast + sizeof(Ipv4HoleDesc));
+      //If the memory budget would be exceeded, make room for the larger
+      //datagram by discarding datagrams that made less progress
+      while((ipv4GetFragQueueSize(interface, frag) + frag->headerLength +
+         dataLast + sizeof(Ipv4HoleDesc)) > IPV4_MAX_FRAG_TOTAL_SIZE)
+      {
+         //No other datagram can be discarded?
+         if(!ipv4EvictFrag(interface, frag, frag->receivedLength + n))
+            break;
+      }
+
+      //The memory budget cannot be met?
+      if((ipv4GetFragQueueSize(interface, frag) + frag->headerLength +
+         dataLast + sizeof(Ipv4HoleDesc)) > IPV4_MAX_FRAG_TOTAL_SIZE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_MEMORY;
+      }
+      else
+      {
+         //Adjust the size of the reconstructed datagram
+         error = netBufferSetLength((NetBuffer *) &frag->buffer,
+            frag->headerLength + dataLast + sizeof(Ipv4HoleDesc));
+      }
 
       //Any error to report?
       if(error)
@@ -391,6 +453,9 @@ void ipv4ReassembleDatagram(NetInterface *interface,
    netBufferWrite((NetBuffer *) &frag->buffer,
       frag->headerLength + dataFirst, IPV4_DATA(packet), length);
 
+   //Keep track of the progress of the reassembly
+   frag->receivedLength += n;
+
    //Dump hole descriptor list
    ipv4DumpHoleList(frag);
 
@@ -424,8 +489,15 @@ void ipv4ReassembleDatagram(NetInterface *interface,
          IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmOKs, 1);
          IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmOKs, 1);
 
-         //Pass the original IPv4 datagram to the higher protocol layer
-         ipv4ProcessDatagram(interface, (NetBuffer *) &frag->buffer);
+         //The checksum offload engine does not process fragmented datagrams
+         error = ipv4CheckReassembledChecksum(interface, (NetBuffer *) &frag->buffer);
+
+         //Valid checksum?
+         if(!error)
+         {
+            //Pass the original IPv4 datagram to the higher protocol layer
+            ipv4ProcessDatagram(interface, (NetBuffer *) &frag->buffer);
+         }
       }
 
       //Release previously allocated memory
@@ -434,6 +506,95 @@ void ipv4ReassembleDatagram(NetInterface *interface,
 }
 
 
+/**
+ * @brief Verify the upper layer checksum of a reassembled datagram
+ *
+ * When receive checksum offload is enabled, the upper layer protocols rely
+ * on the hardware to discard corrupted frames. Since fragmented datagrams are
+ * bypassed by the checksum offload engine, the checksum of the reassembled
+ * datagram has to be verified in software
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer that holds the reassembled datagram
+ * @return Error code
+ **/
+
+error_t ipv4CheckReassembledChecksum(NetInterface *interface,
+   const NetBuffer *buffer)
+{
+   size_t offset;
+   size_t length;
+   uint16_t checksum;
+   Ipv4Header *header;
+   UdpHeader *udpHeader;
+   IpPseudoHeader pseudoHeader;
+
+   //Point to the IPv4 header
+   header = netBufferAt(buffer, 0);
+   //Sanity check
+   if(header == NULL)
+      return ERROR_FAILURE;
+
+   //Get the offset to the payload
+   offset = header->headerLength * 4;
+   //Compute the length of the payload
+   length = netBufferGetLength(buffer) - offset;
+
+   //Form the IPv4 pseudo header
+   pseudoHeader.length = sizeof(Ipv4PseudoHeader);
+   pseudoHeader.ipv4Data.srcAddr = header->srcAddr;
+   pseudoHeader.ipv4Data.destAddr = header->destAddr;
+   pseudoHeader.ipv4Data.reserved = 0;
+   pseudoHeader.ipv4Data.protocol = header->protocol;
+   pseudoHeader.ipv4Data.length = htons(length);
+
+   //The upper layer verifies the checksum itself when offload is not used
+   if(!ipIsRxChecksumOffloaded(interface, &pseudoHeader))
+      return NO_ERROR;
+
+   //Check the protocol field
+   if(header->protocol == IPV4_PROTOCOL_ICMP)
+   {
+      //The ICMP checksum does not cover any pseudo header
+      checksum = ipCalcChecksumEx(buffer, offset, length);
+   }
+   else
+   {
+      //UDP datagram?
+      if(header->protocol == IPV4_PROTOCOL_UDP)
+      {
+         //Malformed datagrams are discarded by the upper layer
+         if(length < sizeof(UdpHeader))
+            return NO_ERROR;
+
+         //Point to the UDP header
+         udpHeader = netBufferAt(buffer, offset);
+
+         //An all zero checksum means that the transmitter
+         //generated no checksum
+         if(udpHeader == NULL || udpHeader->checksum == 0x0000)
+            return NO_ERROR;
+      }
+
+      //Verify TCP or UDP checksum
+      checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv4Data,
+         sizeof(Ipv4PseudoHeader), buffer, offset, length);
+   }
+
+   //Wrong checksum?
+   if(checksum != 0x0000)
+   {
+      //Debug message
+      TRACE_WARNING("Wrong checksum in reassembled datagram!\r\n");
+      //Drop the datagram
+      return ERROR_WRONG_CHECKSUM;
+   }
+
+   //The checksum is valid
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Fragment reassembly timeout handler
  *
@@ -515,10 +676,14 @@ Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *pac
 {
    error_t error;
    uint_t i;
+   uint_t n;
    Ipv4Header *datagram;
    Ipv4FragDesc *frag;
    Ipv4HoleDesc *hole;
 
+   //Number of datagrams from the same source
+   n = 0;
+
    //Search for a matching IP datagram being reassembled
    for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
    {
@@ -534,6 +699,10 @@ Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *pac
          //Check source and destination addresses
          if(datagram->srcAddr != packet->srcAddr)
             continue;
+
+         //Count the datagrams from the same source
+         n++;
+
          if(datagram->destAddr != packet->destAddr)
             continue;
          //Compare identification and protocol fields
@@ -547,6 +716,15 @@ Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *pac
       }
    }
 
+   //A single source cannot take over the whole reassembly queue
+   if(n >= IPV4_MAX_FRAG_DATAGRAMS_PER_SRC)
+   {
+      //Debug message
+      TRACE_INFO("Too many IPv4 datagrams from the same source being reassembled!\r\n");
+      //Drop the incoming fragment
+      return NULL;
+   }
+
    //If the current packet does not match an existing entry
    //in the reassembly queue, then create a new entry
    for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
@@ -557,6 +735,14 @@ Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *pac
       //The current entry is free?
       if(!frag->buffer.chunkCount)
       {
+         //The memory budget applies to new datagrams as well
+         if((ipv4GetFragQueueSize(interface, NULL) + NET_MEM_POOL_BUFFER_SIZE +
+            sizeof(Ipv4HoleDesc)) > IPV4_MAX_FRAG_TOTAL_SIZE)
+         {
+            //Drop the incoming fragment
+            return NULL;
+         }
+
          //Number of chunks that comprise the reassembly buffer
          frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
 
@@ -577,6 +763,8 @@ Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *pac
          //Initial length of the reconstructed datagram
          frag->headerLength = packet->headerLength * 4;
          frag->dataLength = 0;
+         //No payload has been received yet
+         frag->receivedLength = 0;
 
          //Fix the length of the first chunk
          frag->buffer.chunk[0].length = frag->headerLength;
@@ -603,7 +791,8 @@ Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *pac
       }
    }
 
-   //The reassembly queue is full
+   //The reassembly queue is full. New datagrams are dropped rather than
+   //evicting datagrams that are already in progress
    return NULL;
 }
 
@@ -626,6 +815,104 @@ void ipv4FlushFragQueue(NetInterface *interface)
 }
 
 
+/**
+ * @brief Get the amount of memory used by the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @param[in] exclude Entry that is not taken into account (optional parameter)
+ * @return Total length of the reassembly buffers, in bytes
+ **/
+
+size_t ipv4GetFragQueueSize(NetInterface *interface, const Ipv4FragDesc *exclude)
+{
+   uint_t i;
+   size_t size;
+   Ipv4FragDesc *frag;
+
+   //Total length of the reassembly buffers
+   size = 0;
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Point to the current entry in the reassembly queue
+      frag = &interface->ipv4Context.fragQueue[i];
+
+      //Check whether the current entry is used?
+      if(frag->buffer.chunkCount > 0 && frag != exclude)
+         size += netBufferGetLength((NetBuffer *) &frag->buffer);
+   }
+
+   //Return the amount of memory in use
+   return size;
+}
+
+
+/**
+ * @brief Discard the datagram that made the least progress
+ *
+ * Only datagrams that received less payload than the one that needs room
+ * can be discarded, so that a flood of bogus fragments cannot push out
+ * datagrams that are close to completion. Among them, the oldest one is
+ * selected
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Datagram that needs room in the reassembly queue
+ * @param[in] receivedLength Number of payload bytes received for that datagram
+ * @return TRUE if a datagram has been discarded, else FALSE
+ **/
+
+bool_t ipv4EvictFrag(NetInterface *interface, const Ipv4FragDesc *frag,
+   size_t receivedLength)
+{
+   uint_t i;
+   Ipv4FragDesc *entry;
+   Ipv4FragDesc *victim;
+
+   //Keep track of the entry to be discarded
+   victim = NULL;
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Point to the current entry in the reassembly queue
+      entry = &interface->ipv4Context.fragQueue[i];
+
+      //Skip unused entries and the entry that needs room
+      if(entry->buffer.chunkCount == 0 || entry == frag)
+         continue;
+      //Skip entries that made as much progress
+      if(entry->receivedLength >= receivedLength)
+         continue;
+
+      //Select the entry that made the least progress, then the oldest one
+      if(victim == NULL || entry->receivedLength < victim->receivedLength ||
+         (entry->receivedLength == victim->receivedLength &&
+         timeCompare(entry->timestamp, victim->timestamp) < 0))
+      {
+         victim = entry;
+      }
+   }
+
+   //No entry can be discarded?
+   if(victim == NULL)
+      return FALSE;
+
+   //Debug message
+   TRACE_INFO("Discarding IPv4 datagram from the reassembly queue...\r\n");
+
+   //Number of failures detected by the IP reassembly algorithm
+   MIB2_INC_COUNTER32(ipGroup.ipReasmFails, 1);
+   IP_MIB_INC_COUNTER32(ipv4SystemStats.ipSystemStatsReasmFails, 1);
+   IP_MIB_INC_COUNTER32(ipv4IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+   //Drop the partially reconstructed datagram
+   netBufferSetLength((NetBuffer *) &victim->buffer, 0);
+
+   //An entry has been released
+   return TRUE;
+}
+
+
 /**
  * @brief Retrieve hole descriptor
  * @param[in] frag IPv4 fragment descriptor
@@ -62,6 +62,28 @@
    #error IPV4_MAX_FRAG_DATAGRAM_SIZE parameter is not valid
 #endif
 
+//Maximum amount of memory used by the reassembly queue (by default, only
+//half of the datagrams can grow to the maximum size at the same time)
+#ifndef IPV4_MAX_FRAG_TOTAL_SIZE
+   #define IPV4_MAX_FRAG_TOTAL_SIZE (((IPV4_MAX_FRAG_DATAGRAMS + 1) / 2) * IPV4_MAX_FRAG_DATAGRAM_SIZE)
+#elif (IPV4_MAX_FRAG_TOTAL_SIZE < IPV4_MAX_FRAG_DATAGRAM_SIZE)
+   #error IPV4_MAX_FRAG_TOTAL_SIZE parameter is not valid
+#endif
+
+//Maximum number of datagrams a single source can have in the reassembly queue
+#ifndef IPV4_MAX_FRAG_DATAGRAMS_PER_SRC
+   #define IPV4_MAX_FRAG_DATAGRAMS_PER_SRC ((IPV4_MAX_FRAG_DATAGRAMS + 1) / 2)
+#elif (IPV4_MAX_FRAG_DATAGRAMS_PER_SRC < 1)
+   #error IPV4_MAX_FRAG_DATAGRAMS_PER_SRC parameter is not valid
+#endif
+
+//Discard datagrams whose fragments overlap
+#ifndef IPV4_FRAG_DROP_OVERLAPPING
+   #define IPV4_FRAG_DROP_OVERLAPPING ENABLED
+#elif (IPV4_FRAG_DROP_OVERLAPPING != ENABLED && IPV4_FRAG_DROP_OVERLAPPING != DISABLED)
+   #error IPV4_FRAG_DROP_OVERLAPPING parameter is not valid
+#endif
+
 //Maximum time an IPv4 fragment can spend waiting to be reassembled
 #ifndef IPV4_FRAG_TIME_TO_LIVE
    #define IPV4_FRAG_TIME_TO_LIVE 15000
@@ -123,6 +145,7 @@ typedef struct
    systime_t timestamp;         ///<Time at which the first fragment was received
    size_t headerLength;         ///<Length of the header
    size_t dataLength;           ///<Length of the payload
+   size_t receivedLength;       ///<Number of payload bytes received so far
    uint16_t firstHole;          ///<Index of the first hole
    Ipv4ReassemblyBuffer buffer; ///<Buffer containing the reassembled datagram
 } Ipv4FragDesc;
@@ -133,16 +156,24 @@ extern systime_t ipv4FragTickCounter;
 
 //IPv4 datagram fragmentation and reassembly
 error_t ipv4FragmentDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   uint16_t id, const NetBuffer *payload, size_t payloadOffset, uint8_t timeToLive);
+   uint16_t id, const NetBuffer *payload, size_t payloadOffset, uint8_t timeToLive,
+   Ipv4DestCacheEntry *destCacheSlot);
 
 void ipv4ReassembleDatagram(NetInterface *interface,
    const Ipv4Header *packet, size_t length);
 
+error_t ipv4CheckReassembledChecksum(NetInterface *interface,
+   const NetBuffer *buffer);
+
 void ipv4FragTick(NetInterface *interface);
 
 Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *packet);
 void ipv4FlushFragQueue(NetInterface *interface);
 
+size_t ipv4GetFragQueueSize(NetInterface *interface, const Ipv4FragDesc *exclude);
+bool_t ipv4EvictFrag(NetInterface *interface, const Ipv4FragDesc *frag,
+   size_t receivedLength);
+
 Ipv4HoleDesc *ipv4FindHole(Ipv4FragDesc *frag, uint16_t offset);
 void ipv4DumpHoleList(Ipv4FragDesc *frag);
 
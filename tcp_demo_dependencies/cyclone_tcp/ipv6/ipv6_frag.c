@@ -175,6 +175,7 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
    error_t error;
    size_t n;
    size_t length;
+   size_t holeLength;
    uint16_t offset;
    uint16_t dataFirst;
    uint16_t dataLast;
@@ -258,6 +259,43 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
       return;
    }
 
+   //Number of bytes of the fragment that fall into a hole
+   holeLength = 0;
+
+   //Loop through the hole descriptor list
+   for(hole = ipv6FindHole(frag, frag->firstHole); hole != NULL;
+      hole = ipv6FindHole(frag, hole->next))
+   {
+      //Check whether the fragment interacts with the current hole
+      if(dataFirst < hole->last && dataLast > hole->first)
+         holeLength += MIN(dataLast, hole->last) - MAX(dataFirst, hole->first);
+   }
+
+#if (IPV6_FRAG_DROP_OVERLAPPING == ENABLED)
+   //The fragment only carries data that has already been received?
+   if(holeLength == 0 && length > 0)
+   {
+      //Exact or contained duplicates are commonly caused by retransmissions
+      //in the network and are silently ignored
+      return;
+   }
+   //Part of the fragment overlaps data that has already been received?
+   else if(holeLength < length)
+   {
+      //Debug message
+      TRACE_WARNING("Overlapping IPv6 fragment!\r\n");
+
+      //Number of failures detected by the IP reassembly algorithm
+      IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+      //Drop the whole datagram
+      netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+      //Exit immediately
+      return;
+   }
+#endif
+
    //The very first fragment requires special handling
    if(!(offset & IPV6_OFFSET_MASK))
    {
@@ -349,9 +387,29 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
          return;
       }
 
-      //Adjust the size of the reconstructed datagram
-      error = netBufferSetLength((NetBuffer *) &frag->buffer,
-         frag->unfragPartLength + dataLast + sizeof(Ipv6HoleDesc));
+      //If the memory budget would be exceeded, make room for the larger
+      //datagram by discarding datagrams that made less progress
+      while((ipv6GetFragQueueSize(interface, frag) + frag->unfragPartLength +
+         dataLast + sizeof(Ipv6HoleDesc)) > IPV6_MAX_FRAG_TOTAL_SIZE)
+      {
+         //No other datagram can be discarded?
+         if(!ipv6EvictFrag(interface, frag, frag->receivedLength + holeLength))
+            break;
+      }
+
+      //The memory budget cannot be met?
+      if((ipv6GetFragQueueSize(interface, frag) + frag->unfragPartLength +
+         dataLast + sizeof(Ipv6HoleDesc)) > IPV6_MAX_FRAG_TOTAL_SIZE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_MEMORY;
+      }
+      else
+      {
+         //Adjust the size of the reconstructed datagram
+         error = netBufferSetLength((NetBuffer *) &frag->buffer,
+            frag->unfragPartLength + dataLast + sizeof(Ipv6HoleDesc));
+      }
 
       //Any error to report?
       if(error)
@@ -456,6 +514,9 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
    netBufferCopy((NetBuffer *) &frag->buffer, frag->unfragPartLength + dataFirst,
       ipPacket, fragHeaderOffset + sizeof(Ipv6FragmentHeader), length);
 
+   //Keep track of the progress of the reassembly
+   frag->receivedLength += holeLength;
+
    //Dump hole descriptor list
    ipv6DumpHoleList(frag);
 
@@ -578,10 +639,14 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
 {
    error_t error;
    uint_t i;
+   uint_t n;
    Ipv6Header *datagram;
    Ipv6FragDesc *frag;
    Ipv6HoleDesc *hole;
 
+   //Number of datagrams from the same source
+   n = 0;
+
    //Search for a matching IP datagram being reassembled
    for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
    {
@@ -597,6 +662,10 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
          //Check source and destination addresses
          if(!ipv6CompAddr(&datagram->srcAddr, &packet->srcAddr))
             continue;
+
+         //Count the datagrams from the same source
+         n++;
+
          if(!ipv6CompAddr(&datagram->destAddr, &packet->destAddr))
             continue;
          //Compare fragment identification fields
@@ -608,6 +677,15 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
       }
    }
 
+   //A single source cannot take over the whole reassembly queue
+   if(n >= IPV6_MAX_FRAG_DATAGRAMS_PER_SRC)
+   {
+      //Debug message
+      TRACE_INFO("Too many IPv6 datagrams from the same source being reassembled!\r\n");
+      //Drop the incoming fragment
+      return NULL;
+   }
+
    //If the current packet does not match an existing entry
    //in the reassembly queue, then create a new entry
    for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
@@ -618,6 +696,14 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
       //The current entry is free?
       if(!frag->buffer.chunkCount)
       {
+         //The memory budget applies to new datagrams as well
+         if((ipv6GetFragQueueSize(interface, NULL) + NET_MEM_POOL_BUFFER_SIZE +
+            sizeof(Ipv6HoleDesc)) > IPV6_MAX_FRAG_TOTAL_SIZE)
+         {
+            //Drop the incoming fragment
+            return NULL;
+         }
+
          //Number of chunks that comprise the reassembly buffer
          frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
 
@@ -638,6 +724,8 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
          //Initial length of the reconstructed datagram
          frag->unfragPartLength = sizeof(Ipv6Header);
          frag->fragPartLength = 0;
+         //No payload has been received yet
+         frag->receivedLength = 0;
 
          //Fix the length of the first chunk
          frag->buffer.chunk[0].length = frag->unfragPartLength;
@@ -689,6 +777,101 @@ void ipv6FlushFragQueue(NetInterface *interface)
 }
 
 
+/**
+ * @brief Get the amount of memory used by the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @param[in] exclude Entry that is not taken into account (optional parameter)
+ * @return Total length of the reassembly buffers, in bytes
+ **/
+
+size_t ipv6GetFragQueueSize(NetInterface *interface, const Ipv6FragDesc *exclude)
+{
+   uint_t i;
+   size_t size;
+   Ipv6FragDesc *frag;
+
+   //Total length of the reassembly buffers
+   size = 0;
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Point to the current entry in the reassembly queue
+      frag = &interface->ipv6Context.fragQueue[i];
+
+      //Check whether the current entry is used?
+      if(frag->buffer.chunkCount > 0 && frag != exclude)
+         size += netBufferGetLength((NetBuffer *) &frag->buffer);
+   }
+
+   //Return the amount of memory in use
+   return size;
+}
+
+
+/**
+ * @brief Discard the datagram that made the least progress
+ *
+ * Only datagrams that received less payload than the one that needs room
+ * can be discarded. Among them, the oldest one is selected
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Datagram that needs room in the reassembly queue
+ * @param[in] receivedLength Number of payload bytes received for that datagram
+ * @return TRUE if a datagram has been discarded, else FALSE
+ **/
+
+bool_t ipv6EvictFrag(NetInterface *interface, const Ipv6FragDesc *frag,
+   size_t receivedLength)
+{
+   uint_t i;
+   Ipv6FragDesc *entry;
+   Ipv6FragDesc *victim;
+
+   //Keep track of the entry to be discarded
+   victim = NULL;
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Point to the current entry in the reassembly queue
+      entry = &interface->ipv6Context.fragQueue[i];
+
+      //Skip unused entries and the entry that needs room
+      if(entry->buffer.chunkCount == 0 || entry == frag)
+         continue;
+      //Skip entries that made as much progress
+      if(entry->receivedLength >= receivedLength)
+         continue;
+
+      //Select the entry that made the least progress, then the oldest one
+      if(victim == NULL || entry->receivedLength < victim->receivedLength ||
+         (entry->receivedLength == victim->receivedLength &&
+         timeCompare(entry->timestamp, victim->timestamp) < 0))
+      {
+         victim = entry;
+      }
+   }
+
+   //No entry can be discarded?
+   if(victim == NULL)
+      return FALSE;
+
+   //Debug message
+   TRACE_INFO("Discarding IPv6 datagram from the reassembly queue...\r\n");
+
+   //Number of failures detected by the IP reassembly algorithm
+   IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
+   IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+   //Drop the partially reconstructed datagram
+   netBufferSetLength((NetBuffer *) &victim->buffer, 0);
+
+   //An entry has been released
+   return TRUE;
+}
+
+
 /**
  * @brief Retrieve hole descriptor
  * @param[in] frag IPv6 fragment descriptor
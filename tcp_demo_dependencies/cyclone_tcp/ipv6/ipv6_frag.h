@@ -62,6 +62,28 @@
    #error IPV6_MAX_FRAG_DATAGRAM_SIZE parameter is not valid
 #endif
 
+//Maximum amount of memory used by the reassembly queue (by default, only
+//half of the datagrams can grow to the maximum size at the same time)
+#ifndef IPV6_MAX_FRAG_TOTAL_SIZE
+   #define IPV6_MAX_FRAG_TOTAL_SIZE (((IPV6_MAX_FRAG_DATAGRAMS + 1) / 2) * IPV6_MAX_FRAG_DATAGRAM_SIZE)
+#elif (IPV6_MAX_FRAG_TOTAL_SIZE < IPV6_MAX_FRAG_DATAGRAM_SIZE)
+   #error IPV6_MAX_FRAG_TOTAL_SIZE parameter is not valid
+#endif
+
+//Maximum number of datagrams a single source can have in the reassembly queue
+#ifndef IPV6_MAX_FRAG_DATAGRAMS_PER_SRC
+   #define IPV6_MAX_FRAG_DATAGRAMS_PER_SRC ((IPV6_MAX_FRAG_DATAGRAMS + 1) / 2)
+#elif (IPV6_MAX_FRAG_DATAGRAMS_PER_SRC < 1)
+   #error IPV6_MAX_FRAG_DATAGRAMS_PER_SRC parameter is not valid
+#endif
+
+//Discard datagrams whose fragments overlap (refer to RFC 5722)
+#ifndef IPV6_FRAG_DROP_OVERLAPPING
+   #define IPV6_FRAG_DROP_OVERLAPPING ENABLED
+#elif (IPV6_FRAG_DROP_OVERLAPPING != ENABLED && IPV6_FRAG_DROP_OVERLAPPING != DISABLED)
+   #error IPV6_FRAG_DROP_OVERLAPPING parameter is not valid
+#endif
+
 //Maximum time an IPv6 fragment can spend waiting to be reassembled
 #ifndef IPV6_FRAG_TIME_TO_LIVE
    #define IPV6_FRAG_TIME_TO_LIVE 15000
@@ -124,6 +146,7 @@ typedef struct
    uint32_t identification;     ///<Fragment identification field
    size_t unfragPartLength;     ///<Length of the unfragmentable part
    size_t fragPartLength;       ///<Length of the fragmentable part
+   size_t receivedLength;       ///<Number of payload bytes received so far
    uint16_t firstHole;          ///<Index of the first hole
    Ipv6ReassemblyBuffer buffer; ///<Buffer containing the reassembled datagram
 } Ipv6FragDesc;
@@ -146,6 +169,11 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
 
 void ipv6FlushFragQueue(NetInterface *interface);
 
+size_t ipv6GetFragQueueSize(NetInterface *interface, const Ipv6FragDesc *exclude);
+
+bool_t ipv6EvictFrag(NetInterface *interface, const Ipv6FragDesc *frag,
+   size_t receivedLength);
+
 Ipv6HoleDesc *ipv6FindHole(Ipv6FragDesc *frag, uint16_t offset);
 void ipv6DumpHoleList(Ipv6FragDesc *frag);
 
@@ -81,6 +81,9 @@ void snmpLockMib(SnmpAgentContext *context)
    {
       //Get exclusive access
       osAcquireMutex(&netMutex);
+      //MIB objects are read directly from the MIB bases, so the counter
+      //blocks of the TCP/IP stack must be folded in first
+      netFoldCounters();
    }
 }
 
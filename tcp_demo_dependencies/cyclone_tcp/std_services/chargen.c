@@ -264,6 +264,9 @@ void tcpChargenConnectionTask(void *param)
    //Release previously allocated memory
    osFreeMem(context);
 
+   //Return the buffers cached on behalf of the task
+   memPoolFlushCache(NULL);
+
    //Kill ourselves
    osDeleteTask(NULL);
 }
@@ -229,6 +229,9 @@ void tcpDiscardConnectionTask(void *param)
    //Release previously allocated memory
    osFreeMem(context);
 
+   //Return the buffers cached on behalf of the task
+   memPoolFlushCache(NULL);
+
    //Kill ourselves
    osDeleteTask(NULL);
 }
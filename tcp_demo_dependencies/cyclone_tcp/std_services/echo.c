@@ -312,6 +312,9 @@ void tcpEchoConnectionTask(void *param)
    //Release previously allocated memory
    osFreeMem(context);
 
+   //Return the buffers cached on behalf of the task
+   memPoolFlushCache(NULL);
+
    //Kill ourselves
    osDeleteTask(NULL);
 }
@@ -0,0 +1,117 @@
+/**
+ * @file net_config.h
+ * @brief CycloneTCP configuration file (host unit tests)
+ *
+ * Every setting may be overridden on the compiler command line, so that
+ * a test can be built against several configurations
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+#ifndef _NET_CONFIG_H
+#define _NET_CONFIG_H
+
+//Trace level for TCP/IP stack debugging
+#ifndef MEM_TRACE_LEVEL
+   #define MEM_TRACE_LEVEL 0
+#endif
+#ifndef NIC_TRACE_LEVEL
+   #define NIC_TRACE_LEVEL 0
+#endif
+#ifndef ETH_TRACE_LEVEL
+   #define ETH_TRACE_LEVEL 0
+#endif
+#ifndef ARP_TRACE_LEVEL
+   #define ARP_TRACE_LEVEL 0
+#endif
+#ifndef IP_TRACE_LEVEL
+   #define IP_TRACE_LEVEL 0
+#endif
+#ifndef IPV4_TRACE_LEVEL
+   #define IPV4_TRACE_LEVEL 0
+#endif
+#ifndef ICMP_TRACE_LEVEL
+   #define ICMP_TRACE_LEVEL 0
+#endif
+#ifndef IGMP_TRACE_LEVEL
+   #define IGMP_TRACE_LEVEL 0
+#endif
+#ifndef UDP_TRACE_LEVEL
+   #define UDP_TRACE_LEVEL 0
+#endif
+#ifndef TCP_TRACE_LEVEL
+   #define TCP_TRACE_LEVEL 0
+#endif
+#ifndef SOCKET_TRACE_LEVEL
+   #define SOCKET_TRACE_LEVEL 0
+#endif
+
+//Number of network adapters
+#ifndef NET_INTERFACE_COUNT
+   #define NET_INTERFACE_COUNT 2
+#endif
+
+//IPv4 support
+#ifndef IPV4_SUPPORT
+   #define IPV4_SUPPORT ENABLED
+#endif
+//IPv6 support
+#ifndef IPV6_SUPPORT
+   #define IPV6_SUPPORT DISABLED
+#endif
+
+//Use fixed-size blocks allocation
+#ifndef NET_MEM_POOL_SUPPORT
+   #define NET_MEM_POOL_SUPPORT ENABLED
+#endif
+//Number of buffers available
+#ifndef NET_MEM_POOL_BUFFER_COUNT
+   #define NET_MEM_POOL_BUFFER_COUNT 64
+#endif
+
+//TCP support
+#ifndef TCP_SUPPORT
+   #define TCP_SUPPORT ENABLED
+#endif
+//UDP support
+#ifndef UDP_SUPPORT
+   #define UDP_SUPPORT ENABLED
+#endif
+
+//Number of sockets that can be opened simultaneously
+#ifndef SOCKET_MAX_COUNT
+   #define SOCKET_MAX_COUNT 16
+#endif
+
+//Services that are not exercised by the tests
+#define DHCP_CLIENT_SUPPORT DISABLED
+#define DNS_CLIENT_SUPPORT DISABLED
+#define MDNS_CLIENT_SUPPORT DISABLED
+#define MDNS_RESPONDER_SUPPORT DISABLED
+#define NBNS_CLIENT_SUPPORT DISABLED
+#define NBNS_RESPONDER_SUPPORT DISABLED
+#define LLMNR_CLIENT_SUPPORT DISABLED
+#define LLMNR_RESPONDER_SUPPORT DISABLED
+
+#endif
@@ -0,0 +1,122 @@
+#!/bin/sh
+#
+# Build and run the host unit tests
+#
+# The tests are built with the host compiler against the POSIX port of
+# the RTOS abstraction layer. Each test is self-contained and only links
+# the stack modules it exercises. Benchmarks print their results but
+# never fail the run
+#
+# Usage: run_tests.sh [test...]
+#
+
+TESTS_DIR=$(cd "$(dirname "$0")" && pwd)
+DEPS_DIR=$(dirname "$TESTS_DIR")
+COMMON=$DEPS_DIR/common
+TCP=$DEPS_DIR/cyclone_tcp
+OUT=${OUT:-/tmp/cyclone_tcp_tests}
+CC=${CC:-gcc}
+CFLAGS="-O2 -Wall -Wno-unused-function -Wno-unused-but-set-variable -Wno-pointer-sign"
+CFLAGS="$CFLAGS -Wno-pointer-to-int-cast -Wno-stringop-truncation"
+CFLAGS="$CFLAGS -I$TESTS_DIR -I$COMMON -I$TCP"
+OS="$COMMON/os_port_posix.c"
+#Core of the stack (IPv4 only)
+STACK="$(ls $TCP/core/*.c | grep -v bsd_socket) $TCP/ipv4/*.c $OS $COMMON/cpu_endian.c $COMMON/str.c"
+#IPv6 modules, for the tests that enable IPV6_SUPPORT
+IPV6="$TCP/ipv6/*.c"
+#Loopback driver connecting two interfaces of the stack
+LOOPBACK="$TCP/drivers/loopback_driver.c"
+
+mkdir -p "$OUT"
+status=0
+
+#Build a test program: build <name> <sources and flags...>
+build()
+{
+   name=$1
+   shift
+   $CC $CFLAGS -o "$OUT/$name" "$@" -lpthread || exit 1
+}
+
+#Build and run a test program: check <name> <sources and flags...>
+check()
+{
+   name=$1
+
+   #Skip the tests that have not been selected
+   if [ -n "$SELECTED" ] && ! echo " $SELECTED " | grep -q " $name "; then
+      return
+   fi
+
+   build "$@"
+   echo "== $name"
+   "$OUT/$name" || status=1
+}
+
+SELECTED="$*"
+
+#Memory pool (free list, double free detection)
+check test_net_mem $TESTS_DIR/test_net_mem.c $TCP/core/net_mem.c $OS
+#Memory pool with per-task buffer caches
+check test_net_mem_cache $TESTS_DIR/test_net_mem.c $TCP/core/net_mem.c $OS \
+   -DNET_MEM_POOL_CACHE_SUPPORT=ENABLED
+#Internet checksum (reference loop, 64-bit accumulator and AVX2)
+check test_ip_checksum $TESTS_DIR/test_ip_checksum.c $STACK
+check test_ip_checksum_fast $TESTS_DIR/test_ip_checksum.c $STACK \
+   -DIP_FAST_CHECKSUM_SUPPORT=ENABLED
+if grep -q avx2 /proc/cpuinfo 2>/dev/null; then
+   check test_ip_checksum_avx2 $TESTS_DIR/test_ip_checksum.c $STACK \
+      -DIP_FAST_CHECKSUM_SUPPORT=ENABLED -mavx2
+fi
+#Ethernet CRC (bit by bit, lookup table and slicing-by-8)
+check test_eth_crc $TESTS_DIR/test_eth_crc.c $STACK
+check test_eth_crc_table $TESTS_DIR/test_eth_crc.c $STACK \
+   -DETH_FAST_CRC_SUPPORT=ENABLED
+check test_eth_crc_slicing $TESTS_DIR/test_eth_crc.c $STACK \
+   -DETH_FAST_CRC_SUPPORT=ENABLED -DETH_CRC_SLICING_BY_8_SUPPORT=ENABLED
+#TX descriptor ring reclaim (wrap-around, partial completion)
+check test_nic_tx_ring $TESTS_DIR/test_nic_tx_ring.c $STACK
+#Receive path over the loopback driver (buffers copied or kept by the socket)
+check test_loopback $TESTS_DIR/test_loopback.c $STACK $LOOPBACK
+check test_loopback_zero_copy $TESTS_DIR/test_loopback.c $STACK $LOOPBACK \
+   -DNET_ZERO_COPY_RX_SUPPORT=ENABLED
+#Window scale negotiation, with buffers larger than the 16-bit window field
+check test_tcp_window $TESTS_DIR/test_tcp_window.c $STACK $LOOPBACK \
+   -DTCP_WINDOW_SCALE_SUPPORT=ENABLED -DTCP_MAX_TX_BUFFER_SIZE=131072 \
+   -DTCP_MAX_RX_BUFFER_SIZE=131072 -DNET_MEM_POOL_BUFFER_COUNT=512
+#Goodput under random losses, with and without SACK recovery
+check test_tcp_goodput $TESTS_DIR/test_tcp_goodput.c $STACK $LOOPBACK \
+   -DNET_MEM_POOL_BUFFER_COUNT=256
+check test_tcp_goodput_sack $TESTS_DIR/test_tcp_goodput.c $STACK $LOOPBACK \
+   -DNET_MEM_POOL_BUFFER_COUNT=256 -DTCP_SACK_SUPPORT=ENABLED
+check test_tcp_goodput_dest_cache $TESTS_DIR/test_tcp_goodput.c $STACK $LOOPBACK \
+   -DNET_MEM_POOL_BUFFER_COUNT=256 -DIPV4_DEST_CACHE_SUPPORT=ENABLED
+#ARP cache (hash table and LRU list, or linear table) and the destination
+#cache entries that depend on it
+check test_arp_cache $TESTS_DIR/test_arp_cache.c $STACK $LOOPBACK \
+   -DARP_CACHE_SIZE=64 -DIPV4_DEST_CACHE_SUPPORT=ENABLED
+check test_arp_cache_linear $TESTS_DIR/test_arp_cache.c $STACK $LOOPBACK \
+   -DARP_CACHE_HASH_SUPPORT=DISABLED -DIPV4_DEST_CACHE_SUPPORT=ENABLED
+#IPv4 reassembly queue (memory budget, eviction, per-source quota)
+check test_ipv4_frag $TESTS_DIR/test_ipv4_frag.c $STACK $LOOPBACK \
+   -DIPV4_FRAG_SUPPORT=ENABLED
+check test_ipv4_frag_overlapping $TESTS_DIR/test_ipv4_frag.c $STACK $LOOPBACK \
+   -DIPV4_FRAG_SUPPORT=ENABLED -DIPV4_FRAG_DROP_OVERLAPPING=DISABLED
+check test_ipv6_frag $TESTS_DIR/test_ipv6_frag.c $STACK $IPV6 $LOOPBACK \
+   -DIPV6_SUPPORT=ENABLED -DIPV6_FRAG_SUPPORT=ENABLED
+#MIB counters, accumulated in per-layer blocks folded on read, or updated
+#directly on every packet
+MIBS="-DMIB2_SUPPORT=ENABLED -DIP_MIB_SUPPORT=ENABLED -DTCP_MIB_SUPPORT=ENABLED -DUDP_MIB_SUPPORT=ENABLED"
+check test_mib_counters $TESTS_DIR/test_mib_counters.c $STACK $LOOPBACK $MIBS
+check test_mib_counters_direct $TESTS_DIR/test_mib_counters.c $STACK $LOOPBACK $MIBS \
+   -DIPV4_COUNTER_BLOCK_SUPPORT=DISABLED -DTCP_COUNTER_BLOCK_SUPPORT=DISABLED \
+   -DUDP_COUNTER_BLOCK_SUPPORT=DISABLED
+#Socket demultiplexing tables (collisions, removal, lookup cost)
+for n in 16 256 4096; do
+   check test_socket_hash_$n $TESTS_DIR/test_socket_hash.c $STACK \
+      -DSOCKET_MAX_COUNT=$n
+done
+check test_socket_hash_4096_large $TESTS_DIR/test_socket_hash.c $STACK \
+   -DSOCKET_MAX_COUNT=4096 -DSOCKET_CONN_HASH_TABLE_SIZE=1024
+
+exit $status
@@ -0,0 +1,468 @@
+/**
+ * @file test_arp_cache.c
+ * @brief ARP cache (hash table, LRU list, timers) and destination cache invalidation
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include "core/net.h"
+#include "ipv4/arp.h"
+#include "ipv4/ipv4.h"
+#include "test_stack.h"
+#include "test_common.h"
+
+//Number of distinct neighbors used by the stress test
+#define NEIGHBOR_COUNT (3 * ARP_CACHE_SIZE)
+
+
+/**
+ * @brief IPv4 address of the nth neighbor
+ *
+ * The neighbors are on the local subnet but do not exist, so that the
+ * ARP requests sent for them are never answered
+ *
+ * @param[in] n Neighbor index
+ * @return IPv4 address
+ **/
+
+static Ipv4Addr getNeighborAddr(uint_t n)
+{
+   return IPV4_ADDR(10, 0, 0, 10 + n);
+}
+
+
+/**
+ * @brief Make a neighbor reachable, as if it had answered the ARP request
+ * @param[in] interface Underlying network interface
+ * @param[in] n Neighbor index
+ * @return Pointer to the ARP cache entry
+ **/
+
+static ArpCacheEntry *addNeighbor(NetInterface *interface, uint_t n)
+{
+   MacAddr macAddr;
+   ArpCacheEntry *entry;
+
+   //Create an entry in the INCOMPLETE state
+   arpResolve(interface, getNeighborAddr(n), &macAddr);
+   entry = arpFindEntry(interface, getNeighborAddr(n));
+
+   if(entry != NULL)
+   {
+      //Record a link-layer address
+      entry->macAddr.b[0] = 0x02;
+      entry->macAddr.b[5] = n;
+      //Switch to the REACHABLE state
+      entry->state = ARP_STATE_REACHABLE;
+      entry->timestamp = osGetSystemTime();
+      entry->timeout = ARP_REACHABLE_TIME;
+   }
+
+   return entry;
+}
+
+
+/**
+ * @brief Check the consistency of the ARP cache
+ * @param[in] interface Underlying network interface
+ * @return Number of inconsistencies
+ **/
+
+static uint_t checkArpCache(NetInterface *interface)
+{
+   uint_t i;
+   uint_t errors;
+   uint_t usedCount;
+   ArpCacheEntry *entry;
+
+   //Number of inconsistencies
+   errors = 0;
+   usedCount = 0;
+
+   //Every entry in use can be found
+   for(i = 0; i < ARP_CACHE_SIZE; i++)
+   {
+      entry = &interface->arpCache[i];
+
+      if(entry->state != ARP_STATE_NONE)
+      {
+         usedCount++;
+
+         if(arpFindEntry(interface, entry->ipAddr) != entry)
+            errors++;
+      }
+   }
+
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+   {
+      uint_t n;
+      bool_t freeFound;
+      ArpCacheEntry *prevEntry;
+
+      //The LRU list links every entry of the cache in both directions
+      n = 0;
+      prevEntry = NULL;
+      freeFound = FALSE;
+
+      for(entry = interface->arpLruHead; entry != NULL && n <= ARP_CACHE_SIZE;
+         entry = entry->lruNext)
+      {
+         if(entry->lruPrev != prevEntry)
+            errors++;
+
+         //The entries in use come first
+         if(entry->state == ARP_STATE_NONE)
+            freeFound = TRUE;
+         else if(freeFound)
+            errors++;
+
+         prevEntry = entry;
+         n++;
+      }
+
+      if(n != ARP_CACHE_SIZE || interface->arpLruTail != prevEntry)
+         errors++;
+
+      //The hash table holds exactly the entries in use, in the right bucket
+      n = 0;
+
+      for(i = 0; i < ARP_HASH_TABLE_SIZE; i++)
+      {
+         for(entry = interface->arpHashTable[i]; entry != NULL && n <= ARP_CACHE_SIZE;
+            entry = entry->hashNext)
+         {
+            if(entry->state == ARP_STATE_NONE || arpHashAddr(entry->ipAddr) != i)
+               errors++;
+
+            n++;
+         }
+      }
+
+      if(n != usedCount)
+         errors++;
+   }
+#endif
+
+   return errors;
+}
+
+
+/**
+ * @brief Random lookups, insertions and deletions
+ **/
+
+static void testStress(void)
+{
+   uint_t i;
+   uint_t n;
+   uint_t errors;
+   MacAddr macAddr;
+   ArpCacheEntry *entry;
+   NetInterface *interface;
+
+   interface = testClientInterface;
+   errors = 0;
+
+   //Keep the ARP timer away from the cache during the test
+   osAcquireMutex(&netMutex);
+
+   for(i = 0; i < 100000; i++)
+   {
+      //Pick a neighbor
+      n = rand() % NEIGHBOR_COUNT;
+      entry = arpFindEntry(interface, getNeighborAddr(n));
+
+      if(entry != NULL && (rand() % 5) == 0)
+      {
+         //Neighbor no longer reachable
+         arpDeleteEntry(interface, entry);
+      }
+      else if(entry != NULL)
+      {
+         //Lookup of a known neighbor
+         if(arpResolve(interface, getNeighborAddr(n), &macAddr) == NO_ERROR &&
+            macAddr.b[5] != n)
+         {
+            errors++;
+         }
+
+#if (ARP_CACHE_HASH_SUPPORT == ENABLED)
+         //The entry becomes the most recently used one
+         if(interface->arpLruHead != entry)
+            errors++;
+#endif
+      }
+      else
+      {
+         //New neighbor
+         entry = addNeighbor(interface, n);
+
+         if(entry == NULL || entry->ipAddr != getNeighborAddr(n))
+            errors++;
+      }
+
+      errors += checkArpCache(interface);
+   }
+
+   //Empty the cache
+   arpFlushCache(interface);
+   errors += checkArpCache(interface);
+
+   for(i = 0; i < NEIGHBOR_COUNT; i++)
+   {
+      if(arpFindEntry(interface, getNeighborAddr(i)) != NULL)
+         errors++;
+   }
+
+   osReleaseMutex(&netMutex);
+
+   TEST_CHECK(errors == 0);
+}
+
+
+/**
+ * @brief The timer handler deletes the entries whose resolution failed
+ **/
+
+static void testTick(void)
+{
+   uint_t i;
+   uint_t errors;
+   systime_t time;
+   ArpCacheEntry *entry;
+   NetInterface *interface;
+
+   interface = testClientInterface;
+   errors = 0;
+
+   osAcquireMutex(&netMutex);
+
+   //Fill the cache
+   for(i = 0; i < ARP_CACHE_SIZE; i++)
+      addNeighbor(interface, i);
+
+   //Every other neighbor did not answer its last ARP request
+   time = osGetSystemTime();
+
+   for(i = 0; i < ARP_CACHE_SIZE; i += 2)
+   {
+      entry = arpFindEntry(interface, getNeighborAddr(i));
+      entry->state = ARP_STATE_INCOMPLETE;
+      entry->retransmitCount = ARP_MAX_REQUESTS - 1;
+      entry->timestamp = time - ARP_REQUEST_TIMEOUT;
+      entry->timeout = ARP_REQUEST_TIMEOUT;
+   }
+
+   arpTick(interface);
+   errors += checkArpCache(interface);
+
+   //Only the neighbors that answered are left
+   for(i = 0; i < ARP_CACHE_SIZE; i++)
+   {
+      entry = arpFindEntry(interface, getNeighborAddr(i));
+
+      if((i % 2) == 0 && entry != NULL)
+         errors++;
+      if((i % 2) != 0 && (entry == NULL || entry->state != ARP_STATE_REACHABLE))
+         errors++;
+   }
+
+   arpFlushCache(interface);
+   osReleaseMutex(&netMutex);
+
+   TEST_CHECK(errors == 0);
+}
+
+
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+
+/**
+ * @brief Record a TCP destination in the destination cache
+ * @param[in] interface Underlying network interface
+ * @param[in] destCacheSlot Destination cache slot of the sender, if any
+ * @param[in] destAddr Destination IPv4 address
+ * @param[in] arpEntry ARP entry of the next hop
+ **/
+
+static void addDestination(NetInterface *interface, Ipv4DestCacheEntry *destCacheSlot,
+   Ipv4Addr destAddr, ArpCacheEntry *arpEntry)
+{
+   Ipv4Header header;
+
+   //Header of a packet sent to the destination
+   memset(&header, 0, sizeof(Ipv4Header));
+   header.version = IPV4_VERSION;
+   header.headerLength = 5;
+   header.timeToLive = IPV4_DEFAULT_TTL;
+   header.protocol = IPV4_PROTOCOL_TCP;
+   header.srcAddr = TEST_CLIENT_ADDR;
+   header.destAddr = destAddr;
+
+   ipv4AddDestCacheEntry(interface, destCacheSlot, &header, arpEntry);
+}
+
+
+/**
+ * @brief A change of one neighbor only invalidates its own destinations
+ **/
+
+static void testDestCache(void)
+{
+   uint_t i;
+   Ipv4Addr srcAddr;
+   Ipv4Addr destAddr[2];
+   ArpCacheEntry *entry[2];
+   NetInterface *interface;
+
+   interface = testClientInterface;
+   srcAddr = TEST_CLIENT_ADDR;
+
+   osAcquireMutex(&netMutex);
+
+   //Two neighbors, each being the destination of a cached route
+   for(i = 0; i < 2; i++)
+   {
+      entry[i] = addNeighbor(interface, i);
+      destAddr[i] = getNeighborAddr(i);
+      addDestination(interface, NULL, destAddr[i], entry[i]);
+   }
+
+   //Consecutive addresses map to distinct slots
+   TEST_CHECK(ipv4HashDestAddr(destAddr[0]) != ipv4HashDestAddr(destAddr[1]));
+
+   //Both destinations are cached
+   TEST_CHECK(ipv4FindDestCacheEntry(interface, NULL, srcAddr, destAddr[0]) != NULL);
+   TEST_CHECK(ipv4FindDestCacheEntry(interface, NULL, srcAddr, destAddr[1]) != NULL);
+
+   //The first neighbor times out and becomes STALE
+   entry[0]->timestamp = osGetSystemTime() - ARP_REACHABLE_TIME;
+   arpTick(interface);
+   TEST_CHECK(entry[0]->state == ARP_STATE_STALE);
+
+   //Its destination must go through address resolution again, while
+   //the other one is still cached
+   TEST_CHECK(ipv4FindDestCacheEntry(interface, NULL, srcAddr, destAddr[0]) == NULL);
+   TEST_CHECK(ipv4FindDestCacheEntry(interface, NULL, srcAddr, destAddr[1]) != NULL);
+
+   //The second neighbor is deleted and its entry is reused for a third one
+   arpDeleteEntry(interface, entry[1]);
+   TEST_CHECK(addNeighbor(interface, 3) == entry[1]);
+
+   //The stale destination must not be resurrected by the reuse
+   TEST_CHECK(ipv4FindDestCacheEntry(interface, NULL, srcAddr, destAddr[1]) == NULL);
+
+   arpFlushCache(interface);
+   osReleaseMutex(&netMutex);
+}
+
+
+/**
+ * @brief Per-sender slots survive collisions in the shared table
+ **/
+
+static void testDestCacheSlot(void)
+{
+   uint_t i;
+   size_t offset;
+   Ipv4Addr srcAddr;
+   Ipv4Addr destAddr[2];
+   ArpCacheEntry *entry[2];
+   Ipv4DestCacheEntry slot[2];
+   Ipv4Header *packet;
+   NetBuffer *buffer;
+   NetInterface *interface;
+
+   interface = testClientInterface;
+   srcAddr = TEST_CLIENT_ADDR;
+
+   osAcquireMutex(&netMutex);
+
+   //Look for two neighbors that map to the same slot of the shared table
+   entry[0] = addNeighbor(interface, 0);
+   destAddr[0] = getNeighborAddr(0);
+   for(i = 1; ipv4HashDestAddr(getNeighborAddr(i)) != ipv4HashDestAddr(destAddr[0]); i++);
+   entry[1] = addNeighbor(interface, i);
+   destAddr[1] = getNeighborAddr(i);
+
+   //Each sender records its destination in its own slot
+   memset(slot, 0, sizeof(slot));
+   addDestination(interface, &slot[0], destAddr[0], entry[0]);
+   addDestination(interface, &slot[1], destAddr[1], entry[1]);
+
+   //The second destination evicted the first one from the shared table
+   TEST_CHECK(ipv4FindDestCacheEntry(interface, NULL, srcAddr, destAddr[0]) == NULL);
+
+   //A send that does not supply a slot leaves the other slots untouched
+   addDestination(interface, NULL, destAddr[1], entry[1]);
+
+   //Both senders still hit their own slot
+   TEST_CHECK(ipv4FindDestCacheEntry(interface, &slot[0], srcAddr, destAddr[0]) == &slot[0]);
+   TEST_CHECK(ipv4FindDestCacheEntry(interface, &slot[1], srcAddr, destAddr[1]) == &slot[1]);
+
+   //Send a packet from the prebuilt header
+   buffer = ipAllocBuffer(100, &offset);
+   TEST_CHECK(buffer != NULL);
+
+   if(buffer != NULL)
+   {
+      //Point to the IPv4 header
+      offset -= sizeof(Ipv4Header);
+      TEST_CHECK(ipv4SendCachedPacket(interface, &slot[0], 0xBEEF, IPV4_FLAG_DF,
+         buffer, offset) == NO_ERROR);
+
+      //The variable fields are set and the header checksum is valid
+      packet = netBufferAt(buffer, offset);
+      TEST_CHECK(ntohs(packet->totalLength) == sizeof(Ipv4Header) + 100);
+      TEST_CHECK(ntohs(packet->identification) == 0xBEEF);
+      TEST_CHECK(ntohs(packet->fragmentOffset) == IPV4_FLAG_DF);
+      TEST_CHECK(packet->destAddr == destAddr[0]);
+      TEST_CHECK(ipCalcChecksum(packet, sizeof(Ipv4Header)) == 0x0000);
+
+      netBufferFree(buffer);
+   }
+
+   arpFlushCache(interface);
+   osReleaseMutex(&netMutex);
+}
+
+#endif
+
+
+int main(void)
+{
+   //Start the stack with two interfaces connected back to back
+   if(testStackInit())
+      return 1;
+
+   TEST_RUN(testStress);
+   TEST_RUN(testTick);
+#if (IPV4_DEST_CACHE_SUPPORT == ENABLED)
+   TEST_RUN(testDestCache);
+   TEST_RUN(testDestCacheSlot);
+#endif
+
+   return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,101 @@
+/**
+ * @file test_common.h
+ * @brief Helpers shared by the host unit tests
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+#ifndef _TEST_COMMON_H
+#define _TEST_COMMON_H
+
+//Dependencies
+#include <stdio.h>
+#include <time.h>
+
+//Number of failed checks
+static unsigned int testFailureCount = 0;
+
+//Check a condition and report the failure, if any
+#define TEST_CHECK(cond) \
+   do \
+   { \
+      if(!(cond)) \
+      { \
+         printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+         testFailureCount++; \
+      } \
+   } while(0)
+
+//Run a test case
+#define TEST_RUN(test) \
+   do \
+   { \
+      unsigned int n = testFailureCount; \
+      test(); \
+      printf("%-40s %s\n", #test, (testFailureCount == n) ? "ok" : "FAILED"); \
+   } while(0)
+
+//Exit status of the test program
+#define TEST_EXIT_STATUS() ((testFailureCount == 0) ? 0 : 1)
+
+
+/**
+ * @brief Get a monotonic timestamp
+ * @return Current time, in nanoseconds
+ **/
+
+static inline double testGetTime(void)
+{
+   struct timespec ts;
+
+   //Read the monotonic clock
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   //Convert the time to nanoseconds
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/**
+ * @brief Suspend the calling thread
+ *
+ * os_port.h replaces usleep() with a busy loop, which must not be used
+ * to wait for the stack
+ *
+ * @param[in] delay Amount of time to sleep, in milliseconds
+ **/
+
+static inline void testSleep(unsigned int delay)
+{
+   struct timespec ts;
+
+   //Convert the delay
+   ts.tv_sec = delay / 1000;
+   ts.tv_nsec = (delay % 1000) * 1000000L;
+
+   //Suspend the calling thread
+   nanosleep(&ts, NULL);
+}
+
+#endif
@@ -0,0 +1,312 @@
+/**
+ * @file test_eth_crc.c
+ * @brief Ethernet CRC known-answer tests, with a benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include "core/net.h"
+#include "core/ethernet.h"
+#include "test_common.h"
+
+//Size of the random data
+#define DATA_SIZE 4096
+//Maximum length checked for every alignment
+#define MAX_FUZZ_LENGTH 1600
+
+//Random data
+static uint8_t data[DATA_SIZE + 64];
+
+
+/**
+ * @brief Reference CRC (reflected polynomial, bit by bit)
+ * @param[in] p Pointer to the data
+ * @param[in] length Number of bytes to process
+ * @return Resulting CRC value
+ **/
+
+static uint32_t refCrc(const uint8_t *p, size_t length)
+{
+   size_t i;
+   uint_t j;
+   uint32_t crc;
+
+   for(crc = 0xFFFFFFFF, i = 0; i < length; i++)
+   {
+      crc ^= p[i];
+      for(j = 0; j < 8; j++)
+         crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+   }
+
+   return ~crc;
+}
+
+
+/**
+ * @brief Hash filter CRC, as formerly computed bit by bit by the MAC drivers
+ * @param[in] p Pointer to the data
+ * @param[in] length Number of bytes to process
+ * @return CRC register (not complemented)
+ **/
+
+static uint32_t refHashCrc(const uint8_t *p, size_t length)
+{
+   size_t i;
+   uint_t j;
+   uint32_t crc;
+
+   for(crc = 0xFFFFFFFF, i = 0; i < length; i++)
+   {
+      for(j = 0; j < 8; j++)
+      {
+         if(((crc >> 31) ^ (p[i] >> j)) & 0x01)
+            crc = (crc << 1) ^ 0x04C11DB7;
+         else
+            crc = crc << 1;
+      }
+   }
+
+   return crc;
+}
+
+
+/**
+ * @brief Check value and FCS residue
+ **/
+
+static void testKnownAnswer(void)
+{
+   uint32_t crc;
+   uint8_t frame[64];
+
+   //CRC-32 check value
+   TEST_CHECK(ethCalcCrc("123456789", 9) == 0xCBF43926);
+   //Empty data
+   TEST_CHECK(ethCalcCrc(data, 0) == 0x00000000);
+
+   //Append the FCS to a minimum-size frame
+   memset(frame, 0x5A, 60);
+   crc = htole32(ethCalcCrc(frame, 60));
+   memcpy(frame + 60, &crc, 4);
+
+   //The CRC over a frame and its FCS yields the residue
+   TEST_CHECK(ethCalcCrc(frame, 64) == 0x2144DF1C);
+}
+
+
+/**
+ * @brief Every length at every offset around the alignment prologue
+ **/
+
+static void testFuzz(void)
+{
+   size_t i;
+   size_t offset;
+   size_t length;
+   uint_t errors;
+
+   //Number of mismatches
+   errors = 0;
+
+   //Fill the buffer with random data
+   for(i = 0; i < sizeof(data); i++)
+      data[i] = rand();
+
+   //Cover the alignment prologue, the 8-byte loop and the tail loop
+   for(offset = 0; offset < 16; offset++)
+   {
+      for(length = 0; length <= MAX_FUZZ_LENGTH; length++)
+      {
+         if(ethCalcCrc(data + offset, length) != refCrc(data + offset, length))
+            errors++;
+      }
+   }
+
+   TEST_CHECK(errors == 0);
+}
+
+
+/**
+ * @brief Streaming across arbitrary split points and buffer chunks
+ **/
+
+static void testStreaming(void)
+{
+   uint_t i;
+   uint_t j;
+   uint_t errors;
+   size_t split;
+   size_t pos;
+   size_t total;
+   uint32_t crc;
+   uint32_t ref;
+   struct
+   {
+      uint_t chunkCount;
+      uint_t maxChunkCount;
+      ChunkDesc chunk[8];
+   } buffer;
+
+   //Number of mismatches
+   errors = 0;
+
+   //Reference CRC over 1518 bytes
+   ref = refCrc(data + 1, 1518);
+
+   //Split the data in two parts at every position
+   for(split = 0; split <= 1518; split++)
+   {
+      crc = ethUpdateCrc(0xFFFFFFFF, data + 1, split);
+      crc = ethUpdateCrc(crc, data + 1 + split, 1518 - split);
+
+      if(~crc != ref)
+         errors++;
+   }
+
+   //Random multi-chunk buffers
+   for(i = 0; i < 10000; i++)
+   {
+      buffer.chunkCount = 1 + rand() % 8;
+      buffer.maxChunkCount = 8;
+
+      //Consecutive chunks of random lengths
+      for(pos = rand() % 8, total = 0, j = 0; j < buffer.chunkCount; j++)
+      {
+         buffer.chunk[j].address = data + pos;
+         buffer.chunk[j].length = rand() % 300;
+         buffer.chunk[j].size = 0;
+         pos += buffer.chunk[j].length;
+         total += buffer.chunk[j].length;
+      }
+
+      //Process the whole buffer
+      if(ethCalcCrcEx((NetBuffer *) &buffer, 0, total) !=
+         refCrc(buffer.chunk[0].address, total))
+      {
+         errors++;
+      }
+   }
+
+   TEST_CHECK(errors == 0);
+}
+
+
+/**
+ * @brief Multicast hash filter CRC of the MAC drivers
+ **/
+
+static void testHashFilter(void)
+{
+   uint_t i;
+   uint_t errors;
+   MacAddr addr;
+
+   //Number of mismatches
+   errors = 0;
+
+   for(i = 0; i < 100000; i++)
+   {
+      //Random multicast address
+      addr.b[0] = 0x01;
+      addr.b[1] = 0x00;
+      addr.b[2] = 0x5E;
+      addr.b[3] = rand() & 0x7F;
+      addr.b[4] = rand();
+      addr.b[5] = rand();
+
+      //ENC28J60 and KSZ8851 (CRC register, not complemented)
+      if(reverseInt32(ethUpdateCrc(0xFFFFFFFF, &addr, sizeof(MacAddr))) !=
+         refHashCrc(addr.b, sizeof(MacAddr)))
+      {
+         errors++;
+      }
+
+      //STM32F4x7 (complemented CRC register)
+      if(reverseInt32(ethCalcCrc(&addr, sizeof(MacAddr))) !=
+         ~refHashCrc(addr.b, sizeof(MacAddr)))
+      {
+         errors++;
+      }
+   }
+
+   TEST_CHECK(errors == 0);
+}
+
+
+/**
+ * @brief Measure the CRC throughput for typical frame lengths
+ **/
+
+static void benchCrc(void)
+{
+   uint_t i;
+   uint_t k;
+   uint_t n;
+   uint32_t acc;
+   double t0;
+   double t1;
+   static const size_t lengths[] = {6, 64, 1518};
+
+   acc = 0;
+
+   //Loop through the lengths
+   for(k = 0; k < arraysize(lengths); k++)
+   {
+      //Process about 50 MB of data
+      n = 50000000 / lengths[k];
+
+      t0 = testGetTime();
+      for(i = 0; i < n; i++)
+         acc += ethCalcCrc(data + (i & 3), lengths[k]);
+      t1 = testGetTime();
+
+      //Display results
+      printf("   %4u bytes: %8.1f ns per call, %7.1f MB/s\n", (uint_t) lengths[k],
+         (t1 - t0) / n, n * lengths[k] * 1e3 / (t1 - t0));
+   }
+
+   //Keep the computation alive
+   if(acc == 0x12345678)
+      printf("\n");
+}
+
+
+int main(void)
+{
+   //Initialize the memory pool
+   if(memPoolInit())
+      return 1;
+
+   TEST_RUN(testKnownAnswer);
+   TEST_RUN(testFuzz);
+   TEST_RUN(testStreaming);
+   TEST_RUN(testHashFilter);
+
+   //Run benchmark
+   benchCrc();
+
+   return TEST_EXIT_STATUS();
+}
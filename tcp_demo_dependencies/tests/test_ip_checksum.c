@@ -0,0 +1,266 @@
+/**
+ * @file test_ip_checksum.c
+ * @brief Internet checksum known-answer and fuzz tests, with a benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include "core/net.h"
+#include "core/ip.h"
+#include "test_common.h"
+
+//Size of the random data
+#define DATA_SIZE 70000
+//Maximum length checked for every alignment
+#define MAX_FUZZ_LENGTH 2100
+//Number of random multi-chunk buffers
+#define CHUNKED_ITERATIONS 20000
+
+//Random data
+static uint8_t data[DATA_SIZE + 64];
+
+
+/**
+ * @brief Reference checksum (RFC 1071, one 16-bit word at a time)
+ * @param[in] p Pointer to the data
+ * @param[in] length Number of bytes to process
+ * @return Checksum, in the byte order of the data
+ **/
+
+static uint16_t refChecksum(const uint8_t *p, size_t length)
+{
+   size_t i;
+   uint32_t sum;
+
+   //Sum big-endian 16-bit words
+   for(sum = 0, i = 0; i + 1 < length; i += 2)
+      sum += (p[i] << 8) | p[i + 1];
+
+   //Pad the left-over byte, if any
+   if(i < length)
+      sum += p[i] << 8;
+
+   //Fold the carries
+   while(sum >> 16)
+      sum = (sum & 0xFFFF) + (sum >> 16);
+
+   //Return the one's complement of the sum
+   return htons(~sum & 0xFFFF);
+}
+
+
+/**
+ * @brief RFC 1071 example and a valid IPv4 header
+ **/
+
+static void testKnownAnswer(void)
+{
+   static const uint8_t rfc1071[] =
+   {
+      0x00, 0x01, 0xF2, 0x03, 0xF4, 0xF5, 0xF6, 0xF7
+   };
+
+   static const uint8_t ipv4Header[] =
+   {
+      0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11,
+      0xB8, 0x61, 0xC0, 0xA8, 0x00, 0x01, 0xC0, 0xA8, 0x00, 0xC7
+   };
+
+   //The sum of the RFC 1071 example is 0xDDF2
+   TEST_CHECK(ntohs(ipCalcChecksum(rfc1071, sizeof(rfc1071))) == 0x220D);
+   //A header that includes its own checksum verifies to zero
+   TEST_CHECK(ipCalcChecksum(ipv4Header, sizeof(ipv4Header)) == 0x0000);
+   //Empty data
+   TEST_CHECK(ipCalcChecksum(data, 0) == 0xFFFF);
+   //All-ones data sums to negative zero
+   memset(data, 0xFF, 64);
+   TEST_CHECK(ipCalcChecksum(data, 64) == 0x0000);
+   TEST_CHECK(ipCalcChecksum(data + 1, 63) == htons(0x00FF));
+}
+
+
+/**
+ * @brief Every length up to MAX_FUZZ_LENGTH, at every alignment
+ **/
+
+static void testFuzz(void)
+{
+   size_t i;
+   size_t offset;
+   size_t length;
+   uint_t errors;
+
+   //Fill the buffer with random data
+   for(i = 0; i < sizeof(data); i++)
+      data[i] = rand();
+
+   //Number of mismatches
+   errors = 0;
+
+   //Cover the alignment prologue of every kernel
+   for(offset = 0; offset < 64; offset++)
+   {
+      for(length = 0; length <= MAX_FUZZ_LENGTH; length++)
+      {
+         if(ipCalcChecksum(data + offset, length) !=
+            refChecksum(data + offset, length))
+         {
+            errors++;
+         }
+      }
+   }
+
+   //Datagrams that exceed the batch size of the vector kernels
+   for(length = 65000; length <= DATA_SIZE; length += 999)
+   {
+      if(ipCalcChecksum(data + 3, length) != refChecksum(data + 3, length))
+         errors++;
+   }
+
+   //Saturated data maximizes the carries
+   memset(data, 0xFF, sizeof(data));
+   for(length = 0; length <= DATA_SIZE; length += 4999)
+   {
+      if(ipCalcChecksum(data + 1, length) != refChecksum(data + 1, length))
+         errors++;
+   }
+
+   TEST_CHECK(errors == 0);
+}
+
+
+/**
+ * @brief Checksum of multi-chunk buffers at odd and even positions
+ **/
+
+static void testChunked(void)
+{
+   uint_t i;
+   uint_t j;
+   uint_t errors;
+   size_t pos;
+   size_t offset;
+   size_t length;
+   size_t total;
+   struct
+   {
+      uint_t chunkCount;
+      uint_t maxChunkCount;
+      ChunkDesc chunk[8];
+   } buffer;
+
+   //Fill the buffer with random data
+   for(i = 0; i < sizeof(data); i++)
+      data[i] = rand();
+
+   //Number of mismatches
+   errors = 0;
+
+   for(i = 0; i < CHUNKED_ITERATIONS; i++)
+   {
+      //Random number of chunks
+      buffer.chunkCount = 1 + rand() % 8;
+      buffer.maxChunkCount = 8;
+
+      //Consecutive chunks of random lengths
+      for(pos = rand() % 8, total = 0, j = 0; j < buffer.chunkCount; j++)
+      {
+         buffer.chunk[j].address = data + pos;
+         buffer.chunk[j].length = rand() % 200;
+         buffer.chunk[j].size = 0;
+         pos += buffer.chunk[j].length;
+         total += buffer.chunk[j].length;
+      }
+
+      //Random range within the buffer
+      offset = (total > 0) ? rand() % (total + 1) : 0;
+      length = total - offset;
+
+      //The chunks are contiguous, so the reference can run in one pass
+      if(ipCalcChecksumEx((NetBuffer *) &buffer, offset, length) !=
+         refChecksum((uint8_t *) buffer.chunk[0].address + offset, length))
+      {
+         errors++;
+      }
+   }
+
+   TEST_CHECK(errors == 0);
+}
+
+
+/**
+ * @brief Measure the checksum throughput for typical lengths
+ **/
+
+static void benchChecksum(void)
+{
+   uint_t i;
+   uint_t k;
+   uint_t n;
+   uint16_t acc;
+   double t0;
+   double t1;
+   static const size_t lengths[] = {20, 64, 576, 1500, 9000};
+
+   acc = 0;
+
+   //Loop through the lengths
+   for(k = 0; k < arraysize(lengths); k++)
+   {
+      //Process about 1 GB of data
+      n = 1000000000 / lengths[k];
+
+      t0 = testGetTime();
+      for(i = 0; i < n; i++)
+         acc += ipCalcChecksum(data + (i & 1) * 2, lengths[k]);
+      t1 = testGetTime();
+
+      //Display results
+      printf("   %5u bytes: %7.1f ns per call, %6.2f GB/s\n", (uint_t) lengths[k],
+         (t1 - t0) / n, (double) n * lengths[k] / (t1 - t0));
+   }
+
+   //Keep the computation alive
+   if(acc == 0x1234)
+      printf("\n");
+}
+
+
+int main(void)
+{
+   //Initialize the memory pool
+   if(memPoolInit())
+      return 1;
+
+   TEST_RUN(testKnownAnswer);
+   TEST_RUN(testFuzz);
+   TEST_RUN(testChunked);
+
+   //Run benchmark
+   benchChecksum();
+
+   return TEST_EXIT_STATUS();
+}
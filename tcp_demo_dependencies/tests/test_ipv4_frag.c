@@ -0,0 +1,373 @@
+/**
+ * @file test_ipv4_frag.c
+ * @brief IPv4 reassembly queue (memory budget, eviction, per-source quota)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "core/net.h"
+#include "core/udp.h"
+#include "ipv4/ipv4.h"
+#include "ipv4/ipv4_frag.h"
+#include "test_stack.h"
+#include "test_common.h"
+
+//UDP port the reassembled datagrams are sent to
+#define TEST_PORT 7000
+//Size of the UDP datagrams, header included
+#define DATAGRAM_SIZE 7000
+//Payload carried by each fragment
+#define FRAG_SIZE 1480
+
+//Legitimate sender
+#define TEST_SRC_ADDR IPV4_ADDR(10, 0, 0, 50)
+
+//Contents of the datagrams
+static uint8_t datagram[DATAGRAM_SIZE];
+//Receiving socket
+static Socket *udpSocket;
+
+
+/**
+ * @brief Build the UDP datagram carried by the fragments
+ **/
+
+static void buildDatagram(void)
+{
+   size_t i;
+   UdpHeader *header;
+
+   //UDP header without checksum
+   header = (UdpHeader *) datagram;
+   header->srcPort = htons(TEST_PORT);
+   header->destPort = htons(TEST_PORT);
+   header->length = htons(DATAGRAM_SIZE);
+   header->checksum = 0;
+
+   //Recognizable payload
+   for(i = sizeof(UdpHeader); i < DATAGRAM_SIZE; i++)
+      datagram[i] = (uint8_t) (i * 7);
+}
+
+
+/**
+ * @brief Feed a fragment of the datagram to the reassembly algorithm
+ * @param[in] srcAddr Source address
+ * @param[in] id Identification field
+ * @param[in] first Offset of the first byte carried by the fragment
+ * @param[in] length Number of bytes carried by the fragment
+ **/
+
+static void sendFragment(Ipv4Addr srcAddr, uint16_t id, size_t first, size_t length)
+{
+   bool_t more;
+   static uint8_t packet[sizeof(Ipv4Header) + DATAGRAM_SIZE];
+   Ipv4Header *header;
+
+   //The last fragment clears the MF flag
+   more = (first + length) < DATAGRAM_SIZE;
+
+   //Format the IPv4 header
+   header = (Ipv4Header *) packet;
+   memset(header, 0, sizeof(Ipv4Header));
+   header->version = IPV4_VERSION;
+   header->headerLength = 5;
+   header->totalLength = htons(sizeof(Ipv4Header) + length);
+   header->identification = htons(id);
+   header->fragmentOffset = htons((first / 8) | (more ? IPV4_FLAG_MF : 0));
+   header->timeToLive = IPV4_DEFAULT_TTL;
+   header->protocol = IPV4_PROTOCOL_UDP;
+   header->srcAddr = srcAddr;
+   header->destAddr = TEST_SERVER_ADDR;
+
+   //Copy the payload of the fragment
+   memcpy(packet + sizeof(Ipv4Header), datagram + first, length);
+
+   //Process the fragment as the IPv4 input path does
+   osAcquireMutex(&netMutex);
+   ipv4ReassembleDatagram(testServerInterface, header, sizeof(Ipv4Header) + length);
+   osReleaseMutex(&netMutex);
+}
+
+
+/**
+ * @brief Search the reassembly queue for a datagram
+ * @param[in] srcAddr Source address
+ * @param[in] id Identification field
+ * @return Matching entry, if any
+ **/
+
+static Ipv4FragDesc *findDatagram(Ipv4Addr srcAddr, uint16_t id)
+{
+   uint_t i;
+   Ipv4Header *header;
+   Ipv4FragDesc *frag;
+
+   for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+   {
+      frag = &testServerInterface->ipv4Context.fragQueue[i];
+
+      if(frag->buffer.chunkCount > 0)
+      {
+         header = netBufferAt((NetBuffer *) &frag->buffer, 0);
+
+         if(header->srcAddr == srcAddr && header->identification == htons(id))
+            return frag;
+      }
+   }
+
+   return NULL;
+}
+
+
+/**
+ * @brief Number of datagrams in the reassembly queue
+ * @return Number of entries in use
+ **/
+
+static uint_t getQueueCount(void)
+{
+   uint_t i;
+   uint_t n;
+
+   for(i = 0, n = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+   {
+      if(testServerInterface->ipv4Context.fragQueue[i].buffer.chunkCount > 0)
+         n++;
+   }
+
+   return n;
+}
+
+
+/**
+ * @brief Receive a reassembled datagram and compare it with the original one
+ * @return TRUE if the datagram was delivered intact
+ **/
+
+static bool_t checkDelivered(void)
+{
+   error_t error;
+   size_t n;
+   static uint8_t data[DATAGRAM_SIZE];
+
+   error = socketReceive(udpSocket, data, sizeof(data), &n, 0);
+
+   return !error && n == (DATAGRAM_SIZE - sizeof(UdpHeader)) &&
+      !memcmp(data, datagram + sizeof(UdpHeader), n);
+}
+
+
+/**
+ * @brief Send the rest of a datagram whose first fragment was sent
+ * @param[in] srcAddr Source address
+ * @param[in] id Identification field
+ **/
+
+static void completeDatagram(Ipv4Addr srcAddr, uint16_t id)
+{
+   size_t first;
+
+   for(first = FRAG_SIZE; first < DATAGRAM_SIZE; first += FRAG_SIZE)
+      sendFragment(srcAddr, id, first, MIN(FRAG_SIZE, DATAGRAM_SIZE - first));
+}
+
+
+/**
+ * @brief Fragments received out of order are reassembled
+ **/
+
+static void testReassembly(void)
+{
+   //Last fragment first, then the first one, then the rest
+   sendFragment(TEST_SRC_ADDR, 1, 4 * FRAG_SIZE, DATAGRAM_SIZE - 4 * FRAG_SIZE);
+   sendFragment(TEST_SRC_ADDR, 1, 0, FRAG_SIZE);
+   TEST_CHECK(findDatagram(TEST_SRC_ADDR, 1) != NULL);
+   TEST_CHECK(findDatagram(TEST_SRC_ADDR, 1)->receivedLength == DATAGRAM_SIZE - 3 * FRAG_SIZE);
+
+   sendFragment(TEST_SRC_ADDR, 1, 2 * FRAG_SIZE, FRAG_SIZE);
+   sendFragment(TEST_SRC_ADDR, 1, FRAG_SIZE, FRAG_SIZE);
+   sendFragment(TEST_SRC_ADDR, 1, 3 * FRAG_SIZE, FRAG_SIZE);
+
+   TEST_CHECK(checkDelivered());
+   TEST_CHECK(getQueueCount() == 0);
+}
+
+
+/**
+ * @brief A flood of bogus first fragments cannot evict a datagram in progress
+ **/
+
+static void testFlood(void)
+{
+   uint_t i;
+
+   //A legitimate datagram is in progress
+   sendFragment(TEST_SRC_ADDR, 2, 0, FRAG_SIZE);
+
+   //Bogus first fragments from many sources, which are never completed
+   for(i = 0; i < 1000; i++)
+      sendFragment(IPV4_ADDR(10, 1, i >> 8, i & 0xFF), (uint16_t) i, 0, FRAG_SIZE);
+
+   //The queue is full, but the legitimate datagram is still there
+   TEST_CHECK(getQueueCount() == IPV4_MAX_FRAG_DATAGRAMS);
+   TEST_CHECK(findDatagram(TEST_SRC_ADDR, 2) != NULL);
+
+   //It completes normally
+   completeDatagram(TEST_SRC_ADDR, 2);
+   TEST_CHECK(checkDelivered());
+
+   osAcquireMutex(&netMutex);
+   ipv4FlushFragQueue(testServerInterface);
+   osReleaseMutex(&netMutex);
+}
+
+
+/**
+ * @brief A single source cannot take more than its share of the queue
+ **/
+
+static void testPerSourceQuota(void)
+{
+   uint_t i;
+
+   //One source starts more datagrams than it is allowed to
+   for(i = 0; i <= IPV4_MAX_FRAG_DATAGRAMS_PER_SRC; i++)
+      sendFragment(IPV4_ADDR(10, 2, 0, 1), (uint16_t) i, 0, FRAG_SIZE);
+
+   //The extra datagram was dropped
+   TEST_CHECK(getQueueCount() == IPV4_MAX_FRAG_DATAGRAMS_PER_SRC);
+   TEST_CHECK(findDatagram(IPV4_ADDR(10, 2, 0, 1), IPV4_MAX_FRAG_DATAGRAMS_PER_SRC) == NULL);
+
+   //Other sources are still served
+   sendFragment(TEST_SRC_ADDR, 3, 0, FRAG_SIZE);
+   completeDatagram(TEST_SRC_ADDR, 3);
+   TEST_CHECK(checkDelivered());
+
+   osAcquireMutex(&netMutex);
+   ipv4FlushFragQueue(testServerInterface);
+   osReleaseMutex(&netMutex);
+}
+
+
+/**
+ * @brief Memory pressure evicts the datagrams that made the least progress
+ **/
+
+static void testBudget(void)
+{
+   Ipv4Addr bogusAddr[3];
+
+   bogusAddr[0] = IPV4_ADDR(10, 3, 0, 1);
+   bogusAddr[1] = IPV4_ADDR(10, 3, 0, 2);
+   bogusAddr[2] = IPV4_ADDR(10, 3, 0, 3);
+
+   //The legitimate datagram has received two fragments
+   sendFragment(TEST_SRC_ADDR, 4, 0, FRAG_SIZE);
+   sendFragment(TEST_SRC_ADDR, 4, FRAG_SIZE, FRAG_SIZE);
+
+   //Two bogus datagrams claim large buffers with a few bytes each
+   sendFragment(bogusAddr[0], 4, 4 * FRAG_SIZE, 8);
+   sendFragment(bogusAddr[1], 4, 4 * FRAG_SIZE, 8);
+   TEST_CHECK(getQueueCount() == 3);
+
+   //Growing the legitimate datagram exceeds the budget, and the oldest
+   //datagram that made less progress is discarded
+   sendFragment(TEST_SRC_ADDR, 4, 4 * FRAG_SIZE, DATAGRAM_SIZE - 4 * FRAG_SIZE);
+   TEST_CHECK(findDatagram(TEST_SRC_ADDR, 4) != NULL);
+   TEST_CHECK(findDatagram(bogusAddr[0], 4) == NULL);
+   TEST_CHECK(findDatagram(bogusAddr[1], 4) != NULL);
+   TEST_CHECK(ipv4GetFragQueueSize(testServerInterface, NULL) <= IPV4_MAX_FRAG_TOTAL_SIZE);
+
+   //A new bogus datagram cannot push out the ones that made as much
+   //progress, so it is dropped instead
+   sendFragment(bogusAddr[2], 4, 4 * FRAG_SIZE, 8);
+   TEST_CHECK(findDatagram(bogusAddr[2], 4) == NULL);
+   TEST_CHECK(findDatagram(bogusAddr[1], 4) != NULL);
+   TEST_CHECK(findDatagram(TEST_SRC_ADDR, 4) != NULL);
+   TEST_CHECK(ipv4GetFragQueueSize(testServerInterface, NULL) <= IPV4_MAX_FRAG_TOTAL_SIZE);
+
+   //The legitimate datagram completes normally
+   completeDatagram(TEST_SRC_ADDR, 4);
+   TEST_CHECK(checkDelivered());
+
+   osAcquireMutex(&netMutex);
+   ipv4FlushFragQueue(testServerInterface);
+   osReleaseMutex(&netMutex);
+}
+
+
+#if (IPV4_FRAG_DROP_OVERLAPPING == ENABLED)
+
+/**
+ * @brief Duplicates are ignored while partial overlaps drop the datagram
+ **/
+
+static void testOverlap(void)
+{
+   //A duplicate fragment is ignored
+   sendFragment(TEST_SRC_ADDR, 5, 0, FRAG_SIZE);
+   sendFragment(TEST_SRC_ADDR, 5, 0, FRAG_SIZE);
+   TEST_CHECK(findDatagram(TEST_SRC_ADDR, 5) != NULL);
+   completeDatagram(TEST_SRC_ADDR, 5);
+   TEST_CHECK(checkDelivered());
+
+   //A fragment straddling received data drops the whole datagram
+   sendFragment(TEST_SRC_ADDR, 6, 0, FRAG_SIZE);
+   sendFragment(TEST_SRC_ADDR, 6, FRAG_SIZE - 8, FRAG_SIZE);
+   TEST_CHECK(getQueueCount() == 0);
+}
+
+#endif
+
+
+int main(void)
+{
+   //Start the stack with two interfaces connected back to back
+   if(testStackInit())
+      return 1;
+
+   //Receiving socket
+   udpSocket = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_IP_PROTO_UDP);
+   if(udpSocket == NULL)
+      return 1;
+   if(socketBind(udpSocket, &IP_ADDR_ANY, TEST_PORT))
+      return 1;
+   socketSetTimeout(udpSocket, 0);
+
+   buildDatagram();
+
+   TEST_RUN(testReassembly);
+   TEST_RUN(testFlood);
+   TEST_RUN(testPerSourceQuota);
+   TEST_RUN(testBudget);
+#if (IPV4_FRAG_DROP_OVERLAPPING == ENABLED)
+   TEST_RUN(testOverlap);
+#endif
+
+   return TEST_EXIT_STATUS();
+}
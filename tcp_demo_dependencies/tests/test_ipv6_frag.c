@@ -0,0 +1,433 @@
+/**
+ * @file test_ipv6_frag.c
+ * @brief IPv6 reassembly queue (memory budget, eviction, per-source quota)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "core/net.h"
+#include "core/udp.h"
+#include "ipv6/ipv6.h"
+#include "ipv6/ipv6_frag.h"
+#include "ipv6/ipv6_misc.h"
+#include "ipv6/ndp.h"
+#include "test_stack.h"
+#include "test_common.h"
+
+//UDP port the reassembled datagrams are sent to
+#define TEST_PORT 7000
+//Size of the UDP datagrams, header included
+#define DATAGRAM_SIZE 7000
+//Payload carried by each fragment
+#define FRAG_SIZE 1448
+
+//Address of the server interface
+static const Ipv6Addr serverAddr = IPV6_ADDR(0xFE80, 0, 0, 0, 0, 0, 0, 2);
+//Legitimate sender
+static const Ipv6Addr srcAddr = IPV6_ADDR(0xFE80, 0, 0, 0, 0, 0, 0, 50);
+
+//Contents of the datagrams
+static uint8_t datagram[DATAGRAM_SIZE];
+//Receiving socket
+static Socket *udpSocket;
+
+
+/**
+ * @brief Address of a bogus sender
+ * @param[in] n Sender index
+ * @return IPv6 address
+ **/
+
+static Ipv6Addr getBogusAddr(uint_t n)
+{
+   Ipv6Addr addr = IPV6_ADDR(0xFE80, 0, 0, 0, 0, 0, 1, 0);
+
+   addr.w[7] = htons(n);
+   return addr;
+}
+
+
+/**
+ * @brief Build the UDP datagram carried by the fragments
+ **/
+
+static void buildDatagram(void)
+{
+   size_t i;
+   UdpHeader *header;
+   Ipv6PseudoHeader pseudoHeader;
+
+   //UDP header
+   header = (UdpHeader *) datagram;
+   header->srcPort = htons(TEST_PORT);
+   header->destPort = htons(TEST_PORT);
+   header->length = htons(DATAGRAM_SIZE);
+   header->checksum = 0;
+
+   //Recognizable payload
+   for(i = sizeof(UdpHeader); i < DATAGRAM_SIZE; i++)
+      datagram[i] = (uint8_t) (i * 7);
+
+   //The UDP checksum is mandatory over IPv6
+   pseudoHeader.srcAddr = srcAddr;
+   pseudoHeader.destAddr = serverAddr;
+   pseudoHeader.length = htonl(DATAGRAM_SIZE);
+   pseudoHeader.reserved = 0;
+   pseudoHeader.nextHeader = IPV6_UDP_HEADER;
+   header->checksum = ipCalcUpperLayerChecksum(&pseudoHeader,
+      sizeof(Ipv6PseudoHeader), datagram, DATAGRAM_SIZE);
+}
+
+
+/**
+ * @brief Feed a fragment of the datagram to the reassembly algorithm
+ * @param[in] addr Source address
+ * @param[in] id Identification field
+ * @param[in] first Offset of the first byte carried by the fragment
+ * @param[in] length Number of bytes carried by the fragment
+ **/
+
+static void sendFragment(const Ipv6Addr *addr, uint32_t id, size_t first, size_t length)
+{
+   bool_t more;
+   NetBuffer *buffer;
+   Ipv6Header header;
+   Ipv6FragmentHeader fragHeader;
+
+   //The last fragment clears the M flag
+   more = (first + length) < DATAGRAM_SIZE;
+
+   //Format the IPv6 header
+   memset(&header, 0, sizeof(Ipv6Header));
+   header.version = IPV6_VERSION;
+   header.payloadLength = htons(sizeof(Ipv6FragmentHeader) + length);
+   header.nextHeader = IPV6_FRAGMENT_HEADER;
+   header.hopLimit = IPV6_DEFAULT_HOP_LIMIT;
+   header.srcAddr = *addr;
+   header.destAddr = serverAddr;
+
+   //Format the Fragment header
+   fragHeader.nextHeader = IPV6_UDP_HEADER;
+   fragHeader.reserved = 0;
+   fragHeader.fragmentOffset = htons(first | (more ? IPV6_FLAG_M : 0));
+   fragHeader.identification = htonl(id);
+
+   //Build the packet
+   buffer = netBufferAlloc(sizeof(Ipv6Header) + sizeof(Ipv6FragmentHeader) + length);
+   if(buffer == NULL)
+      return;
+
+   netBufferWrite(buffer, 0, &header, sizeof(Ipv6Header));
+   netBufferWrite(buffer, sizeof(Ipv6Header), &fragHeader, sizeof(Ipv6FragmentHeader));
+   netBufferWrite(buffer, sizeof(Ipv6Header) + sizeof(Ipv6FragmentHeader),
+      datagram + first, length);
+
+   //Process the fragment as the IPv6 input path does
+   osAcquireMutex(&netMutex);
+   ipv6ParseFragmentHeader(testServerInterface, buffer, 0, sizeof(Ipv6Header),
+      (uint8_t *) &header.nextHeader - (uint8_t *) &header);
+   osReleaseMutex(&netMutex);
+
+   netBufferFree(buffer);
+}
+
+
+/**
+ * @brief Search the reassembly queue for a datagram
+ * @param[in] addr Source address
+ * @param[in] id Identification field
+ * @return Matching entry, if any
+ **/
+
+static Ipv6FragDesc *findDatagram(const Ipv6Addr *addr, uint32_t id)
+{
+   uint_t i;
+   Ipv6Header *header;
+   Ipv6FragDesc *frag;
+
+   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   {
+      frag = &testServerInterface->ipv6Context.fragQueue[i];
+
+      if(frag->buffer.chunkCount > 0)
+      {
+         header = netBufferAt((NetBuffer *) &frag->buffer, 0);
+
+         if(ipv6CompAddr(&header->srcAddr, addr) && frag->identification == htonl(id))
+            return frag;
+      }
+   }
+
+   return NULL;
+}
+
+
+/**
+ * @brief Number of datagrams in the reassembly queue
+ * @return Number of entries in use
+ **/
+
+static uint_t getQueueCount(void)
+{
+   uint_t i;
+   uint_t n;
+
+   for(i = 0, n = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   {
+      if(testServerInterface->ipv6Context.fragQueue[i].buffer.chunkCount > 0)
+         n++;
+   }
+
+   return n;
+}
+
+
+/**
+ * @brief Receive a reassembled datagram and compare it with the original one
+ * @return TRUE if the datagram was delivered intact
+ **/
+
+static bool_t checkDelivered(void)
+{
+   error_t error;
+   size_t n;
+   static uint8_t data[DATAGRAM_SIZE];
+
+   error = socketReceive(udpSocket, data, sizeof(data), &n, 0);
+
+   return !error && n == (DATAGRAM_SIZE - sizeof(UdpHeader)) &&
+      !memcmp(data, datagram + sizeof(UdpHeader), n);
+}
+
+
+/**
+ * @brief Send the rest of a datagram whose first fragment was sent
+ * @param[in] addr Source address
+ * @param[in] id Identification field
+ **/
+
+static void completeDatagram(const Ipv6Addr *addr, uint32_t id)
+{
+   size_t first;
+
+   for(first = FRAG_SIZE; first < DATAGRAM_SIZE; first += FRAG_SIZE)
+      sendFragment(addr, id, first, MIN(FRAG_SIZE, DATAGRAM_SIZE - first));
+}
+
+
+/**
+ * @brief Discard every datagram being reassembled
+ **/
+
+static void flushQueue(void)
+{
+   osAcquireMutex(&netMutex);
+   ipv6FlushFragQueue(testServerInterface);
+   osReleaseMutex(&netMutex);
+}
+
+
+/**
+ * @brief Fragments received out of order are reassembled
+ **/
+
+static void testReassembly(void)
+{
+   //Last fragment first, then the first one, then the rest
+   sendFragment(&srcAddr, 1, 4 * FRAG_SIZE, DATAGRAM_SIZE - 4 * FRAG_SIZE);
+   sendFragment(&srcAddr, 1, 0, FRAG_SIZE);
+   TEST_CHECK(findDatagram(&srcAddr, 1) != NULL);
+   TEST_CHECK(findDatagram(&srcAddr, 1)->receivedLength == DATAGRAM_SIZE - 3 * FRAG_SIZE);
+
+   sendFragment(&srcAddr, 1, 2 * FRAG_SIZE, FRAG_SIZE);
+   sendFragment(&srcAddr, 1, FRAG_SIZE, FRAG_SIZE);
+   sendFragment(&srcAddr, 1, 3 * FRAG_SIZE, FRAG_SIZE);
+
+   TEST_CHECK(checkDelivered());
+   TEST_CHECK(getQueueCount() == 0);
+}
+
+
+/**
+ * @brief A flood of bogus first fragments cannot evict a datagram in progress
+ **/
+
+static void testFlood(void)
+{
+   uint_t i;
+   Ipv6Addr addr;
+
+   //A legitimate datagram is in progress
+   sendFragment(&srcAddr, 2, 0, FRAG_SIZE);
+
+   //Bogus first fragments from many sources, which are never completed
+   for(i = 0; i < 1000; i++)
+   {
+      addr = getBogusAddr(i);
+      sendFragment(&addr, i, 0, FRAG_SIZE);
+   }
+
+   //The queue is full, but the legitimate datagram is still there
+   TEST_CHECK(getQueueCount() == IPV6_MAX_FRAG_DATAGRAMS);
+   TEST_CHECK(findDatagram(&srcAddr, 2) != NULL);
+
+   //It completes normally
+   completeDatagram(&srcAddr, 2);
+   TEST_CHECK(checkDelivered());
+
+   flushQueue();
+}
+
+
+/**
+ * @brief A single source cannot take more than its share of the queue
+ **/
+
+static void testPerSourceQuota(void)
+{
+   uint_t i;
+   Ipv6Addr addr;
+
+   //One source starts more datagrams than it is allowed to
+   addr = getBogusAddr(0);
+   for(i = 0; i <= IPV6_MAX_FRAG_DATAGRAMS_PER_SRC; i++)
+      sendFragment(&addr, i, 0, FRAG_SIZE);
+
+   //The extra datagram was dropped
+   TEST_CHECK(getQueueCount() == IPV6_MAX_FRAG_DATAGRAMS_PER_SRC);
+   TEST_CHECK(findDatagram(&addr, IPV6_MAX_FRAG_DATAGRAMS_PER_SRC) == NULL);
+
+   //Other sources are still served
+   sendFragment(&srcAddr, 3, 0, FRAG_SIZE);
+   completeDatagram(&srcAddr, 3);
+   TEST_CHECK(checkDelivered());
+
+   flushQueue();
+}
+
+
+/**
+ * @brief Memory pressure evicts the datagrams that made the least progress
+ **/
+
+static void testBudget(void)
+{
+   uint_t i;
+   Ipv6Addr bogusAddr[3];
+
+   for(i = 0; i < 3; i++)
+      bogusAddr[i] = getBogusAddr(100 + i);
+
+   //The legitimate datagram has received two fragments
+   sendFragment(&srcAddr, 4, 0, FRAG_SIZE);
+   sendFragment(&srcAddr, 4, FRAG_SIZE, FRAG_SIZE);
+
+   //Two bogus datagrams claim large buffers with a few bytes each
+   sendFragment(&bogusAddr[0], 4, 4 * FRAG_SIZE, 8);
+   sendFragment(&bogusAddr[1], 4, 4 * FRAG_SIZE, 8);
+   TEST_CHECK(getQueueCount() == 3);
+
+   //Growing the legitimate datagram exceeds the budget, and the oldest
+   //datagram that made less progress is discarded
+   sendFragment(&srcAddr, 4, 4 * FRAG_SIZE, DATAGRAM_SIZE - 4 * FRAG_SIZE);
+   TEST_CHECK(findDatagram(&srcAddr, 4) != NULL);
+   TEST_CHECK(findDatagram(&bogusAddr[0], 4) == NULL);
+   TEST_CHECK(findDatagram(&bogusAddr[1], 4) != NULL);
+   TEST_CHECK(ipv6GetFragQueueSize(testServerInterface, NULL) <= IPV6_MAX_FRAG_TOTAL_SIZE);
+
+   //A new bogus datagram cannot push out the ones that made as much
+   //progress, so it is dropped instead
+   sendFragment(&bogusAddr[2], 4, 4 * FRAG_SIZE, 8);
+   TEST_CHECK(findDatagram(&bogusAddr[2], 4) == NULL);
+   TEST_CHECK(findDatagram(&bogusAddr[1], 4) != NULL);
+   TEST_CHECK(findDatagram(&srcAddr, 4) != NULL);
+   TEST_CHECK(ipv6GetFragQueueSize(testServerInterface, NULL) <= IPV6_MAX_FRAG_TOTAL_SIZE);
+
+   //The legitimate datagram completes normally
+   completeDatagram(&srcAddr, 4);
+   TEST_CHECK(checkDelivered());
+
+   flushQueue();
+}
+
+
+#if (IPV6_FRAG_DROP_OVERLAPPING == ENABLED)
+
+/**
+ * @brief Duplicates are ignored while partial overlaps drop the datagram
+ **/
+
+static void testOverlap(void)
+{
+   //A duplicate fragment is ignored
+   sendFragment(&srcAddr, 5, 0, FRAG_SIZE);
+   sendFragment(&srcAddr, 5, 0, FRAG_SIZE);
+   TEST_CHECK(findDatagram(&srcAddr, 5) != NULL);
+   completeDatagram(&srcAddr, 5);
+   TEST_CHECK(checkDelivered());
+
+   //A fragment straddling received data drops the whole datagram
+   sendFragment(&srcAddr, 6, 0, FRAG_SIZE);
+   sendFragment(&srcAddr, 6, FRAG_SIZE - 8, FRAG_SIZE);
+   TEST_CHECK(getQueueCount() == 0);
+}
+
+#endif
+
+
+int main(void)
+{
+   //Start the stack with two interfaces connected back to back
+   if(testStackInit())
+      return 1;
+
+   //Assign an IPv6 address to the server interface
+   osAcquireMutex(&netMutex);
+   ipv6SetAddr(testServerInterface, 0, &serverAddr, IPV6_ADDR_STATE_PREFERRED,
+      NDP_INFINITE_LIFETIME, NDP_INFINITE_LIFETIME, TRUE);
+   osReleaseMutex(&netMutex);
+
+   //Receiving socket
+   udpSocket = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_IP_PROTO_UDP);
+   if(udpSocket == NULL)
+      return 1;
+   if(socketBind(udpSocket, &IP_ADDR_ANY, TEST_PORT))
+      return 1;
+   socketSetTimeout(udpSocket, 0);
+
+   buildDatagram();
+
+   TEST_RUN(testReassembly);
+   TEST_RUN(testFlood);
+   TEST_RUN(testPerSourceQuota);
+   TEST_RUN(testBudget);
+#if (IPV6_FRAG_DROP_OVERLAPPING == ENABLED)
+   TEST_RUN(testOverlap);
+#endif
+
+   return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,309 @@
+/**
+ * @file test_loopback.c
+ * @brief Zero-copy receive path, over the loopback driver
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "core/net.h"
+#include "core/tcp.h"
+#include "test_stack.h"
+#include "test_common.h"
+
+//Amount of data transferred by each test
+#define TRANSFER_SIZE 2000000
+
+
+/**
+ * @brief Number of memory pool blocks in use
+ * @return Current usage
+ **/
+
+static uint_t getPoolUsage(void)
+{
+   uint_t currentUsage;
+   uint_t maxUsage;
+   uint_t size;
+
+   memPoolGetStats(&currentUsage, &maxUsage, &size);
+   return currentUsage;
+}
+
+
+/**
+ * @brief Drop one TCP data segment out of every n
+ * @param[in] interface Sending interface
+ * @param[in] frame Ethernet frame
+ * @param[in] length Length of the frame
+ * @param[in] param Pointer to the drop period
+ * @return TRUE if the frame must be lost
+ **/
+
+static bool_t dropDataSegments(NetInterface *interface,
+   uint8_t *frame, size_t length, void *param)
+{
+   static uint_t counter = 0;
+
+   //Only full-sized frames carry bulk data
+   if(length < 1000)
+      return FALSE;
+
+   //Drop every nth data segment
+   return (++counter % *((uint_t *) param)) == 0;
+}
+
+
+/**
+ * @brief Drop a single TCP data segment
+ * @param[in] interface Sending interface
+ * @param[in] frame Ethernet frame
+ * @param[in] length Length of the frame
+ * @param[in] param Pointer to the number of data segments left before the loss
+ * @return TRUE if the frame must be lost
+ **/
+
+static bool_t dropOneSegment(NetInterface *interface,
+   uint8_t *frame, size_t length, void *param)
+{
+   uint_t *countdown;
+
+   //Only full-sized frames carry bulk data
+   if(length < 1000)
+      return FALSE;
+
+   //The loss has already occurred?
+   countdown = (uint_t *) param;
+   if(*countdown == 0)
+      return FALSE;
+
+   //Drop the selected data segment
+   return --(*countdown) == 0;
+}
+
+
+/**
+ * @brief Transfer data and make sure every loaned buffer is released
+ * @param[in] port Server port
+ * @param[in] period Drop period of the data segments (0 for no loss)
+ **/
+
+static void checkTransfer(uint16_t port, uint_t period)
+{
+   uint_t i;
+   error_t error;
+   int_t errors;
+   uint_t usage;
+   size_t received;
+   Socket *client;
+   Socket *server;
+   LoopbackDriverStats stats;
+   LoopbackDriverStats statsBefore;
+
+   //Memory pool usage while idle
+   usage = getPoolUsage();
+   loopbackDriverGetStats(testServerInterface, &statsBefore);
+
+   //Lossy link?
+   if(period != 0)
+      loopbackDriverSetLossHook(testClientInterface, dropDataSegments, &period);
+
+   //Connect the two interfaces
+   error = testTcpOpen(port, 8192, &client, &server);
+   TEST_CHECK(error == NO_ERROR);
+   if(error)
+      return;
+
+   errors = testTcpTransfer(client, server, TRANSFER_SIZE, &received);
+   TEST_CHECK(errors == 0);
+   TEST_CHECK(received == TRANSFER_SIZE);
+
+   //The loss hook must not outlive the test
+   loopbackDriverSetLossHook(testClientInterface, NULL, NULL);
+   loopbackDriverGetStats(testServerInterface, &stats);
+
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   //The socket must have kept the receive buffers
+   TEST_CHECK(stats.loanCount > statsBefore.loanCount);
+#else
+   //The receive buffers are always copied
+   TEST_CHECK(stats.loanCount == statsBefore.loanCount);
+#endif
+
+   //Every loaned buffer has been returned once the data was read
+   TEST_CHECK(server->rxQueueCount == 0);
+
+   //Close both ends
+   socketClose(server);
+   socketClose(client);
+
+   //Let the last segments go through
+   for(i = 0; i < 100 && getPoolUsage() != usage; i++)
+      testSleep(50);
+
+   //No buffer may leak
+   TEST_CHECK(getPoolUsage() == usage);
+}
+
+
+/**
+ * @brief Lossless bulk transfer
+ **/
+
+static void testLossless(void)
+{
+   checkTransfer(80, 0);
+}
+
+
+/**
+ * @brief Bulk transfer with losses (out-of-order segments are queued)
+ **/
+
+static void testLossy(void)
+{
+   checkTransfer(81, 13);
+}
+
+
+/**
+ * @brief In-order data are loaned, data received after a gap are copied
+ *
+ * Four full-sized segments are sent while the second one is lost. The
+ * first one is queued as is. The next ones arrive before the gap is filled
+ * and are copied to the receive buffer. The retransmitted segment fills
+ * the gap in order and is queued too. A fifth segment then arrives in order,
+ * but must be copied since the data that precede it were. The stream must
+ * be read back in the right order
+ **/
+
+static void testOutOfOrder(void)
+{
+   uint_t i;
+   uint_t usage;
+   uint_t countdown;
+   error_t error;
+   size_t n;
+   size_t length;
+   Socket *client;
+   Socket *server;
+   uint8_t *data;
+
+   //Memory pool usage while idle
+   usage = getPoolUsage();
+
+   //Connect the two interfaces
+   error = testTcpOpen(82, 16384, &client, &server);
+   TEST_CHECK(error == NO_ERROR);
+   if(error)
+      return;
+
+   //Five full-sized segments
+   length = 5 * client->smss;
+   data = malloc(length);
+
+   for(i = 0; i < length; i++)
+      data[i] = i % 251;
+
+   //The second data segment is lost
+   countdown = 2;
+   loopbackDriverSetLossHook(testClientInterface, dropOneSegment, &countdown);
+
+   //Send four segments without reading them on the other side
+   TEST_CHECK(socketSend(client, data, 4 * client->smss, &n, 0) == NO_ERROR);
+
+   //Wait for the retransmission to fill the gap
+   for(i = 0; i < 100 && server->rcvUser < 4 * client->smss; i++)
+      testSleep(50);
+
+   TEST_CHECK(server->rcvUser == 4 * client->smss);
+   TEST_CHECK(countdown == 0);
+
+   //Send the last segment
+   TEST_CHECK(socketSend(client, data + n, length - n, &n, 0) == NO_ERROR);
+
+   for(i = 0; i < 100 && server->rcvUser < length; i++)
+      testSleep(50);
+
+   TEST_CHECK(server->rcvUser == length);
+
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
+#if (NET_ZERO_COPY_RX_SUPPORT == ENABLED)
+   //The first two segments were received in order while all the unread
+   //data were held by the receive queue
+   TEST_CHECK(server->rxQueueCount == 2);
+   TEST_CHECK(server->rxQueueLength == 2 * client->smss);
+#else
+   //Every segment has been copied
+   TEST_CHECK(server->rxQueueCount == 0);
+   TEST_CHECK(server->rxQueueLength == 0);
+#endif
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+
+   //Read back the stream
+   memset(data, 0, length);
+   TEST_CHECK(socketReceive(server, data, length, &n, SOCKET_FLAG_WAIT_ALL) == NO_ERROR);
+   TEST_CHECK(n == length);
+
+   for(i = 0; i < length && data[i] == i % 251; i++)
+   {
+   }
+
+   TEST_CHECK(i == length);
+   TEST_CHECK(server->rxQueueCount == 0);
+
+   loopbackDriverSetLossHook(testClientInterface, NULL, NULL);
+   free(data);
+
+   //Close both ends
+   socketClose(server);
+   socketClose(client);
+
+   //Let the last segments go through
+   for(i = 0; i < 100 && getPoolUsage() != usage; i++)
+      testSleep(50);
+
+   //No buffer may leak
+   TEST_CHECK(getPoolUsage() == usage);
+}
+
+
+int main(void)
+{
+   //Start the stack
+   if(testStackInit())
+      return 1;
+
+   TEST_RUN(testLossless);
+   TEST_RUN(testLossy);
+   TEST_RUN(testOutOfOrder);
+
+   return TEST_EXIT_STATUS();
+}
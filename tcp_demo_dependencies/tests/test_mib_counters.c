@@ -0,0 +1,365 @@
+/**
+ * @file test_mib_counters.c
+ * @brief MIB counters of the IPv4, TCP and UDP layers, over the loopback driver
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "core/net.h"
+#include "core/tcp.h"
+#include "core/udp.h"
+#include "mibs/mib2_module.h"
+#include "mibs/ip_mib_module.h"
+#include "mibs/tcp_mib_module.h"
+#include "mibs/udp_mib_module.h"
+#include "test_stack.h"
+#include "test_common.h"
+
+//UDP port of the receiving socket
+#define TEST_PORT 5000
+//TCP port of the server
+#define TEST_TCP_PORT 5001
+//Number of UDP datagrams sent by each test
+#define DATAGRAM_COUNT 200
+//Length of the UDP payload
+#define DATAGRAM_SIZE 100
+//Amount of data transferred over TCP
+#define TRANSFER_SIZE 200000
+
+//The MIB modules are not linked, only their bases
+Mib2Base mib2Base;
+IpMibBase ipMibBase;
+TcpMibBase tcpMibBase;
+UdpMibBase udpMibBase;
+
+
+/**
+ * @brief Snapshot of the MIB counters
+ **/
+
+typedef struct
+{
+   Mib2Base mib2;
+   IpMibBase ip;
+   TcpMibBase tcp;
+   UdpMibBase udp;
+} Snapshot;
+
+
+/**
+ * @brief Read the MIB counters the way the SNMP agent does
+ * @param[out] snapshot Current value of the MIB counters
+ **/
+
+static void readCounters(Snapshot *snapshot)
+{
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+   //Fold the counter blocks before reading the MIB bases
+   netFoldCounters();
+
+   //Copy the MIB bases
+   snapshot->mib2 = mib2Base;
+   snapshot->ip = ipMibBase;
+   snapshot->tcp = tcpMibBase;
+   snapshot->udp = udpMibBase;
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+}
+
+
+/**
+ * @brief Check that each Counter32 object matches its Counter64 twin
+ * @param[in] s MIB counters
+ **/
+
+static void checkCounterPairs(const Snapshot *s)
+{
+   uint_t i;
+   const IpMibIpSystemStatsEntry *sys;
+   const IpMibIpIfStatsEntry *ifStats;
+
+   sys = &s->ip.ipv4SystemStats;
+
+   TEST_CHECK(s->mib2.ipGroup.ipInReceives == sys->ipSystemStatsInReceives);
+   TEST_CHECK(sys->ipSystemStatsInReceives == (uint32_t) sys->ipSystemStatsHCInReceives);
+   TEST_CHECK(sys->ipSystemStatsInOctets == (uint32_t) sys->ipSystemStatsHCInOctets);
+   TEST_CHECK(s->mib2.ipGroup.ipInDelivers == sys->ipSystemStatsInDelivers);
+   TEST_CHECK(sys->ipSystemStatsInDelivers == (uint32_t) sys->ipSystemStatsHCInDelivers);
+   TEST_CHECK(s->mib2.ipGroup.ipOutRequests == sys->ipSystemStatsOutRequests);
+   TEST_CHECK(sys->ipSystemStatsOutRequests == (uint32_t) sys->ipSystemStatsHCOutRequests);
+   TEST_CHECK(sys->ipSystemStatsOutTransmits == (uint32_t) sys->ipSystemStatsHCOutTransmits);
+   TEST_CHECK(sys->ipSystemStatsOutOctets == (uint32_t) sys->ipSystemStatsHCOutOctets);
+
+   //The system-wide statistics are the sum of the per-interface ones
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      ifStats = &s->ip.ipv4IfStatsTable[i];
+
+      TEST_CHECK(ifStats->ipIfStatsInReceives == (uint32_t) ifStats->ipIfStatsHCInReceives);
+      TEST_CHECK(ifStats->ipIfStatsInOctets == (uint32_t) ifStats->ipIfStatsHCInOctets);
+      TEST_CHECK(ifStats->ipIfStatsOutTransmits == (uint32_t) ifStats->ipIfStatsHCOutTransmits);
+      TEST_CHECK(ifStats->ipIfStatsOutOctets == (uint32_t) ifStats->ipIfStatsHCOutOctets);
+   }
+
+   TEST_CHECK(sys->ipSystemStatsHCInReceives == s->ip.ipv4IfStatsTable[0].ipIfStatsHCInReceives +
+      s->ip.ipv4IfStatsTable[1].ipIfStatsHCInReceives);
+   TEST_CHECK(sys->ipSystemStatsHCOutOctets == s->ip.ipv4IfStatsTable[0].ipIfStatsHCOutOctets +
+      s->ip.ipv4IfStatsTable[1].ipIfStatsHCOutOctets);
+
+   TEST_CHECK(s->mib2.tcpGroup.tcpInSegs == s->tcp.tcpInSegs);
+   TEST_CHECK(s->tcp.tcpInSegs == (uint32_t) s->tcp.tcpHCInSegs);
+   TEST_CHECK(s->mib2.tcpGroup.tcpOutSegs == s->tcp.tcpOutSegs);
+   TEST_CHECK(s->tcp.tcpOutSegs == (uint32_t) s->tcp.tcpHCOutSegs);
+   TEST_CHECK(s->mib2.tcpGroup.tcpRetransSegs == s->tcp.tcpRetransSegs);
+
+   TEST_CHECK(s->mib2.udpGroup.udpInDatagrams == s->udp.udpInDatagrams);
+   TEST_CHECK(s->udp.udpInDatagrams == (uint32_t) s->udp.udpHCInDatagrams);
+   TEST_CHECK(s->mib2.udpGroup.udpOutDatagrams == s->udp.udpOutDatagrams);
+   TEST_CHECK(s->udp.udpOutDatagrams == (uint32_t) s->udp.udpHCOutDatagrams);
+}
+
+
+/**
+ * @brief Every UDP datagram is counted exactly once at each layer
+ **/
+
+static void testUdp(void)
+{
+   uint_t i;
+   size_t n;
+   error_t error;
+   Socket *sender;
+   Socket *receiver;
+   IpAddr addr;
+   Snapshot before;
+   Snapshot after;
+   uint8_t data[DATAGRAM_SIZE];
+
+   receiver = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_IP_PROTO_UDP);
+   sender = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_IP_PROTO_UDP);
+   TEST_CHECK(receiver != NULL && sender != NULL);
+   if(receiver == NULL || sender == NULL)
+      return;
+
+   socketBindToInterface(receiver, testServerInterface);
+   socketBind(receiver, &IP_ADDR_ANY, TEST_PORT);
+   socketSetTimeout(receiver, 1000);
+   socketBindToInterface(sender, testClientInterface);
+
+   //The ARP resolution must not be part of the measurement
+   addr.length = sizeof(Ipv4Addr);
+   addr.ipv4Addr = TEST_SERVER_ADDR;
+   memset(data, 0x5A, sizeof(data));
+   socketSendTo(sender, &addr, TEST_PORT, data, sizeof(data), NULL, 0);
+   socketReceive(receiver, data, sizeof(data), &n, 0);
+
+   readCounters(&before);
+
+   //Send one datagram at a time so that none of them is dropped
+   for(i = 0; i < DATAGRAM_COUNT; i++)
+   {
+      socketSendTo(sender, &addr, TEST_PORT, data, sizeof(data), NULL, 0);
+      error = socketReceive(receiver, data, sizeof(data), &n, 0);
+      TEST_CHECK(!error && n == DATAGRAM_SIZE);
+   }
+
+   readCounters(&after);
+
+   //UDP layer
+   TEST_CHECK(after.udp.udpHCOutDatagrams - before.udp.udpHCOutDatagrams == DATAGRAM_COUNT);
+   TEST_CHECK(after.udp.udpHCInDatagrams - before.udp.udpHCInDatagrams == DATAGRAM_COUNT);
+   TEST_CHECK(after.mib2.udpGroup.udpOutDatagrams - before.mib2.udpGroup.udpOutDatagrams == DATAGRAM_COUNT);
+   TEST_CHECK(after.mib2.udpGroup.udpInDatagrams - before.mib2.udpGroup.udpInDatagrams == DATAGRAM_COUNT);
+
+   //IP layer, on the client side
+   TEST_CHECK(after.ip.ipv4IfStatsTable[0].ipIfStatsHCOutRequests -
+      before.ip.ipv4IfStatsTable[0].ipIfStatsHCOutRequests == DATAGRAM_COUNT);
+   TEST_CHECK(after.ip.ipv4IfStatsTable[0].ipIfStatsHCOutTransmits -
+      before.ip.ipv4IfStatsTable[0].ipIfStatsHCOutTransmits == DATAGRAM_COUNT);
+   TEST_CHECK(after.ip.ipv4IfStatsTable[0].ipIfStatsHCOutOctets -
+      before.ip.ipv4IfStatsTable[0].ipIfStatsHCOutOctets ==
+      DATAGRAM_COUNT * (sizeof(Ipv4Header) + sizeof(UdpHeader) + DATAGRAM_SIZE));
+
+   //IP layer, on the server side
+   TEST_CHECK(after.ip.ipv4IfStatsTable[1].ipIfStatsHCInReceives -
+      before.ip.ipv4IfStatsTable[1].ipIfStatsHCInReceives == DATAGRAM_COUNT);
+   TEST_CHECK(after.ip.ipv4IfStatsTable[1].ipIfStatsHCInDelivers -
+      before.ip.ipv4IfStatsTable[1].ipIfStatsHCInDelivers == DATAGRAM_COUNT);
+   TEST_CHECK(after.ip.ipv4IfStatsTable[1].ipIfStatsHCInOctets -
+      before.ip.ipv4IfStatsTable[1].ipIfStatsHCInOctets ==
+      DATAGRAM_COUNT * (sizeof(Ipv4Header) + sizeof(UdpHeader) + DATAGRAM_SIZE));
+
+   checkCounterPairs(&after);
+
+   socketClose(sender);
+   socketClose(receiver);
+}
+
+
+/**
+ * @brief Every TCP segment sent over the loopback link is received
+ **/
+
+static void testTcp(void)
+{
+   error_t error;
+   size_t received;
+   Socket *client;
+   Socket *server;
+   Snapshot before;
+   Snapshot after;
+   uint64_t outSegs;
+   uint64_t inSegs;
+
+   readCounters(&before);
+
+   //Bulk transfer from the client to the server
+   error = testTcpOpen(TEST_TCP_PORT, 0, &client, &server);
+   TEST_CHECK(!error);
+
+   if(!error)
+      TEST_CHECK(testTcpTransfer(client, server, TRANSFER_SIZE, &received) == 0);
+
+   //Close both ends and let the last segments go through
+   if(client != NULL)
+      socketClose(client);
+   if(server != NULL)
+      socketClose(server);
+   testSleep(500);
+
+   readCounters(&after);
+
+   outSegs = after.tcp.tcpHCOutSegs - before.tcp.tcpHCOutSegs;
+   inSegs = after.tcp.tcpHCInSegs - before.tcp.tcpHCInSegs;
+
+   //The loopback link does not lose any segment
+   TEST_CHECK(outSegs > TRANSFER_SIZE / TCP_MAX_MSS);
+   TEST_CHECK(inSegs == outSegs + (after.tcp.tcpRetransSegs - before.tcp.tcpRetransSegs));
+
+   //Every segment is also an IP datagram
+   TEST_CHECK(after.ip.ipv4SystemStats.ipSystemStatsHCInDelivers -
+      before.ip.ipv4SystemStats.ipSystemStatsHCInDelivers == inSegs);
+
+   checkCounterPairs(&after);
+}
+
+
+/**
+ * @brief Counters are only published by the fold
+ **/
+
+static void testFold(void)
+{
+#if (IPV4_COUNTER_BLOCK_SUPPORT == ENABLED)
+   uint32_t value;
+
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
+   //Fold whatever is pending
+   netFoldCounters();
+   value = mib2Base.ipGroup.ipInReceives;
+
+   //Count a datagram in the block of the client interface
+   testClientInterface->ipv4Context.counters.inReceives++;
+   TEST_CHECK(mib2Base.ipGroup.ipInReceives == value);
+
+   //The fold publishes it and empties the block
+   netFoldCounters();
+   TEST_CHECK(mib2Base.ipGroup.ipInReceives == value + 1);
+   TEST_CHECK(testClientInterface->ipv4Context.counters.inReceives == 0);
+
+   //Folding an empty block changes nothing
+   netFoldCounters();
+   TEST_CHECK(mib2Base.ipGroup.ipInReceives == value + 1);
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+#endif
+}
+
+
+/**
+ * @brief Measure the per-datagram cost of the counter updates
+ **/
+
+static void benchCounters(void)
+{
+   uint_t i;
+   double start;
+   double duration;
+   Ipv4Header header;
+   NetInterface *interface;
+
+   interface = testServerInterface;
+
+   //Datagram for another host, discarded once the input counters have
+   //been updated
+   memset(&header, 0, sizeof(header));
+   header.version = IPV4_VERSION;
+   header.headerLength = 5;
+   header.totalLength = htons(sizeof(header));
+   header.timeToLive = 64;
+   header.protocol = IPV4_PROTOCOL_UDP;
+   header.srcAddr = TEST_CLIENT_ADDR;
+   header.destAddr = IPV4_ADDR(10, 0, 0, 99);
+   header.headerChecksum = ipCalcChecksum(&header, sizeof(header));
+
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
+   start = testGetTime();
+   for(i = 0; i < 1000000; i++)
+      ipv4ProcessPacket(interface, &header, sizeof(header));
+   duration = testGetTime() - start;
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+
+   printf("   %.1f ns per discarded datagram\n", duration / 1000000);
+}
+
+
+/**
+ * @brief Main entry point
+ **/
+
+int main(void)
+{
+   //Start the stack with two interfaces connected back to back
+   if(testStackInit())
+      return 1;
+
+   TEST_RUN(testUdp);
+   TEST_RUN(testTcp);
+   TEST_RUN(testFold);
+   benchCounters();
+
+   return TEST_EXIT_STATUS();
+}
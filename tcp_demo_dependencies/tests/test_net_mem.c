@@ -0,0 +1,544 @@
+/**
+ * @file test_net_mem.c
+ * @brief Memory pool unit tests and allocator benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <pthread.h>
+#include "core/net.h"
+#include "core/net_mem.h"
+#include "test_common.h"
+
+//Number of alloc/free pairs per benchmark run
+#define BENCH_ITERATIONS 1000000
+//Number of concurrent tasks
+#define TASK_COUNT 4
+//Number of blocks held simultaneously by each task
+#define TASK_BLOCK_COUNT 6
+
+//Blocks handed out by the tests
+static void *block[NET_MEM_POOL_BUFFER_COUNT];
+
+//Reference allocator (linear scan of an allocation table)
+static OsMutex refMutex;
+static uint8_t refPool[NET_MEM_POOL_BUFFER_COUNT][NET_MEM_POOL_BUFFER_SIZE];
+static bool_t refAllocTable[NET_MEM_POOL_BUFFER_COUNT];
+
+
+/**
+ * @brief Reference allocator: allocate a block
+ **/
+
+static void *refAlloc(void)
+{
+   uint_t i;
+   void *p = NULL;
+
+   osAcquireMutex(&refMutex);
+
+   //Loop through the allocation table
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+   {
+      if(!refAllocTable[i])
+      {
+         refAllocTable[i] = TRUE;
+         p = refPool[i];
+         break;
+      }
+   }
+
+   osReleaseMutex(&refMutex);
+   return p;
+}
+
+
+/**
+ * @brief Reference allocator: release a block
+ **/
+
+static void refFree(void *p)
+{
+   uint_t i;
+
+   osAcquireMutex(&refMutex);
+
+   //Loop through the allocation table
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+   {
+      if(refPool[i] == p)
+      {
+         refAllocTable[i] = FALSE;
+         break;
+      }
+   }
+
+   osReleaseMutex(&refMutex);
+}
+
+
+/**
+ * @brief Get the number of blocks currently allocated
+ **/
+
+static uint_t getUsage(void)
+{
+   uint_t n;
+
+   memPoolGetStats(&n, NULL, NULL);
+   return n;
+}
+
+
+/**
+ * @brief Exhaust the pool, then release every block
+ **/
+
+static void testAllocAll(void)
+{
+   uint_t i;
+   uint_t j;
+
+   //Allocate all the blocks
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+   {
+      block[i] = memPoolAlloc(NET_MEM_POOL_BUFFER_SIZE);
+      TEST_CHECK(block[i] != NULL);
+   }
+
+   //The blocks must be distinct
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+   {
+      for(j = i + 1; j < NET_MEM_POOL_BUFFER_COUNT; j++)
+         TEST_CHECK(block[i] != block[j]);
+   }
+
+   //The pool is exhausted
+   TEST_CHECK(memPoolAlloc(1) == NULL);
+   TEST_CHECK(getUsage() == NET_MEM_POOL_BUFFER_COUNT);
+
+   //Oversized requests are rejected
+   memPoolFree(block[0]);
+   TEST_CHECK(memPoolAlloc(NET_MEM_POOL_BUFFER_SIZE + 1) == NULL);
+   block[0] = memPoolAlloc(1);
+   TEST_CHECK(block[0] != NULL);
+
+   //Release all the blocks
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+      memPoolFree(block[i]);
+
+   TEST_CHECK(getUsage() == 0);
+}
+
+
+/**
+ * @brief A double free must not link the block twice in the free list
+ **/
+
+static void testDoubleFree(void)
+{
+   uint_t i;
+   uint_t j;
+   void *p;
+
+   //Allocate and release a block twice
+   p = memPoolAlloc(100);
+   TEST_CHECK(p != NULL);
+   memPoolFree(p);
+   memPoolFree(p);
+   //Same thing through a pointer inside the block
+   memPoolFree((uint8_t *) p + 10);
+
+   //The second release is ignored
+   TEST_CHECK(getUsage() == 0);
+
+   //Every block must still be handed out exactly once
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+   {
+      block[i] = memPoolAlloc(100);
+      TEST_CHECK(block[i] != NULL);
+
+      for(j = 0; j < i; j++)
+         TEST_CHECK(block[i] != block[j]);
+   }
+
+   TEST_CHECK(memPoolAlloc(100) == NULL);
+
+   //Release all the blocks
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+      memPoolFree(block[i]);
+
+   TEST_CHECK(getUsage() == 0);
+}
+
+
+/**
+ * @brief Pointers that do not belong to the pool are ignored
+ **/
+
+static void testForeignPointer(void)
+{
+   uint8_t local[16];
+
+   //Release pointers that were never allocated from the pool
+   memPoolFree(local);
+   memPoolFree(NULL);
+
+   //The pool is left untouched
+   TEST_CHECK(getUsage() == 0);
+   TEST_CHECK(!memPoolHold(local));
+}
+
+
+/**
+ * @brief Additional references keep the block allocated
+ **/
+
+static void testHold(void)
+{
+   void *p;
+   void *q;
+
+   //A reference cannot be taken on a free block
+   p = memPoolAlloc(100);
+   memPoolFree(p);
+   TEST_CHECK(!memPoolHold(p));
+
+   //Take two additional references
+   p = memPoolAlloc(100);
+   TEST_CHECK(memPoolHold(p));
+   TEST_CHECK(memPoolHold(p));
+
+   //The block survives the first two releases
+   memPoolFree(p);
+   memPoolFree(p);
+   TEST_CHECK(getUsage() == 1);
+
+   //The last release returns the block to the pool
+   memPoolFree(p);
+   TEST_CHECK(getUsage() == 0);
+
+   //Any further release is a double free
+   memPoolFree(p);
+   TEST_CHECK(getUsage() == 0);
+
+   //The block is handed out again, once
+   q = memPoolAlloc(100);
+   TEST_CHECK(q != NULL);
+   memPoolFree(q);
+   TEST_CHECK(getUsage() == 0);
+}
+
+
+/**
+ * @brief Task exercising the pool concurrently with other tasks
+ *
+ * Each block is stamped with the task identifier while it is held, so
+ * that a block handed out twice is detected
+ **/
+
+static void *concurrentTask(void *param)
+{
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   uint8_t id;
+   uint_t errors;
+   uint8_t *p[TASK_BLOCK_COUNT];
+
+   //Identifier of the task
+   id = (uint8_t) (uintptr_t) param;
+   errors = 0;
+
+   for(i = 0; i < BENCH_ITERATIONS / 10; i++)
+   {
+      //Allocate a variable number of blocks
+      n = 1 + (i % TASK_BLOCK_COUNT);
+
+      for(j = 0; j < n; j++)
+      {
+         p[j] = memPoolAlloc(100);
+
+         //Stamp the block
+         if(p[j] != NULL)
+            memset(p[j], id, 100);
+      }
+
+      for(j = 0; j < n; j++)
+      {
+         if(p[j] != NULL)
+         {
+            //The block must not have been handed out to another task
+            if(p[j][0] != id || p[j][99] != id)
+               errors++;
+
+            memPoolFree(p[j]);
+         }
+      }
+   }
+
+   //Return the cached buffers before exiting
+   memPoolFlushCache(NULL);
+
+   //Return the number of corrupted blocks
+   return (void *) (uintptr_t) errors;
+}
+
+
+/**
+ * @brief Several tasks share the pool
+ **/
+
+static void testConcurrent(void)
+{
+   uint_t i;
+   void *ret;
+   pthread_t thread[TASK_COUNT];
+
+   //Start the tasks
+   for(i = 0; i < TASK_COUNT; i++)
+      pthread_create(&thread[i], NULL, concurrentTask, (void *) (uintptr_t) (i + 1));
+
+   //Wait for the tasks to complete
+   for(i = 0; i < TASK_COUNT; i++)
+   {
+      pthread_join(thread[i], &ret);
+      TEST_CHECK(ret == NULL);
+   }
+
+   //All the blocks are back in the pool
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+   {
+      block[i] = memPoolAlloc(100);
+      TEST_CHECK(block[i] != NULL);
+   }
+
+   //Release all the blocks
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+      memPoolFree(block[i]);
+
+   TEST_CHECK(getUsage() == 0);
+}
+
+
+//Synchronization between the main task and the helper task
+static pthread_barrier_t barrier;
+
+
+/**
+ * @brief Task that keeps buffers in its cache and then goes idle
+ **/
+
+static void *idleTask(void *param)
+{
+   uint_t i;
+   void *p[TASK_BLOCK_COUNT];
+
+   //Allocate a few blocks and release all of them but one (they stay
+   //in the cache, if any)
+   for(i = 0; i < TASK_BLOCK_COUNT; i++)
+      p[i] = memPoolAlloc(100);
+   for(i = 1; i < TASK_BLOCK_COUNT; i++)
+      memPoolFree(p[i]);
+
+   //Let the main task exhaust the pool
+   pthread_barrier_wait(&barrier);
+   pthread_barrier_wait(&barrier);
+
+   //The next release honors the pending flush request
+   memPoolFree(p[0]);
+
+   //Let the main task allocate again
+   pthread_barrier_wait(&barrier);
+   pthread_barrier_wait(&barrier);
+
+   //Return the cached buffers before exiting
+   memPoolFlushCache(NULL);
+   return NULL;
+}
+
+
+/**
+ * @brief Buffers cached by an idle task are returned on request
+ **/
+
+static void testStarvation(void)
+{
+   uint_t i;
+   uint_t n;
+   pthread_t thread;
+
+   pthread_barrier_init(&barrier, NULL, 2);
+   pthread_create(&thread, NULL, idleTask, NULL);
+
+   //Wait for the helper task to fill its cache
+   pthread_barrier_wait(&barrier);
+
+   //Allocate as many blocks as possible
+   for(n = 0; n < NET_MEM_POOL_BUFFER_COUNT; n++)
+   {
+      block[n] = memPoolAlloc(100);
+      if(block[n] == NULL)
+         break;
+   }
+
+   //Let the helper task honor the flush request
+   pthread_barrier_wait(&barrier);
+   pthread_barrier_wait(&barrier);
+
+   //The rest of the pool is now available
+   for(; n < NET_MEM_POOL_BUFFER_COUNT; n++)
+   {
+      block[n] = memPoolAlloc(100);
+      TEST_CHECK(block[n] != NULL);
+   }
+
+   //Release all the blocks
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+      memPoolFree(block[i]);
+
+   //Let the helper task exit
+   pthread_barrier_wait(&barrier);
+   pthread_join(thread, NULL);
+
+   //Release the cache of the main task
+   memPoolFlushCache(NULL);
+   TEST_CHECK(getUsage() == 0);
+   pthread_barrier_destroy(&barrier);
+}
+
+
+/**
+ * @brief Compare the free list against the reference allocator
+ *
+ * The worst case for the linear scan is a pool where all the blocks but
+ * the last one are in use
+ **/
+
+static void benchAlloc(void)
+{
+   uint_t i;
+   uint_t k;
+   uint_t n;
+   void *p;
+   double t0;
+   double t1;
+   double t2;
+
+   //Benchmark an empty pool and an almost exhausted pool
+   for(k = 0; k < 2; k++)
+   {
+      //Number of blocks held during the run
+      n = (k == 0) ? 0 : NET_MEM_POOL_BUFFER_COUNT - 1;
+
+      //Hold blocks in both allocators
+      for(i = 0; i < n; i++)
+      {
+         block[i] = memPoolAlloc(100);
+         refAllocTable[i] = TRUE;
+      }
+
+      //Free list
+      t0 = testGetTime();
+      for(i = 0; i < BENCH_ITERATIONS; i++)
+      {
+         p = memPoolAlloc(100);
+         memPoolFree(p);
+      }
+
+      //Linear scan
+      t1 = testGetTime();
+      for(i = 0; i < BENCH_ITERATIONS; i++)
+      {
+         p = refAlloc();
+         refFree(p);
+      }
+      t2 = testGetTime();
+
+      //Display results
+      printf("   %u/%u blocks in use: free list %.1f ns, linear scan %.1f ns per alloc/free\n",
+         n, NET_MEM_POOL_BUFFER_COUNT, (t1 - t0) / BENCH_ITERATIONS,
+         (t2 - t1) / BENCH_ITERATIONS);
+
+      //Release the blocks
+      for(i = 0; i < n; i++)
+      {
+         memPoolFree(block[i]);
+         refAllocTable[i] = FALSE;
+      }
+   }
+}
+
+
+/**
+ * @brief Measure the throughput of the pool shared by several tasks
+ **/
+
+static void benchConcurrent(void)
+{
+   uint_t i;
+   uint_t hits;
+   uint_t misses;
+   double t0;
+   pthread_t thread[TASK_COUNT];
+
+   t0 = testGetTime();
+
+   //Start the tasks
+   for(i = 0; i < TASK_COUNT; i++)
+      pthread_create(&thread[i], NULL, concurrentTask, (void *) (uintptr_t) (i + 1));
+
+   //Wait for the tasks to complete
+   for(i = 0; i < TASK_COUNT; i++)
+      pthread_join(thread[i], NULL);
+
+   //Get cache statistics
+   memPoolGetCacheStats(&hits, &misses, NULL);
+
+   //Display results
+   printf("   %u tasks: %.1f ms, cache hits %u, misses %u\n", TASK_COUNT,
+      (testGetTime() - t0) / 1e6, hits, misses);
+}
+
+
+int main(void)
+{
+   //Initialize the memory pool and the reference allocator
+   if(memPoolInit() || !osCreateMutex(&refMutex))
+      return 1;
+
+   TEST_RUN(testAllocAll);
+   TEST_RUN(testDoubleFree);
+   TEST_RUN(testForeignPointer);
+   TEST_RUN(testHold);
+   TEST_RUN(testConcurrent);
+   TEST_RUN(testStarvation);
+
+   //Run benchmark
+   benchAlloc();
+   benchConcurrent();
+
+   return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,276 @@
+/**
+ * @file test_nic_tx_ring.c
+ * @brief TX descriptor ring reclaim, against a simulated DMA
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include "core/net.h"
+#include "core/nic.h"
+#include "test_common.h"
+
+//Number of simulated descriptors
+#define RING_SIZE 5
+
+//Simulated OWN bits
+static bool_t dmaOwned[RING_SIZE];
+//Descriptor ring under test
+static NicTxRing ring;
+static void *heldBuffer[RING_SIZE][2];
+
+
+/**
+ * @brief Simulated OWN bit
+ * @param[in] index Index of the descriptor
+ * @return TRUE if the DMA owns the descriptor
+ **/
+
+static bool_t isOwned(uint_t index)
+{
+   return dmaOwned[index];
+}
+
+
+/**
+ * @brief Number of memory pool blocks in use
+ * @return Current usage
+ **/
+
+static uint_t getPoolUsage(void)
+{
+   uint_t currentUsage;
+   uint_t maxUsage;
+   uint_t size;
+
+   memPoolGetStats(&currentUsage, &maxUsage, &size);
+   return currentUsage;
+}
+
+
+/**
+ * @brief Queue a frame the way a zero-copy driver does
+ *
+ * Each chunk lives in its own memory pool block, as the upper layers
+ * build it. The driver holds every block, hands the descriptors to the
+ * DMA, and the upper layers release their own references right away
+ *
+ * @param[in] chunkCount Number of chunks of the frame
+ * @return Number of descriptors used, or 0 if the ring is full
+ **/
+
+static uint_t sendFrame(uint_t chunkCount)
+{
+   uint_t i;
+   uint_t n;
+   void *p[2 * RING_SIZE];
+
+   //Blocks owned by the upper layers
+   for(i = 0; i < chunkCount; i++)
+      p[i] = memPoolAlloc(NET_MEM_POOL_BUFFER_SIZE);
+
+   //Attach the chunks to the free DMA buffers
+   for(i = 0; i < chunkCount; i++)
+   {
+      if(i >= nicTxRingGetFreeCount(&ring) * 2 || !memPoolHold(p[i]))
+      {
+         //Drop the references taken so far
+         nicTxRingDetachBuffers(&ring, i);
+         break;
+      }
+
+      nicTxRingAttachBuffer(&ring, i, p[i]);
+   }
+
+   //Number of descriptors used by the frame
+   n = (i == chunkCount) ? (chunkCount + 1) / 2 : 0;
+
+   //Hand the descriptors to the DMA
+   for(i = 0; i < n; i++)
+      dmaOwned[(ring.curIndex + i) % RING_SIZE] = TRUE;
+   nicTxRingCommit(&ring, n);
+
+   //The upper layers release the buffer as soon as the send returns
+   for(i = 0; i < chunkCount; i++)
+      memPoolFree(p[i]);
+
+   return n;
+}
+
+
+/**
+ * @brief Let the simulated DMA process some descriptors
+ * @param[in] count Number of descriptors to process
+ **/
+
+static void dmaProcess(uint_t count)
+{
+   uint_t i;
+   uint_t index;
+
+   //The DMA processes the descriptors in ring order
+   for(i = 0, index = ring.dirtyIndex; i < ring.size && count > 0; i++)
+   {
+      if(dmaOwned[index])
+      {
+         dmaOwned[index] = FALSE;
+         count--;
+      }
+
+      index = (index + 1) % ring.size;
+   }
+}
+
+
+/**
+ * @brief Partial completion of a multi-descriptor frame
+ **/
+
+static void testPartialCompletion(void)
+{
+   nicTxRingInit(&ring, heldBuffer, RING_SIZE);
+
+   //Five chunks span three descriptors
+   TEST_CHECK(sendFrame(5) == 3);
+   TEST_CHECK(nicTxRingGetFreeCount(&ring) == 2);
+   TEST_CHECK(getPoolUsage() == 5);
+
+   //Nothing has been transmitted yet
+   TEST_CHECK(nicTxRingReclaim(&ring, isOwned) == 0);
+
+   //The DMA has processed the first descriptor only
+   dmaProcess(1);
+   TEST_CHECK(nicTxRingReclaim(&ring, isOwned) == 1);
+   TEST_CHECK(ring.pendingCount == 2);
+   TEST_CHECK(getPoolUsage() == 3);
+
+   //A later descriptor completing first must not be reclaimed out of order
+   dmaOwned[(ring.dirtyIndex + 1) % RING_SIZE] = FALSE;
+   TEST_CHECK(nicTxRingReclaim(&ring, isOwned) == 0);
+   TEST_CHECK(getPoolUsage() == 3);
+
+   //The rest of the frame
+   dmaProcess(1);
+   TEST_CHECK(nicTxRingReclaim(&ring, isOwned) == 2);
+   TEST_CHECK(nicTxRingGetFreeCount(&ring) == RING_SIZE);
+   TEST_CHECK(getPoolUsage() == 0);
+}
+
+
+/**
+ * @brief A frame that does not fit drops the references it took
+ **/
+
+static void testRingFull(void)
+{
+   nicTxRingInit(&ring, heldBuffer, RING_SIZE);
+
+   //Four descriptors in use
+   TEST_CHECK(sendFrame(4) == 2);
+   TEST_CHECK(sendFrame(3) == 2);
+   TEST_CHECK(getPoolUsage() == 7);
+
+   //Three chunks need two descriptors while one is left
+   TEST_CHECK(sendFrame(3) == 0);
+   TEST_CHECK(nicTxRingGetFreeCount(&ring) == 1);
+   TEST_CHECK(getPoolUsage() == 7);
+   TEST_CHECK(heldBuffer[ring.curIndex][0] == NULL);
+   TEST_CHECK(heldBuffer[ring.curIndex][1] == NULL);
+
+   //Two chunks fit in the last descriptor
+   TEST_CHECK(sendFrame(2) == 1);
+   TEST_CHECK(nicTxRingGetFreeCount(&ring) == 0);
+   TEST_CHECK(sendFrame(1) == 0);
+
+   //Drain the ring
+   dmaProcess(RING_SIZE);
+   TEST_CHECK(nicTxRingReclaim(&ring, isOwned) == RING_SIZE);
+   TEST_CHECK(getPoolUsage() == 0);
+}
+
+
+/**
+ * @brief Random traffic wrapping around the ring many times
+ **/
+
+static void testWrapAround(void)
+{
+   uint_t i;
+   uint_t n;
+   uint_t sent;
+   uint_t reclaimed;
+   uint_t errors;
+
+   nicTxRingInit(&ring, heldBuffer, RING_SIZE);
+
+   //Number of inconsistencies
+   errors = 0;
+   sent = 0;
+   reclaimed = 0;
+
+   for(i = 0; i < 100000; i++)
+   {
+      //Queue a frame of 1 to 6 chunks
+      sent += sendFrame(1 + rand() % 6);
+
+      //The DMA makes random progress
+      dmaProcess(rand() % 3);
+
+      //Reclaim from the send path
+      n = nicTxRingReclaim(&ring, isOwned);
+      reclaimed += n;
+
+      //The bookkeeping must match the simulated ring
+      if(ring.pendingCount != sent - reclaimed)
+         errors++;
+      if(ring.curIndex != (ring.dirtyIndex + ring.pendingCount) % RING_SIZE)
+         errors++;
+      if(ring.pendingCount > 0 && !dmaOwned[ring.dirtyIndex])
+         errors++;
+   }
+
+   //Drain the ring
+   dmaProcess(RING_SIZE);
+   reclaimed += nicTxRingReclaim(&ring, isOwned);
+
+   TEST_CHECK(errors == 0);
+   TEST_CHECK(sent == reclaimed);
+   TEST_CHECK(sent > 1000 * RING_SIZE);
+   TEST_CHECK(getPoolUsage() == 0);
+}
+
+
+int main(void)
+{
+   //Initialize the memory pool
+   if(memPoolInit())
+      return 1;
+
+   TEST_RUN(testPartialCompletion);
+   TEST_RUN(testRingFull);
+   TEST_RUN(testWrapAround);
+
+   return TEST_EXIT_STATUS();
+}
@@ -0,0 +1,360 @@
+/**
+ * @file test_socket_hash.c
+ * @brief Socket demultiplexing tables (collisions, removal), with a benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include "core/net.h"
+#include "core/socket.h"
+#include "core/tcp.h"
+#include "core/tcp_misc.h"
+#include "test_common.h"
+
+//Local port of the connected sockets
+#define TEST_LOCAL_PORT 80
+
+//Sockets under test
+static Socket *sockets[SOCKET_MAX_COUNT];
+
+
+/**
+ * @brief Remote endpoint of the nth connection
+ *
+ * Consecutive pairs of connections share the same hash value: the remote
+ * port and the remote address differ by the same bit, which cancels out
+ * when both are folded into the hash
+ *
+ * @param[in] n Connection index
+ * @param[out] remoteIpAddr Remote IP address
+ * @param[out] remotePort Remote port number
+ **/
+
+static void getRemoteEndpoint(uint_t n, IpAddr *remoteIpAddr, uint16_t *remotePort)
+{
+   remoteIpAddr->length = sizeof(Ipv4Addr);
+   remoteIpAddr->ipv4Addr = IPV4_ADDR(10, 0, (n >> 8) & 0xFF, n & 0xFE) ^ (n & 1);
+   *remotePort = (uint16_t) (1024 + (n & ~1U)) ^ (n & 1);
+}
+
+
+/**
+ * @brief Look up a connected socket the way the TCP input path does
+ * @param[in] localPort Local port number
+ * @param[in] remoteIpAddr IP address of the remote host
+ * @param[in] remotePort Remote port number
+ * @return Matching socket, if any
+ **/
+
+static Socket *hashLookup(uint16_t localPort, const IpAddr *remoteIpAddr,
+   uint16_t remotePort)
+{
+   Socket *socket;
+
+   //Walk the relevant chain
+   for(socket = socketGetConnHashChain(localPort, remoteIpAddr, remotePort);
+      socket != NULL; socket = socket->hashNext)
+   {
+      if(socket->type == SOCKET_TYPE_STREAM &&
+         socket->localPort == localPort &&
+         socket->remotePort == remotePort &&
+         ipCompAddr(&socket->remoteIpAddr, remoteIpAddr))
+      {
+         break;
+      }
+   }
+
+   return socket;
+}
+
+
+/**
+ * @brief Look up a connected socket by scanning the socket table
+ * @param[in] localPort Local port number
+ * @param[in] remoteIpAddr IP address of the remote host
+ * @param[in] remotePort Remote port number
+ * @return Matching socket, if any
+ **/
+
+static Socket *linearLookup(uint16_t localPort, const IpAddr *remoteIpAddr,
+   uint16_t remotePort)
+{
+   uint_t i;
+   Socket *socket;
+
+   //Loop through the socket table
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      socket = &socketTable[i];
+
+      if(socket->type == SOCKET_TYPE_STREAM &&
+         socket->localPort == localPort &&
+         socket->remotePort == remotePort &&
+         ipCompAddr(&socket->remoteIpAddr, remoteIpAddr))
+      {
+         return socket;
+      }
+   }
+
+   return NULL;
+}
+
+
+/**
+ * @brief Fill the socket table with connected TCP sockets
+ **/
+
+static void openAll(void)
+{
+   uint_t i;
+   IpAddr remoteIpAddr;
+   uint16_t remotePort;
+
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      sockets[i] = socketOpen(SOCKET_TYPE_STREAM, SOCKET_IP_PROTO_TCP);
+      TEST_CHECK(sockets[i] != NULL);
+      if(sockets[i] == NULL)
+         return;
+
+      //Bind the socket to a connection, as tcpConnect does, without
+      //leaving the CLOSED state so that no segment is ever sent
+      getRemoteEndpoint(i, &remoteIpAddr, &remotePort);
+      osAcquireMutex(&netMutex);
+      sockets[i]->localPort = TEST_LOCAL_PORT;
+      sockets[i]->remoteIpAddr = remoteIpAddr;
+      sockets[i]->remotePort = remotePort;
+      socketUpdateHashEntry(sockets[i]);
+      osReleaseMutex(&netMutex);
+   }
+
+   //The table is full
+   TEST_CHECK(socketOpen(SOCKET_TYPE_STREAM, SOCKET_IP_PROTO_TCP) == NULL);
+}
+
+
+/**
+ * @brief Every socket is found, colliding pairs included
+ **/
+
+static void testLookup(void)
+{
+   uint_t i;
+   uint_t errors;
+   IpAddr remoteIpAddr;
+   uint16_t remotePort;
+
+   //Number of mismatches
+   errors = 0;
+
+   openAll();
+
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      getRemoteEndpoint(i, &remoteIpAddr, &remotePort);
+
+      //Colliding pairs must land in the same bucket
+      if((i & 1) && sockets[i]->hashBucket != sockets[i - 1]->hashBucket)
+         errors++;
+
+      if(hashLookup(TEST_LOCAL_PORT, &remoteIpAddr, remotePort) != sockets[i])
+         errors++;
+   }
+
+   //Unknown connection
+   getRemoteEndpoint(SOCKET_MAX_COUNT + 2, &remoteIpAddr, &remotePort);
+   if(hashLookup(TEST_LOCAL_PORT, &remoteIpAddr, remotePort) != NULL)
+      errors++;
+
+   TEST_CHECK(errors == 0);
+}
+
+
+/**
+ * @brief Closed sockets are unlinked and their neighbours are still found
+ **/
+
+static void testClose(void)
+{
+   uint_t i;
+   uint_t errors;
+   Socket *socket;
+   IpAddr remoteIpAddr;
+   uint16_t remotePort;
+
+   //Number of mismatches
+   errors = 0;
+
+   //Close one socket of each colliding pair, alternately the first
+   //and the second one, so that both heads and tails are removed
+   for(i = 0; i < SOCKET_MAX_COUNT; i += 2)
+      socketClose(sockets[i + ((i >> 1) & 1)]);
+
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      getRemoteEndpoint(i, &remoteIpAddr, &remotePort);
+      socket = hashLookup(TEST_LOCAL_PORT, &remoteIpAddr, remotePort);
+
+      //Closed socket?
+      if(i == (i & ~1U) + ((i >> 1) & 1))
+      {
+         if(socket != NULL || sockets[i]->hashBucket != NULL)
+            errors++;
+      }
+      else
+      {
+         if(socket != sockets[i])
+            errors++;
+      }
+   }
+
+   //No closed socket may still be linked
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      if(sockets[i]->type == SOCKET_TYPE_UNUSED &&
+         (sockets[i]->hashBucket != NULL || sockets[i]->hashNext != NULL))
+      {
+         errors++;
+      }
+   }
+
+   //Reuse the freed descriptors for new connections
+   for(i = 0; i < SOCKET_MAX_COUNT / 2; i++)
+   {
+      socket = socketOpen(SOCKET_TYPE_STREAM, SOCKET_IP_PROTO_TCP);
+      if(socket == NULL)
+      {
+         errors++;
+         break;
+      }
+
+      getRemoteEndpoint(SOCKET_MAX_COUNT + i, &remoteIpAddr, &remotePort);
+      osAcquireMutex(&netMutex);
+      socket->localPort = TEST_LOCAL_PORT;
+      socket->remoteIpAddr = remoteIpAddr;
+      socket->remotePort = remotePort;
+      socketUpdateHashEntry(socket);
+      osReleaseMutex(&netMutex);
+
+      if(hashLookup(TEST_LOCAL_PORT, &remoteIpAddr, remotePort) != socket)
+         errors++;
+   }
+
+   TEST_CHECK(errors == 0);
+
+   //Release every socket
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+      socketClose(&socketTable[i]);
+
+   //The demultiplexing tables are empty
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      getRemoteEndpoint(i, &remoteIpAddr, &remotePort);
+      if(hashLookup(TEST_LOCAL_PORT, &remoteIpAddr, remotePort) != NULL)
+         errors++;
+   }
+
+   TEST_CHECK(errors == 0);
+}
+
+
+/**
+ * @brief Compare the hashed lookup with a scan of the socket table
+ **/
+
+static void benchLookup(void)
+{
+   uint_t i;
+   uint_t n;
+   uint_t found;
+   double t0;
+   double t1;
+   double t2;
+   IpAddr *remoteIpAddr;
+   uint16_t *remotePort;
+
+   openAll();
+
+   //Precompute the endpoints of the connections
+   remoteIpAddr = malloc(SOCKET_MAX_COUNT * sizeof(IpAddr));
+   remotePort = malloc(SOCKET_MAX_COUNT * sizeof(uint16_t));
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+      getRemoteEndpoint(i, &remoteIpAddr[i], &remotePort[i]);
+
+   //Number of lookups
+   n = 20000000 / SOCKET_MAX_COUNT;
+   n = MAX(n, 1000);
+   found = 0;
+
+   t0 = testGetTime();
+   for(i = 0; i < n; i++)
+   {
+      found += hashLookup(TEST_LOCAL_PORT, &remoteIpAddr[(i * 7) % SOCKET_MAX_COUNT],
+         remotePort[(i * 7) % SOCKET_MAX_COUNT]) != NULL;
+   }
+   t1 = testGetTime();
+   for(i = 0; i < n; i++)
+   {
+      found += linearLookup(TEST_LOCAL_PORT, &remoteIpAddr[(i * 7) % SOCKET_MAX_COUNT],
+         remotePort[(i * 7) % SOCKET_MAX_COUNT]) != NULL;
+   }
+   t2 = testGetTime();
+
+   TEST_CHECK(found == 2 * n);
+
+   //Display results
+   printf("   %u sockets, %u buckets: hash %.1f ns, linear scan %.1f ns per lookup\n",
+      SOCKET_MAX_COUNT, SOCKET_CONN_HASH_TABLE_SIZE, (t1 - t0) / n, (t2 - t1) / n);
+
+   free(remoteIpAddr);
+   free(remotePort);
+
+   //Release every socket
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+      socketClose(&socketTable[i]);
+}
+
+
+int main(void)
+{
+   //Initialize the stack modules under test
+   if(!osCreateMutex(&netMutex))
+      return 1;
+   if(memPoolInit())
+      return 1;
+   if(socketInit())
+      return 1;
+   if(tcpInit())
+      return 1;
+
+   TEST_RUN(testLookup);
+   TEST_RUN(testClose);
+
+   //Run benchmark
+   benchLookup();
+
+   return TEST_EXIT_STATUS();
+}
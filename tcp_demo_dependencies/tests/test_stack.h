@@ -0,0 +1,326 @@
+/**
+ * @file test_stack.h
+ * @brief Two interfaces of the stack connected by the loopback driver
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+#ifndef _TEST_STACK_H
+#define _TEST_STACK_H
+
+//Dependencies
+#include <pthread.h>
+#include "core/net.h"
+#include "core/socket.h"
+#include "ipv4/ipv4.h"
+#include "drivers/loopback_driver.h"
+
+//Address of the first interface (client side)
+#define TEST_CLIENT_ADDR IPV4_ADDR(10, 0, 0, 1)
+//Address of the second interface (server side)
+#define TEST_SERVER_ADDR IPV4_ADDR(10, 0, 0, 2)
+
+//Client and server interfaces
+#define testClientInterface (&netInterface[0])
+#define testServerInterface (&netInterface[1])
+
+
+/**
+ * @brief Bulk transfer parameters
+ **/
+
+typedef struct
+{
+   Socket *socket;
+   size_t length;
+   error_t error;
+} TestSender;
+
+
+/**
+ * @brief Start the stack with two interfaces connected back to back
+ * @return Error code
+ **/
+
+static inline error_t testStackInit(void)
+{
+   error_t error;
+   uint_t i;
+   MacAddr macAddr;
+   NetInterface *interface;
+
+   //Start the TCP/IP stack
+   error = netInit();
+   if(error)
+      return error;
+
+   //Each frame sent by one interface is received by the other one
+   loopbackDriverConnect(testClientInterface, testServerInterface);
+
+   //Configure both interfaces
+   for(i = 0; i < 2; i++)
+   {
+      interface = &netInterface[i];
+
+      //Locally administered MAC address
+      macAddr.b[0] = 0x02;
+      macAddr.b[1] = 0x00;
+      macAddr.b[2] = 0x00;
+      macAddr.b[3] = 0x00;
+      macAddr.b[4] = 0x00;
+      macAddr.b[5] = i + 1;
+
+      netSetMacAddr(interface, &macAddr);
+      netSetDriver(interface, &loopbackDriver);
+
+      error = netConfigInterface(interface);
+      if(error)
+         return error;
+
+      ipv4SetHostAddr(interface, (i == 0) ? TEST_CLIENT_ADDR : TEST_SERVER_ADDR);
+      ipv4SetSubnetMask(interface, IPV4_ADDR(255, 255, 255, 0));
+
+      //The link is always up
+      netSetLinkState(interface, NIC_LINK_STATE_UP);
+   }
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Connection request parameters
+ **/
+
+typedef struct
+{
+   Socket *socket;
+   uint16_t port;
+   error_t error;
+} TestConnector;
+
+
+/**
+ * @brief Connect to the server interface
+ *
+ * The SYN-ACK is only sent once the server accepts the connection, hence
+ * the connection request runs in its own thread
+ *
+ * @param[in] param Connection request parameters
+ * @return NULL
+ **/
+
+static inline void *testConnectTask(void *param)
+{
+   IpAddr addr;
+   TestConnector *connector;
+
+   connector = (TestConnector *) param;
+
+   //Establish the connection
+   addr.length = sizeof(Ipv4Addr);
+   addr.ipv4Addr = TEST_SERVER_ADDR;
+   connector->error = socketConnect(connector->socket, &addr, connector->port);
+
+   return NULL;
+}
+
+
+/**
+ * @brief Open a TCP connection between the two interfaces
+ * @param[in] port Server port
+ * @param[in] bufferSize TX and RX buffer size of both sockets (0 for default)
+ * @param[out] client Client socket
+ * @param[out] server Server socket
+ * @return Error code
+ **/
+
+static inline error_t testTcpOpen(uint16_t port, size_t bufferSize,
+   Socket **client, Socket **server)
+{
+   error_t error;
+   pthread_t thread;
+   Socket *listener;
+   TestConnector connector;
+
+   //No connection for the moment
+   *client = NULL;
+   *server = NULL;
+
+   //Listening socket on the server interface
+   listener = socketOpen(SOCKET_TYPE_STREAM, SOCKET_IP_PROTO_TCP);
+   if(listener == NULL)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Client socket on the client interface
+   *client = socketOpen(SOCKET_TYPE_STREAM, SOCKET_IP_PROTO_TCP);
+   if(*client == NULL)
+   {
+      socketClose(listener);
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //No error to report yet
+   error = NO_ERROR;
+
+   //Adjust buffer sizes before the connection is established
+   if(bufferSize != 0)
+   {
+      error = socketSetTxBufferSize(listener, bufferSize);
+      if(!error)
+         error = socketSetRxBufferSize(listener, bufferSize);
+      if(!error)
+         error = socketSetTxBufferSize(*client, bufferSize);
+      if(!error)
+         error = socketSetRxBufferSize(*client, bufferSize);
+   }
+
+   socketSetTimeout(listener, 5000);
+   socketSetTimeout(*client, 5000);
+   socketBindToInterface(listener, testServerInterface);
+   socketBindToInterface(*client, testClientInterface);
+
+   if(!error)
+      error = socketBind(listener, &IP_ADDR_ANY, port);
+   if(!error)
+      error = socketListen(listener, 1);
+
+   if(!error)
+   {
+      //Send the connection request
+      connector.socket = *client;
+      connector.port = port;
+      pthread_create(&thread, NULL, testConnectTask, &connector);
+
+      //Accept the connection
+      *server = socketAccept(listener, NULL, NULL);
+
+      //Wait for the connection to be established
+      pthread_join(thread, NULL);
+      error = connector.error;
+
+      if(*server == NULL)
+         error = ERROR_TIMEOUT;
+      else
+         socketSetTimeout(*server, 5000);
+   }
+
+   //The listening socket is no longer needed
+   socketClose(listener);
+
+   return error;
+}
+
+
+/**
+ * @brief Send a deterministic byte pattern
+ * @param[in] param Bulk transfer parameters
+ * @return NULL
+ **/
+
+static inline void *testSenderTask(void *param)
+{
+   size_t i;
+   size_t n;
+   size_t written;
+   uint8_t data[1000];
+   TestSender *sender;
+
+   sender = (TestSender *) param;
+   sender->error = NO_ERROR;
+
+   for(i = 0; i < sender->length && !sender->error; i += written)
+   {
+      //Byte k of the stream is k modulo 251
+      for(n = 0; n < sizeof(data); n++)
+         data[n] = (i + n) % 251;
+
+      n = MIN(sizeof(data), sender->length - i);
+      sender->error = socketSend(sender->socket, data, n, &written, 0);
+   }
+
+   //Send a FIN once all the data has been queued
+   if(!sender->error)
+      sender->error = socketShutdown(sender->socket, SOCKET_SD_SEND);
+
+   return NULL;
+}
+
+
+/**
+ * @brief Transfer data from the client to the server and check it
+ * @param[in] client Client socket
+ * @param[in] server Server socket
+ * @param[in] length Number of bytes to transfer
+ * @param[out] received Number of bytes received in order
+ * @return Number of corrupted bytes, or -1 if the transfer failed
+ **/
+
+static inline int_t testTcpTransfer(Socket *client, Socket *server,
+   size_t length, size_t *received)
+{
+   int_t errors;
+   size_t i;
+   size_t n;
+   error_t error;
+   pthread_t thread;
+   TestSender sender;
+   uint8_t data[1500];
+
+   //Start sending data
+   sender.socket = client;
+   sender.length = length;
+   pthread_create(&thread, NULL, testSenderTask, &sender);
+
+   errors = 0;
+   *received = 0;
+
+   //Receive data until the sender closes the connection
+   while(1)
+   {
+      error = socketReceive(server, data, sizeof(data), &n, 0);
+      if(error)
+         break;
+
+      //Check the pattern
+      for(i = 0; i < n; i++)
+      {
+         if(data[i] != (*received + i) % 251)
+            errors++;
+      }
+
+      *received += n;
+   }
+
+   pthread_join(thread, NULL);
+
+   //The connection must end with a FIN after the whole stream
+   if(error != ERROR_END_OF_STREAM || sender.error || *received != length)
+      return -1;
+
+   return errors;
+}
+
+#endif
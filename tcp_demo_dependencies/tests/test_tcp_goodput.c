@@ -0,0 +1,226 @@
+/**
+ * @file test_tcp_goodput.c
+ * @brief Bulk transfer goodput under random losses, with or without SACK
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include <stdio.h>
+#include "core/net.h"
+#include "core/tcp.h"
+#include "test_stack.h"
+#include "test_common.h"
+
+//Amount of data transferred by the test
+#define TRANSFER_SIZE 1000000
+//Socket buffer size (16 full-sized segments in flight)
+#define BUFFER_SIZE 22880
+
+
+/**
+ * @brief Loss process
+ **/
+
+typedef struct
+{
+   uint32_t seed;
+   uint_t rate;
+   uint_t dataCount;
+   uint_t lostCount;
+} LossProcess;
+
+
+/**
+ * @brief Number of memory pool blocks in use
+ * @return Current usage
+ **/
+
+static uint_t getPoolUsage(void)
+{
+   uint_t currentUsage;
+   uint_t maxUsage;
+   uint_t size;
+
+   memPoolGetStats(&currentUsage, &maxUsage, &size);
+   return currentUsage;
+}
+
+
+/**
+ * @brief Drop TCP data segments at random
+ *
+ * The pseudo-random sequence is fixed, so that both builds of the test
+ * see the same losses for the same transmissions
+ *
+ * @param[in] interface Sending interface
+ * @param[in] frame Ethernet frame
+ * @param[in] length Length of the frame
+ * @param[in] param Loss process
+ * @return TRUE if the frame must be lost
+ **/
+
+static bool_t dropRandomSegments(NetInterface *interface,
+   uint8_t *frame, size_t length, void *param)
+{
+   LossProcess *loss;
+
+   //Only full-sized frames carry bulk data
+   if(length < 1000)
+      return FALSE;
+
+   //Linear congruential generator
+   loss = (LossProcess *) param;
+   loss->seed = loss->seed * 1103515245 + 12345;
+   loss->dataCount++;
+
+   //Drop the segment with the requested probability (in percent)
+   if(((loss->seed >> 16) % 100) >= loss->rate)
+      return FALSE;
+
+   loss->lostCount++;
+   return TRUE;
+}
+
+
+/**
+ * @brief Transfer data over a lossy link and report the goodput
+ * @param[in] port Server port
+ * @param[in] rate Loss rate of the data segments, in percent
+ **/
+
+static void checkGoodput(uint16_t port, uint_t rate)
+{
+   uint_t i;
+   error_t error;
+   int_t errors;
+   uint_t usage;
+   size_t received;
+   double t0;
+   double t1;
+   Socket *client;
+   Socket *server;
+   LossProcess loss;
+
+   //Memory pool usage while idle
+   usage = getPoolUsage();
+
+   //Connect the two interfaces over a lossless link
+   error = testTcpOpen(port, BUFFER_SIZE, &client, &server);
+   TEST_CHECK(error == NO_ERROR);
+   if(error)
+      return;
+
+   //A retransmission that is lost again backs the RTO off, possibly
+   //beyond the default timeout of the sockets
+   socketSetTimeout(client, 60000);
+   socketSetTimeout(server, 60000);
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //Both ends must have agreed to use SACK
+   TEST_CHECK(client->sackPermitted);
+   TEST_CHECK(server->sackPermitted);
+#endif
+
+   //Start losing data segments
+   loss.seed = port;
+   loss.rate = rate;
+   loss.dataCount = 0;
+   loss.lostCount = 0;
+   loopbackDriverSetLossHook(testClientInterface, dropRandomSegments, &loss);
+
+   t0 = testGetTime();
+   errors = testTcpTransfer(client, server, TRANSFER_SIZE, &received);
+   t1 = testGetTime();
+
+   //The stream must be received intact
+   TEST_CHECK(errors == 0);
+   TEST_CHECK(received == TRANSFER_SIZE);
+   //The link must actually have been lossy
+   TEST_CHECK(rate == 0 || loss.lostCount > 0);
+
+   //The loss hook must not outlive the test
+   loopbackDriverSetLossHook(testClientInterface, NULL, NULL);
+
+   //Display results
+   printf("   SACK %s, %u%% loss: %u of %u data segments lost, "
+      "goodput %.2f Mbit/s (%.2f s)\n",
+      (TCP_SACK_SUPPORT == ENABLED) ? "on" : "off", rate, loss.lostCount,
+      loss.dataCount, received * 8 * 1e3 / (t1 - t0), (t1 - t0) / 1e9);
+
+   //Close both ends
+   socketClose(server);
+   socketClose(client);
+
+   //Let the last segments go through
+   for(i = 0; i < 100 && getPoolUsage() != usage; i++)
+      testSleep(50);
+
+   //No buffer may leak
+   TEST_CHECK(getPoolUsage() == usage);
+}
+
+
+/**
+ * @brief Lossless reference transfer
+ **/
+
+static void testNoLoss(void)
+{
+   checkGoodput(80, 0);
+}
+
+
+/**
+ * @brief Isolated losses
+ **/
+
+static void testLowLoss(void)
+{
+   checkGoodput(81, 1);
+}
+
+
+/**
+ * @brief Several losses per window
+ **/
+
+static void testHighLoss(void)
+{
+   checkGoodput(82, 5);
+}
+
+
+int main(void)
+{
+   //Start the stack with two interfaces connected back to back
+   if(testStackInit())
+      return 1;
+
+   TEST_RUN(testNoLoss);
+   TEST_RUN(testLowLoss);
+   TEST_RUN(testHighLoss);
+
+   return TEST_EXIT_STATUS();
+}
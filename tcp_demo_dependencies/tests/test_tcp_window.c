@@ -0,0 +1,204 @@
+/**
+ * @file test_tcp_window.c
+ * @brief Window scale negotiation, over the loopback driver
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2017 Oryx Embedded SARL. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded SARL (www.oryx-embedded.com)
+ * @version 1.7.8
+ **/
+
+//Dependencies
+#include "core/net.h"
+#include "core/tcp.h"
+#include "core/tcp_misc.h"
+#include "test_stack.h"
+#include "test_common.h"
+
+//Size of the send and receive buffers (above the 16-bit window field)
+#define BUFFER_SIZE 100000
+//Amount of data transferred by each test
+#define TRANSFER_SIZE 1000000
+
+
+/**
+ * @brief Remove the Window Scale option from outgoing SYN segments
+ *
+ * The option is overwritten with NOP options, as a peer that does not
+ * implement window scaling would send
+ *
+ * @param[in] interface Sending interface
+ * @param[in] frame Ethernet frame
+ * @param[in] length Length of the frame
+ * @param[in] param Unused parameter
+ * @return FALSE (the frame is never lost)
+ **/
+
+static bool_t stripWindowScale(NetInterface *interface,
+   uint8_t *frame, size_t length, void *param)
+{
+   size_t n;
+   EthHeader *ethHeader;
+   Ipv4Header *ipHeader;
+   TcpHeader *segment;
+   TcpOption *option;
+   Ipv4PseudoHeader pseudoHeader;
+
+   //Point to the headers
+   ethHeader = (EthHeader *) frame;
+   ipHeader = (Ipv4Header *) ethHeader->data;
+
+   //Only TCP segments over IPv4 are of interest
+   if(ntohs(ethHeader->type) != ETH_TYPE_IPV4 ||
+      ipHeader->protocol != IPV4_PROTOCOL_TCP)
+   {
+      return FALSE;
+   }
+
+   //Point to the TCP header
+   segment = (TcpHeader *) ((uint8_t *) ipHeader + ipHeader->headerLength * 4);
+   n = ntohs(ipHeader->totalLength) - ipHeader->headerLength * 4;
+
+   //Only SYN segments carry the option
+   if(!(segment->flags & TCP_FLAG_SYN))
+      return FALSE;
+
+   //Search the TCP header for the Window Scale option
+   option = tcpGetOption(segment, TCP_OPTION_WINDOW_SCALE_FACTOR);
+   if(option == NULL)
+      return FALSE;
+
+   //Replace the option with NOP options
+   memset(option, TCP_OPTION_NOP, option->length);
+
+   //Recompute the checksum of the segment
+   pseudoHeader.srcAddr = ipHeader->srcAddr;
+   pseudoHeader.destAddr = ipHeader->destAddr;
+   pseudoHeader.reserved = 0;
+   pseudoHeader.protocol = IPV4_PROTOCOL_TCP;
+   pseudoHeader.length = htons(n);
+
+   segment->checksum = 0;
+   segment->checksum = ipCalcUpperLayerChecksum(&pseudoHeader,
+      sizeof(Ipv4PseudoHeader), segment, n);
+
+   //Deliver the modified frame
+   return FALSE;
+}
+
+
+/**
+ * @brief Open a connection and check the windows negotiated by the handshake
+ * @param[in] port Server port
+ * @param[in] scaled Window scaling is expected to be in effect
+ **/
+
+static void checkHandshake(uint16_t port, bool_t scaled)
+{
+   uint_t i;
+   int_t errors;
+   error_t error;
+   size_t received;
+   uint8_t shift;
+   Socket *client;
+   Socket *server;
+
+   //Shift count expected for the buffers
+   shift = scaled ? tcpGetWindowShift(BUFFER_SIZE) : 0;
+
+   //Connect the two interfaces
+   error = testTcpOpen(port, BUFFER_SIZE, &client, &server);
+   TEST_CHECK(error == NO_ERROR);
+   if(error)
+      return;
+
+   //Both ends must agree on window scaling
+   TEST_CHECK(client->wndScaleEnabled == scaled);
+   TEST_CHECK(server->wndScaleEnabled == scaled);
+   TEST_CHECK(client->rcvWndShift == shift);
+   TEST_CHECK(client->sndWndShift == shift);
+   TEST_CHECK(server->rcvWndShift == shift);
+   TEST_CHECK(server->sndWndShift == shift);
+
+   //The window of the SYN-ACK is never scaled, and the 16-bit
+   //field cannot advertise the whole buffer
+   TEST_CHECK(client->sndWnd == UINT16_MAX);
+
+   //The ACK that completes the handshake carries a scaled window
+   for(i = 0; i < 100 && server->state != TCP_STATE_ESTABLISHED; i++)
+      testSleep(10);
+
+   if(scaled)
+      TEST_CHECK(server->sndWnd == ((BUFFER_SIZE >> shift) << shift));
+   else
+      TEST_CHECK(server->sndWnd == UINT16_MAX);
+
+   //Bulk transfer
+   errors = testTcpTransfer(client, server, TRANSFER_SIZE, &received);
+   TEST_CHECK(errors == 0);
+   TEST_CHECK(received == TRANSFER_SIZE);
+
+   //The client has now seen the scaled windows of the server
+   if(scaled)
+      TEST_CHECK(client->maxSndWnd > UINT16_MAX);
+   else
+      TEST_CHECK(client->maxSndWnd == UINT16_MAX);
+
+   //Close both ends
+   socketClose(server);
+   socketClose(client);
+}
+
+
+/**
+ * @brief Both ends send the Window Scale option
+ **/
+
+static void testScaled(void)
+{
+   checkHandshake(80, TRUE);
+}
+
+
+/**
+ * @brief The client talks to a peer that does not support window scaling
+ **/
+
+static void testUnscaled(void)
+{
+   //The server does not see the option in the SYN
+   loopbackDriverSetLossHook(testClientInterface, stripWindowScale, NULL);
+   checkHandshake(81, FALSE);
+   loopbackDriverSetLossHook(testClientInterface, NULL, NULL);
+}
+
+
+int main(void)
+{
+   //Start the stack
+   if(testStackInit())
+      return 1;
+
+   TEST_RUN(testScaled);
+   TEST_RUN(testUnscaled);
+
+   return TEST_EXIT_STATUS();
+}